@@ -0,0 +1,26 @@
+#!/bin/sh
+#
+# bench/run.sh -- run the scripting benchmarks and collect the results
+#
+# Usage: bench/run.sh [path-to-epic5] [case ...]
+#
+# Each case is run in its own client with -T so that the peak RSS in its
+# "bench_summary" line belongs to that case alone.  Only the "bench" and
+# "bench_summary" lines are printed, so the output can be diffed or fed
+# to another program.
+#
+
+BENCH=`dirname "$0"`
+EPIC=${1:-$BENCH/../source/epic5}
+[ $# -gt 0 ] && shift
+case "$EPIC" in
+	/*)	;;
+	*)	EPIC=`pwd`/$EPIC ;;
+esac
+
+cd "$BENCH" || exit 1
+CASES=${*:-"alias expr arrays words hooks output match"}
+
+for c in $CASES; do
+	"$EPIC" -n bench -T "$c.irc" < /dev/null 2>/dev/null | grep '^bench'
+done
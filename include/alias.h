@@ -74,6 +74,8 @@
 
 	void 	add_var_alias      	(Char *name, Char *stuff, int noisy);
 	void 	add_local_alias    	(Char *name, Char *stuff, int noisy);
+	void	begin_var_alias_batch	(void);
+	void	end_var_alias_batch	(void);
 #if 0	/* Internal now */
 	void 	add_cmd_alias 	   	(void);
 #endif
@@ -99,6 +101,7 @@
                                                         const char *));
 	const char *  get_func_alias	(const char *name, void **args, 
 					 char * (**func) (char *));
+	const char *  get_cmd_alias_package (const char *name);
 	const char *  get_var_alias	(const char *name, 
 					 char *(**efunc)(void), 
 					 IrcVariable **var);
@@ -235,12 +238,14 @@ struct ArgListT {
 	enum	ARG_TYPES types[32];
 	int	void_flag;
 	int	dot_flag;
+	int	refcnt;		/* ArgLists are immutable; share, don't clone */
 };
 typedef struct ArgListT ArgList;
 extern ArgList *parse_arglist (char *arglist);
 extern void	destroy_arglist (ArgList **);
 extern char *	print_arglist (ArgList *);
 extern ArgList *clone_arglist (ArgList *);
+extern ArgList *share_arglist (ArgList *);
 #endif
 
 	void	flush_all_symbols (void);
@@ -96,6 +96,7 @@ typedef struct
 } alist;
 
 void *	add_to_alist 		(alist *, const char *, void *);
+void	add_many_to_alist	(alist *, int, char **, void **);
 void *	remove_from_alist 	(alist *, const char *);
 void *	alist_lookup 		(alist *, const char *, int, int);
 void *	find_alist_item 	(alist *, const char *, int *, int *);
@@ -14,6 +14,13 @@ typedef struct an_array_struct {
         long *index;
         long size;
 	int  unsorted;
+	struct array_node **node;
+	struct array_node *root;
+	long capacity;
+	int  index_valid;
+	long walks;
+	long stamp;
+	long stale;
 } an_array;
 
 	char *	function_indextoitem	(char *);
@@ -33,6 +33,8 @@ extern	int	need_defered_commands;
 	int     parse_statement 	(const char *, int, const char *);
 
 	BUILT_IN_COMMAND(load);
+	void	load_prefetch		(const char *);
+	void	load_prefetch_done	(void);
 	void	send_text	 	(int, const char *, const char *, const char *, int, int);
 	int	redirect_text		(int, const char *, const char *, char *, int);
 	int	command_exist		(char *);
@@ -188,6 +188,8 @@
 #define DEFAULT_HIDE_PRIVATE_CHANNELS 0
 #define DEFAULT_HIGHLIGHT_CHAR "BOLD"
 #define DEFAULT_HIGH_BIT_ESCAPE 2
+#define DEFAULT_HISTORY_DIR NULL
+#define DEFAULT_HISTORY_LEVEL "PUBLICS MSGS NOTICES ACTIONS"
 #define DEFAULT_HOLD_SLIDER 100
 #define DEFAULT_INDENT 0
 #define DEFAULT_INPUT_INDICATOR_LEFT "+ "
@@ -0,0 +1,14 @@
+/*
+ * container.h -- header file for container.c
+ *
+ * Copyright 2026 EPIC Software Labs
+ * See the COPYRIGHT file for copyright information
+ */
+
+#ifndef __container_h__
+#define __container_h__
+
+	char *	listctl			(char *);
+	char *	dictctl			(char *);
+
+#endif
@@ -0,0 +1,461 @@
+/* include/defs.h.  Generated from defs.h.in by configure.  */
+/* include/defs.h.in.  Generated from configure.in by autoheader.  */
+
+/* Define to 1 if using 'alloca.c'. */
+/* #undef C_ALLOCA */
+
+/* Define if <term.h> should be avoided */
+/* #undef DONT_USE_TERM_H */
+
+/* Define this if ipv6 was forbidden by user */
+/* #undef DO_NOT_USE_IPV6 */
+
+/* Define this if your getaddrinfo() does not support AF_UNIX */
+#define GETADDRINFO_DOES_NOT_DO_AF_UNIX 1
+
+/* Define to 1 if you have 'alloca', as a function or macro. */
+#define HAVE_ALLOCA 1
+
+/* Define to 1 if <alloca.h> works. */
+#define HAVE_ALLOCA_H 1
+
+/* Define if you can use __attribute__((fallthrough)) */
+#define HAVE_ATTRIBUTE_FALLTHROUGH 1
+
+/* Define if you can use __attribute__((may_alias)) */
+#define HAVE_ATTRIBUTE_MAY_ALIAS 1
+
+/* Define this if your realpath() doesn't work for nonexistant files */
+#define HAVE_BROKEN_REALPATH 1
+
+/* Define if you have clock_gettime() */
+#define HAVE_CLOCK_GETTIME 1
+
+/* Define if you have crypt() */
+#define HAVE_CRYPT 1
+
+/* Define to 1 if you have the <dirent.h> header file, and it defines 'DIR'.
+   */
+#define HAVE_DIRENT_H 1
+
+/* Define if you have fchdir() */
+#define HAVE_FCHDIR 1
+
+/* Define to 1 if you have the <fcntl.h> header file. */
+#define HAVE_FCNTL_H 1
+
+/* Define if you have finite() */
+#define HAVE_FINITE 1
+
+/* Define if you have fpathconf() */
+#define HAVE_FPATHCONF 1
+
+/* Define if you have getaddrinfo() */
+#define HAVE_GETADDRINFO 1
+
+/* Define if you have getlogin() */
+#define HAVE_GETLOGIN 1
+
+/* Define if you have getnameinfo() */
+#define HAVE_GETNAMEINFO 1
+
+/* Define if you have getpass() */
+#define HAVE_GETPASS 1
+
+/* Define if you have getpgid() */
+#define HAVE_GETPGID 1
+
+/* Define if you have getservbyport() */
+#define HAVE_GETSERVBYPORT 1
+
+/* Define if you have gettimeofday() */
+#define HAVE_GETTIMEOFDAY 1
+
+/* Define this if you have a useful iconv() */
+#define HAVE_ICONV 1
+
+/* Define to 1 if the system has the type 'intmax_t'. */
+#define HAVE_INTMAX_T 1
+
+/* Define to 1 if the system has the type 'intptr_t'. */
+#define HAVE_INTPTR_T 1
+
+/* Define to 1 if you have the <inttypes.h> header file. */
+#define HAVE_INTTYPES_H 1
+
+/* Define if you have isfinite() */
+#define HAVE_ISFINITE 1
+
+/* Define if you have killpg() */
+#define HAVE_KILLPG 1
+
+/* Define this if you have a working libarchive */
+/* #undef HAVE_LIBARCHIVE */
+
+/* Define to 1 if you have the <locale.h> header file. */
+#define HAVE_LOCALE_H 1
+
+/* Define to 1 if the system has the type 'long long int'. */
+#define HAVE_LONG_LONG_INT 1
+
+/* Define to 1 if you have the <math.h> header file. */
+#define HAVE_MATH_H 1
+
+/* Define if you have have_memmove() */
+#define HAVE_MEMMOVE 1
+
+/* Define if you have nanosleep() */
+#define HAVE_NANOSLEEP 1
+
+/* Define to 1 if you have the <ndbm.h> header file. */
+/* #undef HAVE_NDBM_H */
+
+/* Define to 1 if you have the <ndir.h> header file, and it defines 'DIR'. */
+/* #undef HAVE_NDIR_H */
+
+/* Define to 1 if you have the <netdb.h> header file. */
+#define HAVE_NETDB_H 1
+
+/* Define if you have newlocale() */
+#define HAVE_NEWLOCALE 1
+
+/* Define this if you have perl */
+/* #undef HAVE_PERL */
+
+/* Define if you have pledge() */
+/* #undef HAVE_PLEDGE */
+
+/* Define this to support python */
+#define HAVE_PYTHON 1
+
+/* Define if you have realpath() */
+#define HAVE_REALPATH 1
+
+/* Define to 1 if you have the <regex.h> header file. */
+#define HAVE_REGEX_H 1
+
+/* Define this if you want to suppor ruby */
+#define HAVE_RUBY 1
+
+/* Define this if your struct sockaddr has a sa_len field */
+/* #undef HAVE_SA_LEN */
+
+/* Define if you have setenv() */
+#define HAVE_SETENV 1
+
+/* Define if you have setsid() */
+#define HAVE_SETSID 1
+
+/* Define if you have snprintf() */
+#define HAVE_SNPRINTF 1
+
+/* Define if you have socklen_t */
+#define HAVE_SOCKLEN_T 1
+
+/* Define this if you have SO_SNDLOWAT */
+/* #undef HAVE_SO_SNDLOWAT */
+
+/* Define this if you have a working ssl */
+#define HAVE_SSL 1
+
+/* Define to 1 if you have the <stdargs.h> header file. */
+/* #undef HAVE_STDARGS_H */
+
+/* Define to 1 if you have the <stddef.h> header file. */
+#define HAVE_STDDEF_H 1
+
+/* Define to 1 if you have the <stdint.h> header file. */
+#define HAVE_STDINT_H 1
+
+/* Define to 1 if you have the <stdio.h> header file. */
+#define HAVE_STDIO_H 1
+
+/* Define to 1 if you have the <stdlib.h> header file. */
+#define HAVE_STDLIB_H 1
+
+/* Define if you have strerror() */
+#define HAVE_STRERROR 1
+
+/* Define to 1 if you have the <strings.h> header file. */
+#define HAVE_STRINGS_H 1
+
+/* Define to 1 if you have the <string.h> header file. */
+#define HAVE_STRING_H 1
+
+/* Define if you have strlcat() */
+/* #undef HAVE_STRLCAT */
+
+/* Define if you have strlcpy() */
+/* #undef HAVE_STRLCPY */
+
+/* Define if you have strptime() */
+#define HAVE_STRPTIME 1
+
+/* Define if you have strtoul() */
+#define HAVE_STRTOUL 1
+
+/* Define if you have struct addrinfo */
+#define HAVE_STRUCT_ADDRINFO 1
+
+/* Define if you have struct sockaddr_in6 */
+#define HAVE_STRUCT_SOCKADDR_IN6 1
+
+/* Define if you have struct sockaddr_storage */
+#define HAVE_STRUCT_SOCKADDR_STORAGE 1
+
+/* Define if you have sysconf() */
+#define HAVE_SYSCONF 1
+
+/* Define to 1 if you have the <sys/cdefs.h> header file. */
+#define HAVE_SYS_CDEFS_H 1
+
+/* Define to 1 if you have the <sys/dir.h> header file, and it defines 'DIR'.
+   */
+/* #undef HAVE_SYS_DIR_H */
+
+/* Define to 1 if you have the <sys/file.h> header file. */
+#define HAVE_SYS_FILE_H 1
+
+/* Define to 1 if you have the <sys/filio.h> header file. */
+/* #undef HAVE_SYS_FILIO_H */
+
+/* Define to 1 if you have the <sys/ndir.h> header file, and it defines 'DIR'.
+   */
+/* #undef HAVE_SYS_NDIR_H */
+
+/* Define to 1 if you have the <sys/param.h> header file. */
+#define HAVE_SYS_PARAM_H 1
+
+/* Define to 1 if you have the <sys/select.h> header file. */
+#define HAVE_SYS_SELECT_H 1
+
+/* Define if you have sys_siglist */
+/* #undef HAVE_SYS_SIGLIST */
+
+/* Define to 1 if you have the <sys/stat.h> header file. */
+#define HAVE_SYS_STAT_H 1
+
+/* Define to 1 if you have the <sys/syslimits.h> header file. */
+/* #undef HAVE_SYS_SYSLIMITS_H */
+
+/* Define to 1 if you have the <sys/termios.h> header file. */
+#define HAVE_SYS_TERMIOS_H 1
+
+/* Define to 1 if you have the <sys/time.h> header file. */
+#define HAVE_SYS_TIME_H 1
+
+/* Define to 1 if you have the <sys/types.h> header file. */
+#define HAVE_SYS_TYPES_H 1
+
+/* Define to 1 if you have the <sys/un.h> header file. */
+#define HAVE_SYS_UN_H 1
+
+/* Define if you have tcsetpgrp() */
+#define HAVE_TCSETPGRP 1
+
+/* Define to 1 if you have the <termcap.h> header file. */
+/* #undef HAVE_TERMCAP_H */
+
+/* Define if you have terminfo() */
+#define HAVE_TERMINFO 1
+
+/* Define to 1 if you have the <termios.h> header file. */
+#define HAVE_TERMIOS_H 1
+
+/* Define to 1 if you have the <term.h> header file. */
+#define HAVE_TERM_H 1
+
+/* Define if you have tparm() */
+#define HAVE_TPARM 1
+
+/* Define to 1 if the system has the type 'uintmax_t'. */
+#define HAVE_UINTMAX_T 1
+
+/* Define if you have uname() */
+#define HAVE_UNAME 1
+
+/* Define to 1 if you have the <unistd.h> header file. */
+#define HAVE_UNISTD_H 1
+
+/* Define if you have unsetenv() */
+#define HAVE_UNSETENV 1
+
+/* Define to 1 if the system has the type 'unsigned long long int'. */
+#define HAVE_UNSIGNED_LONG_LONG_INT 1
+
+/* Define if you have unveil() */
+/* #undef HAVE_UNVEIL */
+
+/* Define to 1 if you have the <valgrind/memcheck.h> header file. */
+/* #undef HAVE_VALGRIND_MEMCHECK_H */
+
+/* Define if you have vsnprintf() */
+#define HAVE_VSNPRINTF 1
+
+/* Define to 1 if you have the <xlocale.h> header file. */
+/* #undef HAVE_XLOCALE_H */
+
+/* Define this if newlocale() doesn't work the way I expect */
+/* #undef NEWLOCALE_DOESNT_WORK */
+
+/* Define this if newlocale() requires #define __GNU_SOURCE to work */
+/* #undef NEWLOCALE_REQUIRES__GNU_SOURCE */
+
+/* Define this if newlocale() requires #define __XOPEN_SOURCE 700 to work */
+#define NEWLOCALE_REQUIRES__XOPEN_SOURCE_700 1
+
+/* Define if you do not have struct linger */
+/* #undef NO_STRUCT_LINGER */
+
+/* Define to the address where bug reports for this package should be sent. */
+#define PACKAGE_BUGREPORT ""
+
+/* Define to the full name of this package. */
+#define PACKAGE_NAME "epic5"
+
+/* Define to the full name and version of this package. */
+#define PACKAGE_STRING "epic5 2"
+
+/* Define to the one symbol short name of this package. */
+#define PACKAGE_TARNAME "epic5"
+
+/* Define to the home page for this package. */
+#define PACKAGE_URL ""
+
+/* Define to the version of this package. */
+#define PACKAGE_VERSION "2"
+
+/* Add this to CLFAGS for perl support */
+/* #undef PERLCFLAGS */
+
+/* Add this to LDFLAGS for perl support */
+/* #undef PERLLIBS */
+
+/* Add this to CLFAGS for perl support */
+#define PERL_EXTRA_CFLAGS 1
+
+/* Stuff to add to CFLAGS to support python */
+#define PYTHON_CFLAGS 1
+
+/* Stuff to add to LDFLAGS to support python */
+#define PYTHON_LDFLAGS 1
+
+/* Define this add stuff.... */
+#define PYTHON_O 1
+
+/* Stuff to add to CFLAGS to support ruby */
+#define RUBYCFLAGS 1
+
+/* Stuff to add to LDFLAGS to support ruby */
+#define RUBYLIBS 1
+
+/* If using the C implementation of alloca, define if you know the
+   direction of stack growth for your system; otherwise it will be
+   automatically deduced at runtime.
+	STACK_DIRECTION > 0 => grows toward higher addresses
+	STACK_DIRECTION < 0 => grows toward lower addresses
+	STACK_DIRECTION = 0 => direction of growth unknown */
+/* #undef STACK_DIRECTION */
+
+/* Define to 1 if all of the C89 standard headers exist (not just the ones
+   required in a freestanding environment). This macro is provided for
+   backward compatibility; new code need not use it. */
+#define STDC_HEADERS 1
+
+/* Define if <term.h> requires <curses.h> to be included first */
+/* #undef TERM_H_REQUIRES_CURSES_H */
+
+/* Define this if you want to use freebsd kqueue() as the multiplexer */
+/* #undef USE_FREEBSD_KQUEUE */
+
+/* Define this if you want to use poll as the multiplexer */
+/* #undef USE_POLL */
+
+/* Define this if you want to use pthreads as the multiplexer */
+/* #undef USE_PTHREAD */
+
+/* Define this if you want to use select as the multiplexer */
+#define USE_SELECT 1
+
+/* Define this if you want to use Solaris ports as the multiplexer */
+/* #undef USE_SOLARIS_PORTS */
+
+/* Define for Solaris 2.5.1 so the uint32_t typedef from <sys/synch.h>,
+   <pthread.h>, or <semaphore.h> is not used. If the typedef were allowed, the
+   #define below would cause a syntax error. */
+/* #undef _UINT32_T */
+
+/* Define for Solaris 2.5.1 so the uint64_t typedef from <sys/synch.h>,
+   <pthread.h>, or <semaphore.h> is not used. If the typedef were allowed, the
+   #define below would cause a syntax error. */
+/* #undef _UINT64_T */
+
+/* Define for Solaris 2.5.1 so the uint8_t typedef from <sys/synch.h>,
+   <pthread.h>, or <semaphore.h> is not used. If the typedef were allowed, the
+   #define below would cause a syntax error. */
+/* #undef _UINT8_T */
+
+/* Define as 'int' if <sys/types.h> doesn't define. */
+/* #undef gid_t */
+
+/* Define to the type of a signed integer type of width exactly 16 bits if
+   such a type exists and the standard includes do not define it. */
+/* #undef int16_t */
+
+/* Define to the type of a signed integer type of width exactly 32 bits if
+   such a type exists and the standard includes do not define it. */
+/* #undef int32_t */
+
+/* Define to the type of a signed integer type of width exactly 64 bits if
+   such a type exists and the standard includes do not define it. */
+/* #undef int64_t */
+
+/* Define to the type of a signed integer type of width exactly 8 bits if such
+   a type exists and the standard includes do not define it. */
+/* #undef int8_t */
+
+/* Define to the widest signed integer type if <stdint.h> and <inttypes.h> do
+   not define. */
+/* #undef intmax_t */
+
+/* Define to the type of a signed integer type wide enough to hold a pointer,
+   if such a type exists, and if the system does not define it. */
+/* #undef intptr_t */
+
+/* Define to 'int' if <sys/types.h> does not define. */
+/* #undef mode_t */
+
+/* Define to 'long int' if <sys/types.h> does not define. */
+/* #undef off_t */
+
+/* Define as a signed integer type capable of holding a process identifier. */
+/* #undef pid_t */
+
+/* Define as 'unsigned int' if <stddef.h> doesn't define. */
+/* #undef size_t */
+
+/* Define as 'int' if <sys/types.h> doesn't define. */
+/* #undef ssize_t */
+
+/* Define as 'int' if <sys/types.h> doesn't define. */
+/* #undef uid_t */
+
+/* Define to the type of an unsigned integer type of width exactly 16 bits if
+   such a type exists and the standard includes do not define it. */
+/* #undef uint16_t */
+
+/* Define to the type of an unsigned integer type of width exactly 32 bits if
+   such a type exists and the standard includes do not define it. */
+/* #undef uint32_t */
+
+/* Define to the type of an unsigned integer type of width exactly 64 bits if
+   such a type exists and the standard includes do not define it. */
+/* #undef uint64_t */
+
+/* Define to the type of an unsigned integer type of width exactly 8 bits if
+   such a type exists and the standard includes do not define it. */
+/* #undef uint8_t */
+
+/* Define to the widest unsigned integer type if <stdint.h> and <inttypes.h>
+   do not define. */
+/* #undef uintmax_t */
@@ -35,10 +35,21 @@ struct epic_loadfile {
 	int 	epic_fclose (struct epic_loadfile *elf);
 	off_t 	epic_stat (const char *filename, struct stat *buf);
 	size_t  slurp_elf_file (struct epic_loadfile *elf, char **file_contents, off_t *file_contents_size);
+	int	map_elf_file (struct epic_loadfile *elf, char **file_contents, off_t *file_contents_size);
+	void	unmap_elf_file (char *file_contents, off_t file_contents_size);
 
 	int     string_feof( const char *file_contents, off_t file_contents_size);
 	int     string_fgetc (const char **file_contents, off_t *file_contents_size);
 	off_t	string_fgets (char *buffer, size_t buffer_size, const char **file_contents, off_t *file_contents_size);
 
+struct load_cache;
+	struct load_cache *load_cache_open (struct epic_loadfile *elf, const char *filename, const char *loader);
+	int	load_cache_replaying (struct load_cache *lc);
+	int	load_cache_next (struct load_cache *lc, int *type, int *line, char **text);
+	void	load_cache_record (struct load_cache *lc, int type, int line, const char *text);
+	void	load_cache_fail (struct load_cache *lc);
+	void	load_cache_save (struct load_cache *lc);
+	void	load_cache_close (struct load_cache **lc);
+
 
 #endif /* _ELF_H_ */
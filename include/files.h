@@ -15,6 +15,7 @@
 	int	target_file_write	(const char *, const char *);
 	int	file_writeb 		(int, int, char *);
 	char *	file_read 		(int);
+	char *	file_readlines		(int, int);
 	char *	file_readb 		(int, int);
 	int	file_eof 		(int);
 	int	file_close 		(int);
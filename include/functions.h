@@ -83,6 +83,8 @@ struct kwargs {
 #define KWARG_TYPE_BOOL 4
 
 int     parse_kwargs (struct kwargs *kwargs, const char *input);
+
+extern	char *	json_last_error;	/* For $json_error() */
  
 /* 
  * Examples for using the above:
@@ -0,0 +1,19 @@
+/*
+ * history.h -- header file for history.c
+ *
+ * Copyright 2026 EPIC Software Labs
+ * See the COPYRIGHT file for copyright information
+ */
+
+#ifndef __history_h__
+#define __history_h__
+
+extern	int	history_replaying;
+
+	void	add_to_history		(int, const char *, int, const char *);
+	void	close_all_history	(void);
+	void	set_history_dir		(void *);
+	void	set_history_mask	(void *);
+	char *	historyctl		(char *);
+
+#endif
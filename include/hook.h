@@ -139,4 +139,14 @@ enum HOOK_TYPES {
 
 	extern int deny_all_hooks;
 
+/*
+ * One bit per hook type, set whenever that type has an /ON or an implied
+ * hook.  This lets do_hook() (and anyone else who cares) find out that
+ * nobody is listening without pressing the $* buffer first.
+ */
+	extern unsigned char	hooked_types[];
+#define is_hooked(which) \
+	((unsigned)(which) >= NUMBER_OF_LISTS || \
+	 (hooked_types[(unsigned)(which) >> 3] & (1 << ((unsigned)(which) & 7))))
+
 #endif /* __hook_h_ */
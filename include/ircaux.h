@@ -32,6 +32,7 @@ struct metric_time {
 #define RESIZE(x, y, z) 		new_realloc ((void **)& (x), sizeof(y) * (z))
 	void	fatal_malloc_check	(void *, const char *, const char *, int);
 	void *	really_new_malloc 	(size_t, const char *, int);
+extern	intmax_t	new_malloc_count;
 	void *	really_new_free 	(void **, const char *, int);
 	void *	really_new_realloc 	(void **, size_t, const char *, int);
 
@@ -62,6 +63,7 @@ struct metric_time {
 	char *	next_in_div_list	(char *, char **, int);
 	int	remove_from_comma_list	(char *str, const char *what);
 	size_t	escape_chars 		(const char *, const char *, char *, size_t);
+	size_t	quote_dword		(const char *, int, char *, size_t);
 
 	/* - - - - Functions dealing with words - - - - */
 	char *  universal_next_arg_count (char *, char **, int, int, int, const char *);
@@ -100,6 +102,8 @@ struct 	epic_loadfile *	uzfopen 	(char **, const char *, int, struct stat *);
 #define my_table_stricmp(x, y, t) my_table_strnicmp(x, y, UINT_MAX, t)
 	int	server_strnicmp		(const char *, const char *, size_t, int);
 #define server_stricmp(x, y, s)	server_strnicmp(x, y, UINT_MAX, s)
+	uint32_t server_strhash		(const char *, int);
+	uint32_t my_strhash		(const char *);
 	int	my_stricmp 		(const char *, const char *);
 	int     my_strncmp 		(const char *, const char *, size_t);
 	int	my_strnicmp 		(const char *, const char *, size_t);
@@ -0,0 +1,15 @@
+/*
+ * json.h -- header file for json.c
+ *
+ * Copyright 2026 EPIC Software Labs
+ * See the COPYRIGHT file for copyright information
+ */
+
+#ifndef __json_h__
+#define __json_h__
+
+	int	json_explode		(const char *var, const char *json, size_t *errpos);
+	char *	json_implode		(const char *var, int compact);
+	int	json_get		(const char *path, const char *json, char **result, size_t *errpos);
+
+#endif
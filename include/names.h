@@ -11,6 +11,8 @@
 	void	add_channel		(Char *, int); 
 	void	remove_channel		(Char *, int);
 	void	add_to_channel		(Char *, Char *, int, int, int, int, int);
+	void	add_names_to_channel	(Char *, Char *, int);
+	void	channel_names_done	(Char *, int);
 	void	add_userhost_to_channel	(Char *, Char *, int, Char *);
 	void	remove_from_channel	(Char *, Char *, int);
 	void	rename_nick		(Char *, Char *, int);
@@ -20,6 +22,7 @@
 	int	is_chanop		(Char *, Char *);
 	int	is_chanvoice		(Char *, Char *);
 	int	is_halfop		(Char *, Char *);
+	char *	get_nick_prefixes	(Char *, Char *, int);
 	int	number_on_channel	(Char *, int);
 	char *	create_nick_list	(Char *, int);
 	char *	create_chops_list	(Char *, int);
@@ -14,6 +14,11 @@ struct notify_stru;
 
 extern	char	notify_timeref[];
 
+/* What the server will tell us about on its own (Server->notify_push) */
+#define NOTIFY_PUSH_NONE	0	/* Nothing -- we have to ISON */
+#define NOTIFY_PUSH_MONITOR	1	/* IRCv3 MONITOR */
+#define NOTIFY_PUSH_WATCH	2	/* WATCH */
+
 	BUILT_IN_COMMAND(notify);
 	void	do_notify 		(void);
 	void	notify_mark 		(int, const char *, int, int);
@@ -22,6 +27,9 @@ extern	char	notify_timeref[];
 	void	make_notify_list 	(int);
 	char *	get_notify_nicks 	(int, int);
 	void	destroy_notify_list	(int);
+	void	notify_push_start	(int);
+	void	notify_push_stop	(int);
+	int	notify_push_reply	(int, int, const char **);
 
 	void	notify_systimer		(void);
 	void	set_notify_interval	(void *);
@@ -0,0 +1,27 @@
+/*
+ * profiler.h -- header for profiler.c
+ * Copyright 2026 EPIC Software Labs
+ */
+
+#ifndef __profiler_h__
+#define __profiler_h__
+
+#define PROFILE_ALIAS		0
+#define PROFILE_FUNCTION	1
+#define PROFILE_HOOK		2
+#define PROFILE_BUILTIN		3
+
+	int	profile_enter		(int, const char *, const char *);
+	void	profile_leave		(void);
+	char *	profilerctl		(char *);
+
+	extern	int	profiling;
+
+/*
+ * PROFILE_ENTER() returns 1 if it started a new frame, in which
+ * case you must call profile_leave() when the thing is done.
+ */
+#define PROFILE_ENTER(type, name, file)	\
+	(profiling ? profile_enter((type), (name), (file)) : 0)
+
+#endif
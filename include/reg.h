@@ -41,6 +41,9 @@
         int     wild_match      (const char *, const char *);
         int     pattern_regcomp (regex_t *, const char *, int);
         char *  pattern2regex   (const char *, int *);
+        regex_t * get_regex     (const char *, int, char *, size_t);
+        void    release_regex   (regex_t *);
+        char *  regexctl        (char *);
 
 #endif
 
@@ -30,3 +30,12 @@ extern Datum 	sdbm_firstkey (SDBM *);
 extern Datum 	sdbm_nextkey (SDBM *);
 extern int	sdbm_error (SDBM *);
 
+/*
+ * epic extensions
+ */
+extern SDBM *	sdbm_open_pagesize (const char *, int, int, int);
+extern int	sdbm_sync (SDBM *);
+extern int	sdbm_cache (SDBM *, int);
+extern int	sdbm_bulk (SDBM *, int);
+extern int	sdbm_pagesize (SDBM *);
+
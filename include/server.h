@@ -130,10 +130,16 @@ const	AI *		next_addr;		/* The next one to try upon failure */
 	int		userhost_max;		/* Max pending userhosts */
 	UserhostEntry *	userhost_queue;		/* Userhost queue */
 	UserhostEntry *	userhost_wait;		/* Userhost wait queue */
+	QueueStats	who_stats;		/* Latency of WHO queue */
+	QueueStats	ison_stats;		/* Latency of ISON queue */
+	QueueStats	userhost_stats;		/* Latency of USERHOST queue */
 
 		/* /NOTIFY */
 	alist		notify_list;		/* Notify list for this server */
 	char *		ison;
+	int		notify_push;		/* MONITOR or WATCH in use */
+	int		notify_push_max;	/* How many nicks it'll take */
+	int		notify_pushed;		/* How many nicks it has */
 
 		/* /LIST, /NAMES */
 	int		funny_min;		/* Funny stuff */
@@ -56,6 +56,8 @@ int	ACCEPT_INVALID_SSL_CERT_VAR,
 	FLOATING_POINT_PRECISION_VAR,
 	HIDE_PRIVATE_CHANNELS_VAR,
 	HIGHLIGHT_CHAR_VAR,
+	HISTORY_DIR_VAR,
+	HISTORY_LEVEL_VAR,
 	HOLD_SLIDER_VAR,
 	INDENT_VAR,
 	INPUT_INDICATOR_LEFT_VAR,
@@ -66,6 +68,7 @@ int	ACCEPT_INVALID_SSL_CERT_VAR,
 	LASTLOG_VAR,
 	LASTLOG_LEVEL_VAR,
 	LASTLOG_REWRITE_VAR,
+	LOAD_CACHE_DIR_VAR,
 	LOAD_PATH_VAR,
 	LOG_VAR,
 	LOGFILE_VAR,
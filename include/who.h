@@ -8,6 +8,17 @@
 
 void clean_server_queues (int);
 
+/* How long each queue's requests have been taking on a server */
+typedef struct QueueStatsT
+{
+	unsigned long	sent;		/* Queries sent to the server */
+	unsigned long	replies;	/* Replies we've gotten back */
+	double		total_latency;	/* Seconds, for all the replies */
+	double		max_latency;	/* The slowest reply (seconds) */
+} QueueStats;
+
+	char *	get_server_queue_stats	(int, const char *);
+
 /* WHO queue */
 
 /* XXX This should be in who.c */
@@ -59,6 +70,8 @@ typedef struct IsonEntryT
 	char *oncmd;
 	char *offcmd;
 	char *endcmd;
+	int   piggyback;	/* The next one was sent in the same ISON */
+	Timeval sent_time;
 } IsonEntry;
 
 	BUILT_IN_COMMAND(isoncmd);
@@ -87,6 +100,8 @@ typedef struct UserhostEntryT
 	char *		extra;
         struct UserhostEntryT * next;
         void            (*func) (int, UserhostItem *, const char *, const char *); 
+	int		piggyback;	/* The next one was sent with us */
+	Timeval		sent_time;
 } UserhostEntry;
 
 	BUILT_IN_COMMAND(userhostcmd);
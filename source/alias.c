@@ -82,6 +82,7 @@ struct ArgListT {
 	enum	ARG_TYPES types[32];
 	int	void_flag;
 	int	dot_flag;
+	int	refcnt;
 };
 typedef struct ArgListT ArgList;
 ArgList	*parse_arglist (char *arglist);
@@ -134,7 +135,7 @@ const char *symbol_types[] = {
 static alist globals = 	{ NULL, 0, 0, my_strncmp, HASH_INSENSITIVE };
 
 static	Symbol *lookup_symbol 	   (const char *name);
-static	Symbol *find_local_alias   (const char *name, alist **list);
+static	Symbol *find_local_alias   (const char *name, int *frame);
 
 /*
  * This is the ``stack frame''.  Each frame has a ``name'' which is
@@ -142,12 +143,22 @@ static	Symbol *find_local_alias   (const char *name, alist **list);
  * is not an ``enclosing'' frame.  Each frame also has a ``current command''
  * that is being executed, which is used to help us when the client crashes.
  * Each stack also contains a list of local variables.
+ *
+ * The local variables are kept in an alist (so /LOCAL can list them in
+ * order) but they are looked up through a small open hash table, so
+ * that finding a local costs the same no matter how many there are.
+ * ``structs'' counts the locals whose names end in a dot, so we know 
+ * whether it's worth looking for an implied parent of a dotted name.
  */
 typedef struct RuntimeStackStru
 {
 	const char *name;	/* Name of the stack */
 	char 	*current;	/* Current cmd being executed */
 	alist	alias;		/* Local variables */
+	Symbol **locals;	/* Hash index into ``alias'' */
+	int	locals_size;	/* Size of ``locals'' (a power of two) */
+	int	locals_count;	/* Number of symbols in ``locals'' */
+	int	structs;	/* Number of locals ending in a dot */
 	int	locked;		/* Are we locked in a wait? */
 	int	parent;		/* Our parent stack frame */
 }	RuntimeStack;
@@ -209,6 +220,9 @@ static	void	list_var_alias     (Char *name);
 static	void	list_local_alias   (Char *name);
 static	void 	destroy_cmd_aliases    (alist *);
 static	void 	destroy_var_aliases    (alist *);
+static	void	destroy_frame_locals   (RuntimeStack *);
+static	Symbol *find_frame_local       (RuntimeStack *, const char *);
+static	void	add_frame_local        (RuntimeStack *, const char *, Symbol *);
 static	void 	destroy_builtin_commands    (alist *);
 static	void 	destroy_builtin_functions   (alist *);
 static	void 	destroy_builtin_variables   (alist *);
@@ -566,7 +580,7 @@ BUILT_IN_COMMAND(localcmd)
 
 	if (!my_strnicmp(name, "-dump", 2))	/* Illegal name anyways */
 	{
-		destroy_var_aliases(&call_stack[wind_index].alias);
+		destroy_frame_locals(&call_stack[wind_index]);
 		return;
 	}
 
@@ -710,6 +724,7 @@ ArgList	*parse_arglist (char *arglist)
 		panic(1, "parse_arglist: arglist is NULL and it shouldn't be.");
 
 	args->void_flag = args->dot_flag = 0;
+	args->refcnt = 1;
 	for (this_term = arglist; *this_term; this_term = next_term)
 	{
 		while (isspace(*this_term))
@@ -770,6 +785,11 @@ ArgList	*parse_arglist (char *arglist)
 	return args;
 }
 
+/*
+ * destroy_arglist -- Let go of your reference to an ArgList.
+ * The ArgList is only really free()d when the last reference goes away,
+ * but your pointer is always NULLed out.
+ */
 void	destroy_arglist (ArgList **arglist)
 {
 	int	i = 0;
@@ -777,6 +797,12 @@ void	destroy_arglist (ArgList **arglist)
 	if (!arglist || !*arglist)
 		return;
 
+	if (--(*arglist)->refcnt > 0)
+	{
+		*arglist = NULL;
+		return;
+	}
+
 	for (i = 0; ; i++)
 	{
 		if (!(*arglist)->vars[i])
@@ -815,10 +841,28 @@ ArgList *clone_arglist (ArgList *orig)
 	}
 	args->void_flag = orig->void_flag;
 	args->dot_flag = orig->dot_flag;
+	args->refcnt = 1;
 
 	return args;
 }
 
+/*
+ * share_arglist -- Take another reference to an ArgList.
+ * Since nobody ever changes an ArgList after parse_arglist() builds it,
+ * anyone who needs to hold onto one (such as a hook that is being run,
+ * which might be deleted out from under us) can share it rather than 
+ * going through the expense of clone_arglist().  Each reference must 
+ * be released with destroy_arglist().
+ */
+ArgList *share_arglist (ArgList *orig)
+{
+	if (!orig)
+		return NULL;
+
+	orig->refcnt++;
+	return orig;
+}
+
 void	prepare_alias_call (void *al, char **stuff)
 {
 	ArgList *args = al;
@@ -1041,6 +1085,99 @@ static int	GC_symbol (Symbol *item, alist *list, int loc)
 }
 
 /* * * */
+/*
+ * Batched global variable creation.
+ *
+ * Between begin_var_alias_batch() and end_var_alias_batch(), new global
+ * variables are collected here instead of being inserted into ``globals''
+ * one at a time (each of which shifts the whole list).  At the end of the
+ * batch they are all merged in with one pass.  Assignments to variables
+ * that already exist are still done in place.  An empty assignment leaves
+ * a tombstone (a symbol with no value) so that a later flush knows to
+ * discard any earlier pending value for that name.
+ *
+ * Nothing that runs during a batch may expect to look up the variables
+ * it has created until the batch is over.
+ */
+typedef struct {
+	Symbol *	symbol;
+	int		seq;
+} PendingSymbol;
+
+static	int		var_batch_level = 0;
+static	PendingSymbol *	var_batch = NULL;
+static	int		var_batch_count = 0;
+static	int		var_batch_size = 0;
+
+static void	queue_var_alias (Symbol *item)
+{
+	if (var_batch_count >= var_batch_size)
+	{
+		var_batch_size = var_batch_size ? var_batch_size * 2 : 64;
+		RESIZE(var_batch, PendingSymbol, var_batch_size);
+	}
+	var_batch[var_batch_count].symbol = item;
+	var_batch[var_batch_count].seq = var_batch_count;
+	var_batch_count++;
+}
+
+static int	pending_symbol_compare (const void *p1, const void *p2)
+{
+	const PendingSymbol *a = (const PendingSymbol *)p1;
+	const PendingSymbol *b = (const PendingSymbol *)p2;
+	int	c;
+
+	if ((c = strcmp(a->symbol->name, b->symbol->name)))
+		return c;
+	return a->seq - b->seq;
+}
+
+void	begin_var_alias_batch (void)
+{
+	var_batch_level++;
+}
+
+void	end_var_alias_batch (void)
+{
+	char **	names;
+	void **	items;
+	int	i, count = 0;
+
+	if (var_batch_level <= 0 || --var_batch_level > 0)
+		return;
+	if (var_batch_count == 0)
+		return;
+
+	qsort(var_batch, var_batch_count, sizeof(PendingSymbol), 
+		pending_symbol_compare);
+
+	names = (char **)new_malloc(sizeof(char *) * var_batch_count);
+	items = (void **)new_malloc(sizeof(void *) * var_batch_count);
+	for (i = 0; i < var_batch_count; i++)
+	{
+		Symbol *item = var_batch[i].symbol;
+
+		/* Only the last assignment to each name counts */
+		if (item->user_variable && (i + 1 == var_batch_count || 
+		    strcmp(item->name, var_batch[i + 1].symbol->name)))
+		{
+			names[count] = item->name;
+			items[count] = item;
+			count++;
+			continue;
+		}
+
+		new_free(&item->user_variable);
+		GC_symbol(item, NULL, -1);
+	}
+
+	add_many_to_alist(&globals, count, names, items);
+	new_free((char **)&names);
+	new_free((char **)&items);
+	new_free((char **)&var_batch);
+	var_batch_count = var_batch_size = 0;
+}
+
 /*
  * add_var_alias: Add a global variable
  *
@@ -1100,7 +1237,10 @@ void	add_var_alias	(const char *orig_name, const char *stuff, int noisy)
 		if (!tmp || cnt >= 0)
 		{
 			tmp = make_new_Symbol(name);
-			add_to_alist(&globals, name, tmp);
+			if (var_batch_level)
+				queue_var_alias(tmp);
+			else
+				add_to_alist(&globals, name, tmp);
 		}
 
 		if (current_package())
@@ -1122,7 +1262,11 @@ void	add_var_alias	(const char *orig_name, const char *stuff, int noisy)
 			say("Assign %s added [%s]", name, stuff);
 	}
 	else
+	{
+		if (var_batch_level)
+			queue_var_alias(make_new_Symbol(name));
 		delete_var_alias(name, noisy);
+	}
 
 	new_free(&save);
 	return;
@@ -1177,7 +1321,7 @@ void	add_local_alias	(const char *orig_name, const char *stuff, int noisy)
 {
 	const char 	*ptr;
 	Symbol 	*tmp = NULL;
-	alist *list = NULL;
+	int	frame = wind_index;
 	char *	name;
 
 	name = remove_brackets(orig_name, NULL);
@@ -1200,10 +1344,10 @@ void	add_local_alias	(const char *orig_name, const char *stuff, int noisy)
 	 * If it doesnt, then we add it to the current frame,
 	 * where it will be reaped later.
 	 */
-	if (!(tmp = find_local_alias (name, &list)))
+	if (!(tmp = find_local_alias (name, &frame)))
 	{
 		tmp = make_new_Symbol(name);
-		add_to_alist (list, name, tmp);
+		add_frame_local(&call_stack[frame], name, tmp);
 	}
 
 	/* Fill in the interesting stuff */
@@ -1442,7 +1586,7 @@ static Symbol *	lookup_symbol (const char *name)
  * is an exact leading subset of ``name'' and that variable ends in a
  * period (a dot).
  */
-static Symbol *	find_local_alias (const char *orig_name, alist **list)
+static Symbol *	find_local_alias (const char *orig_name, int *frame)
 {
 	Symbol 	*alias = NULL;
 	int 	c;
@@ -1486,31 +1630,32 @@ static Symbol *	find_local_alias (const char *orig_name, alist **list)
 		if (x_debug & DEBUG_LOCAL_VARS)
 			yell("Looking for [%s] in level [%d]", name, c);
 
-		if (call_stack[c].alias.list)
+		if (call_stack[c].locals_count)
 		{
-			int x, cnt, loc;
+			char *	dot;
 
 			/* We can always hope that the variable exists */
-			find_alist_item(&call_stack[c].alias, name, &cnt, &loc);
-			if (cnt < 0)
-				alias = call_stack[c].alias.list[loc]->data;
+			alias = find_frame_local(&call_stack[c], name);
 
-			/* XXXX - This is bletcherous */
-			else if (strchr(name, '.'))
+			/*
+			 * If not, then "A.B.C" exists implicitly if there
+			 * is a local "A." or "A.B." in this frame.
+			 */
+			if (!alias && call_stack[c].structs)
 			{
-			    for (x = 0; x < loc; x++)
+			    for (dot = strchr(name, '.'); dot; 
+					dot = strchr(dot + 1, '.'))
 			    {
+				char	save = dot[1];
 				Symbol *item;
-				size_t len;
 
-				item = call_stack[c].alias.list[x]->data;
-				len =  strlen(item->name);
+				dot[1] = 0;
+				item = find_frame_local(&call_stack[c], name);
+				dot[1] = save;
 
-				if (streq(item->name, name) == len) {
-					if (item->name[len-1] == '.') {
-						implicit = c;
-						break;
-					}
+				if (item) {
+					implicit = c;
+					break;
 				}
 			    }
 			}
@@ -1518,7 +1663,7 @@ static Symbol *	find_local_alias (const char *orig_name, alist **list)
 			if (!alias && implicit >= 0)
 			{
 				alias = make_new_Symbol(name);
-				add_to_alist (&call_stack[implicit].alias, name, alias);
+				add_frame_local(&call_stack[implicit], name, alias);
 			}
 		}
 
@@ -1542,12 +1687,12 @@ static Symbol *	find_local_alias (const char *orig_name, alist **list)
 
 	if (alias)
 	{
-		if (list)
-			*list = &call_stack[c].alias;
+		if (frame)
+			*frame = c;
 		return alias;
 	}
-	else if (list)
-		*list = &call_stack[wind_index].alias;
+	else if (frame)
+		*frame = wind_index;
 
 	return NULL;
 }
@@ -2182,7 +2327,7 @@ char **	get_subarray_elements (const char *orig_root, int *howmany, int type)
 
 		if (*howmany >= matches_size)
 		{
-			matches_size = *howmany + 5;
+			matches_size = matches_size ? matches_size * 2 : 8;
 			RESIZE(matches, char *, matches_size + 1);
 		}
 		if ((matches[*howmany] = malloc_strext(s->name, cmp + end)))
@@ -2228,15 +2373,18 @@ static	void	destroy_cmd_aliases (alist *my_alist)
 	}
 }
 
+/*
+ * Walk the list backwards.  When GC_symbol() removes item "cnt", it
+ * only slides down the items after it, which we have already looked
+ * at, so nothing we haven't looked at yet gets skipped.
+ */
 static	void	destroy_var_aliases (alist *my_alist)
 {
-	int cnt = 0;
+	int cnt;
 	Symbol *item;
 
-	for (;;)
+	for (cnt = my_alist->max - 1; cnt >= 0; cnt--)
 	{
-	    for (cnt = 0; cnt < my_alist->max; cnt++)
-	    {
 		item = my_alist->list[cnt]->data;
 		if (!item->user_variable && !item->user_variable_stub)
 			continue;
@@ -2245,10 +2393,6 @@ static	void	destroy_var_aliases (alist *my_alist)
 		new_free((void **)&item->user_variable_package);
 		item->user_variable_stub = 0;
 		GC_symbol(item, my_alist, cnt);
-		break;
-	    }
-	    if (cnt >= my_alist->max)
-		    return;
 	}
 }
 
@@ -2337,6 +2481,88 @@ static	void	destroy_builtin_variables (alist *my_alist)
 }
 
 /******************* RUNTIME STACK SUPPORT **********************************/
+static unsigned	local_hash (const char *name)
+{
+	unsigned	h = 2166136261U;
+
+	while (*name)
+		h = (h ^ (unsigned char)toupper((unsigned char)*name++)) 
+				* 16777619U;
+	return h;
+}
+
+static Symbol *	find_frame_local (RuntimeStack *frame, const char *name)
+{
+	unsigned	i, mask;
+
+	if (!frame->locals_count)
+		return NULL;
+
+	mask = frame->locals_size - 1;
+	for (i = local_hash(name) & mask; frame->locals[i]; i = (i + 1) & mask)
+		if (!strcmp(frame->locals[i]->name, name))
+			return frame->locals[i];
+
+	return NULL;
+}
+
+static void	index_frame_local (RuntimeStack *frame, Symbol *item)
+{
+	unsigned	i, mask;
+
+	mask = frame->locals_size - 1;
+	for (i = local_hash(item->name) & mask; frame->locals[i]; 
+			i = (i + 1) & mask)
+		;
+	frame->locals[i] = item;
+	frame->locals_count++;
+
+	if (*item->name && item->name[strlen(item->name) - 1] == '.')
+		frame->structs++;
+}
+
+/*
+ * Put a new local variable in a stack frame.  The hash table is kept
+ * no more than half full; when it gets fuller than that, we just 
+ * rebuild it from the alist.
+ */
+static void	add_frame_local (RuntimeStack *frame, const char *name, Symbol *item)
+{
+	int	i;
+
+	add_to_alist(&frame->alias, name, item);
+
+	if ((frame->locals_count + 1) * 2 > frame->locals_size)
+	{
+		new_free(&frame->locals);
+		frame->locals_size = frame->locals_size ? 
+					frame->locals_size * 2 : 16;
+		frame->locals = new_malloc(sizeof(Symbol *) * frame->locals_size);
+		memset(frame->locals, 0, sizeof(Symbol *) * frame->locals_size);
+		frame->locals_count = frame->structs = 0;
+
+		for (i = 0; i < frame->alias.max; i++)
+			index_frame_local(frame, frame->alias.list[i]->data);
+	}
+	else
+		index_frame_local(frame, item);
+}
+
+static void	destroy_frame_locals (RuntimeStack *frame)
+{
+	int	i;
+
+	destroy_var_aliases(&frame->alias);
+
+	if (frame->locals)
+		memset(frame->locals, 0, sizeof(Symbol *) * frame->locals_size);
+	frame->locals_count = frame->structs = 0;
+
+	/* Anything that survived still has to be findable */
+	for (i = 0; i < frame->alias.max; i++)
+		index_frame_local(frame, frame->alias.list[i]->data);
+}
+
 
 int	make_local_stack 	(const char *name)
 {
@@ -2367,6 +2593,10 @@ int	make_local_stack 	(const char *name)
 			call_stack[wind_index].alias.list = NULL;
 			call_stack[wind_index].alias.func = my_strncmp;
 			call_stack[wind_index].alias.hash = HASH_INSENSITIVE;
+			call_stack[wind_index].locals = NULL;
+			call_stack[wind_index].locals_size = 0;
+			call_stack[wind_index].locals_count = 0;
+			call_stack[wind_index].structs = 0;
 			call_stack[wind_index].current = NULL;
 			call_stack[wind_index].name = NULL;
 			call_stack[wind_index].parent = -1;
@@ -2414,7 +2644,7 @@ void 	destroy_local_stack 	(void)
 	 * We clean up as best we can here...
 	 */
 	if (call_stack[wind_index].alias.list)
-		destroy_var_aliases(&call_stack[wind_index].alias);
+		destroy_frame_locals(&call_stack[wind_index]);
 	if (call_stack[wind_index].current)
 		call_stack[wind_index].current = 0;
 	if (call_stack[wind_index].name)
@@ -2586,6 +2816,16 @@ const char *	get_func_alias (const char *name, void **args, char * (**func) (cha
 	return NULL;
 }
 
+/* Which package an alias (or function) was loaded from, or NULL */
+const char *	get_cmd_alias_package (const char *name)
+{
+	Symbol *item;
+
+	if ((item = lookup_symbol(name)))
+		return item->user_command_package;
+	return NULL;
+}
+
 const char *	get_var_alias (const char *name, char *(**efunc)(void), IrcVariable **var)
 {
 	Symbol *item;
@@ -2671,11 +2911,10 @@ static	int maxret = 0;
 		case (SETPACKAGE) :
 		{
 			Symbol *alias = NULL;
-			alist *a_list;
 
 			upper(listc);
 			if (list == VAR_ALIAS_LOCAL)
-				alias = find_local_alias(listc, &a_list);
+				alias = find_local_alias(listc, NULL);
 			else 
 				alias = lookup_symbol(listc);
 
@@ -84,6 +84,95 @@ void *	add_to_alist (alist *a, const char *name, void *item)
 	return ret;
 }
 
+/*
+ * add_many_to_alist -- Insert a batch of new entries in one pass
+ *
+ * This is the same as calling add_to_alist() for each of the 'count'
+ * names/items, except that the list is only shifted once, so loading
+ * a large number of entries is O(n log n) instead of O(n^2).
+ * The caller must ensure the names are unique and not already present
+ * in the alist; there is no "displaced entry" to hand back.
+ */
+typedef struct {
+	alist_item_ *	item;
+	int		loc;
+} pending_item_;
+
+static	alist *	pending_alist = NULL;
+
+static int	pending_compare (const void *p1, const void *p2)
+{
+	const pending_item_ *a = (const pending_item_ *)p1;
+	const pending_item_ *b = (const pending_item_ *)p2;
+	uint32_t	mask;
+	intmax_t	c;
+
+	if (a->loc != b->loc)
+		return a->loc < b->loc ? -1 : 1;
+
+	/* The same ordering find_alist_item() would place them in */
+	if (pending_alist->hash == HASH_INSENSITIVE)
+		ci_alist_hash(a->item->name, &mask);
+	else
+		cs_alist_hash(a->item->name, &mask);
+	c = (intmax_t)(a->item->hash & mask) - (intmax_t)(b->item->hash & mask);
+	if (c == 0)
+		c = pending_alist->func(a->item->name, b->item->name, 
+					strlen(a->item->name));
+	if (c == 0)
+		return -1;	/* 'a' is a prefix of 'b' */
+	return c < 0 ? -1 : 1;
+}
+
+void	add_many_to_alist (alist *a, int count, char **names, void **items)
+{
+	pending_item_ *	pending;
+	uint32_t	mask;
+	int		i, cnt, src, dst;
+
+	if (count <= 0)
+		return;
+
+	pending = (pending_item_ *)new_malloc(sizeof(pending_item_) * count);
+	for (i = 0; i < count; i++)
+	{
+		pending[i].item = (alist_item_ *)new_malloc(sizeof(alist_item_));
+		pending[i].item->name = malloc_strdup(names[i]);
+		if (a->hash == HASH_INSENSITIVE)
+			pending[i].item->hash = ci_alist_hash(names[i], &mask);
+		else
+			pending[i].item->hash = cs_alist_hash(names[i], &mask);
+		pending[i].item->data = items[i];
+		find_alist_item(a, names[i], &cnt, &pending[i].loc);
+	}
+
+	pending_alist = a;
+	qsort(pending, count, sizeof(pending_item_), pending_compare);
+	pending_alist = NULL;
+
+	if (a->total_max == 0)
+	{
+		new_free(&a->list);
+		a->total_max = 6;
+	}
+	while (a->total_max < a->max + count + 1)
+		a->total_max *= 2;
+	RESIZE(a->list, alist_item_ *, a->total_max);
+
+	/* Merge from the top down so nothing is moved more than once */
+	src = a->max - 1;
+	dst = a->max + count - 1;
+	for (i = count - 1; i >= 0; i--)
+	{
+		while (src >= pending[i].loc)
+			LALIST_ITEM(a, dst--) = ALIST_ITEM(a, src--);
+		LALIST_ITEM(a, dst--) = pending[i].item;
+	}
+
+	a->max += count;
+	new_free((char **)&pending);
+}
+
 /*
  * Returns the entry that has been removed, if any.
  */
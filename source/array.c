@@ -204,24 +204,49 @@ Karll on IRC
 #define BUILT_IN_FUNCTION(x, y) char * x (char * y)
 #undef index			/* doh! */
 
-#define ARRAY_THRESHOLD	10
-
-#if 0
-typedef struct an_array_struct {
-	char **item;
-	long *index;
-	long size;
-} an_array;
-#endif
+/*
+ * Each array keeps its items in item[], numbered by position, and keeps the
+ * "sorted" view (by strcmp(), then by item number) in a treap whose nodes
+ * carry their subtree size.  That lets us find the n'th index, the index
+ * of an item, and the place for a new item all in O(log n) without ever
+ * shifting the sorted view around.  array->index[] is just a flattened copy
+ * of the treap that is built on demand for callers that walk every index.
+ *
+ * Deleting an item renumbers every item above it, so the nodes don't sort
+ * by item number; they sort by a "stamp" that is handed out in item order
+ * and never changes.  Each node remembers its item number, but only the 
+ * ones below array->stale are known to be right.  The rest are found by 
+ * looking the stamp up in node[], which is in stamp order.
+ *
+ * Arrays in "unsorted" mode (see $usetitem()) don't maintain the treap at
+ * all; it is rebuilt from scratch the next time anyone needs it.
+ */
+struct array_node {
+	struct array_node *left;
+	struct array_node *right;
+	char *	str;
+	long	stamp;
+	long	item;
+	long	count;
+	unsigned int prio;
+};
 
 static an_array array_info = {
         NULL,
         NULL,
         0L,
-	1
+	1,
+	NULL,
+	NULL,
+	0L,
+	0,
+	0L,
+	0L,
+	0L
 };
 
 static an_array *array_array = NULL;
+static long	last_array = -1;
 an_array *qsort_array;
 
 static int compare_indices (const void *a1, const void *a2)
@@ -238,35 +263,363 @@ static int compare_indices (const void *a1, const void *a2)
 		return *(const long *)a1 - *(const long *)a2;
 }
 
-static void sort_indices (an_array *array)
+static unsigned int	node_prio (void)
+{
+	static unsigned int	seed = 2463534242U;
+
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+#define NODE_COUNT(n)	((n) ? (n)->count : 0)
+#define NODE_FIX(n)	((n)->count = NODE_COUNT((n)->left) + NODE_COUNT((n)->right) + 1)
+
+/* Does node "a" sort before node "b"? */
+static int	node_before (struct array_node *a, struct array_node *b)
+{
+	int	cmp;
+
+	if ((cmp = strcmp(a->str, b->str)))
+		return cmp < 0;
+	return a->stamp < b->stamp;
+}
+
+/* Return the item number of a node */
+static long	node_item (an_array *array, struct array_node *n)
+{
+	long	top, bottom, key;
+
+	if (array->stale >= array->size || n->stamp < array->node[array->stale]->stamp)
+		return n->item;
+
+	bottom = array->stale;
+	top = array->size - 1;
+	while (top > bottom)
+	{
+		key = (top + bottom) / 2;
+		if (array->node[key]->stamp < n->stamp)
+			bottom = key + 1;
+		else
+			top = key;
+	}
+	return (n->item = bottom);
+}
+
+/* Make every node's item number right again */
+static void	renumber_nodes (an_array *array)
 {
+	long	cnt;
+
+	for (cnt = array->stale; cnt < array->size; cnt++)
+		array->node[cnt]->item = cnt;
+	array->stale = array->size;
+}
+
+static struct array_node *	node_merge (struct array_node *l, struct array_node *r)
+{
+	if (!l)
+		return r;
+	if (!r)
+		return l;
+	if (l->prio > r->prio)
+	{
+		l->right = node_merge(l->right, r);
+		NODE_FIX(l);
+		return l;
+	}
+	r->left = node_merge(l, r->left);
+	NODE_FIX(r);
+	return r;
+}
+
+/*
+ * Split "n" into everything that sorts before "key" (*l) and everything
+ * else (*r).
+ */
+static void	node_split (struct array_node *n, struct array_node *key, struct array_node **l, struct array_node **r)
+{
+	if (!n)
+	{
+		*l = *r = NULL;
+		return;
+	}
+	if (node_before(n, key))
+	{
+		node_split(n->right, key, &n->right, r);
+		*l = n;
+	}
+	else
+	{
+		node_split(n->left, key, l, &n->left);
+		*r = n;
+	}
+	NODE_FIX(n);
+}
+
+/* Put an item (whose string has already been set) into the sorted view. */
+static void	node_insert (an_array *array, long item)
+{
+	struct array_node *n, *l, *r;
+
+	n = array->node[item];
+	n->left = n->right = NULL;
+	n->str = array->item[item];
+	n->count = 1;
+	n->prio = node_prio();
+
+	node_split(array->root, n, &l, &r);
+	array->root = node_merge(node_merge(l, n), r);
+	array->index_valid = 0;
+}
+
+/* Take an item (whose string has not changed yet) out of the sorted view. */
+static void	node_remove (an_array *array, long item)
+{
+	struct array_node *l, *r, **p;
+
+	/* The item is the leftmost node of everything not before it. */
+	node_split(array->root, array->node[item], &l, &r);
+	for (p = &r; (*p)->left; p = &(*p)->left)
+		(*p)->count--;
+	*p = (*p)->right;
+	array->root = node_merge(l, r);
+	array->index_valid = 0;
+}
+
+/*
+ * Throw away the sorted view.  The nodes are freed through node[] because
+ * the treap of an unsorted array may be out of date.
+ */
+static void	free_nodes (an_array *array)
+{
+	long	cnt;
+
+	for (cnt = 0; cnt < array->size; cnt++)
+		new_free((char **)&array->node[cnt]);
+	array->root = NULL;
+	array->index_valid = 0;
+}
+
+static long	node_fixup (struct array_node *n)
+{
+	if (!n)
+		return 0;
+	return (n->count = node_fixup(n->left) + node_fixup(n->right) + 1);
+}
+
+/*
+ * Rebuild the sorted view from scratch.  array->index[] is sorted with
+ * qsort() and the treap is then built from it in one linear pass.
+ */
+static void	sort_indices (an_array *array)
+{
+	struct array_node **stack, *n, *last;
+	long	cnt, sp = 0;
+
+	for (cnt = 0; cnt < array->size; cnt++)
+	{
+		if (!(n = array->node[cnt]))
+			n = array->node[cnt] = (struct array_node *)new_malloc(sizeof(*n));
+		n->str = array->item[cnt];
+		n->stamp = n->item = cnt;
+		array->index[cnt] = cnt;
+	}
+	array->stamp = array->stale = array->size;
 	qsort_array = array;
-	qsort(array->index, array->size, sizeof(long *), compare_indices);
+	qsort(array->index, array->size, sizeof(long), compare_indices);
+
+	stack = (struct array_node **)new_malloc(sizeof(*stack) * (array->size + 1));
+	for (cnt = 0; cnt < array->size; cnt++)
+	{
+		n = array->node[array->index[cnt]];
+		n->prio = node_prio();
+		n->right = NULL;
+		for (last = NULL; sp && stack[sp - 1]->prio < n->prio; )
+			last = stack[--sp];
+		n->left = last;
+		if (sp)
+			stack[sp - 1]->right = n;
+		stack[sp++] = n;
+	}
+	array->root = sp ? stack[0] : NULL;
+	new_free((char **)&stack);
+	node_fixup(array->root);
+
 	array->unsorted = 0;
+	array->index_valid = 1;
+	array->walks = 0;
 }
 
 #define SORT_INDICES(arrayp) {if ((arrayp)->unsorted) sort_indices((arrayp));}
 
+/* Make sure array->index[] is a copy of the sorted view */
+static void	build_index (an_array *array)
+{
+	struct array_node **stack, *n;
+	long	cnt = 0, sp = 0;
+
+	SORT_INDICES(array);
+	if (array->index_valid)
+		return;
+
+	renumber_nodes(array);
+	stack = (struct array_node **)new_malloc(sizeof(*stack) * (array->size + 1));
+	for (n = array->root; n || sp; n = n->right)
+	{
+		for (; n; n = n->left)
+			stack[sp++] = n;
+		n = stack[--sp];
+		array->index[cnt++] = n->item;
+	}
+	new_free((char **)&stack);
+	array->index_valid = 1;
+	array->walks = 0;
+}
+
 /*
- * find_item() does a binary search of array.item[] using array.index[]
- * to find an exact match of the string *find.  If found, it returns the item
- * number (array.item[item_number]) of the match.  Otherwise, it returns a
- * negative number.  The negative number, if made positive again, and then
- * having 1 subtracted from it, will be the item_number where the string *find
- * should be inserted into the array.item[].  The function_setitem() makes use
- * of this attribute.
+ * Return the item number at the given index (0 <= idx < size).  Walking
+ * the treap is O(log n), but once there have been enough walks since the
+ * array last changed to pay for it, array->index[] is rebuilt instead.
  */
+static long	index_item (an_array *array, long idx)
+{
+	struct array_node *n;
+
+	SORT_INDICES(array);
+	if (!array->index_valid && ++array->walks > array->size / 16)
+		build_index(array);
+	if (array->index_valid)
+		return array->index[idx];
+
+	for (n = array->root; n; )
+	{
+		if (idx < NODE_COUNT(n->left))
+			n = n->left;
+		else if (idx == NODE_COUNT(n->left))
+			return node_item(array, n);
+		else
+		{
+			idx -= NODE_COUNT(n->left) + 1;
+			n = n->right;
+		}
+	}
+	return -1;		/* Not reached */
+}
+
 /*
- * NOTE:  The new item argument is advisory, and only matters for callers
- * that plan to use the return value for updating the index array, such as
- * set_item and del_item, and is an indicator of where the caller intends
- * to insert the given string in the array.  The intent is to cause the
- * indices to be sorted by name then item.
+ * find_index() takes an item and returns the index number that refers
+ * to it.  It assumes that the item is valid.
+ */
+static long		find_index (an_array *array, long item)
+{
+	struct array_node *n, *target;
+	long	idx = 0;
+
+	SORT_INDICES(array);
+	target = array->node[item];
+	for (n = array->root; n; )
+	{
+		if (n == target)
+			return idx + NODE_COUNT(n->left);
+		if (node_before(target, n))
+			n = n->left;
+		else
+		{
+			idx += NODE_COUNT(n->left) + 1;
+			n = n->right;
+		}
+	}
+
+	say("ERROR in find_index(): item %ld not in array", item);
+	return 0;
+}
+
+/*
+ * Add a new item to the end of the array.  The storage grows
+ * geometrically so that appending items is amortized O(1).
+ */
+static void	append_item (an_array *array, const char *input)
+{
+	long	cnt, item = array->size;
+
+	if (array->size == array->capacity)
+	{
+		array->capacity = array->capacity ? array->capacity * 2 : 4;
+		RESIZE(array->item, char *, array->capacity);
+		RESIZE(array->index, long, array->capacity);
+		RESIZE(array->node, struct array_node *, array->capacity);
+		for (cnt = array->size; cnt < array->capacity; cnt++)
+		{
+			array->item[cnt] = NULL;
+			array->node[cnt] = NULL;
+		}
+	}
+
+	malloc_strcpy(&array->item[item], input);
+	if (!array->node[item])
+		array->node[item] = (struct array_node *)new_malloc(sizeof(struct array_node));
+	array->node[item]->stamp = array->stamp++;
+	array->node[item]->item = item;
+	if (array->stale == array->size++)
+		array->stale = array->size;
+	array->index_valid = 0;
+}
+
+/*
+ * Remove an item from the array, moving the items above it down by one.
+ * Their nodes don't change; they just fall into the stale range.
+ */
+static void	remove_item (an_array *array, long item)
+{
+	if (!array->unsorted)
+		node_remove(array, item);
+	new_free(&array->item[item]);
+	new_free((char **)&array->node[item]);
+	array->size--;
+
+	memmove(array->item + item, array->item + item + 1,
+			(array->size - item) * sizeof(*array->item));
+	memmove(array->node + item, array->node + item + 1,
+			(array->size - item) * sizeof(*array->node));
+	array->item[array->size] = NULL;
+	array->node[array->size] = NULL;
+	if (array->stale > item)
+		array->stale = item;
+	array->index_valid = 0;
+}
+
+static void	free_array (an_array *array)
+{
+	long	cnt;
+
+	free_nodes(array);
+	for (cnt = 0; cnt < array->size; cnt++)
+		new_free(&array->item[cnt]);
+	new_free((char **)&array->item);
+	new_free((char **)&array->index);
+	new_free((char **)&array->node);
+	array->size = array->capacity = 0;
+	array->stamp = array->stale = 0;
+}
+
+/*
+ * find_item() does a binary search of array.item[] in sorted order
+ * to find an exact match of the string *find.  If found, it returns the
+ * index of the match.  Otherwise, it returns a negative number.  The 
+ * negative number, if made positive again, and then having 1 subtracted 
+ * from it, will be the index where the string *find would be inserted.
+ */
+/*
+ * NOTE:  The new item argument is advisory, and if it is not negative,
+ * the search is for that exact item, which is used to sort the indices
+ * by name then item.
  */
 #define FINDIT(fn, test, pre)                                            \
 static long	(fn) (an_array *array, char *find, long item)            \
 {                                                                        \
-	long top, bottom, key, cmp;                                      \
+	long top, bottom, key, cmp, found;                               \
 	int len = (pre);                                                 \
 	(void)len;	/* Eliminate a specious warning from gcc. */	 \
                                                                          \
@@ -278,9 +631,10 @@ static long	(fn) (an_array *array, char *find, long item)            \
 	while (top >= bottom)                                            \
 	{                                                                \
 		key = (top + bottom) / 2;                                \
+		found = index_item(array, key);                          \
 		cmp = (test);                                            \
 		if (cmp == 0)                                            \
-			cmp = item < 0 ? cmp : item - array->index[key]; \
+			cmp = item < 0 ? cmp : item - found;             \
 		if (cmp == 0)                                            \
 			return key;                                      \
 		if (cmp < 0)                                             \
@@ -290,88 +644,15 @@ static long	(fn) (an_array *array, char *find, long item)            \
 	}                                                                \
 	return ~bottom;                                                  \
 }
-FINDIT(find_item, strcmp(find, array->item[array->index[key]]), 0)
-FINDIT(find_items, strncmp(find, array->item[array->index[key]], len), strlen(find))
+FINDIT(find_item, strcmp(find, array->item[found]), 0)
+FINDIT(find_items, strncmp(find, array->item[found], len), strlen(find))
 #undef FINDIT
 
-/*
- * insert_index() takes a valid index (newIndex) and inserts it into the array
- * **index, then increments the *size of the index array.
- */
-static void	insert_index (long **idx, long *size, long newIndex)
-{
-	long cnt;
-
-	if (*size)
-		RESIZE(*idx, long, *size + 1);
-	else
-	{
-		*idx = (long *)new_malloc(sizeof(long));
-		newIndex = 0;
-	}
-	
-	for (cnt = *size; cnt > newIndex; cnt--)
-		(*idx)[cnt] = (*idx)[cnt - 1];
-	(*idx)[newIndex] = *size;
-	(*size)++;
-}
-
-/*
- * move_index() moves the array.index[] up or down to make room for new entries
- * or to clean up so an entry can be deleted.
- */
-static void		move_index (an_array *array, long oldindex, long newindex)
-{
-	long temp;
-
-	if (newindex > oldindex)
-		newindex--;
-	if (newindex == oldindex)
-		return;
-	
-	temp = array->index[oldindex];
-
-	if (oldindex < newindex)
-		for (; oldindex < newindex; oldindex++)
-			array->index[oldindex] = array->index[oldindex + 1];
-	else
-		for(; oldindex > newindex; oldindex--)
-			array->index[oldindex] = array->index[oldindex - 1];
-	
-	array->index[newindex] = temp;
-}
-
-/*
- * find_index() attempts to take an item and discover the index number
- * that refers to it.  find_index() assumes that find_item() WILL always return
- * a positive or zero result (be successful) because find_index() assumes that
- * the item is valid, and thus a find will be successful.  I don't know what
- * value ARRAY_THRESHOLD ought to be.  I figured someone smarter than I am
- * could figure it out and tell me or tell me to abandon the entire idea.
- */
-static long		find_index (an_array *array, long item)
-{
-	long srch = 0;
-
-	if (array->size >= ARRAY_THRESHOLD)
-	{
-		srch = find_item(array, array->item[item], item);
-		qsort_array = array;
-		while (srch >= 0 && !compare_indices(&array->index[srch], &item))
-			srch--;
-		srch++;
-	}
-	while(array->index[srch] != item && srch < array->size)
-		srch++;
-
-	if (srch < 0 || srch >= array->size)
-		say("ERROR in find_index(): ! 0 <= %ld < %ld", srch, array->size);	
-	return srch;
-}
-
 /*
  * get_array() searches and finds the array referenced by *name.  It returns
- * a pointer to the array, or a null pointer on failure to find it.
+ * a pointer to the array, or a null pointer on failure to find it.  The
+ * last array found is remembered, since scripts tend to hit the same
+ * array many times in a row.
  */
 an_array *	get_array (char *name)
 {
@@ -380,8 +661,13 @@ an_array *	get_array (char *name)
 	if (array_info.size && *name)
         {
                 upper(name);
+		if (last_array >= 0 && !strcmp(name, array_info.item[last_array]))
+			return &array_array[last_array];
                 if ((idx = find_item(&array_info, name, -1)) >= 0)
-                        return &array_array[array_info.index[idx]];
+		{
+			last_array = index_item(&array_info, idx);
+                        return &array_array[last_array];
+		}
 	}
 	return NULL;
 }
@@ -393,44 +679,25 @@ an_array *	get_array (char *name)
  */
 static void		delete_array (char *name)
 {
-        char **ptr;
-        long cnt;
         long idx;
         long item;
-        an_array *array;
 
         idx = find_item(&array_info, name, -1);
-        item = array_info.index[idx];
-        array = &array_array[item];
-        for (ptr=array->item, cnt=0; cnt < array->size; cnt++, ptr++)
-                new_free((char **)ptr);
-        new_free((char **)&array->item);
-        new_free((char **)&array->index);
-        new_free((char **)&array_info.item[item]);
+        item = index_item(&array_info, idx);
+	free_array(&array_array[item]);
+	last_array = -1;
 
         if (array_info.size > 1)
         {
-                for(cnt = 0; cnt < array_info.size; cnt++)
-                        if (array_info.index[cnt] > item)
-                                (array_info.index[cnt])--;
-
-                move_index(&array_info, idx, array_info.size);
-                array_info.size--;
-                for(ptr=&array_info.item[item], cnt=item; cnt < array_info.size; cnt++, ptr++, array++)
-                {
-                        *ptr = *(ptr + 1);
-                        *array = *(array + 1);
-                }
-				RESIZE(array_info.item, char *, array_info.size);
-				RESIZE(array_info.index, long, array_info.size);
-				RESIZE(array_array, an_array, array_info.size);
+		remove_item(&array_info, item);
+		memmove(array_array + item, array_array + item + 1,
+				(array_info.size - item) * sizeof(*array_array));
         }
         else
         {
-                new_free((char **)&array_info.item);
-                new_free((char **)&array_info.index);
+		free_array(&array_info);
                 new_free((char **)&array_array);
-                array_info.size = 0;
+		array_info.unsorted = 1;
         }
 }
 
@@ -441,39 +708,31 @@ static void		delete_array (char *name)
 int set_item (char* name, long item, char* input, int unsorted)
 {
 	long idx = 0;
-	long oldindex;
 	an_array *array;
 	int result = -1;
-	if (array_info.size && ((idx = find_item(&array_info, name, -1)) >= 0))
+
+	if ((array = get_array(name)))
 	{
-		array =  &array_array[array_info.index[idx]];
 		result = -2;
 		if (item < array->size)
 		{
 			if (unsorted || array->unsorted) {
 				array->unsorted = 1;
+				malloc_strcpy(&array->item[item], input);
 			} else {
-				oldindex = find_index(array, item);
-				idx = find_item(array, input, item);
-				idx = (idx >= 0) ? idx : (-idx) - 1;
-				move_index(array, oldindex, idx);
+				node_remove(array, item);
+				malloc_strcpy(&array->item[item], input);
+				node_insert(array, item);
 			}
-			malloc_strcpy(&array->item[item], input);
 			result = 0;
 		}
 		else if (item == array->size)
 		{
-			RESIZE(array->item, char *, array->size + 1);
-			array->item[item] = NULL;
-			malloc_strcpy(&array->item[item], input);
-			if (unsorted || array->unsorted) {
+			append_item(array, input);
+			if (unsorted || array->unsorted)
 				array->unsorted = 1;
-				idx = item;
-			} else {
-				idx = find_item(array, input, item);
-				idx = (idx >= 0) ? idx : (-idx) - 1;
-			}
-			insert_index(&array->index, &array->size, idx);
+			else
+				node_insert(array, item);
 			result = 2;
 		}
 	}
@@ -481,19 +740,16 @@ int set_item (char* name, long item, char* input, int unsorted)
 	{
 		if (item == 0)
 		{
-			RESIZE(array_array, an_array, array_info.size + 1);
-			array = &array_array[array_info.size];
-			array->size = 1;
-			array->item = (char **)new_malloc(sizeof(char *));
-			array->index = (long *)new_malloc(sizeof(long));
-			array->item[0] = NULL;
-			array->index[0] = 0;
+			idx = array_info.size;
+			if (idx == array_info.capacity)
+				RESIZE(array_array, an_array, array_info.capacity ? array_info.capacity * 2 : 4);
+			array = &array_array[idx];
+			memset(array, 0, sizeof(*array));
 			array->unsorted = 1;
-			malloc_strcpy(&array->item[0], input);
-			RESIZE(array_info.item, char *, array_info.size + 1);
-			array_info.item[array_info.size] = NULL;
-			malloc_strcpy(&array_info.item[array_info.size], name);
-			insert_index(&array_info.index, &array_info.size, (-idx) - 1);
+			append_item(array, input);
+			append_item(&array_info, name);
+			if (!array_info.unsorted)
+				node_insert(&array_info, idx);
 			result = 1;
 		}
 	}
@@ -553,22 +809,33 @@ BUILT_IN_FUNCTION((fn), input)                                               \
 	char    *name = NULL;                                          \
 	long    idx;                                                       \
 	an_array *array;                                                     \
+	size_t	clue = 0, size = 0;                                          \
                                                                              \
 	if ((name = next_arg(input, &input)) &&                              \
 	    (array = get_array(name)) && input)                              \
 	{                                                                    \
 	    do pre while (0);                                                \
 	    for (idx = 0; idx < array->size; idx++)                    \
-		if (wild_match((wm1), (wm2)) > 0)                            \
-		    malloc_strcat_wordlist(&result, space, ltoa(idx));       \
+	    {                                                                \
+		if (wild_match((wm1), (wm2)) <= 0)                           \
+		    continue;                                                \
+		/* A long and a space always fit in 24 bytes */              \
+		if (clue + 24 > size)                                        \
+		{                                                            \
+		    size = size ? size * 2 : 128;                            \
+		    RESIZE(result, char, size);                              \
+		}                                                            \
+		clue += snprintf(result + clue, size - clue,                 \
+				clue ? " %ld" : "%ld", idx);                 \
+	    }                                                                \
 	}                                                                    \
                                                                              \
 	RETURN_MSTR(result);                                                 \
 }
 GET_MATCHES(function_getmatches, input, array->item[idx], {})
 GET_MATCHES(function_getrmatches, array->item[idx], input, {})
-GET_MATCHES(function_igetmatches, input, array->item[array->index[idx]], SORT_INDICES(array))
-GET_MATCHES(function_igetrmatches, array->item[array->index[idx]], input, SORT_INDICES(array))
+GET_MATCHES(function_igetmatches, input, array->item[array->index[idx]], {build_index(array);})
+GET_MATCHES(function_igetrmatches, array->item[array->index[idx]], input, {build_index(array);})
 #undef GET_MATCHES
 
 
@@ -614,7 +881,7 @@ BUILT_IN_FUNCTION((fn), input)                                               \
 	RETURN_MSTR(retval);                                                 \
 }
 GETITEM(function_getitem, array->item[item], {})
-GETITEM(function_igetitem, array->item[array->index[item]], SORT_INDICES(array))
+GETITEM(function_igetitem, array->item[index_item(array, item)], {})
 #undef GETITEM
 
 /*
@@ -664,6 +931,7 @@ BUILT_IN_FUNCTION(function_getarrays, input)
 	long idx;
 	char *result = NULL;
 
+	build_index(&array_info);
 	for (idx = 0; idx < array_info.size; idx++)
 		if (!input || !*input || wild_match(input, array_info.item[array_info.index[idx]]))
 			malloc_strcat_wordlist(&result, space, array_info.item[array_info.index[idx]]);
@@ -708,9 +976,9 @@ BUILT_IN_FUNCTION((func), input)                                            \
         }                                                                   \
 	RETURN_INT(item);                                                   \
 }
-FINDI(function_finditem, find_item, array->index[item], -2)
+FINDI(function_finditem, find_item, index_item(array, item), -2)
 FINDI(function_ifinditem, find_item, item, -2)
-FINDI(function_finditems, find_items, array->index[item], ~(array->index[~item]))
+FINDI(function_finditems, find_items, index_item(array, item), ~item < array->size ? ~index_item(array, ~item) : ~array->size)
 FINDI(function_ifinditems, find_items, item, item)
 #undef FINDI
 
@@ -747,7 +1015,7 @@ BUILT_IN_FUNCTION((fn), input)                                             \
 	else                                                               \
 		RETURN_INT(found);                                         \
 }
-I2I(function_indextoitem, array->index[item])
+I2I(function_indextoitem, index_item(array, item))
 I2I(function_itemtoindex, find_index(array, item))
 #undef I2I
 
@@ -766,11 +1034,7 @@ BUILT_IN_FUNCTION(function_delitem, input)
 {
 	char *name;
 	char *itemstr;
-	char **strptr;
 	long item;
-	long cnt;
-	long oldindex;
-	long more;
 	an_array *array;
 	long found = -1;
 
@@ -789,26 +1053,7 @@ BUILT_IN_FUNCTION(function_delitem, input)
 					break;
 				}
 				else
-				{
-					if (item == array->index[item])
-						oldindex = item;
-					else
-						oldindex = find_index(array, item);
-					more = array->size - item;
-					for (cnt = array->size; --cnt >= 0 && more;)
-						if (array->index[cnt] >= item)
-							more--,
-							(array->index[cnt])--;
-					move_index(array, oldindex, array->size);
-					new_free(&array->item[item]);
-					array->size--;
-					for (strptr=&(array->item[item]), cnt=item; 
-							cnt < array->size; 
-							cnt++, strptr++)
-						*strptr = *(strptr + 1);
-					RESIZE(array->item, char *, array->size);
-					RESIZE(array->index, long, array->size);
-				}
+					remove_item(array, item);
 			}
 		}
 	}
@@ -854,12 +1099,11 @@ BUILT_IN_FUNCTION(function_delitems, input)
 			for (cnt = 0; cnt < array->size; cnt++)
 				if (array->item[cnt])
 					array->item[new++] = array->item[cnt];
+			for (cnt = new; cnt < array->size; cnt++)
+				array->item[cnt] = NULL;
+			free_nodes(array);
 			array->unsorted = 1;
 			array->size -= deleted;
-			for (cnt = 0; cnt < array->size; cnt++)
-				(array->index[cnt]) = cnt;
-			RESIZE(array->item, char *, array->size);
-			RESIZE(array->index, long, array->size);
 		}
 	}
 	RETURN_INT(found);
@@ -900,9 +1144,8 @@ BUILT_IN_FUNCTION(function_ifindfirst, input)
 				item = -2;
 			else
 			{
-				while (item >= 0 && !strcmp(array->item[array->index[item]], input))
+				while (item > 0 && !strcmp(array->item[index_item(array, item - 1)], input))
 					item--;
-				item++;
 			}
 		}
         }
@@ -75,6 +75,7 @@
 #include "reg.h"
 #include "extlang.h"
 #include "elf.h"
+#include "profiler.h"
 
 /* used with input_move_cursor */
 #define RIGHT 1
@@ -620,6 +621,7 @@ BUILT_IN_COMMAND(describe)
 	if (target && args && *args)
 	{
 		char	*message;
+		const char	*old_from_nick;
 		int	l;
 
 		if (!strcmp(target, "*"))
@@ -628,11 +630,14 @@ BUILT_IN_COMMAND(describe)
 
 		message = args;
 
+		old_from_nick = FromNick;
+		FromNick = empty_string;
 		l = message_from(target, LEVEL_ACTION);
 		send_ctcp(1, target, "ACTION", "%s", message);
 		if (do_hook(SEND_ACTION_LIST, "%s %s", target, message))
 			put_it("* -> %s: %s %s", target, get_server_nickname(from_server), message);
 		pop_message_from(l);
+		FromNick = old_from_nick;
 	}
 	else
 		say("Usage: /DESCRIBE <[=]nick|channel|*> <action description>");
@@ -1583,6 +1588,7 @@ struct load_info
 	int	line;
 	int	start_line;
 	struct stat sb;
+	struct load_cache *cache;
 } load_level[MAX_LOAD_DEPTH];
 
 int 	load_depth = -1;
@@ -1673,6 +1679,9 @@ BUILT_IN_COMMAND(subpackagecmd)
 static void	loader_which (const char *file_contents, off_t file_contents_size, const char *filename, const char *args, struct load_info *);
 static void	loader_std (const char *file_contents, off_t file_contents_size, const char *filename, const char *args, struct load_info *);
 static void	loader_pf  (const char *file_contents, off_t file_contents_size, const char *filename, const char *args, struct load_info *);
+static void	loader_cache (const char *loader_name, const char *args, struct load_info *);
+static void	recode_script (const char *filename, const char *encoding, char **file_contents, off_t *file_contents_size);
+static int	take_prefetched_file (char **filename, const char *path, char **file_contents, off_t *file_contents_size, struct stat *sb);
 
 /*
  * load: the /LOAD command.  Reads the named file, parsing each line as
@@ -1691,6 +1700,9 @@ BUILT_IN_COMMAND(load)
 	void	(*loader) (const char *, off_t, const char *, const char *, struct load_info *);
 	char *	file_contents = NULL;
 	off_t	file_contents_size = 0;
+	int	mapped;
+	const char *	loader_name;
+	struct load_cache *cache;
 	/* This should default to /SET DEFAULT_SCRIPT_ENCODING */
 	const char *	declared_encoding = NULL;
 
@@ -1709,6 +1721,7 @@ BUILT_IN_COMMAND(load)
 	load_level[load_depth].package_set_here = 0;
 	load_level[load_depth].line = 0;
 	load_level[load_depth].start_line = 0;
+	load_level[load_depth].cache = NULL;
 	/* What to do with load_level[load_depth].sb? */
 
 	display = swap_window_display(0);
@@ -1771,41 +1784,87 @@ BUILT_IN_COMMAND(load)
 		continue;
 	    }
 
-	    /*
-	     * uzfopen emits an error if the file is not found, so we dont.
-	     * uzfopen() also frees 'expanded' for us on error.
-	     */
 	    expanded = malloc_strdup(filename);
+	    loader_name = (loader == loader_pf) ? "pf" : "std";
+	    cache = NULL;
+	    mapped = 0;
 
-	    /* Read the file into a string */
-            if (!(elf = uzfopen(&expanded, use_path, 1, 
-				&load_level[load_depth].sb)))
-                continue;
-
-	    if (slurp_elf_file(elf, &file_contents, &file_contents_size) > 0)
+	    /* If load_prefetch() already read the file, use that. */
+	    if (take_prefetched_file(&expanded, use_path, &file_contents, 
+			&file_contents_size, &load_level[load_depth].sb))
 	    {
 		if (invalid_utf8str(file_contents))
-		{
-		    size_t	really;
+		    recode_script(expanded, declared_encoding, 
+				&file_contents, &file_contents_size);
+	    }
 
-		    really = file_contents_size;
-		    if ((off_t)really != file_contents_size)
-			privileged_yell("Loading a non-utf8 file whose size is greater than size_t will probably have problems");
+	    /*
+	     * Otherwise, read the file into a string.
+	     * uzfopen emits an error if the file is not found, so we dont.
+	     * uzfopen() also frees 'expanded' for us on error.
+	     */
+	    else
+	    {
+		if (!(elf = uzfopen(&expanded, use_path, 1, 
+				    &load_level[load_depth].sb)))
+		    continue;
 
-		    say("Recoding %s using encoding %s", 
-				expanded, declared_encoding);
-		    recode_with_iconv(declared_encoding, NULL, 
-				&file_contents, &really);
+		/*
+		 * If the file was loaded before and hasn't changed since,
+		 * then we can replay it from the load cache and don't need 
+		 * to read it at all.  Otherwise, ordinary files are mapped 
+		 * rather than copied into memory.
+		 */
+		if (loader != loader_which)
+		    cache = load_cache_open(elf, expanded, loader_name);
 
-		    file_contents_size = (off_t)really;
-	        }
+		if (load_cache_replaying(cache))
+		    ;
+		else if (map_elf_file(elf, &file_contents, &file_contents_size))
+		{
+		    mapped = 1;
+		    if (invalid_utf8str(file_contents))
+		    {
+			/* Recoding needs a copy it can change */
+			char *	copy;
+
+			copy = new_malloc(file_contents_size + 1);
+			memcpy(copy, file_contents, file_contents_size);
+			copy[file_contents_size] = 0;
+			unmap_elf_file(file_contents, file_contents_size);
+			file_contents = copy;
+			mapped = 0;
+
+			recode_script(expanded, declared_encoding, 
+				    &file_contents, &file_contents_size);
+			load_cache_fail(cache);
+		    }
+		}
+		else if (slurp_elf_file(elf, &file_contents, &file_contents_size) > 0)
+		{
+		    if (invalid_utf8str(file_contents))
+		    {
+			recode_script(expanded, declared_encoding, 
+				    &file_contents, &file_contents_size);
+			load_cache_fail(cache);
+		    }
+		}
+		epic_fclose(elf);
+		new_free(&elf);
 	    }
-	    epic_fclose(elf);
-	    new_free(&elf);
 
 	    /* If no file resulted, then we're done. */
-	    if (!file_contents || !*file_contents)
+	    if (!load_cache_replaying(cache) && 
+			(!file_contents || !*file_contents))
+	    {
+		load_cache_close(&cache);
+		if (mapped)
+		    unmap_elf_file(file_contents, file_contents_size);
+		else
+		    new_free(&file_contents);
+		file_contents = NULL;
 		continue;
+	    }
 
 	    /* Now process the file */
             load_level[load_depth].filename = expanded;
@@ -1814,15 +1873,28 @@ BUILT_IN_COMMAND(load)
 	        malloc_strcpy(&load_level[load_depth].package,
 				load_level[load_depth-1].package);
 
+	    load_level[load_depth].cache = cache;
 	    will_catch_return_exceptions++;
-	    loader(file_contents, file_contents_size, expanded, 
+	    if (load_cache_replaying(cache))
+		loader_cache(loader_name, sargs, &load_level[load_depth]);
+	    else
+		loader(file_contents, file_contents_size, expanded, 
 			sargs, &load_level[load_depth]);
 	    will_catch_return_exceptions--;
+
+	    /* A load that was cut short by /RETURN is not cached */
+	    if (!return_exception)
+		load_cache_save(cache);
+	    load_cache_close(&load_level[load_depth].cache);
 	    return_exception = 0;
 
 	    new_free(&load_level[load_depth].filename);
 	    new_free(&load_level[load_depth].package);
-	    new_free(&file_contents);
+	    if (mapped)
+		unmap_elf_file(file_contents, file_contents_size);
+	    else
+		new_free(&file_contents);
+	    file_contents = NULL;
 	}
 
 	/*
@@ -1846,6 +1918,412 @@ BUILT_IN_COMMAND(load)
 	load_depth--;
 }
 
+/*
+ * Startup prefetch
+ *
+ * Script packs are often compressed, and /LOAD decompresses them one at
+ * a time as it comes to them, waiting on gunzip (or bunzip2) each time.
+ * Before the startup file is loaded, load_prefetch() looks through it
+ * for /LOADs of plain filenames, and through the files those load, and
+ * so on, and runs the decompressors for the compressed ones side by side
+ * (as many at once as there are cpus), collecting their output as it 
+ * arrives.  When the startup file
+ * gets around to /LOADing them, take_prefetched_file() hands over what
+ * is already in memory.  The scripts are still run by /LOAD, in the 
+ * same order as always; this only gets the reading out of the way.
+ *
+ * Uncompressed files are looked through but not kept, since /LOAD
+ * maps them, and that costs nothing.
+ */
+#define MAX_PREFETCH 128
+
+struct prefetch
+{
+	char *	name;		/* The filename as it was given to /LOAD */
+	char *	fullname;	/* The file that uzfopen() found */
+	struct epic_loadfile *elf;	/* The decompressor, while it runs */
+	char *	data;		/* What the decompressor wrote */
+	size_t	len;
+	size_t	size;
+	int	depth;
+	int	queued;		/* Not started yet */
+	struct stat sb;
+};
+
+static	struct prefetch	prefetched[MAX_PREFETCH];
+static	int		prefetch_count = 0;
+static	char *		prefetch_path = NULL;
+
+static void	prefetch_file (const char *name, int depth);
+
+/*
+ * prefetch_scan - Look for "/LOAD filename" lines in a script and 
+ * prefetch each file.  Filenames with expandos or quoting in them 
+ * can't be known until the line is run, so they are left alone.
+ */
+static void	prefetch_scan (const char *contents, int depth)
+{
+	const char *	line;
+	const char *	eol;
+	char *	copy;
+	char *	args;
+	char *	word;
+	size_t	len, wlen;
+	int	last_one;
+
+	if (depth >= MAX_LOAD_DEPTH)
+		return;
+
+	for (line = contents; line && *line; line = eol ? eol + 1 : NULL)
+	{
+		eol = strchr(line, '\n');
+		len = eol ? (size_t)(eol - line) : strlen(line);
+
+		while (len && my_isspace(*line))
+			line++, len--;
+		if (len && *line == '/')
+			line++, len--;
+		if (len < 6 || my_strnicmp(line, "LOAD", 4) || 
+				!my_isspace(line[4]))
+			continue;
+
+		copy = new_malloc(len - 3);
+		memcpy(copy, line + 4, len - 4);
+		copy[len - 4] = 0;
+
+		args = copy;
+		last_one = 0;
+		while ((word = next_arg(args, &args)))
+		{
+			/* These are the same flags that /LOAD takes */
+			if (*word == '-')
+			{
+				wlen = strlen(word);
+				if (!my_strnicmp(word, "-pf", wlen) ||
+				    !my_strnicmp(word, "-std", wlen))
+					continue;
+				else if (!my_strnicmp(word, "-args", wlen))
+					last_one = 1;
+				else if (!my_strnicmp(word, "-encoding", wlen))
+					next_arg(args, &args);
+				continue;
+			}
+
+			if ((wlen = strlen(word)) && word[wlen - 1] == ';')
+				word[wlen - 1] = 0;
+			if (*word && !strpbrk(word, "$\\{}()[];\"'"))
+				prefetch_file(word, depth + 1);
+			if (last_one)
+				break;
+		}
+		new_free(&copy);
+	}
+}
+
+/*
+ * prefetch_file - Queue up a file to be found and read by prefetch_wait().
+ */
+static void	prefetch_file (const char *name, int depth)
+{
+	struct prefetch *	p;
+	int		i;
+
+	if (prefetch_count >= MAX_PREFETCH)
+		return;
+	for (i = 0; i < prefetch_count; i++)
+		if (!strcmp(prefetched[i].name, name))
+			return;
+
+	p = &prefetched[prefetch_count++];
+	p->name = malloc_strdup(name);
+	p->fullname = NULL;
+	p->elf = NULL;
+	p->data = NULL;
+	p->len = p->size = 0;
+	p->depth = depth;
+	p->queued = 1;
+}
+
+/*
+ * prefetch_start - Find a file the way /LOAD would.  If it's compressed,
+ * leave the decompressor running for prefetch_wait(); otherwise, look 
+ * through it right away.
+ */
+static void	prefetch_start (struct prefetch *p)
+{
+	struct epic_loadfile *	elf;
+	struct stat	st;
+	char *		contents = NULL;
+	off_t		size = 0;
+
+	p->queued = 0;
+	memset(&p->sb, 0, sizeof(p->sb));
+	p->fullname = malloc_strdup(p->name);
+	if (!(elf = uzfopen(&p->fullname, prefetch_path, 0, &p->sb)))
+		return;
+
+	if (elf->fp && fstat(fileno(elf->fp), &st) == 0 && S_ISFIFO(st.st_mode))
+	{
+		p->elf = elf;
+		return;
+	}
+
+	if (map_elf_file(elf, &contents, &size))
+	{
+		prefetch_scan(contents, p->depth);
+		unmap_elf_file(contents, size);
+	}
+	else
+	{
+		if (slurp_elf_file(elf, &contents, &size) > 0)
+			prefetch_scan(contents, p->depth);
+		new_free(&contents);
+	}
+	epic_fclose(elf);
+	new_free(&elf);
+}
+
+/*
+ * prefetch_wait - Run the decompressors, one per cpu at a time, and 
+ * collect their output.  Each file is looked through as soon as it's 
+ * done, which may queue up more files.
+ */
+static void	prefetch_wait (void)
+{
+	struct prefetch *p;
+	fd_set	rd;
+	int	i, fd, maxfd, count, running, max_running = 1;
+	ssize_t	n;
+
+#ifdef _SC_NPROCESSORS_ONLN
+	if ((max_running = (int)sysconf(_SC_NPROCESSORS_ONLN)) < 1)
+		max_running = 1;
+#endif
+
+	for (;;)
+	{
+		running = 0;
+		for (i = 0; i < prefetch_count; i++)
+			if (prefetched[i].elf)
+				running++;
+		for (i = 0; i < prefetch_count && running < max_running; i++)
+		{
+			if (!prefetched[i].queued)
+				continue;
+			prefetch_start(&prefetched[i]);
+			if (prefetched[i].elf)
+				running++;
+		}
+
+		FD_ZERO(&rd);
+		maxfd = -1;
+		count = prefetch_count;
+		for (i = 0; i < count; i++)
+		{
+			if (!prefetched[i].elf)
+				continue;
+			fd = fileno(prefetched[i].elf->fp);
+			FD_SET(fd, &rd);
+			if (fd > maxfd)
+				maxfd = fd;
+		}
+		if (maxfd == -1)
+			break;
+
+		if (select(maxfd + 1, &rd, NULL, NULL, NULL) < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+
+		for (i = 0; i < count; i++)
+		{
+			p = &prefetched[i];
+			if (!p->elf || !FD_ISSET(fileno(p->elf->fp), &rd))
+				continue;
+
+			if (p->len + 8192 >= p->size)
+			{
+				p->size = p->size ? p->size * 2 : 65536;
+				RESIZE(p->data, char, p->size);
+			}
+
+			n = read(fileno(p->elf->fp), p->data + p->len, 
+					p->size - p->len - 1);
+			if (n < 0 && errno == EINTR)
+				continue;
+			if (n > 0)
+			{
+				p->len += n;
+				continue;
+			}
+
+			p->data[p->len] = 0;
+			epic_fclose(p->elf);
+			new_free(&p->elf);
+
+			/* If it failed, /LOAD can try it again */
+			if (n < 0)
+				new_free(&p->data);
+			else
+				prefetch_scan(p->data, p->depth);
+		}
+	}
+
+	/* Anything still running, /LOAD will have to do itself */
+	for (i = 0; i < prefetch_count; i++)
+	{
+		if (!(p = &prefetched[i])->elf)
+			continue;
+		epic_fclose(p->elf);
+		new_free(&p->elf);
+		new_free(&p->data);
+	}
+}
+
+/*
+ * load_prefetch - Read ahead the scripts that 'filename' will /LOAD.
+ * Call load_prefetch_done() after loading 'filename' to throw away 
+ * anything that wasn't used.
+ */
+void	load_prefetch (const char *filename)
+{
+	const char *	path;
+
+	if (!filename || !(path = get_string_var(LOAD_PATH_VAR)))
+		return;
+
+	malloc_strcpy(&prefetch_path, path);
+	prefetch_file(filename, 0);
+	prefetch_wait();
+}
+
+void	load_prefetch_done (void)
+{
+	int	i;
+
+	for (i = 0; i < prefetch_count; i++)
+	{
+		new_free(&prefetched[i].name);
+		new_free(&prefetched[i].fullname);
+		new_free(&prefetched[i].data);
+	}
+	prefetch_count = 0;
+	new_free(&prefetch_path);
+}
+
+/*
+ * take_prefetched_file - If load_prefetch() read 'filename' (looking in
+ * the same LOAD_PATH), then hand over its contents (which you must free),
+ * its stat, and the full filename in (*filename).  Each prefetched file 
+ * is only handed over once; a second /LOAD of it reads it again.
+ */
+static int	take_prefetched_file (char **filename, const char *path, char **file_contents, off_t *file_contents_size, struct stat *sb)
+{
+	struct prefetch *p;
+	int	i;
+
+	if (!prefetch_path || strcmp(path, prefetch_path))
+		return 0;
+
+	for (i = 0; i < prefetch_count; i++)
+	{
+		p = &prefetched[i];
+		if (!p->data || strcmp(p->name, *filename))
+			continue;
+
+		*file_contents = p->data;
+		*file_contents_size = (off_t)p->len;
+		*sb = p->sb;
+		malloc_strcpy(filename, p->fullname);
+		p->data = NULL;
+		return 1;
+	}
+	return 0;
+}
+
+/*
+ * recode_script - Convert a non-utf8 script to utf8 before loading it.
+ */
+static void	recode_script (const char *filename, const char *encoding, char **file_contents, off_t *file_contents_size)
+{
+	size_t	really;
+
+	really = *file_contents_size;
+	if ((off_t)really != *file_contents_size)
+		privileged_yell("Loading a non-utf8 file whose size is greater than size_t will probably have problems");
+
+	say("Recoding %s using encoding %s", filename, encoding);
+	recode_with_iconv(encoding, NULL, file_contents, &really);
+
+	*file_contents_size = (off_t)really;
+}
+
+/*
+ * The loaders tell the load cache about everything they do that depends 
+ * on the contents of the file -- every statement they run, and every 
+ * error they report -- so it can be replayed by loader_cache() the next 
+ * time the file is loaded.  Alias and ON definitions are cached as the 
+ * statements that create them.
+ *	'S'	- parse_statement() a statement
+ *	'P'	- call_lambda_command() a pre-formatted block
+ *	'E'	- my_error() a message
+ *	'Y'	- yell() a message
+ */
+static void	load_statement (struct load_info *loadinfo, const char *statement)
+{
+	load_cache_record(loadinfo->cache, 'S', loadinfo->line, statement);
+	parse_statement(statement, 0, NULL);
+}
+
+static void	load_message (struct load_info *loadinfo, int type, const char *format, ...)
+{
+	char	buffer[BIG_BUFFER_SIZE + 1];
+	va_list	args;
+
+	va_start(args, format);
+	vsnprintf(buffer, sizeof(buffer), format, args);
+	va_end(args);
+
+	load_cache_record(loadinfo->cache, type, loadinfo->line, buffer);
+	if (type == 'E')
+		my_error("%s", buffer);
+	else
+		yell("%s", buffer);
+}
+
+/* The "CACHE" loader -- replays what a loader did the last time */
+static void	loader_cache (const char *loader_name, const char *subargs, struct load_info *loadinfo)
+{
+	int	type, line;
+	char *	text;
+
+	loadinfo->loader = loader_name;
+	while (load_cache_next(loadinfo->cache, &type, &line, &text))
+	{
+		loadinfo->line = line;
+		switch (type)
+		{
+			case 'S':
+				parse_statement(text, 0, NULL);
+				break;
+			case 'P':
+				call_lambda_command("LOAD", text, subargs);
+				break;
+			case 'E':
+				my_error("%s", text);
+				break;
+			case 'Y':
+				yell("%s", text);
+				break;
+		}
+
+		if (return_exception)
+			return;
+	}
+}
+
 /* The "WHICH" loader */
 static void	loader_which (const char *file_contents, off_t file_contents_size, const char *filename, const char *subargs, struct load_info *loadinfo)
 {
@@ -1883,7 +2361,8 @@ static void	loader_std (const char *file_contents, off_t file_contents_size, con
             if (loadinfo->line == 1 && loadinfo->sb.st_mode & 0111 &&
 	    	(buffer[0] != '#' || buffer[1] != '!'))
 	    {
-	    	yell("Caution -- %s is marked as an executable; "
+	    	load_message(loadinfo, 'Y', 
+		     "Caution -- %s is marked as an executable; "
 		     "loading binaries results in undefined behavior.", 
 		     loadinfo->filename);
 	    }
@@ -1953,7 +2432,7 @@ static void	loader_std (const char *file_contents, off_t file_contents_size, con
 		{
 		    if (!paste_level)
 		    {
-			parse_statement(current_row, 0, NULL);
+			load_statement(loadinfo, current_row);
 			new_free(&current_row);
 
 			if (return_exception)
@@ -2002,8 +2481,12 @@ static void	loader_std (const char *file_contents, off_t file_contents_size, con
 			 * beginning of a line (if ON) or anywhere (if OFF).
 			 * This is needed because some older scripts (phoenix,
 			 * textbox, etc) may use slash-star in some ascii 
-			 * graphics.
+			 * graphics.  (Since that's not up to the file, a
+			 * file where it matters can't be cached.)
 			 */
+			if (ptr[1] == '*' && ptr != real_start)
+			    load_cache_fail(loadinfo->cache);
+
 			if ((ptr[1] == '*') && 
 			    (!get_int_var(COMMENT_HACK_VAR) || 
 			     ptr == real_start))
@@ -2023,7 +2506,7 @@ static void	loader_std (const char *file_contents, off_t file_contents_size, con
 				/* If we are NOT in a block alias, */
 				if (paste_level == 0)
 				{
-				    parse_statement(current_row, 0, NULL);
+				    load_statement(loadinfo, current_row);
 				    new_free(&current_row);
 				    if (return_exception)
 					return;
@@ -2066,7 +2549,8 @@ static void	loader_std (const char *file_contents, off_t file_contents_size, con
 
 			if (!paste_level)
 			{
-				my_error("Unexpected } in %s, line %d",
+				load_message(loadinfo, 'E', 
+					"Unexpected } in %s, line %d",
 					filename, loadinfo->line);
 				break;
 			}
@@ -2093,7 +2577,7 @@ static void	loader_std (const char *file_contents, off_t file_contents_size, con
 			/* Semicolon at the end of line, not within {}s */
 			if (ptr[1] == 0 && !paste_level)
 			{
-			    parse_statement(current_row, 0, NULL);
+			    load_statement(loadinfo, current_row);
 			    new_free(&current_row);
 			    if (return_exception)
 				return;
@@ -2123,20 +2607,22 @@ static void	loader_std (const char *file_contents, off_t file_contents_size, con
 	} /* End of for(;;line++) */
 
 	if (in_comment)
-	    my_error("File %s ended with an unterminated comment in line %d",
+	    load_message(loadinfo, 'E', 
+			"File %s ended with an unterminated comment in line %d",
 			filename, comment_line);
 
 	if (current_row)
 	{
 	    if (paste_level)
 	    {
-		my_error("Unexpected EOF in %s trying to match '{' at line %d",
+		load_message(loadinfo, 'E', 
+				"Unexpected EOF in %s trying to match '{' at line %d",
 				filename, paste_line);
 	        new_free(&current_row);
 	    }
 	    else
 	    {
-		parse_statement(current_row, 0, NULL);
+		load_statement(loadinfo, current_row);
 	        new_free(&current_row);
 	        if (return_exception)
 			return;
@@ -2216,7 +2702,8 @@ static void	loader_pf (const char *file_contents, off_t file_contents_size, cons
 
 	    if (shebang == 0)
 	    {
-		yell("Cannot open %s -- executable file", 
+		load_message(loadinfo, 'Y', 
+			"Cannot open %s -- executable file", 
 			loadinfo->filename); 
 		new_free(&buffer);
 		return;
@@ -2273,6 +2760,7 @@ static void	loader_pf (const char *file_contents, off_t file_contents_size, cons
 	}
 
 	buffer[pos] = 0;
+	load_cache_record(loadinfo->cache, 'P', loadinfo->line, buffer);
 	call_lambda_command("LOAD", buffer, subargs);
 	new_free(&buffer);
 }
@@ -2286,16 +2774,20 @@ BUILT_IN_COMMAND(mecmd)
 	if (args && *args)
 	{
 		const char	*target;
+		const char	*old_from_nick;
 		int	l;
 
 		if ((target = get_window_target(0)) != NULL)
 		{
 			send_ctcp(1, target, "ACTION", "%s", args);
 
+			old_from_nick = FromNick;
+			FromNick = empty_string;
 			l = message_from(target, LEVEL_ACTION);
 			if (do_hook(SEND_ACTION_LIST, "%s %s", target, args))
 				put_it("* %s %s", get_server_nickname(from_server), args);
 			pop_message_from(l);
+			FromNick = old_from_nick;
 		}
 		else
 			say("No target, neither channel nor query");
@@ -3150,6 +3642,7 @@ void 	send_text (int server, const char *nick_list, const char *text, const char
 static	int	recursion = 0;
 	char *	extra = NULL;
 	const char	*recode_text;
+	const char	*old_from_nick;
 
 	/*
 	 * XXXX - Heaven help us.
@@ -3189,6 +3682,8 @@ struct target_type target[4] =
 
 	old_from_server = from_server;
 	from_server = server;
+	old_from_nick = FromNick;
+	FromNick = empty_string;	/* What we send is from us, not them */
 	old_window_display = swap_window_display(hook);
 	next_nick = LOCAL_COPY(nick_list);
 
@@ -3410,6 +3905,7 @@ struct target_type target[4] =
 	}
 
 	swap_window_display(old_window_display);
+	FromNick = old_from_nick;
 	from_server = old_from_server;
 	recursion--;
 }
@@ -3470,8 +3966,15 @@ void	call_lambda_command (const char *name, const char *what, const char *args)
  */
 char 	*call_user_function	(const char *alias_name, const char *alias_stuff, char *args, void *arglist)
 {
-	return parse_line_alias_special(alias_name, alias_stuff, args, 
+	char *	retval;
+	int	profiled;
+
+	profiled = PROFILE_ENTER(PROFILE_FUNCTION, alias_name, NULL);
+	retval = parse_line_alias_special(alias_name, alias_stuff, args, 
 						arglist, 1);
+	if (profiled)
+		profile_leave();
+	return retval;
 }
 
 /*
@@ -3480,8 +3983,13 @@ char 	*call_user_function	(const char *alias_name, const char *alias_stuff, char
  */
 void	call_user_command (const char *alias_name, const char *alias_stuff, char *args, void *arglist)
 {
+	int	profiled;
+
+	profiled = PROFILE_ENTER(PROFILE_ALIAS, alias_name, NULL);
 	parse_line_alias_special(alias_name, alias_stuff, args, 
 					arglist, 0);
+	if (profiled)
+		profile_leave();
 }
 
 /*
@@ -0,0 +1,970 @@
+/*
+ * container.c -- Lists and dicts that live outside of the string world
+ *
+ * Copyright 2026 EPIC Software Labs
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notices, the above paragraph (the one permitting redistribution),
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The names of the author(s) may not be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Every value in ircII is a string, so a script that keeps a big list or
+ * a nested structure in a variable pays to split it back up into words 
+ * every time it is used, and to glue it back together every time it is
+ * changed.  This file keeps lists and dicts as real data structures.
+ *
+ * A list or dict is referred to by a handle, like "list#3" or "dict#7", 
+ * which is what you put in your variables and pass to functions.  The 
+ * handle is just a word, so it's cheap to pass around, no matter how 
+ * big the list is.  Use $listctl() and $dictctl() to work with them.
+ *
+ * The values in a list or dict are strings, except when a value is the
+ * handle of another list or dict, then it's a reference to it.  That's 
+ * how you build nested structures.  A list or dict stays around until
+ * you $listctl(FREE ...) it *and* nothing refers to it any more.  (So 
+ * if you make two things refer to each other, they'll never go away.)
+ *
+ * The text forms (the word list, the JSON) are made only when you ask
+ * for them and are remembered until the list or dict is changed.
+ */
+
+#include "irc.h"
+#include "ircaux.h"
+#include "container.h"
+#include "functions.h"
+#include "output.h"
+#include "words.h"
+#include "cJSON.h"
+
+#define CONTAINER_LIST	1
+#define CONTAINER_DICT	2
+
+#define VALUE_STRING	0
+#define VALUE_NUMBER	1	/* From JSON -- the text of the number */
+#define VALUE_TRUE	2
+#define VALUE_FALSE	3
+#define VALUE_NULL	4
+#define VALUE_REF	5	/* Another container */
+
+#define JSON_MAX_DEPTH	128
+
+struct ContainerStru;
+
+typedef struct {
+	int			kind;
+	char *			str;	/* The text of this value */
+	struct ContainerStru *	ref;	/* For VALUE_REF */
+} Value;
+
+typedef struct ContainerStru {
+	int		refnum;
+	int		type;
+	int		held;		/* Not FREE'd by the user yet */
+	int		refs;		/* Values that refer to this */
+	int		count;
+	int		size;
+	Value *		values;
+	char **		keys;		/* Dicts only */
+	uint32_t *	hashes;		/* Dicts only -- of keys */
+	int *		index;		/* Dicts only -- into keys */
+	int		index_mask;
+	int		nrefs;		/* How many values are VALUE_REF */
+	char *		text;		/* Cached word list */
+	char *		json;		/* Cached JSON (if nrefs == 0) */
+	int		doomed;		/* On the garbage list */
+	struct ContainerStru *next_garbage;
+} Container;
+
+static	Container **	containers = NULL;
+static	int		containers_size = 0;
+static	int		containers_next = 1;	/* Lowest maybe-free refnum */
+static	Container *	garbage = NULL;
+
+static	void	destroy_container (Container *);
+
+/****************************************************************************/
+static Container *	new_container (int type)
+{
+	Container *	c;
+	int		refnum;
+
+	for (refnum = containers_next; refnum < containers_size; refnum++)
+		if (!containers[refnum])
+			break;
+
+	if (refnum >= containers_size)
+	{
+		int	i, newsize;
+
+		newsize = containers_size ? containers_size * 2 : 64;
+		RESIZE(containers, Container *, newsize);
+		for (i = containers_size; i < newsize; i++)
+			containers[i] = NULL;
+		containers_size = newsize;
+	}
+	containers_next = refnum + 1;
+
+	c = (Container *)new_malloc(sizeof(Container));
+	memset(c, 0, sizeof(Container));
+	c->refnum = refnum;
+	c->type = type;
+	c->held = 1;
+	containers[refnum] = c;
+	return c;
+}
+
+/*
+ * Return the container for 'handle' (of 'type', or either type if 'type'
+ * is 0), or NULL if 'handle' isn't the handle of a live container.
+ */
+static Container *	lookup_container (const char *handle, int type)
+{
+	Container *	c;
+	char *		after;
+	long		refnum;
+	int		t;
+
+	if (!handle)
+		return NULL;
+	if (!my_strnicmp(handle, "list#", 5))
+		t = CONTAINER_LIST;
+	else if (!my_strnicmp(handle, "dict#", 5))
+		t = CONTAINER_DICT;
+	else
+		return NULL;
+
+	if (type && t != type)
+		return NULL;
+
+	refnum = strtol(handle + 5, &after, 10);
+	if (after == handle + 5 || *after)
+		return NULL;
+	if (refnum <= 0 || refnum >= containers_size)
+		return NULL;
+	if (!(c = containers[refnum]) || c->type != t)
+		return NULL;
+	return c;
+}
+
+static const char *	container_handle (Container *c)
+{
+	static char	handle[32];
+
+	snprintf(handle, sizeof(handle), "%s#%d", 
+		c->type == CONTAINER_LIST ? "list" : "dict", c->refnum);
+	return handle;
+}
+
+/*
+ * Containers that nobody wants any more aren't destroyed right away,
+ * because the one we're working on might be one of them (if it refers 
+ * to itself).  They go on the garbage list, which is emptied when the
+ * $listctl() or $dictctl() call is done.
+ */
+static void	doom_container (Container *c)
+{
+	if (c->doomed)
+		return;
+	c->doomed = 1;
+	c->next_garbage = garbage;
+	garbage = c;
+}
+
+static void	collect_garbage (void)
+{
+	Container *	c;
+
+	while ((c = garbage))
+	{
+		garbage = c->next_garbage;
+		c->doomed = 0;
+
+		/* It might have been put in something since it was doomed */
+		if (c->refs <= 0 && !c->held)
+			destroy_container(c);
+	}
+}
+
+static void	container_unref (Container *c)
+{
+	if (--c->refs <= 0 && !c->held)
+		doom_container(c);
+}
+
+static void	container_release (Container *c)
+{
+	c->held = 0;
+	if (c->refs <= 0)
+		doom_container(c);
+}
+
+static void	container_changed (Container *c)
+{
+	new_free(&c->text);
+	new_free(&c->json);
+}
+
+/****************************************************************************/
+/*
+ * Make 'v' hold 'str' -- or a reference, if 'str' is the handle of a
+ * container.  'owner' is the container 'v' will be stored in.
+ */
+static void	make_value (Container *owner, Value *v, const char *str)
+{
+	Container *	c;
+
+	if ((c = lookup_container(str, 0)))
+	{
+		v->kind = VALUE_REF;
+		v->ref = c;
+		v->str = malloc_strdup(container_handle(c));
+		c->refs++;
+		owner->nrefs++;
+	}
+	else
+	{
+		v->kind = VALUE_STRING;
+		v->ref = NULL;
+		v->str = malloc_strdup(str);
+	}
+}
+
+static void	clear_value (Container *owner, Value *v)
+{
+	new_free(&v->str);
+	if (v->kind == VALUE_REF)
+	{
+		owner->nrefs--;
+		container_unref(v->ref);
+	}
+	v->ref = NULL;
+	v->kind = VALUE_NULL;
+}
+
+static void	grow_container (Container *c, int count)
+{
+	if (count <= c->size)
+		return;
+
+	c->size = c->size ? c->size * 2 : 16;
+	if (c->size < count)
+		c->size = count;
+	RESIZE(c->values, Value, c->size);
+	if (c->type == CONTAINER_DICT)
+	{
+		RESIZE(c->keys, char *, c->size);
+		RESIZE(c->hashes, uint32_t, c->size);
+	}
+}
+
+static void	destroy_container (Container *c)
+{
+	int	i;
+
+	containers[c->refnum] = NULL;
+	if (c->refnum < containers_next)
+		containers_next = c->refnum;
+
+	for (i = 0; i < c->count; i++)
+	{
+		clear_value(c, &c->values[i]);
+		if (c->type == CONTAINER_DICT)
+			new_free(&c->keys[i]);
+	}
+	new_free((char **)&c->values);
+	new_free((char **)&c->keys);
+	new_free((char **)&c->hashes);
+	new_free((char **)&c->index);
+	container_changed(c);
+	new_free((char **)&c);
+}
+
+/*
+ * Join 'howmany' strings into a word list, double quoting the ones 
+ * that need it (see quote_dword()), so split_wordlist() gives them back
+ * to you.  Empty strings are "", so there is always one word per string.
+ */
+static char *	join_words (char **strs, int howmany)
+{
+	char *	retval = NULL;
+	const char *str;
+	size_t	len = 0, size = 0, need;
+	int	i;
+
+	for (i = 0; i < howmany; i++)
+	{
+		str = strs[i] ? strs[i] : empty_string;
+		need = len + strlen(str) * 2 + 4;
+		if (need > size)
+		{
+			size = size ? size * 2 : 1024;
+			while (size < need)
+				size *= 2;
+			RESIZE(retval, char, size);
+		}
+		if (len)
+			retval[len++] = ' ';
+		len += quote_dword(str, 0, retval + len, size - len);
+	}
+	return retval;
+}
+
+/****************************************************************************/
+/* Lists */
+/*
+ * Negative indexes count from the end of the list.  Returns -1 if 'idx'
+ * isn't in the list.  If 'append' is set, the end of the list is valid.
+ */
+static int	list_index (Container *c, int idx, int append)
+{
+	if (idx < 0)
+		idx += c->count;
+	if (idx < 0 || idx > c->count || (idx == c->count && !append))
+		return -1;
+	return idx;
+}
+
+static void	list_insert (Container *c, int idx, Value *v)
+{
+	grow_container(c, c->count + 1);
+	memmove(&c->values[idx + 1], &c->values[idx], 
+			sizeof(Value) * (c->count - idx));
+	c->values[idx] = *v;
+	c->count++;
+	container_changed(c);
+}
+
+static void	list_delete (Container *c, int idx)
+{
+	clear_value(c, &c->values[idx]);
+	memmove(&c->values[idx], &c->values[idx + 1], 
+			sizeof(Value) * (c->count - idx - 1));
+	c->count--;
+	container_changed(c);
+}
+
+static char *	list_words (Container *c)
+{
+	char **	strs;
+	int	i;
+
+	if (!c->text && c->count)
+	{
+		strs = new_malloc(sizeof(char *) * c->count);
+		for (i = 0; i < c->count; i++)
+			strs[i] = c->values[i].str;
+		c->text = join_words(strs, c->count);
+		new_free((char **)&strs);
+	}
+	return malloc_strdup(c->text ? c->text : empty_string);
+}
+
+/****************************************************************************/
+/* Dicts */
+/* Keys are case sensitive, since JSON's are. */
+static uint32_t	key_hash (const char *key)
+{
+	uint32_t	hash = 2166136261U;
+
+	for (; *key; key++)
+	{
+		hash ^= (unsigned char)*key;
+		hash *= 16777619U;
+	}
+	return hash;
+}
+
+static void	dict_add_index (Container *c, int i)
+{
+	int	slot;
+
+	for (slot = c->hashes[i] & c->index_mask; c->index[slot] != -1; 
+			slot = (slot + 1) & c->index_mask)
+		;
+	c->index[slot] = i;
+}
+
+static void	dict_reindex (Container *c)
+{
+	int	i, size;
+
+	for (size = 16; size < c->count * 2 + 2; size <<= 1)
+		;
+	RESIZE(c->index, int, size);
+	for (i = 0; i < size; i++)
+		c->index[i] = -1;
+	c->index_mask = size - 1;
+
+	for (i = 0; i < c->count; i++)
+		dict_add_index(c, i);
+}
+
+/* Which slot in the index points at entry 'i'? */
+static int	dict_slot (Container *c, int i)
+{
+	int	slot;
+
+	for (slot = c->hashes[i] & c->index_mask; c->index[slot] != i; 
+			slot = (slot + 1) & c->index_mask)
+		;
+	return slot;
+}
+
+/* 
+ * Take 'slot' out of the index.  The entries after it that belong 
+ * before it are moved back, so lookups never hit a hole too soon.
+ */
+static void	dict_unindex (Container *c, int slot)
+{
+	int	next, home;
+
+	for (next = (slot + 1) & c->index_mask; c->index[next] != -1; 
+			next = (next + 1) & c->index_mask)
+	{
+		home = c->hashes[c->index[next]] & c->index_mask;
+
+		/* Leave it if its home is in (slot, next] */
+		if (slot <= next ? (slot < home && home <= next) 
+				 : (slot < home || home <= next))
+			continue;
+
+		c->index[slot] = c->index[next];
+		slot = next;
+	}
+	c->index[slot] = -1;
+}
+
+static int	dict_find (Container *c, const char *key, uint32_t hash)
+{
+	int	slot;
+
+	if (!c->index)
+		return -1;
+
+	for (slot = hash & c->index_mask; c->index[slot] != -1; 
+			slot = (slot + 1) & c->index_mask)
+	{
+		int	i = c->index[slot];
+
+		if (c->hashes[i] == hash && !strcmp(c->keys[i], key))
+			return i;
+	}
+	return -1;
+}
+
+/* Store 'v' under 'key', replacing the old value if there is one. */
+static void	dict_store (Container *c, const char *key, Value *v)
+{
+	uint32_t	hash;
+	int		i;
+
+	hash = key_hash(key);
+	if ((i = dict_find(c, key, hash)) >= 0)
+	{
+		clear_value(c, &c->values[i]);
+		c->values[i] = *v;
+	}
+	else
+	{
+		grow_container(c, c->count + 1);
+		i = c->count++;
+		c->keys[i] = malloc_strdup(key);
+		c->hashes[i] = hash;
+		c->values[i] = *v;
+
+		if (!c->index || c->count * 2 > c->index_mask + 1)
+			dict_reindex(c);
+		else
+			dict_add_index(c, i);
+	}
+	container_changed(c);
+}
+
+static int	dict_delete (Container *c, const char *key)
+{
+	int	i, last;
+
+	if ((i = dict_find(c, key, key_hash(key))) < 0)
+		return 0;
+
+	clear_value(c, &c->values[i]);
+	new_free(&c->keys[i]);
+	dict_unindex(c, dict_slot(c, i));
+
+	/* Move the last one into the hole */
+	last = --c->count;
+	if (i != last)
+	{
+		c->index[dict_slot(c, last)] = i;
+		c->values[i] = c->values[last];
+		c->keys[i] = c->keys[last];
+		c->hashes[i] = c->hashes[last];
+	}
+	container_changed(c);
+	return 1;
+}
+
+/****************************************************************************/
+/* JSON */
+static cJSON *	container_to_cjson (Container *, int);
+
+static cJSON *	value_to_cjson (Value *v, int depth)
+{
+	switch (v->kind)
+	{
+		case VALUE_STRING:
+			return cJSON_CreateString(v->str);
+		case VALUE_NUMBER:
+			return cJSON_CreateRaw(v->str);
+		case VALUE_TRUE:
+			return cJSON_CreateTrue();
+		case VALUE_FALSE:
+			return cJSON_CreateFalse();
+		case VALUE_REF:
+			return container_to_cjson(v->ref, depth + 1);
+		default:
+			return cJSON_CreateNull();
+	}
+}
+
+static cJSON *	container_to_cjson (Container *c, int depth)
+{
+	cJSON *	root;
+	cJSON *	item;
+	int	i;
+
+	/* This is how we stop on a list that contains itself */
+	if (depth > JSON_MAX_DEPTH)
+		return NULL;
+
+	if (c->type == CONTAINER_LIST)
+		root = cJSON_CreateArray();
+	else
+		root = cJSON_CreateObject();
+
+	for (i = 0; i < c->count; i++)
+	{
+		if (!(item = value_to_cjson(&c->values[i], depth)))
+		{
+			cJSON_Delete(root);
+			return NULL;
+		}
+		if (c->type == CONTAINER_LIST)
+			cJSON_AddItemToArray(root, item);
+		else
+			cJSON_AddItemToObject(root, c->keys[i], item);
+	}
+	return root;
+}
+
+static char *	container_json (Container *c)
+{
+	cJSON *	root;
+	char *	json;
+	char *	retval;
+
+	if (c->json)
+	{
+		new_free(&json_last_error);
+		return malloc_strdup(c->json);
+	}
+
+	if (!(root = container_to_cjson(c, 0)))
+	{
+		malloc_strcpy(&json_last_error, "Too deeply nested for JSON "
+				"(does it contain itself?)");
+		return NULL;
+	}
+	new_free(&json_last_error);
+	json = cJSON_PrintUnformatted(root);
+	cJSON_Delete(root);
+	retval = malloc_strdup(json);
+	if (json)
+		cJSON_free(json);
+
+	/* 
+	 * If we refer to other containers, they can change behind our
+	 * back, so we can't remember the JSON for them.
+	 */
+	if (c->nrefs == 0)
+		c->json = malloc_strdup(retval);
+	return retval;
+}
+
+static Container *	cjson_to_container (cJSON *);
+
+static void	cjson_to_value (Container *owner, Value *v, cJSON *item)
+{
+	v->ref = NULL;
+	v->str = NULL;
+
+	if (cJSON_IsFalse(item))
+	{
+		v->kind = VALUE_FALSE;
+		v->str = malloc_strdup(zero);
+	}
+	else if (cJSON_IsTrue(item))
+	{
+		v->kind = VALUE_TRUE;
+		v->str = malloc_strdup(one);
+	}
+	else if (cJSON_IsNumber(item))
+	{
+		char *	number;
+
+		v->kind = VALUE_NUMBER;
+		number = cJSON_PrintUnformatted(item);
+		v->str = malloc_strdup(number);
+		cJSON_free(number);
+	}
+	else if (cJSON_IsString(item))
+	{
+		v->kind = VALUE_STRING;
+		v->str = malloc_strdup(item->valuestring);
+	}
+	else if (cJSON_IsArray(item) || cJSON_IsObject(item))
+	{
+		Container *	c;
+
+		/* It belongs to 'owner' -- the user never held it */
+		c = cjson_to_container(item);
+		c->held = 0;
+		c->refs = 1;
+		owner->nrefs++;
+		v->kind = VALUE_REF;
+		v->ref = c;
+		v->str = malloc_strdup(container_handle(c));
+	}
+	else
+		v->kind = VALUE_NULL;
+}
+
+static Container *	cjson_to_container (cJSON *item)
+{
+	Container *	c;
+	cJSON *		sub;
+	Value		v;
+
+	if (cJSON_IsArray(item))
+		c = new_container(CONTAINER_LIST);
+	else
+		c = new_container(CONTAINER_DICT);
+
+	for (sub = item->child; sub; sub = sub->next)
+	{
+		cjson_to_value(c, &v, sub);
+		if (c->type == CONTAINER_LIST)
+			list_insert(c, c->count, &v);
+		else
+			dict_store(c, sub->string ? sub->string : empty_string, &v);
+	}
+	return c;
+}
+
+/* Returns the handle of a new list or dict, whichever 'json' is. */
+static char *	container_from_json (const char *json)
+{
+	cJSON *		root;
+	Container *	c;
+
+	if (!(root = cJSON_Parse(json)))
+	{
+		malloc_sprintf(&json_last_error, "JSON parse error at position %u", 
+				(unsigned)(cJSON_GetErrorPtr() - json));
+		return NULL;
+	}
+	new_free(&json_last_error);
+
+	if (!cJSON_IsArray(root) && !cJSON_IsObject(root))
+	{
+		malloc_strcpy(&json_last_error, "JSON is not an array or object");
+		cJSON_Delete(root);
+		return NULL;
+	}
+
+	c = cjson_to_container(root);
+	cJSON_Delete(root);
+	return malloc_strdup(container_handle(c));
+}
+
+static char *	all_handles (int type)
+{
+	char *	retval = NULL;
+	int	i;
+
+	for (i = 1; i < containers_size; i++)
+		if (containers[i] && containers[i]->type == type)
+			malloc_strcat_wordlist(&retval, space, 
+				container_handle(containers[i]));
+	return retval;
+}
+
+/****************************************************************************/
+/*
+ * $listctl(NEW [word ...])		Returns the handle of a new list
+ * $listctl(FROMJSON <json>)		Returns the handle of a new list (or
+ *					dict, if <json> is an object)
+ * $listctl(HANDLES)			All of the lists
+ * $listctl(FREE <list>)		You're done with <list>
+ * $listctl(LEN <list>)			How many values are in <list>
+ * $listctl(GET <list> <index>)		The <index>th value (from 0)
+ * $listctl(SET <list> <index> <text>)	Change the <index>th value
+ * $listctl(PUSH <list> <text>)		Add a value to the end
+ * $listctl(POP <list>)			Remove (and return) the last value
+ * $listctl(SHIFT <list>)		Remove (and return) the first value
+ * $listctl(INSERT <list> <index> <text>) Insert a value before <index>
+ * $listctl(DELETE <list> <index>)	Remove the <index>th value
+ * $listctl(FIND <list> <text>)		The index of the first <text>, or -1
+ * $listctl(SLICE <list> <index> <len>)	A new list of <len> values
+ * $listctl(WORDS <list>)		The values as a word list
+ * $listctl(JSON <list>)		The list as JSON
+ *
+ * A negative <index> counts from the end of the list.
+ */
+static char *	do_listctl (char *input)
+{
+	char *		listc;
+	char *		handle;
+	Container *	c;
+	Container *	c2;
+	Value		v;
+	char *		retval;
+	const char *	newhandle;
+	int		idx, len, i;
+
+	GET_FUNC_ARG(listc, input);
+	if (!my_strnicmp(listc, "NEW", 1)) {
+		char **	words = NULL;
+		int	count;
+
+		c = new_container(CONTAINER_LIST);
+		count = split_wordlist(input, &words, DWORD_YES);
+		grow_container(c, count);
+		for (i = 0; i < count; i++)
+		{
+			make_value(c, &v, words[i]);
+			list_insert(c, c->count, &v);
+		}
+		new_free((char **)&words);
+		newhandle = container_handle(c);
+		RETURN_STR(newhandle);
+	} else if (!my_strnicmp(listc, "FROMJSON", 3)) {
+		retval = container_from_json(input);
+		RETURN_MSTR(retval);
+	} else if (!my_strnicmp(listc, "HANDLES", 1)) {
+		retval = all_handles(CONTAINER_LIST);
+		RETURN_MSTR(retval);
+	}
+
+	GET_FUNC_ARG(handle, input);
+	if (!(c = lookup_container(handle, CONTAINER_LIST)))
+		RETURN_EMPTY;
+
+	if (!my_strnicmp(listc, "FREE", 3)) {
+		container_release(c);
+		RETURN_INT(1);
+	} else if (!my_strnicmp(listc, "LEN", 1)) {
+		RETURN_INT(c->count);
+	} else if (!my_strnicmp(listc, "GET", 1)) {
+		GET_INT_ARG(idx, input);
+		if ((idx = list_index(c, idx, 0)) < 0)
+			RETURN_EMPTY;
+		RETURN_STR(c->values[idx].str);
+	} else if (!my_strnicmp(listc, "SET", 3)) {
+		GET_INT_ARG(idx, input);
+		if ((idx = list_index(c, idx, 1)) < 0)
+			RETURN_EMPTY;
+		make_value(c, &v, input);
+		if (idx == c->count)
+			list_insert(c, idx, &v);
+		else
+		{
+			clear_value(c, &c->values[idx]);
+			c->values[idx] = v;
+			container_changed(c);
+		}
+		RETURN_INT(1);
+	} else if (!my_strnicmp(listc, "PUSH", 2)) {
+		make_value(c, &v, input);
+		list_insert(c, c->count, &v);
+		RETURN_INT(c->count);
+	} else if (!my_strnicmp(listc, "POP", 2) || 
+		   !my_strnicmp(listc, "SHIFT", 2)) {
+		if (c->count == 0)
+			RETURN_EMPTY;
+		idx = (toupper(*listc) == 'P') ? c->count - 1 : 0;
+		retval = malloc_strdup(c->values[idx].str);
+		list_delete(c, idx);
+		RETURN_MSTR(retval);
+	} else if (!my_strnicmp(listc, "INSERT", 1)) {
+		GET_INT_ARG(idx, input);
+		if ((idx = list_index(c, idx, 1)) < 0)
+			RETURN_EMPTY;
+		make_value(c, &v, input);
+		list_insert(c, idx, &v);
+		RETURN_INT(c->count);
+	} else if (!my_strnicmp(listc, "DELETE", 1)) {
+		GET_INT_ARG(idx, input);
+		if ((idx = list_index(c, idx, 0)) < 0)
+			RETURN_EMPTY;
+		list_delete(c, idx);
+		RETURN_INT(1);
+	} else if (!my_strnicmp(listc, "FIND", 2)) {
+		for (i = 0; i < c->count; i++)
+			if (!strcmp(nonull(c->values[i].str), input))
+				RETURN_INT(i);
+		RETURN_INT(-1);
+	} else if (!my_strnicmp(listc, "SLICE", 2)) {
+		GET_INT_ARG(idx, input);
+		GET_INT_ARG(len, input);
+		if ((idx = list_index(c, idx, 1)) < 0)
+			RETURN_EMPTY;
+		if (len > c->count - idx)
+			len = c->count - idx;
+
+		c2 = new_container(CONTAINER_LIST);
+		grow_container(c2, len);
+		for (i = 0; i < len; i++)
+		{
+			v = c->values[idx + i];
+			v.str = malloc_strdup(v.str);
+			if (v.kind == VALUE_REF)
+			{
+				v.ref->refs++;
+				c2->nrefs++;
+			}
+			list_insert(c2, c2->count, &v);
+		}
+		newhandle = container_handle(c2);
+		RETURN_STR(newhandle);
+	} else if (!my_strnicmp(listc, "WORDS", 1)) {
+		return list_words(c);
+	} else if (!my_strnicmp(listc, "JSON", 1)) {
+		retval = container_json(c);
+		RETURN_MSTR(retval);
+	}
+
+	RETURN_EMPTY;
+}
+
+/*
+ * $dictctl(NEW)			Returns the handle of a new dict
+ * $dictctl(FROMJSON <json>)		Returns the handle of a new dict (or
+ *					list, if <json> is an array)
+ * $dictctl(HANDLES)			All of the dicts
+ * $dictctl(FREE <dict>)		You're done with <dict>
+ * $dictctl(LEN <dict>)			How many keys are in <dict>
+ * $dictctl(GET <dict> <key>)		The value of <key>
+ * $dictctl(SET <dict> <key> <text>)	Change the value of <key>
+ * $dictctl(DELETE <dict> <key>)	Remove <key>
+ * $dictctl(EXISTS <dict> <key>)	1 if <key> is in <dict>, 0 if not
+ * $dictctl(KEYS <dict>)		The keys, in the order they were added
+ *					(except that DELETE moves the last
+ *					key into the deleted key's place)
+ * $dictctl(JSON <dict>)		The dict as JSON
+ *
+ * A <key> is a dword -- double quote it if it has spaces.
+ * Keys are case sensitive.
+ */
+static char *	do_dictctl (char *input)
+{
+	char *		listc;
+	char *		handle;
+	char *		key;
+	Container *	c;
+	Value		v;
+	char *		retval;
+	const char *	newhandle;
+	int		i;
+
+	GET_FUNC_ARG(listc, input);
+	if (!my_strnicmp(listc, "NEW", 1)) {
+		c = new_container(CONTAINER_DICT);
+		newhandle = container_handle(c);
+		RETURN_STR(newhandle);
+	} else if (!my_strnicmp(listc, "FROMJSON", 3)) {
+		retval = container_from_json(input);
+		RETURN_MSTR(retval);
+	} else if (!my_strnicmp(listc, "HANDLES", 1)) {
+		retval = all_handles(CONTAINER_DICT);
+		RETURN_MSTR(retval);
+	}
+
+	GET_FUNC_ARG(handle, input);
+	if (!(c = lookup_container(handle, CONTAINER_DICT)))
+		RETURN_EMPTY;
+
+	if (!my_strnicmp(listc, "FREE", 3)) {
+		container_release(c);
+		RETURN_INT(1);
+	} else if (!my_strnicmp(listc, "LEN", 1)) {
+		RETURN_INT(c->count);
+	} else if (!my_strnicmp(listc, "GET", 1)) {
+		GET_DWORD_ARG(key, input);
+		if ((i = dict_find(c, key, key_hash(key))) < 0)
+			RETURN_EMPTY;
+		RETURN_STR(c->values[i].str);
+	} else if (!my_strnicmp(listc, "SET", 1)) {
+		GET_DWORD_ARG(key, input);
+		make_value(c, &v, input);
+		dict_store(c, key, &v);
+		RETURN_INT(1);
+	} else if (!my_strnicmp(listc, "DELETE", 1)) {
+		GET_DWORD_ARG(key, input);
+		i = dict_delete(c, key);
+		RETURN_INT(i);
+	} else if (!my_strnicmp(listc, "EXISTS", 1)) {
+		GET_DWORD_ARG(key, input);
+		i = dict_find(c, key, key_hash(key));
+		RETURN_INT(i >= 0);
+	} else if (!my_strnicmp(listc, "KEYS", 1)) {
+		retval = join_words(c->keys, c->count);
+		RETURN_MSTR(retval);
+	} else if (!my_strnicmp(listc, "JSON", 1)) {
+		retval = container_json(c);
+		RETURN_MSTR(retval);
+	}
+
+	RETURN_EMPTY;
+}
+
+char *	listctl (char *input)
+{
+	char *	retval;
+
+	retval = do_listctl(input);
+	collect_garbage();
+	return retval;
+}
+
+char *	dictctl (char *input)
+{
+	char *	retval;
+
+	retval = do_dictctl(input);
+	collect_garbage();
+	return retval;
+}
@@ -37,6 +37,10 @@
 #include "ircaux.h"
 #include "elf.h"
 #include "output.h"
+#include "vars.h"
+#include "list.h"
+#include "sedcrypt.h"
+#include <sys/mman.h>
 
 #ifdef HAVE_LIBARCHIVE
 static int archive_fopen(struct epic_loadfile *elf, char *filename, const char *ext, int do_error);
@@ -379,7 +383,7 @@ size_t	slurp_elf_file (struct epic_loadfile *elf, char **file_contents, off_t *f
 	{
 		if (next_byte >= size)
 		{
-			size += 8192;
+			size *= 2;
 			RESIZE(*file_contents, char, size);
 		}
 
@@ -449,3 +453,353 @@ off_t	string_fgets(char *buffer, size_t buffer_size, const char **file_contents,
 	}
 }
 
+
+/*
+ * elf_plain_file - Is this loadfile an ordinary file on disk?
+ *
+ * Arguments:
+ *	elf	- A loadfile from epic_fopen() or uzfopen()
+ *	st	- Where to put the fstat() of the underlying file
+ *
+ * Return value:
+ *	1	- It's a regular file, read directly (not through a
+ *		  decompressor or from an archive), and 'st' is filled in.
+ *	0	- Anything else.
+ */
+static int	elf_plain_file (struct epic_loadfile *elf, struct stat *st)
+{
+	if (!elf || !elf->fp)
+		return 0;
+#ifdef HAVE_LIBARCHIVE
+	if (elf->a)
+		return 0;
+#endif
+	if (fstat(fileno(elf->fp), st) < 0 || !S_ISREG(st->st_mode))
+		return 0;
+	if (ftell(elf->fp) != 0)
+		return 0;
+	return 1;
+}
+
+/*
+ * map_elf_file - Like slurp_elf_file(), but without copying the file
+ *
+ * Arguments:
+ *	elf		- A loadfile from epic_fopen() or uzfopen()
+ *	file_contents	- Where to put a pointer to the file's contents
+ *	file_contents_size - Where to put the size of the file
+ *
+ * Return value:
+ *	1	- (*file_contents) points to a read-only mapping of the file,
+ *		  which is nul terminated.  YOU MUST unmap_elf_file() it!
+ *	0	- The file can't be mapped; use slurp_elf_file() instead.
+ *
+ * Only regular files can be mapped.  Since the scripts are treated as 
+ * C strings, we rely on the kernel zero-filling the tail of the last page,
+ * so files whose size is an exact multiple of the page size are slurped.
+ */
+int	map_elf_file (struct epic_loadfile *elf, char **file_contents, off_t *file_contents_size)
+{
+	struct stat	st;
+	long		pagesize;
+	void *		ptr;
+
+	if (!elf_plain_file(elf, &st) || st.st_size == 0)
+		return 0;
+	if ((pagesize = sysconf(_SC_PAGESIZE)) <= 0 || st.st_size % pagesize == 0)
+		return 0;
+	if ((off_t)(size_t)st.st_size != st.st_size)
+		return 0;
+
+	ptr = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, 
+			fileno(elf->fp), 0);
+	if (ptr == MAP_FAILED)
+		return 0;
+
+	*file_contents = (char *)ptr;
+	*file_contents_size = st.st_size;
+	return 1;
+}
+
+void	unmap_elf_file (char *file_contents, off_t file_contents_size)
+{
+	if (file_contents)
+		munmap(file_contents, (size_t)file_contents_size);
+}
+
+
+/*
+ * The load cache
+ *
+ * Loading a large script with the standard loader spends most of its 
+ * time in the lexer, which reassembles the file into statements, and 
+ * the answer is always the same for the same file.  So when 
+ * /SET LOAD_CACHE_DIR is set, /LOAD records what the loader did -- each 
+ * statement it ran (and the line it was on), and each error it reported --
+ * and saves it in that directory.  The next time the same file is loaded 
+ * with the same loader, and it hasn't changed (same size, mtime, ctime,
+ * inode, and permission bits), the recording is replayed instead.
+ *
+ * Times are only good to the second, so a file that changed during the
+ * second we load it is never cached: it could change again in that
+ * same second without its size or times changing.
+ *
+ * A cache file looks like:
+ *	EPIC5-LOADCACHE <version> <loader> <size> <mtime> <ctime> <inode> <mode>
+ *	<path>
+ *	<type> <line> <length>
+ *	<length bytes of text>
+ *	... (more records) ...
+ *	Z 0 0
+ *
+ * The file name is the sha256 of the loader name and path, so there is
+ * one cache file per script and loader.
+ */
+#define LOAD_CACHE_VERSION 2
+
+struct load_cache {
+	int	replaying;	/* 1 if 'data' came from the cache file */
+	int	failed;		/* 1 if the recording can't be used */
+	char *	cachefile;	/* The full path to the cache file */
+	char *	header;		/* The first two lines of the cache file */
+	char *	data;		/* The cache file, or the recording */
+	size_t	len;		/* How much of 'data' is used */
+	size_t	size;		/* How big 'data' is */
+	size_t	pos;		/* For replay -- the next record */
+};
+
+/*
+ * load_cache_open - Get ready to load a file through the cache
+ *
+ * Arguments:
+ *	elf	 - The loadfile that /LOAD just opened
+ *	filename - The full path to the file
+ *	loader	 - The name of the loader ("std" or "pf")
+ *
+ * Return value:
+ *	NULL	 - The cache isn't in use for this file.  Just load it.
+ *	non-NULL - If load_cache_replaying() is true, then the file is 
+ *		   cached and you should replay it with load_cache_next().
+ *		   Otherwise, load the file and pass what you did to 
+ *		   load_cache_record(), and then call load_cache_save().
+ *		   Either way, you must load_cache_close() it.
+ */
+struct load_cache *	load_cache_open (struct epic_loadfile *elf, const char *filename, const char *loader)
+{
+	const char *	dir;
+	Filename	expanded;
+	struct stat	st, cst;
+	struct load_cache *lc;
+	char *		key;
+	char		digest[65];
+	FILE *		fp;
+	size_t		hlen;
+	time_t		now;
+
+	if (!(dir = get_string_var(LOAD_CACHE_DIR_VAR)) || !*dir)
+		return NULL;
+	if (!elf_plain_file(elf, &st))
+		return NULL;
+	if (expand_twiddle(dir, expanded))
+		return NULL;
+
+	lc = (struct load_cache *)new_malloc(sizeof(struct load_cache));
+	lc->replaying = 0;
+	lc->failed = 0;
+	lc->data = NULL;
+	lc->len = lc->size = lc->pos = 0;
+
+	key = malloc_sprintf(NULL, "%s:%s", loader, filename);
+	sha256str(key, strlen(key), digest);
+	new_free(&key);
+	lc->cachefile = malloc_sprintf(NULL, "%s/%s", expanded, digest);
+	lc->header = malloc_sprintf(NULL, "EPIC5-LOADCACHE %d %s %jd %jd %jd %ju %o\n%s\n",
+			LOAD_CACHE_VERSION, loader, (intmax_t)st.st_size, 
+			(intmax_t)st.st_mtime, (intmax_t)st.st_ctime,
+			(uintmax_t)st.st_ino, (unsigned)(st.st_mode & 07777), 
+			filename);
+	hlen = strlen(lc->header);
+
+	/* Changed this very second?  Then what we record can't be trusted */
+	now = time(NULL);
+	if (st.st_mtime >= now || st.st_ctime >= now)
+		lc->failed = 1;
+
+	/* Is there a usable cache file? */
+	if (!(fp = fopen(lc->cachefile, "r")))
+		return lc;
+	if (fstat(fileno(fp), &cst) < 0 || !S_ISREG(cst.st_mode) ||
+			(size_t)cst.st_size < hlen + 6)
+	{
+		fclose(fp);
+		return lc;
+	}
+
+	lc->size = (size_t)cst.st_size + 1;
+	lc->data = new_malloc(lc->size);
+	lc->len = fread(lc->data, 1, lc->size - 1, fp);
+	lc->data[lc->len] = 0;
+	fclose(fp);
+
+	/* It has to be for this file, and it can't be truncated */
+	if (lc->len != lc->size - 1 || 
+	    memcmp(lc->data, lc->header, hlen) ||
+	    strcmp(lc->data + lc->len - 6, "Z 0 0\n"))
+	{
+		new_free(&lc->data);
+		lc->len = lc->size = 0;
+		return lc;
+	}
+
+	lc->replaying = 1;
+	lc->pos = hlen;
+	return lc;
+}
+
+int	load_cache_replaying (struct load_cache *lc)
+{
+	return lc && lc->replaying;
+}
+
+/*
+ * load_cache_next - Fetch the next thing to replay
+ *
+ * Arguments:
+ *	lc	- A cache for which load_cache_replaying() is true
+ *	type	- Where to put the record type (what the loader did)
+ *	line	- Where to put the line of the file the loader was on
+ *	text	- Where to put the statement or message.  This points into
+ *		  the cache and is only good until load_cache_close().
+ *
+ * Return value:
+ *	1	- (*type), (*line), and (*text) are set
+ *	0	- There is nothing more to replay
+ */
+int	load_cache_next (struct load_cache *lc, int *type, int *line, char **text)
+{
+	char *	ptr;
+	char *	end;
+	size_t	len;
+
+	if (!lc || !lc->replaying || lc->pos >= lc->len)
+		return 0;
+
+	ptr = lc->data + lc->pos;
+	if (*ptr == 'Z' || ptr[1] != ' ')
+		return 0;
+	*type = *ptr;
+	*line = (int)strtol(ptr + 2, &end, 10);
+	if (*end != ' ')
+		return 0;
+	len = (size_t)strtoul(end + 1, &end, 10);
+	if (*end != '\n')
+		return 0;
+	ptr = end + 1;
+	if (len >= lc->len - (size_t)(ptr - lc->data))
+		return 0;
+
+	*text = ptr;
+	ptr[len] = 0;			/* Replaces the newline */
+	lc->pos = (size_t)(ptr - lc->data) + len + 1;
+	return 1;
+}
+
+/*
+ * load_cache_record - Remember something the loader did
+ *
+ * Arguments:
+ *	lc	- A cache returned by load_cache_open() (or NULL)
+ *	type	- What the loader did (the loader decides what these are)
+ *	line	- What line of the file the loader was on
+ *	text	- The statement or message
+ */
+void	load_cache_record (struct load_cache *lc, int type, int line, const char *text)
+{
+	char	prefix[64];
+	size_t	plen, tlen, need;
+
+	if (!lc || lc->replaying || lc->failed)
+		return;
+
+	tlen = strlen(text);
+	plen = (size_t)snprintf(prefix, sizeof(prefix), "%c %d %lu\n", 
+				type, line, (unsigned long)tlen);
+	need = lc->len + plen + tlen + 2;
+	if (need > lc->size)
+	{
+		lc->size = lc->size ? lc->size * 2 : 65536;
+		while (lc->size < need)
+			lc->size *= 2;
+		RESIZE(lc->data, char, lc->size);
+	}
+
+	memcpy(lc->data + lc->len, prefix, plen);
+	lc->len += plen;
+	memcpy(lc->data + lc->len, text, tlen);
+	lc->len += tlen;
+	lc->data[lc->len++] = '\n';
+	lc->data[lc->len] = 0;
+}
+
+/*
+ * load_cache_fail - The recording can't be replayed, so don't save it.
+ * A loader calls this when what it did depended on something other 
+ * than the contents of the file.
+ */
+void	load_cache_fail (struct load_cache *lc)
+{
+	if (lc)
+		lc->failed = 1;
+}
+
+/*
+ * load_cache_save - Write a finished recording to the cache directory.
+ * The cache file is written under a temporary name and renamed into 
+ * place so another client never sees a partial cache file.
+ */
+void	load_cache_save (struct load_cache *lc)
+{
+	char *	tmpfile;
+	char *	slash;
+	FILE *	fp;
+	int	ok;
+
+	if (!lc || lc->replaying || lc->failed)
+		return;
+
+	if ((slash = strrchr(lc->cachefile, '/')))
+	{
+		*slash = 0;
+		mkdir(lc->cachefile, 0700);
+		*slash = '/';
+	}
+
+	tmpfile = malloc_sprintf(NULL, "%s.%ld", lc->cachefile, (long)getpid());
+	if (!(fp = fopen(tmpfile, "w")))
+	{
+		new_free(&tmpfile);
+		return;
+	}
+
+	ok = (fputs(lc->header, fp) != EOF);
+	if (ok && lc->len)
+		ok = (fwrite(lc->data, 1, lc->len, fp) == lc->len);
+	if (ok)
+		ok = (fputs("Z 0 0\n", fp) != EOF);
+	if (fclose(fp))
+		ok = 0;
+
+	if (!ok || rename(tmpfile, lc->cachefile))
+		unlink(tmpfile);
+	new_free(&tmpfile);
+}
+
+void	load_cache_close (struct load_cache **lc)
+{
+	if (!lc || !*lc)
+		return;
+	new_free(&(*lc)->cachefile);
+	new_free(&(*lc)->header);
+	new_free(&(*lc)->data);
+	new_free(lc);
+}
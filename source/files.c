@@ -37,6 +37,19 @@
 #include "output.h"
 #include "elf.h"
 
+/*
+ * Files opened for reading get a big stdio buffer so that reading 
+ * a file a line at a time doesn't go to the disk every 4k.
+ */
+#define FILE_READ_BUFFER_SIZE	(256 * 1024)
+
+/*
+ * Files opened for reading remember where every LINE_INDEX_STEP'th line
+ * starts as they are read through, so $fseek(fd N LINE) to a line that
+ * has already been passed only has to read up to LINE_INDEX_STEP lines.
+ */
+#define LINE_INDEX_STEP		1024
+
 /* 
  * Here's the plan...
  *  You want to open a file.. you can READ it or you can WRITE it.
@@ -64,6 +77,11 @@
 struct FILE___ {
         long int id;
         struct epic_loadfile *elf;
+	off_t *	line_index;	/* Where every LINE_INDEX_STEP'th line starts */
+	long	line_index_count;
+	long	line_index_size;
+	off_t	line;		/* The line we're at, or -1 if we don't know */
+	char *	buffer;		/* Our stdio buffer (files opened for read) */
 	struct FILE___ *next;
 };
 typedef struct FILE___ File;
@@ -89,6 +107,11 @@ static File *	new_file (struct epic_loadfile *elf)
 
         tmp_file->id  = id;
         tmp_file->elf = elf;
+	tmp_file->line_index = NULL;
+	tmp_file->line_index_count = 0;
+	tmp_file->line_index_size = 0;
+	tmp_file->line = -1;
+	tmp_file->buffer = NULL;
 
 	tmp_file->next = NULL;
 
@@ -110,6 +133,8 @@ static void	remove_file (File *file)
 	}
 	epic_fclose(file->elf);
 	new_free(&file->elf);
+	new_free((char **)&file->line_index);
+	new_free(&file->buffer);		/* Only after the fclose! */
 	new_free(&file);
 }
 
@@ -135,6 +160,14 @@ int	open_file_for_read (const char *filename)
 	}
 
 	fr = new_file(elf);
+
+	/* stdio ignores the size if we don't give it the buffer, too */
+	if (elf->fp)
+	{
+		fr->buffer = new_malloc(FILE_READ_BUFFER_SIZE);
+		setvbuf(elf->fp, fr->buffer, _IOFBF, FILE_READ_BUFFER_SIZE);
+		fr->line = 0;
+	}
 	return fr->id;
 }
 
@@ -208,7 +241,7 @@ static File *	lookup_window_logfile (int refnum)
 {
 	FILE *			x = NULL;
 static struct epic_loadfile	elf;
-static File 			retval = {0 , &elf, NULL};
+static File 			retval = {0 , &elf, NULL, 0, 0, -1, NULL, NULL};
 
 	if (refnum == -1)
 		x = irclog_fp;
@@ -373,50 +406,176 @@ int	file_writeb (int logtype, int fd, char *text)
 	return retval;
 }
 
+/*
+ * index_line - Count a line that was just read past, and remember where
+ * the next one starts if it is a multiple of LINE_INDEX_STEP that we
+ * haven't seen yet.  Only files with a line count are indexed.
+ */
+static void	index_line (File *ptr)
+{
+	if (ptr->line < 0)
+		return;
+
+	if (!ptr->line_index)
+	{
+		ptr->line_index_size = 16;
+		ptr->line_index = (off_t *)new_malloc(sizeof(off_t) * 
+						ptr->line_index_size);
+		ptr->line_index[0] = 0;
+		ptr->line_index_count = 1;
+	}
+
+	if (++ptr->line % LINE_INDEX_STEP == 0 && 
+	    ptr->line / LINE_INDEX_STEP == ptr->line_index_count)
+	{
+		if (ptr->line_index_count == ptr->line_index_size)
+		{
+			ptr->line_index_size *= 2;
+			RESIZE(ptr->line_index, off_t, ptr->line_index_size);
+		}
+		ptr->line_index[ptr->line_index_count++] = ftello(ptr->elf->fp);
+	}
+}
+
+/*
+ * read_line - Read the next line of an $open()ed file.
+ * The newline is removed, and the line is recoded to utf8 if it's not.
+ * This always returns a malloced string, which is empty at EOF.
+ */
+static char *	read_line (File *ptr)
+{
+	char	*ret = NULL;
+	size_t	retlen = 0;
+	size_t	retbufsiz = 0;
+	char	*end = NULL;
+
+	if (ptr->elf->fp)
+	    clearerr(ptr->elf->fp);
+
+	for (;;)
+	{
+	    retbufsiz = retbufsiz ? retbufsiz * 2 : 4096;
+	    RESIZE(ret, char, retbufsiz);
+	    ret[retlen] = 0;	/* Keep this -- C requires it! */
+	    if (!epic_fgets(ret + retlen, retbufsiz - retlen, ptr->elf))
+		break;
+	    if ((end = strchr(ret + retlen, '\n')))
+		break;
+	    retlen = retbufsiz - 1;
+	}
+
+	/* Do we need to truncate the result? */
+	if (end)
+	{
+	    *end = 0;	/* Either the newline */
+	    index_line(ptr);
+	}
+	else if ( (ptr->elf->fp) && (ferror(ptr->elf->fp)) )
+	{
+	    *ret = 0;	/* Or the whole thing on error */
+	    ptr->line = -1;
+	}
+
+	/* XXX TODO -- this is just temporary */
+	if (invalid_utf8str(ret))
+	{
+		const char *encodingx;
+
+		encodingx = find_recoding("scripts", NULL, NULL);
+		recode_with_iconv(encodingx, NULL, &ret, &retlen);
+	}
+
+	return ret;
+}
+
+/*
+ * skip_line - Read past the next line of an $open()ed file, without
+ * keeping it anywhere.
+ */
+static void	skip_line (File *ptr)
+{
+	char	buffer[8192];
+
+	if (ptr->elf->fp)
+	    clearerr(ptr->elf->fp);
+
+	for (;;)
+	{
+	    /* If fgets() fills the buffer, it overwrites this. */
+	    buffer[sizeof(buffer) - 1] = 1;
+	    if (!epic_fgets(buffer, sizeof(buffer), ptr->elf))
+		break;
+	    if (buffer[sizeof(buffer) - 1] != 0 || 
+	        buffer[sizeof(buffer) - 2] == '\n')
+	    {
+		if (strchr(buffer, '\n'))
+		    index_line(ptr);
+		break;
+	    }
+	}
+
+	if (ptr->elf->fp && ferror(ptr->elf->fp))
+	    ptr->line = -1;
+}
+
 char *	file_read (int fd)
 {
 	File *ptr = lookup_file(fd);
 	if (!ptr)
 		return malloc_strdup(empty_string);
 	else
-	{
-		char	*ret = NULL;
-		size_t	retlen = 0;
-		size_t	retbufsiz = 0;
-		char	*end = NULL;
+		return read_line(ptr);
+}
 
-                if (ptr->elf->fp)
-                    clearerr(ptr->elf->fp);
+/*
+ * file_readlines - Read up to 'count' lines from an $open()ed file, 
+ * and return them as a word list.  Every line is one word -- lines 
+ * with whitespace in them, lines that start with a double quote, and 
+ * empty lines are double quoted.  This stops early at EOF or on a read
+ * error; the empty "line" that $read() returns then is not included.
+ *
+ * (See quote_dword() for what happens to double quotes and backslashes.)
+ */
+char *	file_readlines (int fd, int count)
+{
+	File *	ptr;
+	char *	line;
+	char *	ret = NULL;
+	size_t	len = 0, size = 0, linelen, need;
+	int	i;
+
+	if (!(ptr = lookup_file(fd)))
+		return malloc_strdup(empty_string);
 
-		for (;;)
+	for (i = 0; i < count && !epic_feof(ptr->elf); i++)
+	{
+		line = read_line(ptr);
+		if (!*line && (epic_feof(ptr->elf) || 
+				(ptr->elf->fp && ferror(ptr->elf->fp))))
 		{
-		    retbufsiz += 4096;
-		    RESIZE(ret, char, retbufsiz);
-		    ret[retlen] = 0;	/* Keep this -- C requires it! */
-		    if (!epic_fgets(ret + retlen, retbufsiz - retlen, ptr->elf))
+			new_free(&line);
 			break;
-		    if ((end = strchr(ret + retlen, '\n')))
-			break;
-		    retlen = retbufsiz - 1;
 		}
 
-		/* Do we need to truncate the result? */
-		if (end)
-                    *end = 0;	/* Either the newline */
-		else if ( (ptr->elf->fp) && (ferror(ptr->elf->fp)) )
-                    *ret = 0;	/* Or the whole thing on error */
-
-		/* XXX TODO -- this is just temporary */
-		if (invalid_utf8str(ret))
+		linelen = strlen(line);
+		need = len + linelen * 2 + 4;
+		if (need > size)
 		{
-			const char *encodingx;
-
-			encodingx = find_recoding("scripts", NULL, NULL);
-			recode_with_iconv(encodingx, NULL, &ret, &retlen);
+			size = size ? size * 2 : 8192;
+			while (size < need)
+				size *= 2;
+			RESIZE(ret, char, size);
 		}
 
-		return ret;
+		if (len)
+			ret[len++] = ' ';
+		len += quote_dword(line, 0, ret + len, size - len);
+		new_free(&line);
 	}
+
+	if (!ret)
+		return malloc_strdup(empty_string);
+	return ret;
 }
 
 char *	file_readb (int fd, int numb)
@@ -433,6 +592,7 @@ char *	file_readb (int fd, int numb)
                 if (ptr->elf->fp) {
                     clearerr(ptr->elf->fp);
                     numb = fread(blah, 1, numb, ptr->elf->fp);
+		    ptr->line = -1;	/* Probably not at a line start */
 #ifdef HAVE_LIBARCHIVE
                 } else if (ptr->elf->a) {
                     numb = archive_read_data(ptr->elf->a, blah, numb);
@@ -474,6 +634,9 @@ int	file_rewind (int fd)
 		return -1;
 	else
 	{
+		if (ptr->buffer)
+			ptr->line = 0;
+
 		/* 
 		 * The dumb things i do to satisfy static analyzers...
 		 */
@@ -484,6 +647,52 @@ int	file_rewind (int fd)
 	}
 }
 
+/*
+ * seek_to_line - Go to the start of line 'line' (the first line is 0).
+ *
+ * This starts reading from the nearest line in the index, and reading
+ * (here, or with $read(), $readlines() or $fskip()) adds to the index,
+ * so going back to a line that has been passed is quick.  The index 
+ * assumes the file is only ever appended to while it's open.
+ *
+ * Return value:
+ *	0	- The file is at the start of the line
+ *	-1	- The file doesn't have that many lines (and is at EOF), or 
+ *		  it isn't a plain file opened for reading (such as a 
+ *		  compressed file, or a /LOG or /WINDOW LOG file, whose File
+ *		  is shared).
+ */
+static int	seek_to_line (File *ptr, off_t line)
+{
+	FILE *	fp;
+	long	k;
+
+	/* Only open_file_for_read() gives plain files a buffer */
+	if (!ptr->buffer || !(fp = ptr->elf->fp) || line < 0)
+		return -1;
+
+	/* Start at the closest line we know about */
+	if (!ptr->line_index)
+		k = 0;
+	else if ((k = (long)(line / LINE_INDEX_STEP)) >= ptr->line_index_count)
+		k = ptr->line_index_count - 1;
+	clearerr(fp);
+	if (fseeko(fp, k ? ptr->line_index[k] : 0, SEEK_SET))
+	{
+		ptr->line = -1;
+		return -1;
+	}
+
+	/* skip_line() counts the lines, and adds to the index */
+	for (ptr->line = (off_t)k * LINE_INDEX_STEP; ptr->line < line; )
+	{
+		skip_line(ptr);
+		if (feof(fp) || ferror(fp))
+			return -1;
+	}
+	return 0;
+}
+
 /* LONG should support 64 bit */
 int	file_seek (int fd, off_t offset, const char *whence)
 {
@@ -491,6 +700,11 @@ int	file_seek (int fd, off_t offset, const char *whence)
 	if (!ptr)
 		return -1;
 
+	if (!my_stricmp(whence, "LINE"))
+		return seek_to_line(ptr, offset);
+
+	/* We don't know what line we're on after any other kind */
+	ptr->line = -1;
 	if (!my_stricmp(whence, "SET"))
 		return fseeko(ptr->elf->fp, offset, SEEK_SET);
 	else if (!my_stricmp(whence, "CUR"))
@@ -513,12 +727,15 @@ intmax_t	file_tell (int fd)
 
 int	file_skip (int fd, int num_lines)
 {
-	int line = 0;
+	int	line = 0;
+	File *	ptr;
+
+	if (!(ptr = lookup_file(fd)))
+		return -1;
 
 	while (line < num_lines && !file_eof(fd))
 	{
-		char *foo = file_read(fd);
-		new_free(&foo);
+		skip_line(ptr);
 		line++;
 	}
 	if (file_eof(fd))
@@ -563,7 +780,7 @@ static Dbm *	DtopEntry = NULL;
 
 static Dbm *	new_dbm (SDBM *the_db, int type);
 static void	remove_dbm (Dbm *db);
-static int	open_dbm (const char *filename, int rdonly, int type);
+static int	open_dbm (const char *filename, int rdonly, int type, int pagesize);
 static Dbm *	lookup_dbm (int refnum);
 static int	close_dbm (int refnum);
 static int	write_to_dbm (int refnum, char *key, char *data, int replace);
@@ -571,6 +788,7 @@ static char *	read_from_dbm (int refnum, char *key);
 static int	delete_from_dbm (int refnum, char *key);
 static char *	iterate_on_dbm (int refnum, int restart);
 static char *	all_keys_for_dbm (int refnum);
+static int	sync_dbm (int refnum);
 static int	error_from_dbm (int refnum);
 static char *	Datum_to_string (Datum d);
 
@@ -614,7 +832,7 @@ static void	remove_dbm (Dbm *db)
 }
 
 
-static int	open_dbm (const char *filename, int rdonly, int type)
+static int	open_dbm (const char *filename, int rdonly, int type, int pagesize)
 {
 	SDBM *db;
 	Dbm *dbm;
@@ -625,7 +843,7 @@ static int	open_dbm (const char *filename, int rdonly, int type)
 	else
 		perm = O_RDWR|O_CREAT;
 
-	if (!(db = sdbm_open(filename, perm, 0660)))
+	if (!(db = sdbm_open_pagesize(filename, perm, 0660, pagesize)))
 	{
 		yell("open_dbm(%s) failed: %s", filename, strerror(errno));
 		last_failed_open_errno = errno;
@@ -762,6 +980,18 @@ static char *	all_keys_for_dbm (int refnum)
 	return retval;
 }
 
+static int	sync_dbm (int refnum)
+{
+	Dbm *	db;
+
+	if (!(db = lookup_dbm(refnum)))
+		return -1;
+
+	if (sdbm_sync(db->db))
+		return sdbm_error(db->db);
+	return 0;
+}
+
 static int	error_from_dbm (int refnum)
 {
 	Dbm *	db;
@@ -792,6 +1022,7 @@ static char *	Datum_to_string (Datum d)
 /*
  * $dbmctl(OPEN type filename)
  *	Open a DBM file for read and write access.
+ *	Changes are cached in memory until SYNC or CLOSE.
  * $dbmctl(OPEN_READ type filename)
  *	Open a DBM file for read-only access.
  * $dbmctl(CLOSE refnum)
@@ -810,14 +1041,39 @@ static char *	Datum_to_string (Datum d)
  *	Return all keys -- could be huge! could take a long time!
  * $dbmctl(ERROR refnum)
  *	Return the errno for the last error.
+ * $dbmctl(SYNC refnum)
+ *	Write all pending changes to disk.
+ * $dbmctl(CACHE refnum [pages])
+ *	Return (or set) the number of pages kept in memory (at most 64MB
+ *	worth).  Pages are only allocated as they are used.
+ * $dbmctl(BULK refnum on-off)
+ *	In bulk mode, ADD and CHANGE are queued and inserted later (on 
+ *	SYNC, CLOSE, or any other operation), sorted by the page each 
+ *	key goes to.  They always return 0 in this mode.  Returns the
+ *	previous mode.
+ * $dbmctl(PAGESIZE refnum)
+ *	Return the page size of the database.
  *
  * "refnum" is a value returned by OPEN and OPEN_READ.
- * "type" must always be "STD" for now. 
+ * "type" must always be "STD" for now.  When creating a new database,
+ *	"STD:<size>" uses <size> byte pages (1024 to 32768, a power of 2)
+ *	instead of 1024; such databases are not compatable with perl or
+ *	apache, and record their page size in a .siz file.
  * "filename" is a dbm file (without the .db extension!)
  * "key" is a dbm key.  Spaces are important!
  * "data" is a dbm value.  Spaces are important!
  * 
  */
+/* "STD" is the default page size; "STD:8192" asks for 8192 byte pages */
+static int	dbm_pagesize (const char *type)
+{
+	const char *	colon;
+
+	if ((colon = strchr(type, ':')))
+		return (int)my_atol(colon + 1);
+	return 0;
+}
+
 char *	dbmctl (char *input)
 {
 	char *	listc;
@@ -829,14 +1085,12 @@ char *	dbmctl (char *input)
 
 	GET_FUNC_ARG(listc, input);
 	if (!my_strnicmp(listc, "OPEN", 4)) {
-		GET_FUNC_ARG(type, input);	/* Ignored for now */
-		(void)type;
-		retval = open_dbm(input, 0, 0);
+		GET_FUNC_ARG(type, input);
+		retval = open_dbm(input, 0, 0, dbm_pagesize(type));
 		RETURN_INT(retval);
 	} else if (!my_strnicmp(listc, "OPEN_READ", 5)) {
-		GET_FUNC_ARG(type, input);	/* Ignored for now */
-		(void)type;
-		retval = open_dbm(input, 1, 0);
+		GET_FUNC_ARG(type, input);
+		retval = open_dbm(input, 1, 0, dbm_pagesize(type));
 		RETURN_INT(retval);
 	} else if (!my_strnicmp(listc, "CLOSE", 2)) {
 		GET_INT_ARG(refnum, input);
@@ -876,6 +1130,39 @@ char *	dbmctl (char *input)
 		GET_INT_ARG(refnum, input);
 		retval = error_from_dbm(refnum);
 		RETURN_INT(retval);
+	} else if (!my_strnicmp(listc, "SYNC", 2)) {
+		GET_INT_ARG(refnum, input);
+		retval = sync_dbm(refnum);
+		RETURN_INT(retval);
+	} else if (!my_strnicmp(listc, "CACHE", 2)) {
+		int	pages = 0;
+		Dbm *	db;
+
+		GET_INT_ARG(refnum, input);
+		if (*input)
+			GET_INT_ARG(pages, input);
+		if (!(db = lookup_dbm(refnum)))
+			RETURN_INT(-1);
+		retval = sdbm_cache(db->db, pages);
+		RETURN_INT(retval);
+	} else if (!my_strnicmp(listc, "BULK", 1)) {
+		int	on;
+		Dbm *	db;
+
+		GET_INT_ARG(refnum, input);
+		GET_INT_ARG(on, input);
+		if (!(db = lookup_dbm(refnum)))
+			RETURN_INT(-1);
+		retval = sdbm_bulk(db->db, on);
+		RETURN_INT(retval);
+	} else if (!my_strnicmp(listc, "PAGESIZE", 1)) {
+		Dbm *	db;
+
+		GET_INT_ARG(refnum, input);
+		if (!(db = lookup_dbm(refnum)))
+			RETURN_INT(-1);
+		retval = sdbm_pagesize(db->db);
+		RETURN_INT(retval);
 	}
 
 	RETURN_EMPTY;
@@ -84,6 +84,10 @@
 #include "extlang.h"
 #include "ctcp.h"
 #include "cJSON.h"
+#include "profiler.h"
+#include "container.h"
+#include "json.h"
+#include "history.h"
 
 #ifdef NEED_GLOB
 # include "glob.h"
@@ -215,6 +219,7 @@ static	char
 	*function_channel	(char *),
 	*function_channellimit	(char *),
 	*function_channelmode	(char *),
+	*function_chanprefix	(char *),
 	*function_channelsyncing (char *),
 	*function_check_code	(char *),
 	*function_chmod		(char *),
@@ -240,6 +245,7 @@ static	char
 	*function_dbmctl	(char *),
 	*function_dccctl	(char *),
 	*function_deuhc		(char *),
+	*function_dictctl	(char *),
 	*function_diff 		(char *),
 	*function_encryptparm 	(char *),
 	*function_eof 		(char *),
@@ -281,6 +287,7 @@ static	char
 	*function_help_topics	(char *),
 #endif
 	*function_hex		(char *),
+	*function_historyctl	(char *),
 	*function_hookctl	(char *),
 	*function_iconvctl	(char *),
 	*function_idle		(char *),
@@ -310,6 +317,7 @@ static	char
 	*function_jot 		(char *),
 	*function_json_error	(char *),
 	*function_json_explode	(char *),
+	*function_json_get	(char *),
 	*function_json_implode	(char *),
 	*function_jsontest	(char *),
 	*function_key 		(char *),
@@ -318,6 +326,7 @@ static	char
 	*function_leftw 	(char *),
 	*function_levelctl	(char *),
 	*function_levelwindow	(char *),
+	*function_listctl	(char *),
 	*function_loadinfo	(char *),
 	*function_log		(char *),
 	*function_log10		(char *),
@@ -358,13 +367,16 @@ static	char
 #endif
 	*function_prefix	(char *),
 	*function_printlen	(char *),
+	*function_profilerctl	(char *),
 	*function_querywin	(char *),
 	*function_qword		(char *),
 	*function_randread	(char *),
 	*function_read 		(char *),
+	*function_readlines	(char *),
 	*function_realpath	(char *),
 	*function_regcomp	(char *),
 	*function_regcomp_cs	(char *),
+	*function_regexctl	(char *),
 	*function_regexec	(char *),
 	*function_regerror	(char *),
 	*function_regfree	(char *),
@@ -494,6 +506,7 @@ static BuiltInFunctions	built_in_functions[] =
 	{ "CHANLIMIT",		function_channellimit	},
 	{ "CHANMODE",		function_channelmode	},
 	{ "CHANNEL",		function_channel	},
+	{ "CHANPREFIX",		function_chanprefix	},
 	{ "CHANUSERS",		function_onchannel 	},
 	{ "CHANWIN",		function_winchan	},
 	{ "CHANSYNCING",	function_channelsyncing },
@@ -529,6 +542,7 @@ static BuiltInFunctions	built_in_functions[] =
 	{ "DELITEM",            function_delitem	},
 	{ "DELITEMS",           function_delitems	},
 	{ "DEUHC",		function_deuhc		},
+	{ "DICTCTL",		function_dictctl	},
 	{ "DIFF",               function_diff 		},
 	{ "ENCODINGCTL",	function_encodingctl	},
 	{ "ENCRYPTPARM",	function_encryptparm	},
@@ -585,6 +599,7 @@ static BuiltInFunctions	built_in_functions[] =
 	{ "HELP_TOPICS",	function_help_topics	},
 #endif
 	{ "HEX",		function_hex		},
+	{ "HISTORYCTL",		function_historyctl	},
 	{ "HOOKCTL",		function_hookctl	},
 	{ "ICONVCTL",		function_iconvctl	},
 	{ "IDLE",		function_idle		},
@@ -626,6 +641,7 @@ static BuiltInFunctions	built_in_functions[] =
 	{ "JOT",                function_jot 		},
 	{ "JSON_ERROR",         function_json_error 	},
 	{ "JSON_EXPLODE",       function_json_explode 	},
+	{ "JSON_GET",           function_json_get 	},
 	{ "JSON_IMPLODE",       function_json_implode 	},
 	{ "JSONTEST",       	function_jsontest 	},
 	{ "KEY",                function_key 		},
@@ -638,6 +654,7 @@ static BuiltInFunctions	built_in_functions[] =
 	{ "LEVELWINDOW",	function_levelwindow	},
 	{ "LINE",		function_line		}, /* lastlog.h */
 	{ "LISTARRAY",		function_listarray	},
+	{ "LISTCTL",		function_listctl	},
 	{ "LISTEN",		function_listen 	},
 	{ "LOADINFO",		function_loadinfo	},
 	{ "LOG",		function_log		},
@@ -689,16 +706,19 @@ static BuiltInFunctions	built_in_functions[] =
 	{ "PPID",		function_ppid 		},
 	{ "PREFIX",		function_prefix		},
 	{ "PRINTLEN",		function_printlen	},
+	{ "PROFILERCTL",	function_profilerctl	},
 	{ "PUSH",		function_push 		},
 	{ "QUERYWIN",		function_querywin	},
 	{ "QWORD",		function_qword		},
 	{ "RAND",		function_rand 		},
 	{ "RANDREAD",		function_randread	},
 	{ "READ",		function_read 		},
+	{ "READLINES",		function_readlines	},
 	{ "REALPATH",		function_realpath	},
 	{ "REGCOMP",		function_regcomp	},
 	{ "REGCOMP_CS",		function_regcomp_cs	},
 	{ "REGERROR",		function_regerror	},
+	{ "REGEXCTL",		function_regexctl	},
 	{ "REGEXEC",		function_regexec	},
 	{ "REGFREE",		function_regfree	},
 	{ "REGMATCHES",		function_regmatches	},
@@ -875,7 +895,14 @@ char	*call_function (char *name, const char *args)
 	debug_copy = LOCAL_COPY(tmp);
 
 	if (func && type != 1)
+	{
+		int	profiled;
+
+		profiled = PROFILE_ENTER(PROFILE_BUILTIN, str, NULL);
 		result = func(tmp);
+		if (profiled)
+			profile_leave();
+	}
 	else if (alias && type != 2)
 		result = call_user_function(str, alias, tmp, arglist);
 
@@ -1751,6 +1778,22 @@ BUILT_IN_FUNCTION(function_ischanop, input)
 	RETURN_INT(ret);
 }
 
+/*
+ * Usage: $chanprefix(nick channel)
+ * Returns: The nickname prefixes (eg, "~@" or "+") <nick> has on <channel>,
+ *          highest first, using whatever the server's PREFIX 005 says.
+ *          This includes the ones $ischanop() and friends don't know
+ *          about, such as channel owners and admins.
+ */
+BUILT_IN_FUNCTION(function_chanprefix, input)
+{
+	char 	*nick, *chan;
+
+	GET_FUNC_ARG(nick, input);
+	GET_FUNC_ARG(chan, input);
+	RETURN_MSTR(get_nick_prefixes(chan, nick, from_server));
+}
+
 
 /*
  * Usage: $word(number text)
@@ -1766,8 +1809,14 @@ BUILT_IN_FUNCTION(function_word, word)
 	if (cvalue < 0)
 		RETURN_EMPTY;
 
-	while (cvalue-- > 0 && word && *word)
-		next_func_arg(word, &word);
+	/* Jump to the word (this is O(1) for a list we've seen before) */
+	if (cvalue > 0 && word && *word)
+	{
+		while (*word && my_isspace(*word))
+			word++;
+		real_move_to_abs_word(word, (const char **)&word, cvalue, 
+					DWORD_DWORDS, "\"");
+	}
 
 	GET_FUNC_ARG(w_word, word);
 	RETURN_STR(w_word);
@@ -2266,6 +2315,64 @@ BUILT_IN_FUNCTION(function_chngw, word)
 }
 
 
+/*
+ * A WordSet is a case insensitive multiset of words (as my_stricmp() sees
+ * them) used by the word list functions below, so they can look up each
+ * word in O(1) instead of scanning the other list for it.  The words are
+ * not copied -- they point into the caller's split_wordlist() result.
+ */
+typedef struct {
+	const char *	word;
+	uint32_t	hashval;
+	int		count;
+} WordSlot;
+
+typedef struct {
+	WordSlot *	slots;
+	size_t		mask;
+} WordSet;
+
+static void	wordset_init (WordSet *set, int howmany)
+{
+	size_t	size;
+
+	for (size = 16; size < (size_t)howmany * 2; size <<= 1)
+		;
+	set->slots = new_malloc(sizeof(WordSlot) * size);
+	memset(set->slots, 0, sizeof(WordSlot) * size);
+	set->mask = size - 1;
+}
+
+static void	wordset_free (WordSet *set)
+{
+	new_free((char **)&set->slots);
+}
+
+/*
+ * Return the slot for "word", or NULL if it isn't in the set.  If "add"
+ * is set, the word is added (with a count of 0) if it isn't there.
+ */
+static WordSlot *	wordset_find (WordSet *set, const char *word, int add)
+{
+	uint32_t	hashval;
+	size_t		i;
+
+	hashval = my_strhash(word);
+	for (i = hashval & set->mask; set->slots[i].word; i = (i + 1) & set->mask)
+	{
+		if (set->slots[i].hashval == hashval &&
+				!my_stricmp(set->slots[i].word, word))
+			return &set->slots[i];
+	}
+
+	if (!add)
+		return NULL;
+	set->slots[i].word = word;
+	set->slots[i].hashval = hashval;
+	set->slots[i].count = 0;
+	return &set->slots[i];
+}
+
 /* $common (string of text / string of text)
  * Given two sets of words seperated by a forward-slash '/', returns
  * all words that are found in both sets.
@@ -2282,8 +2389,12 @@ BUILT_IN_FUNCTION(function_common, word)
 	char 	*booya = NULL;
 	char **leftw = NULL;
 	char **rightw = NULL;
+	char **outw;
 	int	leftc, lefti,
-		rightc, righti;
+		rightc, righti,
+		outc;
+	WordSet	set;
+	WordSlot *slot;
 
 	left = word;
 	if (!(right = strchr(word,'/')))
@@ -2293,18 +2404,29 @@ BUILT_IN_FUNCTION(function_common, word)
 	leftc = split_wordlist(left, &leftw, DWORD_DWORDS);
 	rightc = split_wordlist(right, &rightw, DWORD_DWORDS);
 
-	for (lefti = 0; lefti < leftc; lefti++)
+	wordset_init(&set, rightc);
+	for (righti = 0; righti < rightc; righti++)
+		wordset_find(&set, rightw[righti], 1)->count++;
+
+	/*
+	 * Each word on the left is output once for every time it appears
+	 * on the right, and then those right words are used up.
+	 */
+	outw = new_malloc(sizeof(char *) * (rightc + 1));
+	for (outc = 0, lefti = 0; lefti < leftc; lefti++)
 	{
-		for (righti = 0; righti < rightc; righti++)
-		{
-			if (rightw[righti] && !my_stricmp(leftw[lefti], rightw[righti]))
-			{
-				malloc_strcat_word(&booya, space, leftw[lefti], DWORD_DWORDS);
-				rightw[righti] = NULL;
-			}
-		}
+		if (!*leftw[lefti] || !(slot = wordset_find(&set, leftw[lefti], 0)))
+			continue;
+		for (; slot->count > 0; slot->count--)
+			outw[outc++] = leftw[lefti];
 	}
+	outw[outc] = NULL;
+	wordset_free(&set);
 
+	if (outc)
+		booya = unsplitw(&outw, outc, DWORD_DWORDS);
+	else
+		new_free((char **)&outw);
 	new_free((char **)&leftw);
 	new_free((char **)&rightw);
 
@@ -2324,10 +2446,13 @@ BUILT_IN_FUNCTION(function_diff, word)
 	     	*right = NULL, 
 		*booya = NULL;
 	char **rightw = NULL,
-		   **leftw = NULL;
+		   **leftw = NULL,
+		   **outw;
 	int 	lefti, leftc,
-	    	righti, rightc;
-	int 	found;
+	    	righti, rightc,
+		outc;
+	WordSet	set;
+	WordSlot *slot;
 
 	left = word;
 	if ((right = strchr(word, '/')) == (char *) 0)
@@ -2337,27 +2462,35 @@ BUILT_IN_FUNCTION(function_diff, word)
 	leftc = split_wordlist(left, &leftw, DWORD_DWORDS);
 	rightc = split_wordlist(right, &rightw, DWORD_DWORDS);
 
-	for (lefti = 0; lefti < leftc; lefti++)
+	wordset_init(&set, rightc);
+	for (righti = 0; righti < rightc; righti++)
+		wordset_find(&set, rightw[righti], 1)->count++;
+
+	/*
+	 * A word on the left uses up every copy of itself on the right;
+	 * if there weren't any (left), then it is output.
+	 */
+	outw = new_malloc(sizeof(char *) * (leftc + rightc + 1));
+	for (outc = 0, lefti = 0; lefti < leftc; lefti++)
 	{
-		found = 0;
-		for (righti = 0; righti < rightc; righti++)
-		{
-			if (rightw[righti] && !my_stricmp(leftw[lefti], rightw[righti]))
-			{
-				found = 1;
-				rightw[righti] = NULL;
-			}
-		}
-		if (!found)
-			malloc_strcat_word(&booya, space, leftw[lefti], DWORD_DWORDS);
+		if ((slot = wordset_find(&set, leftw[lefti], 0)) && slot->count > 0)
+			slot->count = 0;
+		else if (*leftw[lefti])
+			outw[outc++] = leftw[lefti];
 	}
 
 	for (righti = 0; righti < rightc; righti++)
 	{
-		if (rightw[righti])
-			malloc_strcat_word(&booya, space, rightw[righti], DWORD_DWORDS);
+		if (*rightw[righti] && wordset_find(&set, rightw[righti], 0)->count > 0)
+			outw[outc++] = rightw[righti];
 	}
+	outw[outc] = NULL;
+	wordset_free(&set);
 
+	if (outc)
+		booya = unsplitw(&outw, outc, DWORD_DWORDS);
+	else
+		new_free((char **)&outw);
 	new_free((char **)&leftw);
 	new_free((char **)&rightw);
 
@@ -2369,13 +2502,29 @@ char *wrapper_pattern(char *word, int mode)
 	char    *blah;
 	char    *booya = NULL;
 	char    *pattern;
+	char	**outw = NULL;
+	int	outc = 0, outsize = 0;
 
 	GET_FUNC_ARG(pattern, word)
 	while (((blah = next_func_arg(word, &word)) != NULL))
 	{
-		if (!!wild_match(pattern, blah) == !!mode)
-			malloc_strcat_word(&booya, space, blah, DWORD_DWORDS);
+		if (*blah && !!wild_match(pattern, blah) == !!mode)
+		{
+			if (outc + 1 >= outsize)
+			{
+				outsize = outsize ? outsize * 2 : 64;
+				RESIZE(outw, char *, outsize);
+			}
+			outw[outc++] = blah;
+		}
+	}
+	if (outc)
+	{
+		outw[outc] = NULL;
+		booya = unsplitw(&outw, outc, DWORD_DWORDS);
 	}
+	else
+		new_free((char **)&outw);
 	RETURN_MSTR(booya);
 }
 
@@ -3571,6 +3720,16 @@ BUILT_IN_FUNCTION(function_read, words)
 		return file_read(my_atol(fdc));
 }
 
+BUILT_IN_FUNCTION(function_readlines, words)
+{
+	int	fd, count = 1;
+
+	GET_INT_ARG(fd, words);
+	if (words && *words)
+		GET_INT_ARG(count, words);
+	return file_readlines(fd, count);
+}
+
 BUILT_IN_FUNCTION(function_seek, words)
 {
 	int	fdc;
@@ -4336,25 +4495,6 @@ BUILT_IN_FUNCTION(function_umode, words)
 	RETURN_STR(ret);		/* Dont pass function call to macro! */
 }
 
-static int sort_it (const void *val1, const void *val2)
-{
-	return my_stricmp(*(const char * const *)val1, *(const char * const *)val2);
-}
-
-BUILT_IN_FUNCTION(function_sort, words)
-{
-	int 	wordc;
-	char **wordl;
-	char	*retval;
-
-	if (!(wordc = split_wordlist(words, &wordl, DWORD_DWORDS)))
-		RETURN_EMPTY;
-
-	qsort((void *)wordl, wordc, sizeof(char *), sort_it);
-	retval = unsplitw(&wordl, wordc, DWORD_DWORDS);
-	RETURN_MSTR(retval);
-}
-
 static int num_sort_it (const void *val1, const void *val2)
 {
 	const char *oneptr = *(const char * const *)val1;
@@ -4388,17 +4528,205 @@ static int num_sort_it (const void *val1, const void *val2)
 	return (*oneptr - *twoptr);
 }
 
-BUILT_IN_FUNCTION(function_numsort, words)
+/*
+ * $sort() and $numsort() compare each word against many others, so rather
+ * than case folding and parsing numbers out of the words every time, each
+ * word's sort key is worked out once up front (a Schwartzian transform).
+ * Comparing two keys gives the same answer as my_stricmp() or num_sort_it()
+ * would on the words, and whenever a key can't tell, they are called.
+ *
+ * For $sort() the key is the word with every code point upper cased,
+ * which strcmp()s in code point order.  For $numsort() it is the word
+ * broken into lower cased characters and the numbers strtoimax() finds.
+ */
+typedef struct NumsortToken {
+	intmax_t	value;
+	char		kind;		/* 0 (end), 'c' (char), 'n' (number) */
+	char		lower;
+	char		raw;
+} NumsortToken;
+
+typedef struct SortKey {
+	const char *	word;
+	const char *	folded;		/* For $sort(); NULL if it can't be */
+	const NumsortToken *tokens;	/* For $numsort() */
+} SortKey;
+
+static int	sort_key_compare (const void *val1, const void *val2)
 {
-	int wordc;
-	char **wordl;
-	char *retval;
+	const SortKey *k1 = *(const SortKey * const *)val1;
+	const SortKey *k2 = *(const SortKey * const *)val2;
+
+	if (!k1->folded || !k2->folded)
+		return my_stricmp(k1->word, k2->word);
+	return strcmp(k1->folded, k2->folded);
+}
+
+static int	numsort_key_compare (const void *val1, const void *val2)
+{
+	const SortKey *k1 = *(const SortKey * const *)val1;
+	const SortKey *k2 = *(const SortKey * const *)val2;
+	const NumsortToken *t1, *t2;
+
+	for (t1 = k1->tokens, t2 = k2->tokens; ; t1++, t2++)
+	{
+		if (!t1->kind || !t2->kind)
+			return t1->raw - t2->raw;
+
+		/* num_sort_it() would strtoimax() a non-number here */
+		if (t1->kind != t2->kind)
+			return num_sort_it(&k1->word, &k2->word);
+
+		if (t1->kind == 'c')
+		{
+			if (t1->lower != t2->lower)
+				return t1->lower - t2->lower;
+		}
+		else if (t1->value != t2->value)
+			return t1->value - t2->value;
+	}
+}
+
+/*
+ * These fill in the sort key of each word, and return the buffer the
+ * keys live in, which you free when you're done sorting.
+ */
+static char *	sort_folded_keys (SortKey *keys, int wordc)
+{
+	char *	pool = NULL;
+	size_t	clue = 0, size = 0;
+	ptrdiff_t *offsets;
+	ptrdiff_t offset;
+	const char *s;
+	int	i, c, u;
+
+	offsets = (ptrdiff_t *)new_malloc(sizeof(ptrdiff_t) * wordc);
+	for (i = 0; i < wordc; i++)
+	{
+		offsets[i] = clue;
+		for (s = keys[i].word; ; s += offset)
+		{
+			if (clue + 8 > size)
+			{
+				size = size ? size * 2 : 1024;
+				RESIZE(pool, char, size);
+			}
+
+			if ((c = next_code_point2(s, &offset, 1)) == 0)
+				break;
+			u = c == -1 ? -1 : mkupper_l(c);
+
+			/* Things that don't survive a trip through UTF-8 */
+			if (u <= 0 || (u >= 0xD800 && u <= 0xDFFF) || u > 0x10FFFF)
+			{
+				offsets[i] = -1;
+				break;
+			}
+			clue += ucs_to_utf8(u, pool + clue, size - clue);
+		}
+		pool[clue++] = 0;
+	}
+
+	for (i = 0; i < wordc; i++)
+		keys[i].folded = offsets[i] < 0 ? NULL : pool + offsets[i];
+	new_free((char **)&offsets);
+	return pool;
+}
+
+static char *	sort_numeric_keys (SortKey *keys, int wordc)
+{
+	NumsortToken *pool, *t;
+	size_t	total = 0;
+	const char *s;
+	char *	end;
+	int	i;
+
+	for (i = 0; i < wordc; i++)
+		total += strlen(keys[i].word) + 1;
+	t = pool = (NumsortToken *)new_malloc(sizeof(NumsortToken) * total);
+
+	for (i = 0; i < wordc; i++)
+	{
+		keys[i].tokens = t;
+		for (s = keys[i].word; *s; t++)
+		{
+			t->raw = *s;
+			if (my_isdigit(s))
+			{
+				t->kind = 'n';
+				t->value = strtoimax(s, &end, 0);
+				s = end;
+			}
+			else
+			{
+				t->kind = 'c';
+				t->lower = tolower(*s);
+				s++;
+			}
+		}
+		t->kind = 0;
+		t->raw = 0;
+		t++;
+	}
+	return (char *)pool;
+}
+
+static char *	sort_words (char *words, int numeric)
+{
+	int	wordc, i;
+	char **	wordl;
+	SortKey	*keys, **order;
+	char *	pool;
+	char *	retval;
 
 	if (!(wordc = split_wordlist(words, &wordl, DWORD_DWORDS)))
-		RETURN_EMPTY;
-	qsort((void *)wordl, wordc, sizeof(char *), num_sort_it);
+		return NULL;
+
+	keys = (SortKey *)new_malloc(sizeof(SortKey) * wordc);
+	order = (SortKey **)new_malloc(sizeof(SortKey *) * wordc);
+	for (i = 0; i < wordc; i++)
+	{
+		keys[i].word = wordl[i];
+		order[i] = &keys[i];
+	}
+
+	if (numeric)
+	{
+		pool = sort_numeric_keys(keys, wordc);
+		qsort((void *)order, wordc, sizeof(SortKey *), numsort_key_compare);
+	}
+	else
+	{
+		pool = sort_folded_keys(keys, wordc);
+		qsort((void *)order, wordc, sizeof(SortKey *), sort_key_compare);
+	}
+
+	for (i = 0; i < wordc; i++)
+		wordl[i] = (char *)order[i]->word;
+	new_free(&pool);
+	new_free((char **)&order);
+	new_free((char **)&keys);
+
 	retval = unsplitw(&wordl, wordc, DWORD_DWORDS);
-	RETURN_MSTR(retval);
+	return retval;
+}
+
+BUILT_IN_FUNCTION(function_sort, words)
+{
+	char	*retval;
+
+	if (!(retval = sort_words(words, 0)))
+		RETURN_EMPTY;
+	return retval;
+}
+
+BUILT_IN_FUNCTION(function_numsort, words)
+{
+	char	*retval;
+
+	if (!(retval = sort_words(words, 1)))
+		RETURN_EMPTY;
+	return retval;
 }
 
 
@@ -4611,11 +4939,6 @@ BUILT_IN_FUNCTION(function_twiddle, words)
 }
 
 
-static int unsort_it (const void *v1, const void *v2)
-{
-	/* This just makes me itch. ;-) */
-	return (int)(*(const char * const *)v1 - *(const char * const *)v2);
-}
 /* 
  * Date: Sun, 29 Sep 1996 19:17:25 -0700
  * Author: Thomas Morgan <tmorgan@pobox.com>
@@ -4631,6 +4954,7 @@ BUILT_IN_FUNCTION(function_uniq, word)
         char    **list = NULL;
 	char *booya = NULL;
         int     listc, listi, listo;
+	WordSet	set;
 
 	RETURN_IF_EMPTY(word);
         listc = split_wordlist(word, &list, DWORD_DWORDS);
@@ -4639,40 +4963,23 @@ BUILT_IN_FUNCTION(function_uniq, word)
 	if (!list)
 		RETURN_EMPTY;
 
-#if 1
 	/*
-	 * This was originally conceved by wd, although his code
-	 * never made it into the distribution.
-	 *
-	 * Sort followed up with a remove duplicates.  Standard stuff,
-	 * only, the whacky way we go about it is due to compatibility.
-	 *
-	 * The major assumption here is that the pointers in list[] are
-	 * in ascending order.  Since split_wordlist() works by inserting nuls
-	 * into the original string, we can be somewhat secure here.
+	 * Keep the first copy of each word and drop the subsequent ones,
+	 * so the remaining words appear in their original order.
 	 */
-	qsort((void *)list, listc, sizeof(char *), sort_it);
-
-	/* Remove _subsequent_ duplicate values wrt the original list
-	 * This means, kill the higher valued pointers value.
-	 */
-	for (listo = 0, listi = 1; listi < listc; listi++) {
-		if (sort_it(&list[listi], &list[listo])) {
-			listo = listi;
-		} else {
-			if (list[listi] < list[listo]) {
-				*list[listo] = 0;
-				listo = listi;
-			} else {
-				*list[listi] = 0;
-			}
+	wordset_init(&set, listc);
+	for (listo = listi = 0; listi < listc; listi++)
+	{
+		if (*list[listi] && !wordset_find(&set, list[listi], 0))
+		{
+			wordset_find(&set, list[listi], 1);
+			list[listo++] = list[listi];
 		}
 	}
+	wordset_free(&set);
 
-	/* We want the remaining words to appear in their original order */
-	qsort(list, listc, sizeof(char *), unsort_it);
-	booya = unsplitw(&list, listc, DWORD_DWORDS);
-#endif
+	if (listo)
+		booya = unsplitw(&list, listo, DWORD_DWORDS);
 
         new_free((char **)&list);
 	RETURN_MSTR(booya);
@@ -4774,6 +5081,7 @@ BUILT_IN_FUNCTION(function_findws, input)
 	char	*word, *this_word;
 	int	word_cnt;
 	char	*ret = NULL;
+	size_t	clue = 0, size = 0;
 
 	GET_FUNC_ARG(word, input);
 
@@ -4781,7 +5089,16 @@ BUILT_IN_FUNCTION(function_findws, input)
 	{
 		GET_FUNC_ARG(this_word, input);
 		if (!my_stricmp(this_word, word))
-			malloc_strcat_word(&ret, space, ltoa(word_cnt), DWORD_NO);
+		{
+			/* An int and a space always fit in 16 bytes */
+			if (clue + 16 > size)
+			{
+				size = size ? size * 2 : 128;
+				RESIZE(ret, char, size);
+			}
+			clue += snprintf(ret + clue, size - clue, 
+					clue ? " %d" : "%d", word_cnt);
+		}
 	}
 
 	RETURN_MSTR(ret);
@@ -6011,8 +6328,11 @@ BUILT_IN_FUNCTION(function_remws, word)
 	char	**lhs = NULL,
 		**rhs = NULL;
 	int	leftc,
+		lefti,
 		rightc,
-		righti;
+		righti,
+		righto;
+	WordSet	set;
 
 	left = word;
 	if (!(right = strchr(word,'/')))
@@ -6020,16 +6340,22 @@ BUILT_IN_FUNCTION(function_remws, word)
 
 	*right++ = 0;
 	leftc = split_wordlist(left, &lhs, DWORD_DWORDS);
-	if (leftc > 0)
-		qsort((void *)lhs, leftc, sizeof(char *), sort_it);
 	rightc = split_wordlist(right, &rhs, DWORD_DWORDS);
 
-	for (righti = 0; righti < rightc; righti++)
+	wordset_init(&set, leftc);
+	for (lefti = 0; lefti < leftc; lefti++)
+		wordset_find(&set, lhs[lefti], 1);
+
+	/* Keep the right hand words that aren't on the left */
+	for (righto = righti = 0; righti < rightc; righti++)
 	{
-		if (leftc <= 0 || !bsearch(&rhs[righti], lhs, leftc, sizeof(char *), sort_it))
-			malloc_strcat_word(&booya, space, rhs[righti], DWORD_DWORDS);
+		if (*rhs[righti] && !wordset_find(&set, rhs[righti], 0))
+			rhs[righto++] = rhs[righti];
 	}
+	wordset_free(&set);
 
+	if (righto > 0)
+		booya = unsplitw(&rhs, righto, DWORD_DWORDS);
 	new_free((char **)&lhs);
 	new_free((char **)&rhs);
 
@@ -7182,6 +7508,11 @@ BUILT_IN_FUNCTION(function_logctl, input)
 	return logctl(input);
 }
 
+BUILT_IN_FUNCTION(function_historyctl, input)
+{
+	return historyctl(input);
+}
+
 /*
  * Joins the word lists in two different variables together with an
  * optional seperator string.
@@ -7535,6 +7866,16 @@ BUILT_IN_FUNCTION(function_hookctl, input)
         return hookctl(input);
 }
 
+BUILT_IN_FUNCTION(function_profilerctl, input)
+{
+	return profilerctl(input);
+}
+
+BUILT_IN_FUNCTION(function_regexctl, input)
+{
+	return regexctl(input);
+}
+
 BUILT_IN_FUNCTION(function_fix_arglist, input)
 {
 	ArgList *l;
@@ -7564,6 +7905,16 @@ BUILT_IN_FUNCTION(function_dbmctl, input)
 	return dbmctl(input);
 }
 
+BUILT_IN_FUNCTION(function_listctl, input)
+{
+	return listctl(input);
+}
+
+BUILT_IN_FUNCTION(function_dictctl, input)
+{
+	return dictctl(input);
+}
+
 /*
  * Here's the plan -- we're going to do this over again a second time.
  *
@@ -8148,10 +8499,10 @@ BUILT_IN_FUNCTION(function_pydirect, input)
 /*
  * $json_error() - show the parse error the from the last json_explode()
  *
- * Returns the parse error from the last $json_explode() call, or an empty
- * string if the last $json_explode() call succeeded.
+ * Returns the parse error from the last $json_explode() or $json_get()
+ * call, or an empty string if the last call succeeded.
  */
-static char *json_last_error;
+char *json_last_error = NULL;
 
 BUILT_IN_FUNCTION(function_json_error, input)
 {
@@ -8167,154 +8518,66 @@ BUILT_IN_FUNCTION(function_json_error, input)
  *
  * Returns an empty string on failure or 1 on success.
  */
-static void explode_json_object(const char *var, cJSON *item)
-{
-	int n;
-	cJSON *subitem;
-	char *subvar = NULL;
-	char *subitem_name = NULL;
-
-	switch (item->type)
-	{
-		case cJSON_False:
-		add_var_alias(var, "0", 0);
-		break;
-
-		case cJSON_True:
-		add_var_alias(var, "1", 0);
-		break;
-
-		case cJSON_NULL:
-		add_var_alias(var, NULL, 0);
-		break;
-
-		case cJSON_Number:
-		add_var_alias(var, ftoa(item->valuedouble), 0);
-		break;
-
-		case cJSON_String:
-		add_var_alias(var, item->valuestring, 0);
-		break;
-
-		case cJSON_Array:
-		case cJSON_Object:
-		for (subitem = item->child, n = 0; subitem; subitem = subitem->next, n++)
-		{
-			if (subitem->string)
-			{
-				char *ptr = malloc_strcpy(&subitem_name, subitem->string);
-		
-				/* The name must be mangled to be suitable as an ASSIGN */
-				while (*ptr)
-				{
-					if (!isalnum(*ptr))
-						*ptr = '_';
-
-					ptr++;
-				}
-
-				malloc_sprintf(&subvar, "%s.%s", var, subitem_name);
-			}
-			else
-				malloc_sprintf(&subvar, "%s.%d", var, n);
-
-
-			explode_json_object(subvar, subitem);
-		}
-		break;
-
-		default:
-		yell("Odd cJSON type in $json_explode");
-	}
-	new_free(&subitem_name);
-	new_free(&subvar);
-}	
-
 BUILT_IN_FUNCTION(function_json_explode, input)
 {
 	const char *var;
-	cJSON *root;
+	size_t	errpos;
 
 	GET_FUNC_ARG(var, input);
-	root = cJSON_Parse(input);
-
-	if (!root)
+	if (!json_explode(var, input, &errpos))
 	{
-		malloc_sprintf(&json_last_error, "JSON parse error at position %u", (unsigned)(cJSON_GetErrorPtr() - input));
+		malloc_sprintf(&json_last_error, "JSON parse error at position %u", (unsigned)errpos);
 		RETURN_EMPTY;
 	}
 
 	new_free(&json_last_error);
-	explode_json_object(var, root);
-	cJSON_Delete(root);
 	RETURN_INT(1);
 }
 
 /*
- * $json_implode(var) - serialise a Structure assign var into a JSON string
+ * $json_get(path json) - extract one value from a JSON string
  *
  * Arguments:
- *  $0 - var - An assign variable
+ *  $0 - path - Member names and array indexes, separated by dots
+ *		(ie, "results.0.name").  An empty path ("") is the whole thing.
+ *  $1 - json - A valid JSON string
  *
- * Returns an empty string on failure or a valid JSON string on success.
+ * Returns the value at 'path' -- strings, numbers and booleans the same 
+ * way $json_explode() would assign them, objects and arrays as JSON text.
+ * Returns an empty string if there is no such value or on a parse error.
  */
-static int implode_struct_var(char *var, cJSON *parent)
+BUILT_IN_FUNCTION(function_json_get, input)
 {
-	char **sublist;
-	int count;
-	int i;
-	const char *name = strrchr(var, '.');
-	int err = 0;
-
-	if (name)
-		name++;
-	else
-		name = var;
-
-	sublist = get_subarray_elements(var, &count, VAR_ALIAS);
+	const char *path;
+	char *	result;
+	size_t	errpos;
 
-	if (count == 0)
+	GET_DWORD_ARG(path, input);
+	if (!path)
+		path = empty_string;
+	if (!json_get(path, input, &result, &errpos))
 	{
-		char *var_text = get_variable(var);
-		cJSON_AddStringToObject(parent, name, var_text);
-		new_free(&var_text);
-	}
-	else
-	{
-		cJSON *child = cJSON_CreateObject();
-
-		if (child)
-		{
-			cJSON_AddItemToObject(parent, name, child);
-
-			for (i = 0; i < count && err == 0; i++)
-				err = implode_struct_var(sublist[i], child);
-		}
-		else
-		{
-			yell("cJSON_CreateObject() returned NULL");
-			err = ENOMEM;
-		}
+		malloc_sprintf(&json_last_error, "JSON parse error at position %u", (unsigned)errpos);
+		RETURN_EMPTY;
 	}
 
-	for (i = 0; i < count; i++)
-		new_free(&sublist[i]);
-	new_free(&sublist);
-	return err;
+	new_free(&json_last_error);
+	RETURN_MSTR(result);
 }
 
+/*
+ * $json_implode(var) - serialise a Structure assign var into a JSON string
+ *
+ * Arguments:
+ *  $0 - var - An assign variable
+ *
+ * Returns an empty string on failure or a valid JSON string on success.
+ */
 BUILT_IN_FUNCTION(function_json_implode, input)
 {
 	const char *var = NULL;
-	const char *canon_var;
-	cJSON *root;
-	char **sublist;
-	int count;
-	int i;
-	char *json = NULL;
-	char *retval;
-	int err = 0;
 	int	compact = 0;
+	char *	json;
 
 	struct kwargs kwargs[] = {
 		{ "root", KWARG_TYPE_STRING, &var, 1 },
@@ -8328,42 +8591,8 @@ BUILT_IN_FUNCTION(function_json_implode, input)
 		GET_FUNC_ARG(var, input);
 
 	RETURN_IF_EMPTY(var);
-	canon_var = remove_brackets(var, NULL);
-
-
-	sublist = get_subarray_elements(canon_var, &count, VAR_ALIAS);
-	new_free(&canon_var);
-	
-	if (count == 0)
-		RETURN_EMPTY;
-
-	root = cJSON_CreateObject();
-
-	if (root)
-	{
-		for (i = 0; i < count && err == 0; i++)
-			err = implode_struct_var(sublist[i], root);
-
-		if (err == 0)
-		{
-			if (compact)
-				json = cJSON_PrintUnformatted(root);
-			else
-				json = cJSON_Print(root);
-		}
-		cJSON_Delete(root);
-	}
-
-	for (i = 0; i < count; i++)
-		new_free(&sublist[i]);
-	new_free(&sublist);
-
-	retval = malloc_strdup(json);
-
-	if (json)
-		cJSON_free(json);
-
-	return retval;
+	json = json_implode(var, compact);
+	RETURN_MSTR(json);
 }
 
 BUILT_IN_FUNCTION(function_uuid4, input)
@@ -0,0 +1,1292 @@
+/*
+ * history.c -- Append-only message history, indexed by time and nick
+ *
+ * Copyright 2026 EPIC Software Labs
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notices, the above paragraph (the one permitting redistribution),
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The names of the author(s) may not be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+/*
+ * When /SET HISTORY_DIR is set, everything that goes through add_to_logs()
+ * for a target (channel or nick) at a /SET HISTORY_LEVEL level is also
+ * appended to a "store" for that server and target:
+ *
+ *	<HISTORY_DIR>/<server>/<target>.log
+ *		One line per message: "<time> <nick> <level> <text>".
+ *		Plain text, so you can still grep it.  Only ever appended to,
+ *		and the times never go backwards.
+ *	<HISTORY_DIR>/<server>/<target>.tix
+ *		The sparse time index: (time, offset) of every 64th line.
+ *	<HISTORY_DIR>/<server>/<target>.nix
+ *		The nick index: (nick hash, time, offset) of every line.  The
+ *		front of the file is a few "runs", each sorted by hash, and
+ *		oldest first; new entries are appended to an unsorted tail.
+ *		Once the tail gets big, a timer sorts it into a new run, and
+ *		merges the newest runs while they are about the same size
+ *		("compaction"), so every entry is only rewritten a few times.
+ *
+ * The indexes are only a cache of what is in the .log file.  If they are
+ * missing, they are rebuilt; if the client died between writing a line
+ * and indexing it, the missing entries are added the next time.
+ *
+ * A query for a time range does a binary search on the .tix file and
+ * reads forward from there; a query for a nick does a binary search on
+ * each run of the .nix file, plus a scan of the (short) tail.
+ * The index files are in native byte order; they aren't portable, but
+ * they can always be rebuilt.
+ */
+#include "irc.h"
+#include "ircaux.h"
+#include "levels.h"
+#include "vars.h"
+#include "output.h"
+#include "server.h"
+#include "window.h"
+#include "timer.h"
+#include "parse.h"
+#include "functions.h"
+#include "history.h"
+
+#define HISTORY_TIME_STEP	64	/* lines per .tix entry */
+#define HISTORY_NIX_TAIL	4096	/* unsorted .nix entries allowed */
+#define HISTORY_MAX_OPEN	16	/* stores kept open */
+#define HISTORY_COMPACT_DELAY	5	/* seconds before compacting */
+#define HISTORY_NIX_RUNS	32	/* most sorted runs in a .nix */
+#define HISTORY_NIX_MAGIC	"EPICNIX2"
+
+typedef struct {
+	int64_t		when;
+	int64_t		offset;
+} TimeEntry;
+
+typedef struct {
+	uint32_t	hash;
+	uint32_t	when;
+	int64_t		offset;
+} NickEntry;
+
+typedef struct {
+	char		magic[8];
+	int64_t		sorted;		/* entries in all the runs */
+	int64_t		merging;	/* the runs are being rewritten */
+	int64_t		newest;		/* .log offset of the last line in them */
+	int64_t		nruns;
+	int64_t		runs[HISTORY_NIX_RUNS];	/* their sizes, oldest first */
+} NickHeader;
+
+typedef struct HistoryStore {
+	struct HistoryStore *next;
+	char *	server;		/* as given to open_store() */
+	char *	target;
+	char *	path;		/* .../server/target, without extension */
+	int	logfd;
+	int	tixfd;
+	int	nixfd;
+	off_t	logsize;	/* where the next line goes */
+	time_t	last;		/* time of the newest line */
+	long	since_tix;	/* lines since the last .tix entry */
+	long	tix_count;	/* entries in the .tix file */
+	long	nix_sorted;	/* sorted entries at the front of .nix */
+	long	nix_runs[HISTORY_NIX_RUNS];	/* ... in these runs */
+	int	nix_nruns;
+	off_t	nix_newest;	/* .log offset of the last line in the runs */
+	long	nix_count;	/* all entries in the .nix file */
+	long	used;		/* for closing the least recently used */
+} HistoryStore;
+
+/*
+ * A line reader over a file descriptor, for scanning .log files.
+ */
+typedef struct {
+	int	fd;
+	off_t	off;		/* file offset of buf[0] */
+	char *	buf;
+	size_t	len;
+	size_t	pos;
+	size_t	size;
+	int	eof;
+} HistoryReader;
+
+/* Set while $historyctl(REPLAY) is showing old lines; don't log them */
+int		history_replaying = 0;
+
+static	HistoryStore *	stores = NULL;
+static	long		store_clock = 0;
+static	Mask		history_mask;
+static	char		history_timeref[] = "HISTCMP";
+
+static	int	history_compact_timer	(void *);
+static	void	close_store		(HistoryStore *);
+
+/****************************************************************************/
+static int	history_read_at (int fd, void *buf, size_t len, off_t off)
+{
+	ssize_t	got;
+	size_t	total = 0;
+
+	if (lseek(fd, off, SEEK_SET) < 0)
+		return -1;
+	while (total < len)
+	{
+		if ((got = read(fd, (char *)buf + total, len - total)) <= 0)
+			break;
+		total += got;
+	}
+	return (int)total;
+}
+
+static int	history_write (int fd, const void *buf, size_t len)
+{
+	ssize_t	wrote;
+	size_t	total = 0;
+
+	while (total < len)
+	{
+		if ((wrote = write(fd, (const char *)buf + total, len - total)) <= 0)
+			return -1;
+		total += wrote;
+	}
+	return 0;
+}
+
+/* Nicks are hashed case insensitively (FNV-1a) */
+static uint32_t	history_nick_hash (const char *nick)
+{
+	uint32_t	h = 2166136261U;
+
+	for (; *nick; nick++)
+	{
+		h ^= (unsigned char)tolower((unsigned char)*nick);
+		h *= 16777619U;
+	}
+	return h;
+}
+
+/*
+ * Servers and targets become file names: lower case, and anything
+ * that isn't obviously safe is written as %XX.
+ */
+static void	history_file_name (const char *name, char *buf, size_t size)
+{
+	size_t	len = 0;
+	unsigned char c;
+
+	for (; *name && len + 4 < size; name++)
+	{
+		c = (unsigned char)tolower((unsigned char)*name);
+		if (isalnum(c) || (c && strchr("#&+!_-", c)) ||
+		    (c == '.' && len > 0))
+			buf[len++] = c;
+		else
+			len += snprintf(buf + len, size - len, "%%%02X", c);
+	}
+	buf[len] = 0;
+}
+
+static void	reader_init (HistoryReader *r, int fd, off_t off)
+{
+	r->fd = fd;
+	r->off = off;
+	r->buf = NULL;
+	r->len = r->pos = r->size = 0;
+	r->eof = 0;
+}
+
+/*
+ * reader_line - Return the next line (without the newline) and the file
+ * offset where it starts.  A partial line at the end of the file (from
+ * a crash in the middle of a write) is not returned.
+ */
+static int	reader_line (HistoryReader *r, char **line, off_t *where)
+{
+	char *	nl;
+	ssize_t	got;
+
+	for (;;)
+	{
+		if (r->pos < r->len &&
+		    (nl = memchr(r->buf + r->pos, '\n', r->len - r->pos)))
+		{
+			*nl = 0;
+			*line = r->buf + r->pos;
+			*where = r->off + r->pos;
+			r->pos = nl - r->buf + 1;
+			return 1;
+		}
+		if (r->eof)
+			return 0;
+
+		/* Slide what's left down, and read some more */
+		if (r->pos)
+		{
+			memmove(r->buf, r->buf + r->pos, r->len - r->pos);
+			r->len -= r->pos;
+			r->off += r->pos;
+			r->pos = 0;
+		}
+		if (r->len == r->size)
+		{
+			r->size = r->size ? r->size * 2 : 65536;
+			RESIZE(r->buf, char, r->size);
+		}
+		if (lseek(r->fd, r->off + r->len, SEEK_SET) < 0 ||
+		    (got = read(r->fd, r->buf + r->len, r->size - r->len)) <= 0)
+			r->eof = 1;
+		else
+			r->len += got;
+	}
+}
+
+static void	reader_done (HistoryReader *r)
+{
+	new_free(&r->buf);
+}
+
+/*
+ * Split a .log line into its parts.  "text" is the rest of the line.
+ */
+static int	parse_record (char *line, time_t *when, char **nick, char **text)
+{
+	char *	after;
+
+	*when = (time_t)strtol(line, &after, 10);
+	if (after == line || *after != ' ')
+		return -1;
+	*nick = after + 1;
+	if (!(after = strchr(*nick, ' ')))
+		return -1;
+	*after = 0;
+	*text = after + 1;
+	return 0;
+}
+
+/****************************************************************************/
+static int	add_nick_entry (HistoryStore *s, const char *nick, time_t when, off_t offset)
+{
+	NickEntry	ne;
+
+	ne.hash = history_nick_hash(nick);
+	ne.when = (uint32_t)when;
+	ne.offset = (int64_t)offset;
+
+	/* .nix isn't O_APPEND (because of the header), and gets read from */
+	if (lseek(s->nixfd, sizeof(NickHeader) +
+			(off_t)s->nix_count * sizeof(ne), SEEK_SET) < 0 ||
+	    history_write(s->nixfd, &ne, sizeof(ne)))
+		return -1;
+	s->nix_count++;
+	return 0;
+}
+
+static int	add_time_entry (HistoryStore *s, time_t when, off_t offset)
+{
+	TimeEntry	te;
+
+	te.when = (int64_t)when;
+	te.offset = (int64_t)offset;
+	if (history_write(s->tixfd, &te, sizeof(te)))
+		return -1;
+	s->tix_count++;
+	return 0;
+}
+
+static int	write_nix_header (HistoryStore *s, int merging)
+{
+	NickHeader	nh;
+	int		i;
+
+	memset(&nh, 0, sizeof(nh));
+	memcpy(nh.magic, HISTORY_NIX_MAGIC, sizeof(nh.magic));
+	nh.sorted = s->nix_sorted;
+	nh.merging = merging;
+	nh.newest = s->nix_newest;
+	nh.nruns = s->nix_nruns;
+	for (i = 0; i < s->nix_nruns; i++)
+		nh.runs[i] = s->nix_runs[i];
+	if (lseek(s->nixfd, 0, SEEK_SET) < 0)
+		return -1;
+	return history_write(s->nixfd, &nh, sizeof(nh));
+}
+
+/*
+ * catch_up - Index every line in the .log file from "from" onwards that
+ * isn't already indexed.  The .nix file has an entry for every line after
+ * "nix_after"; the .tix file has an entry for the line at "from", if
+ * "from_indexed".
+ */
+static int	catch_up (HistoryStore *s, off_t from, int from_indexed, off_t nix_after)
+{
+	HistoryReader	r;
+	struct stat	st;
+	char *	line;
+	char *	nick;
+	char *	text;
+	off_t	where;
+	time_t	when;
+	char	c;
+
+	/* A crash in the middle of a write leaves part of a line; end it */
+	if (fstat(s->logfd, &st))
+		return -1;
+	if (st.st_size > 0 && (history_read_at(s->logfd, &c, 1,
+				st.st_size - 1) != 1 || c != '\n') &&
+	    history_write(s->logfd, "\n", 1))
+		return -1;
+
+	s->since_tix = 0;
+	reader_init(&r, s->logfd, from);
+	while (reader_line(&r, &line, &where))
+	{
+		if (parse_record(line, &when, &nick, &text))
+			continue;
+		if (when < s->last)
+			when = s->last;
+		s->last = when;
+
+		if (s->since_tix % HISTORY_TIME_STEP == 0 &&
+		    !(from_indexed && where == from))
+		{
+			if (add_time_entry(s, when, where))
+				goto failed;
+			s->since_tix = 0;
+		}
+		s->since_tix++;
+
+		if (where > nix_after && add_nick_entry(s, nick, when, where))
+			goto failed;
+	}
+	s->logsize = r.off + r.pos;
+	reader_done(&r);
+	return 0;
+
+failed:
+	reader_done(&r);
+	return -1;
+}
+
+/*
+ * open_store - Open (and create, if "create") the store for a target.
+ * Returns NULL if it doesn't exist, or can't be opened.
+ */
+static HistoryStore *	open_store (const char *server, const char *target, int create)
+{
+	HistoryStore *	s;
+	HistoryStore *	oldest;
+	const char *	dir;
+	Filename	expanded;
+	char		sname[256], tname[256];
+	char *		name;
+	struct stat	st;
+	NickHeader	nh;
+	TimeEntry	te;
+	NickEntry	ne;
+	off_t		nix_after = -1, from = 0;
+	int		count, from_indexed = 0, i;
+	long		sum;
+
+	if (!(dir = get_string_var(HISTORY_DIR_VAR)) || !*dir)
+		return NULL;
+	if (!server || !*server || !target || !*target)
+		return NULL;
+
+	for (s = stores; s; s = s->next)
+	{
+		if (!my_stricmp(s->target, target) &&
+		    !my_stricmp(s->server, server))
+		{
+			s->used = ++store_clock;
+			return s;
+		}
+	}
+
+	if (expand_twiddle(dir, expanded))
+		return NULL;
+	history_file_name(server, sname, sizeof(sname));
+	history_file_name(target, tname, sizeof(tname));
+	name = malloc_sprintf(NULL, "%s/%s/%s", expanded, sname, tname);
+
+	/* Make room */
+	for (count = 0, oldest = s = stores; s; s = s->next, count++)
+		if (s->used < oldest->used)
+			oldest = s;
+	if (count >= HISTORY_MAX_OPEN)
+		close_store(oldest);
+
+	s = (HistoryStore *)new_malloc(sizeof(HistoryStore));
+	s->server = malloc_strdup(server);
+	s->target = malloc_strdup(target);
+	s->path = name;
+	s->logfd = s->tixfd = s->nixfd = -1;
+	s->logsize = 0;
+	s->last = 0;
+	s->since_tix = s->tix_count = 0;
+	s->nix_sorted = s->nix_count = 0;
+	s->nix_nruns = 0;
+	s->nix_newest = -1;
+	s->used = ++store_clock;
+
+	if (create)
+	{
+		mkdir(expanded, 0700);
+		name = malloc_sprintf(NULL, "%s/%s", expanded, sname);
+		mkdir(name, 0700);
+		new_free(&name);
+	}
+
+	name = malloc_sprintf(NULL, "%s.log", s->path);
+	s->logfd = open(name, O_RDWR | O_APPEND | (create ? O_CREAT : 0), 0600);
+	new_free(&name);
+	if (s->logfd < 0)
+		goto failed;
+
+	name = malloc_sprintf(NULL, "%s.tix", s->path);
+	s->tixfd = open(name, O_RDWR | O_APPEND | O_CREAT, 0600);
+	new_free(&name);
+	name = malloc_sprintf(NULL, "%s.nix", s->path);
+	s->nixfd = open(name, O_RDWR | O_CREAT, 0600);
+	new_free(&name);
+	if (s->tixfd < 0 || s->nixfd < 0)
+		goto failed;
+
+	/* Where do the indexes leave off? */
+	if (fstat(s->tixfd, &st))
+		goto failed;
+	s->tix_count = st.st_size / sizeof(TimeEntry);
+	if (s->tix_count > 0 && history_read_at(s->tixfd, &te, sizeof(te),
+			(off_t)(s->tix_count - 1) * sizeof(te)) == sizeof(te))
+	{
+		from = (off_t)te.offset;
+		from_indexed = 1;
+		s->last = (time_t)te.when;
+	}
+
+	if (fstat(s->nixfd, &st))
+		goto failed;
+	/* A crash in the middle of a compaction leaves "merging" set */
+	if (st.st_size >= (off_t)sizeof(nh) &&
+	    history_read_at(s->nixfd, &nh, sizeof(nh), 0) == sizeof(nh) &&
+	    !memcmp(nh.magic, HISTORY_NIX_MAGIC, sizeof(nh.magic)) &&
+	    !nh.merging && nh.nruns >= 0 && nh.nruns <= HISTORY_NIX_RUNS)
+	{
+		s->nix_count = (st.st_size - sizeof(nh)) / sizeof(NickEntry);
+		s->nix_sorted = (long)nh.sorted;
+		s->nix_nruns = (int)nh.nruns;
+		for (sum = 0, i = 0; i < s->nix_nruns; i++)
+			sum += (s->nix_runs[i] = (long)nh.runs[i]);
+		s->nix_newest = (off_t)nh.newest;
+		if (sum != s->nix_sorted || s->nix_sorted > s->nix_count)
+			s->nix_count = 0;	/* Start over */
+
+		/* The tail is in .log order; the runs aren't */
+		if (s->nix_count > 0 && s->nix_count == s->nix_sorted)
+			nix_after = s->nix_newest;
+		else if (s->nix_count > 0 && history_read_at(s->nixfd, &ne, sizeof(ne), 
+				sizeof(nh) + (off_t)(s->nix_count - 1) *
+					sizeof(ne)) == sizeof(ne))
+			nix_after = (off_t)ne.offset;
+	}
+
+	/*
+	 * If either index is missing (or the .nix doesn't reach back as
+	 * far as the last .tix entry, or either one points past the end 
+	 * of the .log, which someone must have cut short), start them 
+	 * both over.
+	 */
+	if (fstat(s->logfd, &st))
+		goto failed;
+	if (!from_indexed || s->nix_count == 0 || nix_after < from ||
+	    from >= st.st_size || nix_after >= st.st_size)
+	{
+		if (ftruncate(s->tixfd, 0) || ftruncate(s->nixfd, 0))
+			goto failed;
+		s->tix_count = s->nix_count = s->nix_sorted = 0;
+		s->nix_nruns = 0;
+		s->nix_newest = -1;
+		s->last = 0;
+		from = 0;
+		from_indexed = 0;
+		nix_after = -1;
+	}
+	if (s->nix_count == 0 && write_nix_header(s, 0))
+		goto failed;
+
+	if (catch_up(s, from, from_indexed, nix_after))
+		goto failed;
+
+	s->next = stores;
+	stores = s;
+
+	if (s->nix_count - s->nix_sorted >= HISTORY_NIX_TAIL &&
+	    !timer_exists(history_timeref))
+		add_timer(1, history_timeref, HISTORY_COMPACT_DELAY, 1,
+			  history_compact_timer, NULL, NULL,
+			  GENERAL_TIMER, -1, 0, 0);
+	return s;
+
+failed:
+	if (create)
+		yell("Could not open history file %s: %s", s->path,
+							strerror(errno));
+	if (s->logfd >= 0)
+		close(s->logfd);
+	if (s->tixfd >= 0)
+		close(s->tixfd);
+	if (s->nixfd >= 0)
+		close(s->nixfd);
+	new_free(&s->server);
+	new_free(&s->target);
+	new_free(&s->path);
+	new_free((char **)&s);
+	return NULL;
+}
+
+static void	close_store (HistoryStore *s)
+{
+	HistoryStore **	sp;
+
+	for (sp = &stores; *sp; sp = &(*sp)->next)
+	{
+		if (*sp == s)
+		{
+			*sp = s->next;
+			break;
+		}
+	}
+	close(s->logfd);
+	close(s->tixfd);
+	close(s->nixfd);
+	new_free(&s->server);
+	new_free(&s->target);
+	new_free(&s->path);
+	new_free((char **)&s);
+}
+
+void	close_all_history (void)
+{
+	while (stores)
+		close_store(stores);
+}
+
+/*
+ * The server part of the file name.  This is the name you gave to the
+ * client (not whatever the server calls itself), so it stays the same
+ * from one connection to the next.
+ */
+static const char *	history_server_name (const char *desc)
+{
+	int	refnum;
+
+	if (is_number(desc))
+	{
+		refnum = (int)my_atol(desc);
+		if (!is_server_valid(refnum))
+			return NULL;
+		return get_server_name(refnum);
+	}
+	return desc;
+}
+
+/****************************************************************************/
+/*
+ * add_to_history - Called by add_to_logs() for every line of output.
+ */
+void	add_to_history (int servref, const char *target, int level, const char *str)
+{
+	HistoryStore *	s;
+	const char *	nick;
+	const char *	server;
+	char *		line;
+	char *		p;
+	time_t		now;
+	off_t		where;
+	size_t		len;
+
+	if (history_replaying || !target || !*target || !str)
+		return;
+	if (!get_string_var(HISTORY_DIR_VAR))
+		return;
+	if (level == LEVEL_NONE || mask_isset(&history_mask, level) != 1)
+		return;
+	if (!is_server_valid(servref) || !(server = get_server_name(servref)))
+		return;
+	if (!(s = open_store(server, target, 1)))
+		return;
+
+	if (FromNick && *FromNick)
+		nick = FromNick;
+	else if (!(nick = get_server_nickname(servref)) || !*nick)
+		nick = "*";
+
+	time(&now);
+	if (now < s->last)
+		now = s->last;
+
+	line = malloc_sprintf(NULL, "%ld %s %s %s\n", (long)now, nick,
+					level_to_str(level), str);
+	len = strlen(line);
+	for (p = line; p < line + len - 1; p++)
+		if (*p == '\n' || *p == '\r')
+			*p = ' ';
+
+	where = s->logsize;
+	if (history_write(s->logfd, line, len))
+	{
+		yell("Could not write history file %s.log: %s", s->path,
+							strerror(errno));
+		new_free(&line);
+		close_store(s);
+		return;
+	}
+	new_free(&line);
+	s->logsize += len;
+	s->last = now;
+
+	/* The .log is right; the indexes can be fixed up next time */
+	if (add_nick_entry(s, nick, now, where))
+		return;
+	if (s->since_tix % HISTORY_TIME_STEP == 0)
+	{
+		if (add_time_entry(s, now, where))
+			return;
+		s->since_tix = 0;
+	}
+	s->since_tix++;
+
+	if (s->nix_count - s->nix_sorted >= HISTORY_NIX_TAIL &&
+	    !timer_exists(history_timeref))
+		add_timer(1, history_timeref, HISTORY_COMPACT_DELAY, 1,
+			  history_compact_timer, NULL, NULL,
+			  GENERAL_TIMER, -1, 0, 0);
+}
+
+/****************************************************************************/
+static int	nick_entry_cmp (const void *a, const void *b)
+{
+	const NickEntry *x = (const NickEntry *)a;
+	const NickEntry *y = (const NickEntry *)b;
+
+	if (x->hash != y->hash)
+		return x->hash < y->hash ? -1 : 1;
+	if (x->offset != y->offset)
+		return x->offset < y->offset ? -1 : 1;
+	return 0;
+}
+
+/*
+ * merge_runs - Merge run 'r' of the .nix file with the run after it, in
+ * place.  Run 'r' is read into memory first; the one after it is read a
+ * chunk at a time, and is never overwritten before it has been read,
+ * because the merged entries can't get ahead of the entries read so far.
+ */
+static int	merge_runs (HistoryStore *s, int r)
+{
+	NickEntry *	first;
+	NickEntry *	second;
+	NickEntry *	out;
+	NickEntry *	next;
+	off_t		base;
+	long		nfirst, nsecond, i, j, k, got, nout, written, chunk;
+	int		retval = -1;
+
+	for (base = sizeof(NickHeader), i = 0; i < r; i++)
+		base += (off_t)s->nix_runs[i] * sizeof(NickEntry);
+	nfirst = s->nix_runs[r];
+	nsecond = s->nix_runs[r + 1];
+
+	first = (NickEntry *)new_malloc(sizeof(NickEntry) * nfirst);
+	if (history_read_at(s->nixfd, first, sizeof(NickEntry) * nfirst, base)
+					!= (int)(sizeof(NickEntry) * nfirst))
+	{
+		new_free((char **)&first);
+		return -1;
+	}
+
+	chunk = 4096;
+	second = (NickEntry *)new_malloc(sizeof(NickEntry) * chunk);
+	out = (NickEntry *)new_malloc(sizeof(NickEntry) * chunk);
+	nout = written = 0;
+	i = 0;			/* next entry of the first run */
+	j = 0;			/* next entry of the second run to read */
+	k = got = 0;		/* position in, and size of, "second" */
+	for (;;)
+	{
+		if (k == got && j < nsecond)
+		{
+			got = nsecond - j;
+			if (got > chunk)
+				got = chunk;
+			if (history_read_at(s->nixfd, second, 
+				sizeof(NickEntry) * got, base + (off_t)(nfirst + j) *
+					sizeof(NickEntry)) != (int)(sizeof(NickEntry) * got))
+				goto done;
+			j += got;
+			k = 0;
+		}
+
+		if (i < nfirst && (k == got ||
+				nick_entry_cmp(&first[i], &second[k]) <= 0))
+			next = &first[i++];
+		else if (k < got)
+			next = &second[k++];
+		else
+			break;
+
+		out[nout++] = *next;
+		if (nout == chunk)
+		{
+			if (lseek(s->nixfd, base + (off_t)written * 
+					sizeof(NickEntry), SEEK_SET) < 0 ||
+			    history_write(s->nixfd, out, sizeof(NickEntry) * nout))
+				goto done;
+			written += nout;
+			nout = 0;
+		}
+	}
+	if (nout && (lseek(s->nixfd, base + (off_t)written * 
+				sizeof(NickEntry), SEEK_SET) < 0 ||
+		     history_write(s->nixfd, out, sizeof(NickEntry) * nout)))
+		goto done;
+
+	s->nix_runs[r] += nsecond;
+	for (i = r + 1; i < s->nix_nruns - 1; i++)
+		s->nix_runs[i] = s->nix_runs[i + 1];
+	s->nix_nruns--;
+	retval = 0;
+
+done:
+	new_free((char **)&first);
+	new_free((char **)&second);
+	new_free((char **)&out);
+	return retval;
+}
+
+/*
+ * compact_store - Sort the unsorted tail of the .nix file into a new
+ * run, and then merge the newest two runs for as long as the older one
+ * is no more than twice as big as the newer one.  Like a binary counter,
+ * this keeps the number of runs logarithmic, and every entry gets
+ * merged O(log n) times, instead of the whole file being rewritten each
+ * time the tail fills up.
+ */
+static int	compact_store (HistoryStore *s)
+{
+	NickEntry *	tail;
+	long		ntail;
+	off_t		newest;
+	int		n;
+
+	ntail = s->nix_count - s->nix_sorted;
+	if (ntail <= 0)
+		return 0;
+
+	tail = (NickEntry *)new_malloc(sizeof(NickEntry) * ntail);
+	if (history_read_at(s->nixfd, tail, sizeof(NickEntry) * ntail,
+		sizeof(NickHeader) + (off_t)s->nix_sorted * sizeof(NickEntry))
+			!= (int)(sizeof(NickEntry) * ntail))
+	{
+		new_free((char **)&tail);
+		return -1;
+	}
+	newest = (off_t)tail[ntail - 1].offset;
+	qsort(tail, ntail, sizeof(NickEntry), nick_entry_cmp);
+
+	/* If we die before we're done, the .nix is rebuilt next time */
+	if (write_nix_header(s, 1))
+		goto failed;
+	if (lseek(s->nixfd, sizeof(NickHeader) + (off_t)s->nix_sorted *
+					sizeof(NickEntry), SEEK_SET) < 0 ||
+	    history_write(s->nixfd, tail, sizeof(NickEntry) * ntail))
+		goto failed;
+	new_free((char **)&tail);
+
+	/* This can only be full if the runs didn't come from here */
+	if (s->nix_nruns == HISTORY_NIX_RUNS && merge_runs(s, s->nix_nruns - 2))
+		goto failed;
+	s->nix_runs[s->nix_nruns++] = ntail;
+	s->nix_sorted = s->nix_count;
+	s->nix_newest = newest;
+
+	while ((n = s->nix_nruns) >= 2 && 
+			s->nix_runs[n - 2] <= 2 * s->nix_runs[n - 1])
+		if (merge_runs(s, n - 2))
+			goto failed;
+
+	if (write_nix_header(s, 0))
+		goto failed;
+	return 1;
+
+failed:
+	/*
+	 * The runs may be half-written, but every entry is still in the 
+	 * file somewhere, so treat it all as unsorted tail for now.
+	 */
+	new_free((char **)&tail);
+	s->nix_sorted = 0;
+	s->nix_nruns = 0;
+	return -1;
+}
+
+/*
+ * Compact one store per timer tick, so a lot of busy channels don't
+ * all get compacted at once.
+ */
+static int	history_compact_timer (void *unused)
+{
+	HistoryStore *	s;
+	int		more = 0;
+
+	for (s = stores; s; s = s->next)
+	{
+		if (s->nix_count - s->nix_sorted < HISTORY_NIX_TAIL)
+			continue;
+		if (more++ == 0)
+			compact_store(s);
+	}
+
+	if (more > 1)
+		add_timer(1, history_timeref, 1, 1, history_compact_timer,
+			  NULL, NULL, GENERAL_TIMER, -1, 0, 0);
+	return 0;
+}
+
+/****************************************************************************/
+/*
+ * Queries collect lines in a Results, and return them as a word list,
+ * one (double quoted) word per line.
+ */
+typedef struct {
+	char *	buf;
+	size_t	len;
+	size_t	size;
+	long	count;
+	long	max;
+} Results;
+
+static void	results_add (Results *res, const char *line)
+{
+	size_t	need = res->len + strlen(line) * 2 + 4;
+
+	if (need > res->size)
+	{
+		res->size = res->size ? res->size * 2 : 8192;
+		while (res->size < need)
+			res->size *= 2;
+		RESIZE(res->buf, char, res->size);
+	}
+	if (res->len)
+		res->buf[res->len++] = ' ';
+	res->len += quote_dword(line, 1, res->buf + res->len,
+						res->size - res->len);
+	res->count++;
+}
+
+/*
+ * Find the last .tix entry at or before "when" (with times equal to
+ * "when", the first of them), and return the offset to start reading
+ * from.
+ */
+static off_t	time_search (HistoryStore *s, time_t when, long *index)
+{
+	TimeEntry	te;
+	long		lo = 0, hi = s->tix_count, mid;
+
+	/* Find the first entry with a time >= when */
+	while (lo < hi)
+	{
+		mid = lo + (hi - lo) / 2;
+		if (history_read_at(s->tixfd, &te, sizeof(te),
+				(off_t)mid * sizeof(te)) != sizeof(te))
+			return 0;
+		if (te.when < (int64_t)when)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	/* The entry before that one may have lines at "when" after it */
+	if (lo > 0)
+		lo--;
+	if (index)
+		*index = lo;
+	if (lo >= s->tix_count || history_read_at(s->tixfd, &te, sizeof(te),
+				(off_t)lo * sizeof(te)) != sizeof(te))
+		return 0;
+	return (off_t)te.offset;
+}
+
+static void	query_time (HistoryStore *s, time_t start, time_t end, Results *res)
+{
+	HistoryReader	r;
+	char *		line;
+	char *		after;
+	off_t		where;
+	time_t		when;
+
+	reader_init(&r, s->logfd, time_search(s, start, NULL));
+	while (res->count < res->max && reader_line(&r, &line, &where))
+	{
+		when = (time_t)strtol(line, &after, 10);
+		if (after == line || *after != ' ')
+			continue;
+		if (when < start)
+			continue;
+		if (end >= 0 && when > end)
+			break;
+		results_add(res, line);
+	}
+	reader_done(&r);
+}
+
+/*
+ * Read the whole .log line at "offset", and return it if it is really
+ * from "nick" (it might just be a hash collision).
+ */
+static char *	read_record (HistoryStore *s, off_t offset, const char *nick)
+{
+	HistoryReader	r;
+	char *		line;
+	char *		lnick;
+	char *		retval = NULL;
+	off_t		where;
+	size_t		len = strlen(nick);
+
+	reader_init(&r, s->logfd, offset);
+	r.size = 1024;
+	r.buf = new_malloc(r.size);
+	if (reader_line(&r, &line, &where) && (lnick = strchr(line, ' ')))
+	{
+		lnick++;
+		if (!my_strnicmp(lnick, nick, len) && lnick[len] == ' ')
+			retval = malloc_strdup(line);
+	}
+	reader_done(&r);
+	return retval;
+}
+
+static int	nick_match (HistoryStore *s, NickEntry *ne, uint32_t hash, const char *nick, time_t start, time_t end, Results *res)
+{
+	char *	line;
+
+	if (ne->hash != hash || (time_t)ne->when < start)
+		return 0;
+	if (end >= 0 && (time_t)ne->when > end)
+		return 0;
+	if ((line = read_record(s, (off_t)ne->offset, nick)))
+	{
+		results_add(res, line);
+		new_free(&line);
+	}
+	return 1;
+}
+
+/*
+ * query_run - Add the entries for "nick" in the sorted run of "len"
+ * entries starting at entry "first" of the .nix file.
+ */
+static void	query_run (HistoryStore *s, long first, long len, uint32_t hash, const char *nick, time_t start, time_t end, Results *res)
+{
+	NickEntry	buf[256];
+	long		lo = first, hi = first + len, mid, i, n, got;
+	off_t		base = sizeof(NickHeader);
+
+	/* The first entry at or after (hash, start) */
+	while (lo < hi)
+	{
+		mid = lo + (hi - lo) / 2;
+		if (history_read_at(s->nixfd, buf, sizeof(NickEntry),
+			base + (off_t)mid * sizeof(NickEntry)) != sizeof(NickEntry))
+			return;
+		if (buf[0].hash < hash ||
+		    (buf[0].hash == hash && (time_t)buf[0].when < start))
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	/* All the entries for this hash are together, in time order */
+	for (i = lo; i < first + len && res->count < res->max; i += got)
+	{
+		got = first + len - i;
+		if (got > 256)
+			got = 256;
+		if (history_read_at(s->nixfd, buf, sizeof(NickEntry) * got,
+			base + (off_t)i * sizeof(NickEntry))
+					!= (int)(sizeof(NickEntry) * got))
+			return;
+		for (n = 0; n < got && res->count < res->max; n++)
+			if (!nick_match(s, &buf[n], hash, nick, start, end, res))
+				break;
+		if (n < got)
+			break;
+	}
+}
+
+static void	query_nick (HistoryStore *s, const char *nick, time_t start, time_t end, Results *res)
+{
+	NickEntry	buf[256];
+	uint32_t	hash = history_nick_hash(nick);
+	long		i, n, got, first;
+	off_t		base = sizeof(NickHeader);
+	int		r;
+
+	/* Only neighbouring runs are ever merged, so they're oldest first */
+	for (first = 0, r = 0; r < s->nix_nruns; first += s->nix_runs[r++])
+		query_run(s, first, s->nix_runs[r], hash, nick, start, end, res);
+
+	/* The unsorted tail is in time order, and newer than the rest */
+	for (i = s->nix_sorted; i < s->nix_count && res->count < res->max; i += got)
+	{
+		got = s->nix_count - i;
+		if (got > 256)
+			got = 256;
+		if (history_read_at(s->nixfd, buf, sizeof(NickEntry) * got,
+			base + (off_t)i * sizeof(NickEntry))
+					!= (int)(sizeof(NickEntry) * got))
+			break;
+		for (n = 0; n < got && res->count < res->max; n++)
+			nick_match(s, &buf[n], hash, nick, start, end, res);
+	}
+}
+
+/*
+ * The last "count" lines in the store.  We back up enough .tix entries
+ * to be sure of having them, and keep the last "count" we see.  The
+ * ring starts out small and grows as lines are read, so a huge "count"
+ * only costs as much as the lines that are really there.
+ */
+static char **	query_last (HistoryStore *s, long count, long *found)
+{
+	HistoryReader	r;
+	TimeEntry	te;
+	char **		ring;
+	char *		line;
+	off_t		where, from = 0;
+	long		back, n = 0, i, first, size;
+	char **		retval;
+
+	back = s->tix_count - (count / HISTORY_TIME_STEP) - 2;
+	if (back > 0 && history_read_at(s->tixfd, &te, sizeof(te),
+			(off_t)back * sizeof(te)) == sizeof(te))
+		from = (off_t)te.offset;
+
+	size = count < 256 ? count : 256;
+	ring = (char **)new_malloc(sizeof(char *) * size);
+	for (i = 0; i < size; i++)
+		ring[i] = NULL;
+
+	reader_init(&r, s->logfd, from);
+	while (reader_line(&r, &line, &where))
+	{
+		/* It hasn't wrapped around yet, so it can just grow */
+		if (n == size && size < count)
+		{
+			size = size > count / 2 ? count : size * 2;
+			RESIZE(ring, char *, size);
+			for (i = n; i < size; i++)
+				ring[i] = NULL;
+		}
+		malloc_strcpy(&ring[n++ % size], line);
+	}
+	reader_done(&r);
+
+	/* Put them in order */
+	*found = n < size ? n : size;
+	first = n < size ? 0 : n % size;
+	retval = (char **)new_malloc(sizeof(char *) * (*found + 1));
+	for (i = 0; i < *found; i++)
+		retval[i] = ring[(first + i) % size];
+	retval[i] = NULL;
+	new_free((char **)&ring);
+	return retval;
+}
+
+/*
+ * Show the last "count" lines in the target's window, as though they
+ * had just arrived, but without adding them to the history again.
+ */
+static long	history_replay (int servref, const char *target, HistoryStore *s, long count)
+{
+	char **	lines;
+	char *	nick;
+	char *	text;
+	char *	lev;
+	time_t	when;
+	long	found, i;
+	int	level, l, old_from_server;
+
+	lines = query_last(s, count, &found);
+
+	old_from_server = from_server;
+	from_server = servref;
+	history_replaying++;
+	for (i = 0; i < found; i++)
+	{
+		if (!parse_record(lines[i], &when, &nick, &lev) &&
+		    (text = strchr(lev, ' ')))
+		{
+			*text++ = 0;
+			if ((level = str_to_level(lev)) < 0)
+				level = LEVEL_OTHER;
+			l = message_from(target, level);
+			put_it("%s", text);
+			pop_message_from(l);
+		}
+		new_free(&lines[i]);
+	}
+	history_replaying--;
+	from_server = old_from_server;
+
+	new_free((char **)&lines);
+	return found;
+}
+
+/****************************************************************************/
+void	set_history_dir (void *stuff)
+{
+	close_all_history();
+}
+
+void	set_history_mask (void *stuff)
+{
+	VARIABLE *v;
+	const char *str;
+	char *rejects = NULL;
+
+	v = stuff;
+	str = v->string;
+
+	if (str_to_mask(&history_mask, str, &rejects))
+		standard_level_warning("/SET HISTORY_LEVEL", &rejects);
+	malloc_strcpy(&v->string, mask_to_str(&history_mask));
+}
+
+/*
+ * $historyctl(GET <server> <target> <start> <end> [<nick> [<max>]])
+ *	Return the lines for <target> from <start> to <end> (in seconds
+ *	since the epoch; -1 for <end> means "until now"), oldest first.
+ *	If <nick> is given (and isn't "*"), only the lines from <nick>.
+ *	At most <max> lines (default 1000).
+ * $historyctl(LAST <server> <target> <count>)
+ *	Return the last <count> lines for <target>.
+ * $historyctl(REPLAY <server> <target> <count>)
+ *	Display the last <count> lines for <target>, as though they had
+ *	just arrived.  Returns the number of lines displayed.
+ * $historyctl(COMPACT)
+ *	Compact the nick index of every open store now.
+ * $historyctl(FILENAME <server> <target>)
+ *	Return the name of the .log file for <target>.
+ *
+ * <server> is a server refnum or a server name.  Each line returned is a
+ * double quoted word: "<time> <nick> <level> <text>".
+ */
+char *	historyctl (char *input)
+{
+	char *		listc;
+	char *		server;
+	char *		target;
+	const char *	sname;
+	HistoryStore *	s;
+	Results		res;
+	long		start, end, count;
+
+	GET_FUNC_ARG(listc, input);
+	if (!my_strnicmp(listc, "COMPACT", 1)) {
+		count = 0;
+		for (s = stores; s; s = s->next)
+			if (compact_store(s) > 0)
+				count++;
+		RETURN_INT(count);
+	}
+
+	GET_FUNC_ARG(server, input);
+	GET_FUNC_ARG(target, input);
+	if (!(sname = history_server_name(server)))
+		RETURN_EMPTY;
+
+	if (!my_strnicmp(listc, "FILENAME", 1)) {
+		char *	retval;
+
+		if (!(s = open_store(sname, target, 0)))
+			RETURN_EMPTY;
+		retval = malloc_sprintf(NULL, "%s.log", s->path);
+		RETURN_MSTR(retval);
+	}
+
+	if (!(s = open_store(sname, target, 0)))
+		RETURN_EMPTY;
+
+	if (!my_strnicmp(listc, "GET", 1)) {
+		char *	nick = NULL;
+
+		GET_INT_ARG(start, input);
+		GET_INT_ARG(end, input);
+		res.buf = NULL;
+		res.len = res.size = 0;
+		res.count = 0;
+		res.max = 1000;
+		if (input && *input)
+			nick = next_arg(input, &input);
+		if (input && *input)
+			GET_INT_ARG(res.max, input);
+
+		if (nick && strcmp(nick, "*"))
+			query_nick(s, nick, (time_t)start, (time_t)end, &res);
+		else
+			query_time(s, (time_t)start, (time_t)end, &res);
+		RETURN_MSTR(res.buf);
+	} else if (!my_strnicmp(listc, "LAST", 1)) {
+		char **	lines;
+		long	found, i;
+
+		GET_INT_ARG(count, input);
+		if (count <= 0)
+			RETURN_EMPTY;
+		lines = query_last(s, count, &found);
+		res.buf = NULL;
+		res.len = res.size = 0;
+		res.count = 0;
+		for (i = 0; i < found; i++)
+		{
+			results_add(&res, lines[i]);
+			new_free(&lines[i]);
+		}
+		new_free((char **)&lines);
+		RETURN_MSTR(res.buf);
+	} else if (!my_strnicmp(listc, "REPLAY", 1)) {
+		int	servref;
+
+		GET_INT_ARG(count, input);
+		if (count <= 0)
+			RETURN_INT(0);
+		if (is_number(server))
+			servref = (int)my_atol(server);
+		else
+			servref = str_to_servref(server);
+		RETURN_INT(history_replay(servref, target, s, count));
+	}
+
+	RETURN_EMPTY;
+}
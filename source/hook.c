@@ -44,6 +44,7 @@
 #include "stack.h"
 #include "reg.h"
 #include "functions.h"
+#include "profiler.h"
 
 /*
  * The various ON levels: SILENT means the DISPLAY will be OFF and it will
@@ -257,11 +258,28 @@ static Hook **hooklist = NULL;
 static int hooklist_size = 0;
 static int	last_created_hook = -2;
 static struct Current_hook *current_hook = NULL;
+
+/*
+ * Current_hook frames are recycled through this pool rather than being
+ * new_malloc()ed and new_free()d for every event.  Hooks can't nest any
+ * deeper than the recursion limit, so the pool never gets very big.
+ */
+#define HOOK_FRAME_PREALLOC	16
+static struct Current_hook *hook_frame_pool = NULL;
+static long	hook_dispatches = 0;
+static long	hook_allocations = 0;
 /*
  * If deny_all_hooks is set to 1, no action is taken for any hook.
  */
 int deny_all_hooks = 0;
 
+/*
+ * The "is anyone listening?" bitmap -- see is_hooked() in hook.h.
+ * Keep it up to date with update_hooked_type() whenever a list or an
+ * implied hook comes or goes.
+ */
+unsigned char	hooked_types[(NUMBER_OF_LISTS + 7) / 8];
+
 static	struct NoiseInfo **	noise_info = NULL;
 static	int 			noise_level_num = 0;
 static	int 			default_noise;
@@ -271,6 +289,36 @@ extern char *	    function_cparse	(char *);
 static void 	    add_to_list 	(Hook **list, Hook *item);
 static Hook *	    remove_from_list 	(Hook **list, char *item, int sernum);
 
+static void	update_hooked_type (int which)
+{
+	unsigned char	bit = 1 << (which & 7);
+
+	if (hook_functions[which].list || hook_functions[which].implied)
+		hooked_types[which >> 3] |= bit;
+	else
+		hooked_types[which >> 3] &= ~bit;
+}
+
+static struct Current_hook *	get_hook_frame (void)
+{
+	struct Current_hook *hook;
+
+	if ((hook = hook_frame_pool))
+		hook_frame_pool = hook->under;
+	else
+	{
+		hook = new_malloc(sizeof(struct Current_hook));
+		hook_allocations++;
+	}
+	return hook;
+}
+
+static void	release_hook_frame (struct Current_hook *hook)
+{
+	hook->under = hook_frame_pool;
+	hook_frame_pool = hook;
+}
+
 static void	initialize_hook_functions (void)
 {
 	int	i, b;
@@ -324,6 +372,10 @@ static void	initialize_hook_functions (void)
 				default_noise = b;
 		}
 	}
+
+	for (i = 0; i < HOOK_FRAME_PREALLOC; i++)
+		release_hook_frame(new_malloc(sizeof(struct Current_hook)));
+
 	hook_functions_initialized = 1;
 }
 
@@ -497,6 +549,7 @@ static int	add_hook (int which, char *nick, ArgList *arglist, char *stuff, int n
 
 	hooklist[new_h->userial] = new_h;
 	add_to_list(&hook_functions[which].list, new_h);
+	update_hooked_type(which);
 
 	last_created_hook = new_h->userial;
 
@@ -538,6 +591,7 @@ static void remove_hook (int which, char *nick, int sernum, int quiet)
 			}
 			tmp->next = NULL;
 			new_free((char **)&tmp); /* XXX why? */
+			update_hooked_type(which);
 		}
 		else if (!quiet)
 			say("\"%s\" is not on the %s list", nick,
@@ -575,6 +629,7 @@ static void remove_hook (int which, char *nick, int sernum, int quiet)
 		new_free((char **)&tmp);
 	}
 	hook_functions[which].list = top;
+	update_hooked_type(which);
 	if (!quiet)
 	{
 		if (sernum)
@@ -704,6 +759,15 @@ int	do_hook (int which, const char *format, ...)
 	int	retval;
 	va_list	args;
 
+	/*
+	 * If nobody is listening, there's no point in pressing the
+	 * buffer, because our caller doesn't want it anyways.  The first
+	 * call still has to go through, because it sets up hook_functions[]
+	 * which everybody else assumes is there.
+	 */
+	if (hook_functions_initialized && !is_hooked(which))
+		return NO_ACTION_TAKEN;
+
 	va_start(args, format);
 	retval = do_hook_internal(which, &result, format, args);
 	new_free(&result);
@@ -782,7 +846,8 @@ static int 	do_hook_internal (int which, char **result, const char *format, va_l
 	/*
 	 * Set current_hook
 	 */
-	hook = new_malloc(sizeof(struct Current_hook));
+	hook = get_hook_frame();
+	hook_dispatches++;
 	hook->userial = -1;
 	hook->halt = 0;
 	hook->under = current_hook;
@@ -809,6 +874,7 @@ static int 	do_hook_internal (int which, char **result, const char *format, va_l
 		char *buffer_copy;
 		int bestmatch = 0;
 		int currmatch;
+		int profiled = 0;
 
 		if (tmp->sernum < serial_number)
 		    continue;
@@ -855,12 +921,20 @@ static int 	do_hook_internal (int which, char **result, const char *format, va_l
 		/* Copy off everything important from 'tmp'. */
 		noise = tmp->noisy;
 		if (!name)
-			name = LOCAL_COPY(h->name);
+			name = h->name;		/* These never go away */
 		stuff_copy = LOCAL_COPY(tmp->stuff);
 		quote = tmp->flexible ? '\'' : '"';
 
 		hook->userial = tmp->userial;
-		tmp_arglist = clone_arglist(tmp->arglist);
+		tmp_arglist = share_arglist(tmp->arglist);
+
+		if (profiling)
+		{
+			char	label[64];
+
+			snprintf(label, sizeof(label), "%s#%d", name, hook->userial);
+			profiled = profile_enter(PROFILE_HOOK, label, tmp->filename);
+		}
 
 		/*
 		 * YOU CAN'T TOUCH ``tmp'' AFTER THIS POINT!!!
@@ -925,6 +999,9 @@ static int 	do_hook_internal (int which, char **result, const char *format, va_l
 				destroy_arglist(&tmp_arglist);
 		}
 
+		if (profiled)
+			profile_leave();
+
 		/*
 		 * Clean up the stuff that may have been mangled by the
 		 * execution.
@@ -956,7 +1033,7 @@ static int 	do_hook_internal (int which, char **result, const char *format, va_l
 	if (hook->user_supplied_info)
 		new_free(&hook->user_supplied_info);
 	current_hook = hook->under;
-	new_free(&hook);
+	release_hook_frame(hook);
 
 	/*
 	 * And return the user-specified suppression level
@@ -1461,6 +1538,7 @@ void	do_stack_on (int type, char *args)
 		new_os->next = on_stack;
 		on_stack = new_os;
 		hook_functions[which].list = NULL;
+		update_hooked_type(which);
 		return;
 	}
 
@@ -1486,6 +1564,7 @@ void	do_stack_on (int type, char *args)
 		}
 
 		hook_functions[which].list = p->list;
+		update_hooked_type(which);
 
 		new_free((char **)&p);
 		return;
@@ -1635,6 +1714,7 @@ enum
 enum
 {
 	HOOKCTL_ADD = 1,
+	HOOKCTL_ALLOCATIONS,
 	HOOKCTL_ARGS,
 	HOOKCTL_COUNT,
 	HOOKCTL_CURRENT_IMPLIED_HOOK,
@@ -1685,6 +1765,10 @@ enum
  *       Argument list not yet implemented for $hookctl()
  *   ADD <#!'[NOISETYPE]><list> [[#]<serial>] <nick> <stuff>
  *       - Creates a new hook. Returns hook id.
+ *   ALLOCATIONS
+ *       - Returns two numbers: how many events have been dispatched to
+ *         /ON hooks, and how many times that had to allocate memory for
+ *         the bookkeeping.  The second number should stay flat.
  *   COUNT
  *       - See COUNT/LIST
  *   HALTCHAIN <recursive number>
@@ -1904,6 +1988,7 @@ char *hookctl (char *input)
 	GET_FUNC_ARG(str, input);
 	go = vmy_strnicmp (strlen(str), str, 
 		"ADD",
+		"ALLOCATIONS",
 		"ARGS",
 		"COUNT",
 		"CURRENT_IMPLIED_HOOK",
@@ -2024,6 +2109,13 @@ char *hookctl (char *input)
 		}
 		break;
 	
+	/* go-switch */
+	case HOOKCTL_ALLOCATIONS:
+		malloc_strcat_wordlist(&ret, space, ltoa(hook_dispatches));
+		malloc_strcat_wordlist(&ret, space, ltoa(hook_allocations));
+		RETURN_MSTR(ret);
+		break;
+
 	/* go-switch */
 	case HOOKCTL_DENY_ALL_HOOKS:
 		if (!input || !*input)
@@ -2575,6 +2667,7 @@ char *hookctl (char *input)
 									new_free(&hooks->implied);
 								else
 									malloc_strcpy(&hooks->implied, input);
+								update_hooked_type(hooknum);
 								RETURN_INT(1);
 							} else
 								RETURN_STR(hooks->implied);
@@ -133,6 +133,52 @@ static	List *	ignored_nicks = NULL;
 static	int	global_ignore_refnum = 0;
 static	int	ignores_are_suspended = 0;
 
+/*
+ * The ignore index -- check_ignore_channel() runs for every message we
+ * get, so rather than wild_match() every ignore, we only try the ones that
+ * could possibly match:
+ *   - An ignore without wildcards can only match a string that is the
+ *     same as it, so they are hashed by their whole name.
+ *   - An ignore that ends with plain characters (like *!*@*.domain) can
+ *     only match strings that end with them, so they are hashed by that
+ *     suffix, and we look up each suffix of the string.
+ *   - Likewise, an ignore that starts with plain characters (nick!*@*) 
+ *     is hashed by that prefix.
+ *   - Everything else is tried every time.
+ * The ignores that turn up are tried in the order they're in on the
+ * ignore list, so the best match is the same one we'd get by trying every
+ * ignore.  The index is rebuilt the next time it's needed after the 
+ * ignore list changes.
+ */
+#define IGNORE_EXACT	0
+#define IGNORE_PREFIX	1
+#define IGNORE_SUFFIX	2
+#define IGNORE_WILD	3
+
+typedef struct	IgnoreKeyStru
+{
+	List *	item;			/* The ignore */
+	int	position;		/* Where it is in ignored_nicks */
+	int	kind;			/* IGNORE_EXACT, _PREFIX, etc */
+	const char *key;		/* The plain chars in item->name */
+	size_t	len;			/* How many plain chars there are */
+	uint32_t hashval;		/* ignore_hash() of the plain chars */
+struct	IgnoreKeyStru *next;		/* Next key in the hash bucket */
+}	IgnoreKey;
+
+static	IgnoreKey *	ignore_keys = NULL;
+static	IgnoreKey **	ignore_buckets = NULL;
+static	int		ignore_buckets_size = 0;
+static	IgnoreKey **	ignore_wild = NULL;
+static	int		ignore_wild_count = 0;
+static	size_t		ignore_max_prefix = 0;
+static	size_t		ignore_max_suffix = 0;
+static	int		ignore_index_dirty = 1;
+
+static	IgnoreKey **	ignore_candidates = NULL;
+static	int		ignore_candidates_count = 0;
+static	int		ignore_candidates_size = 0;
+
 static void	expire_ignores			(void);
 static const char *	get_ignore_types 		(List *item, int);
 static int	change_ignore_mask_by_desc (const char *type, Mask *do_mask, Mask *dont_mask, char **reason, Timeval *expire);
@@ -170,6 +216,7 @@ static List *new_ignore (const char *new_nick)
 	item->d = d;
 
 	add_item_to_list(&ignored_nicks, item);
+	ignore_index_dirty = 1;
 	return item;
 }
 
@@ -279,6 +326,7 @@ static int 	remove_ignore (const char *nick)
 			last->next = item->next;
 		    else
 			ignored_nicks = item->next;
+		    ignore_index_dirty = 1;
 
 		    say("%s removed from ignorance list (ignore refnum %d)", 
 				item->name, IGNORE(item)->refnum);
@@ -308,6 +356,7 @@ static int 	remove_ignore (const char *nick)
 	 */
 	while ((item = remove_from_list(&ignored_nicks, new_nick)))
 	{
+		ignore_index_dirty = 1;
 		say("%s removed from ignorance list (ignore refnum %d)", 
 				item->name, IGNORE(item)->refnum);
 		new_free(&(item->name));
@@ -1116,6 +1165,7 @@ char *	ignorectl (char *input)
 		len = strlen(listc);
 		if (!my_strnicmp(listc, "NICK", len)) {
 			malloc_strcpy(&i->name, input);
+			ignore_index_dirty = 1;
 			RETURN_INT(IGNORE(i)->refnum);
 		} else if (!my_strnicmp(listc, "LEVELS", len)) {
 			mask_unsetall(&IGNORE(i)->type);
@@ -1179,6 +1229,219 @@ char *	ignorectl (char *input)
 
 
 /***************************** BACK END *************************************/
+/*
+ * The hash of the plain characters in an ignore (see ignore_keys).  
+ * wild_match() doesn't care about case, so neither does this.  It is
+ * done one character at a time so we can hash every prefix (or suffix,
+ * going backwards) of a string as we walk it.
+ */
+#define IGNORE_HASH_INIT	2166136261U
+#define ignore_hash_step(h, c)	\
+	(((h) ^ (uint32_t)tolower((unsigned char)(c))) * 16777619U)
+
+static uint32_t	ignore_hash (const char *str, size_t len, int backwards)
+{
+	uint32_t h = IGNORE_HASH_INIT;
+	size_t	i;
+
+	for (i = 0; i < len; i++)
+		h = ignore_hash_step(h, backwards ? str[len - 1 - i] : str[i]);
+	return h;
+}
+
+/*
+ * Figure out which plain characters "key" (an ignore) is to be found
+ * by, and return what kind of key it is.
+ */
+static int	classify_ignore (IgnoreKey *key)
+{
+	const char *name = key->item->name;
+	size_t	len, head, tail;
+
+	/* \ quotes things, and \[ \] are alternatives.  Punt on those. */
+	if (strchr(name, '\\'))
+		return IGNORE_WILD;
+
+	len = strlen(name);
+	if ((head = strcspn(name, "*%?")) == len)
+	{
+		key->key = name;
+		key->len = len;
+		return IGNORE_EXACT;
+	}
+
+	for (tail = 0; tail < len; tail++)
+		if (strchr("*%?", name[len - 1 - tail]))
+			break;
+
+	if (tail > 0 && tail >= head)
+	{
+		key->key = name + len - tail;
+		key->len = tail;
+		return IGNORE_SUFFIX;
+	}
+	else if (head > 0)
+	{
+		key->key = name;
+		key->len = head;
+		return IGNORE_PREFIX;
+	}
+
+	return IGNORE_WILD;
+}
+
+static void	build_ignore_index (void)
+{
+	List *	item;
+	IgnoreKey *key;
+	int	count, i, bucket;
+
+	new_free((char **)&ignore_keys);
+	new_free((char **)&ignore_buckets);
+	new_free((char **)&ignore_wild);
+	ignore_wild_count = 0;
+	ignore_max_prefix = ignore_max_suffix = 0;
+
+	for (count = 0, item = ignored_nicks; item; item = item->next)
+		count++;
+
+	for (ignore_buckets_size = 16; ignore_buckets_size < count * 2; )
+		ignore_buckets_size *= 2;
+	ignore_buckets = (IgnoreKey **)new_malloc(sizeof(IgnoreKey *) * 
+						ignore_buckets_size);
+	for (i = 0; i < ignore_buckets_size; i++)
+		ignore_buckets[i] = NULL;
+
+	if (count)
+	{
+		ignore_keys = (IgnoreKey *)new_malloc(sizeof(IgnoreKey) * count);
+		ignore_wild = (IgnoreKey **)new_malloc(sizeof(IgnoreKey *) * count);
+	}
+
+	for (i = 0, item = ignored_nicks; item; i++, item = item->next)
+	{
+		key = &ignore_keys[i];
+		key->item = item;
+		key->position = i;
+		key->key = NULL;
+		key->len = 0;
+		key->next = NULL;
+		key->kind = classify_ignore(key);
+
+		if (key->kind == IGNORE_WILD)
+		{
+			ignore_wild[ignore_wild_count++] = key;
+			continue;
+		}
+
+		if (key->kind == IGNORE_PREFIX && key->len > ignore_max_prefix)
+			ignore_max_prefix = key->len;
+		if (key->kind == IGNORE_SUFFIX && key->len > ignore_max_suffix)
+			ignore_max_suffix = key->len;
+
+		key->hashval = ignore_hash(key->key, key->len, 
+					key->kind == IGNORE_SUFFIX);
+		bucket = key->hashval & (ignore_buckets_size - 1);
+		key->next = ignore_buckets[bucket];
+		ignore_buckets[bucket] = key;
+	}
+
+	ignore_index_dirty = 0;
+}
+
+static void	add_ignore_candidate (IgnoreKey *key)
+{
+	if (ignore_candidates_count == ignore_candidates_size)
+	{
+		ignore_candidates_size = ignore_candidates_size ?
+					ignore_candidates_size * 2 : 16;
+		RESIZE(ignore_candidates, IgnoreKey *, ignore_candidates_size);
+	}
+	ignore_candidates[ignore_candidates_count++] = key;
+}
+
+/* Add the ignores of kind "kind" whose plain chars are "str" */
+static void	find_ignore_keys (int kind, uint32_t hashval, const char *str, size_t len)
+{
+	IgnoreKey *key;
+	size_t	i;
+
+	for (key = ignore_buckets[hashval & (ignore_buckets_size - 1)]; 
+			key; key = key->next)
+	{
+		if (key->kind != kind || key->hashval != hashval || 
+				key->len != len)
+			continue;
+
+		for (i = 0; i < len; i++)
+			if (tolower((unsigned char)key->key[i]) != 
+					tolower((unsigned char)str[i]))
+				break;
+		if (i == len)
+			add_ignore_candidate(key);
+	}
+}
+
+/* Add every ignore that could possibly match "str" */
+static void	find_ignore_candidates (const char *str)
+{
+	uint32_t h;
+	size_t	len, i;
+
+	len = strlen(str);
+
+	for (h = IGNORE_HASH_INIT, i = 0; i < len; i++)
+	{
+		h = ignore_hash_step(h, str[i]);
+		if (i < ignore_max_prefix)
+			find_ignore_keys(IGNORE_PREFIX, h, str, i + 1);
+	}
+	find_ignore_keys(IGNORE_EXACT, h, str, len);
+
+	for (h = IGNORE_HASH_INIT, i = 0; i < len && i < ignore_max_suffix; i++)
+	{
+		h = ignore_hash_step(h, str[len - 1 - i]);
+		find_ignore_keys(IGNORE_SUFFIX, h, str + len - 1 - i, i + 1);
+	}
+}
+
+static int	compare_ignore_candidates (const void *a, const void *b)
+{
+	const IgnoreKey *ka = *(const IgnoreKey * const *)a;
+	const IgnoreKey *kb = *(const IgnoreKey * const *)b;
+
+	return ka->position - kb->position;
+}
+
+/*
+ * Collect the ignores that might match "nuh" or "channel" into
+ * ignore_candidates, in the order they are on the ignore list.
+ */
+static void	get_ignore_candidates (const char *nuh, const char *channel)
+{
+	int	i, j;
+
+	if (ignore_index_dirty)
+		build_ignore_index();
+
+	ignore_candidates_count = 0;
+	for (i = 0; i < ignore_wild_count; i++)
+		add_ignore_candidate(ignore_wild[i]);
+	find_ignore_candidates(nuh);
+	if (channel)
+		find_ignore_candidates(channel);
+
+	if (ignore_candidates_count < 2)
+		return;
+
+	qsort(ignore_candidates, ignore_candidates_count, sizeof(IgnoreKey *),
+		compare_ignore_candidates);
+	for (i = j = 1; i < ignore_candidates_count; i++)
+		if (ignore_candidates[i] != ignore_candidates[j - 1])
+			ignore_candidates[j++] = ignore_candidates[i];
+	ignore_candidates_count = j;
+}
+
 /* 
  * check_ignore -- replaces the old double_ignore
  *   Why did i change the name?
@@ -1204,6 +1467,7 @@ int	check_ignore_channel (const char *nick, const char *uh, const char *channel,
 	char 	nuh[IRCD_BUFFER_SIZE];
 	List	*tmp;
 	int	count = 0;
+	int	x;
 	int	bestimatch = 0;
 	List	*i_match = NULL;
 	int	bestcmatch = 0;
@@ -1228,8 +1492,10 @@ int	check_ignore_channel (const char *nick, const char *uh, const char *channel,
 						nick ? nick : star,
 						uh ? uh : star);
 
-	for (tmp = ignored_nicks; tmp; tmp = tmp->next)
+	get_ignore_candidates(nuh, channel);
+	for (x = 0; x < ignore_candidates_count; x++)
 	{
+		tmp = ignore_candidates[x]->item;
 		if (!IGNORE(tmp)->enabled)
 			continue;
 
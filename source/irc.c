@@ -92,7 +92,9 @@ const char ridiculous_version_name[] = "Obturation";
 #include "extlang.h"
 #include "files.h"
 #include "ctcp.h"
+#include "history.h"
 #include <pwd.h>
+#include <sys/resource.h>
 #ifdef NEWLOCALE_REQUIRES__GNU_SOURCE
 #define _GNU_SOURCE
 #endif
@@ -190,7 +192,8 @@ int		inbound_line_mangler = 0,
 		outbound_line_mangler = 0;
 
 static char	*epicrc_file = NULL,		/* full path .epicrc file */
-		*ircrc_file = NULL;		/* full path .ircrc file */
+		*ircrc_file = NULL,		/* full path .ircrc file */
+		*benchmark_file = NULL;		/* -T script to time, then exit */
 char		*startup_file = NULL,		/* Set when epicrc loaded */
 		*my_path = (char *) 0,		/* path to users home dir */
 		*irc_lib = (char *) 0,		/* path to the ircII library */
@@ -233,6 +236,7 @@ static		char	switch_help[] =
       -L <file>\tLoads <file> instead of your .ircrc file             \n\
       -n <nick>\tThe program will use <nick> as your default nickname \n\
       -p <port>\tThe program will use <port> as the default portnum   \n\
+      -T <file>\tRun <file> as a benchmark (no tty, no server), then exit\n\
       -z <user>\tThe program will use <user> as your default username \n";
 
 
@@ -298,6 +302,7 @@ void	irc_exit (int really_quit, const char *format, ...)
 	get_child_exit(-1);  /* In case some children died in the exit hook. */
 	clean_up_processes();
 	close_all_dbms();
+	close_all_history();
 
 	/* Arrange to have the cursor on the input line after exit */
 	if (!dumb_mode)
@@ -668,7 +673,7 @@ static	void	parse_args (int argc, char **argv)
 	/*
 	 * Parse the command line arguments.
 	 */
-	while ((ch = getopt(argc, argv, "aBbc:dhH:l:L:n:p:qsSvxz:")) != EOF)
+	while ((ch = getopt(argc, argv, "aBbc:dhH:l:L:n:p:qsSvxT:z:")) != EOF)
 	{
 		switch (ch)
 		{
@@ -734,6 +739,13 @@ static	void	parse_args (int argc, char **argv)
 				/* Historical option */
 				break;
 
+			case 'T': /* Benchmark a script headlessly */
+				malloc_strcpy(&benchmark_file, optarg);
+				dumb_mode = 1;
+				quick_startup = 1;
+				dont_connect = 1;
+				break;
+
 			case 'c':
 				malloc_strcpy(&default_channel, optarg);
 				break;
@@ -1025,7 +1037,40 @@ void    load_ircrc (void)
 	else
 		startup_file = malloc_strdup("global");
 
+	load_prefetch(startup_file);
 	load("LOAD", startup_file, empty_string);
+	load_prefetch_done();
+}
+
+/*
+ * run_benchmark: Load the -T script in the "TOP" frame with no server and 
+ * no input, and then report how long it took and the high water mark of
+ * the process's memory usage.  The script itself reports each of its cases
+ * (see bench/README); this is the summary line for the whole run.  Both
+ * are one line of "key=value" pairs so they can be picked up by a tool.
+ */
+static void	run_benchmark (void)
+{
+	Timeval		before, after;
+	struct rusage	ru;
+	long		peak_rss;
+
+	get_time(&before);
+	load_prefetch(benchmark_file);
+	load("LOAD", benchmark_file, empty_string);
+	load_prefetch_done();
+	get_time(&after);
+
+	getrusage(RUSAGE_SELF, &ru);
+#ifdef __APPLE__
+	peak_rss = ru.ru_maxrss / 1024;		/* Darwin reports bytes */
+#else
+	peak_rss = ru.ru_maxrss;		/* Everyone else reports KB */
+#endif
+	fprintf(stdout, "bench_summary file=%s secs=%.6f peak_rss_kb=%ld\n",
+			benchmark_file, time_diff(before, after), peak_rss);
+	fflush(stdout);
+	irc_exit(1, NULL);
 }
 
 /*************************************************************************/
@@ -1144,6 +1189,9 @@ int 	main (int argc, char *argv[])
 
 	init_input();
 
+	if (benchmark_file)
+		run_benchmark();		/* Does not return */
+
 	if (dont_connect)
 		display_server_list();		/* Let user choose server */
 	else
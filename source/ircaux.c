@@ -243,6 +243,8 @@ void	fatal_malloc_check (void *ptr, const char *special, const char *fn, int lin
  *	are done with the space.  There is no garbage collector --
  *	you must manage your memory's lifecycle specifically.
  */
+intmax_t	new_malloc_count = 0;	/* For the profiler */
+
 void *	really_new_malloc (size_t size, const char *fn, int line)
 {
 	char	*ptr;
@@ -266,6 +268,7 @@ void *	really_new_malloc (size_t size, const char *fn, int line)
 	alloc_size(ptr) = size;
 	VALGRIND_CREATE_MEMPOOL(mo_ptr(ptr), 0, 1);
 	VALGRIND_MEMPOOL_ALLOC(mo_ptr(ptr), ptr, size);
+	new_malloc_count++;
 	return ptr;
 }
 
@@ -1576,6 +1579,47 @@ int	server_strnicmp (const char *str1, const char *str2, size_t n, int servref)
 		return utf8_strnicmp(str1, str2, n);
 }
 
+/*
+ * server_strhash: A hash of "str" that agrees with server_stricmp() --
+ * any two strings that server_stricmp() says are the same for "servref"
+ * hash to the same value.  (FNV-1a over the folded characters)
+ */
+uint32_t	server_strhash (const char *str, int servref)
+{
+	uint32_t	hash = 2166136261U;
+
+	if (get_server_stricmp_table(servref) == 1)
+	{
+		for (; *str; str++)
+		{
+			hash ^= stricmp_tables[1][(unsigned char)*str];
+			hash *= 16777619U;
+		}
+	}
+	else
+		hash = my_strhash(str);
+	return hash;
+}
+
+/*
+ * my_strhash: A hash of "str" that agrees with my_stricmp() -- any two
+ * strings that my_stricmp() says are the same hash to the same value.
+ */
+uint32_t	my_strhash (const char *str)
+{
+	uint32_t	hash = 2166136261U;
+	ptrdiff_t	offset;
+	int		c;
+
+	while ((c = next_code_point2(str, &offset, 1)) > 0)
+	{
+		hash ^= (uint32_t)mkupper_l(c);
+		hash *= 16777619U;
+		str += offset;
+	}
+	return hash;
+}
+
 int	alist_stricmp (const char *str1, const char *str2, size_t ignored)
 {
 	return my_stricmp(str1, str2);
@@ -2202,6 +2246,65 @@ size_t	escape_chars (const char *input, const char *stuff, char *output, size_t
 	return output_fullsize;
 }
 
+/*
+ * quote_dword - Make a string into one double quoted word
+ *
+ * Arguments:
+ *	input	- The string to make into a word.
+ *		  - (error) If NULL, returns 0
+ *	always	- If 0, 'input' is only double quoted if it has to be (it is
+ *		  empty, has whitespace in it, or starts with a double quote)
+ *	output	- Where to put the word.
+ *		  - (error) If NULL, returns 0
+ *	output_size - Size of 'output'.
+ *		  - (error) If less than (strlen(input) * 2 + 3), returns 0
+ *
+ * Return value:
+ *	The number of bytes written to 'output' (not including the nul).
+ *
+ * Notes:
+ *	Double quoted words are not unescaped when they are split up again,
+ *	so 'input' is copied as-is, and a backslash is only added where the
+ *	word would otherwise end early: before a double quote followed by 
+ *	whitespace, and after a backslash at the end of 'input'.  Everything
+ *	else comes back just as it went in.
+ */
+size_t	quote_dword (const char *input, int always, char *output, size_t output_size)
+{
+	const char *	p;
+	size_t	len, o = 0;
+	int	quote;
+
+	if (input == NULL || output == NULL)
+		return 0;
+	if (output_size < (len = strlen(input)) * 2 + 3)
+		return 0;
+
+	quote = (always || !*input || *input == '"');
+	for (p = input; !quote && *p; p++)
+		if (isspace((unsigned char)*p))
+			quote = 1;
+
+	if (!quote)
+	{
+		memcpy(output, input, len + 1);
+		return len;
+	}
+
+	output[o++] = '"';
+	for (p = input; *p; p++)
+	{
+		if (*p == '\\' && p[1])
+			output[o++] = *p++;
+		else if (*p == '\\' || (*p == '"' && isspace((unsigned char)p[1])))
+			output[o++] = '\\';
+		output[o++] = *p;
+	}
+	output[o++] = '"';
+	output[o] = 0;
+	return o;
+}
+
 void	panic (int quitmsg, const char *format, ...)
 {
 	char buffer[BIG_BUFFER_SIZE * 10 + 1];
@@ -3177,17 +3280,63 @@ char *	unsplitw (char ***container, int howmany, int extended)
 {
 	char *retval = NULL;
 	char **str;
+	size_t	size, len;
+	char *	p;
+	int	i, quote;
 
 	if (!container || !*container || !**container)
 		return NULL;
 	str = *container;
-	while (howmany)
+
+	/* This is the same policy as malloc_strcat_word() */
+	if ((extended == DWORD_DWORDS && !(x_debug & DEBUG_DWORD)) ||
+	    (extended == DWORD_EXTRACTW && !(x_debug & DEBUG_EXTRACTW)) ||
+	     extended == DWORD_NO)
+		quote = 0;
+	else
+		quote = 1;
+
+	/*
+	 * Size the result up front (allowing for every double quote in a
+	 * word that has to be quoted to be escaped) instead of re-scanning
+	 * and re-allocating it once per word.
+	 */
+	for (size = 1, i = 0; i < howmany; i++)
 	{
-		if (*str && **str)
-			malloc_strcat_word(&retval, space, *str, extended);
-		str++, howmany--;
+		if (!str[i] || !*str[i])
+			continue;
+		len = strlen(str[i]);
+		if (quote && strpbrk(str[i], space))
+			size += len * 2 + 3;
+		else
+			size += len + 1;
 	}
 
+	retval = p = new_malloc(size);
+	for (i = 0; i < howmany; i++)
+	{
+		if (!str[i] || !*str[i])
+			continue;
+		if (p > retval)
+			*p++ = ' ';
+
+		len = strlen(str[i]);
+		if (quote && strpbrk(str[i], space))
+		{
+			*p++ = '"';
+			p += escape_chars(str[i], "\"", p, len * 2 + 1);
+			*p++ = '"';
+		}
+		else
+		{
+			memcpy(p, str[i], len);
+			p += len;
+		}
+	}
+	*p = 0;
+	if (!*retval)
+		new_free(&retval);
+
 	new_free((char **)container);
 	return retval;
 }
@@ -6421,8 +6570,14 @@ int	invalid_utf8str (char *utf8str)
 	ptrdiff_t	offset;
 
 	s = utf8str;
-	while ((code_point = next_code_point2(s, &offset, 0)))
+	for (;;)
 	{
+		/* Plain ascii is always valid, so don't bother decoding it */
+		while (*s && !(*(const unsigned char *)s & 0x80))
+			s++;
+		if (!(code_point = next_code_point2(s, &offset, 0)))
+			break;
+
 		/* The next byte did not start a utf8 code point */
 		if (code_point < 0)
 		{
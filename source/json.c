@@ -0,0 +1,861 @@
+/*
+ * json.c -- Streaming JSON reader and writer for assign variables
+ *
+ * Copyright 2026 EPIC Software Labs
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notices, the above paragraph (the one permitting redistribution),
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The names of the author(s) may not be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * $json_explode() used to parse the whole document into a cJSON tree,
+ * walk the tree creating one variable at a time, and then throw the tree
+ * away.  $json_implode() did the same thing backwards.  For a big document
+ * the tree is pure overhead, and creating the variables one at a time
+ * shifted the whole symbol table once per variable.
+ *
+ * The parser in here calls you back as it goes (open, member, value,
+ * close) instead of building a tree.  It accepts exactly what cJSON_Parse()
+ * accepts, and fails at the same offset, so $json_error() doesn't change.
+ * The writer appends straight into one buffer, and produces exactly what
+ * cJSON_Print() and cJSON_PrintUnformatted() would have.
+ */
+
+#include "irc.h"
+#include "ircaux.h"
+#include "alias.h"
+#include "json.h"
+
+#define JSON_NESTING_LIMIT	1000		/* Same as cJSON */
+
+#define JSON_NULL	0
+#define JSON_FALSE	1
+#define JSON_TRUE	2
+#define JSON_NUMBER	3
+#define JSON_STRING	4
+#define JSON_ARRAY	5
+#define JSON_OBJECT	6
+
+struct JsonParserStru;
+
+typedef struct {
+	void	(*open)   (struct JsonParserStru *, int type, size_t offset);
+	void	(*member) (struct JsonParserStru *, const char *key, long index);
+	void	(*value)  (struct JsonParserStru *, int type, const char *str, double num);
+	void	(*close)  (struct JsonParserStru *, int type, size_t offset);
+} JsonHandler;
+
+/*
+ * 'length' includes the nul terminator, and 'offset' is moved around
+ * exactly the way cJSON moves it, so that errors land at the same place.
+ * If there is no handler, the document is only checked.
+ */
+typedef struct JsonParserStru {
+	const unsigned char *	content;
+	size_t			length;
+	size_t			offset;
+	size_t			depth;
+	const JsonHandler *	handler;
+	void *			data;
+	char *			str;		/* The last decoded string */
+	size_t			strsize;
+} JsonParser;
+
+#define AT(p)			((p)->content + (p)->offset)
+#define CAN_READ(p, n)		((p)->offset + (n) <= (p)->length)
+#define CAN_ACCESS(p, i)	((p)->offset + (i) < (p)->length)
+
+static	int	read_value (JsonParser *p);
+
+static void	skip_whitespace (JsonParser *p)
+{
+	if (!CAN_ACCESS(p, 0))
+		return;
+
+	while (CAN_ACCESS(p, 0) && AT(p)[0] <= 32)
+		p->offset++;
+
+	if (p->offset == p->length)
+		p->offset--;
+}
+
+static unsigned	read_hex4 (const unsigned char *input)
+{
+	unsigned h = 0;
+	int	i;
+
+	for (i = 0; i < 4; i++)
+	{
+		if (input[i] >= '0' && input[i] <= '9')
+			h += input[i] - '0';
+		else if (input[i] >= 'A' && input[i] <= 'F')
+			h += 10 + input[i] - 'A';
+		else if (input[i] >= 'a' && input[i] <= 'f')
+			h += 10 + input[i] - 'a';
+		else
+			return 0;		/* Sic -- cJSON does this */
+
+		if (i < 3)
+			h <<= 4;
+	}
+	return h;
+}
+
+/*
+ * Decode a \uXXXX (or a \uXXXX\uXXXX surrogate pair) at 'in' into 'out'.
+ * Returns the number of input bytes used, or 0 if it is invalid.
+ */
+static int	utf16_literal (const unsigned char *in, const unsigned char *end, char **out)
+{
+	uint32_t	code, second;
+	int		seqlen;
+
+	if (end - in < 6)
+		return 0;
+
+	code = read_hex4(in + 2);
+	if (code >= 0xDC00 && code <= 0xDFFF)
+		return 0;
+
+	if (code >= 0xD800 && code <= 0xDBFF)
+	{
+		if (end - (in + 6) < 6)
+			return 0;
+		if (in[6] != '\\' || in[7] != 'u')
+			return 0;
+		second = read_hex4(in + 8);
+		if (second < 0xDC00 || second > 0xDFFF)
+			return 0;
+		code = 0x10000 + (((code & 0x3FF) << 10) | (second & 0x3FF));
+		seqlen = 12;
+	}
+	else
+		seqlen = 6;
+
+	*out += ucs_to_utf8(code, *out, 5);
+	return seqlen;
+}
+
+/*
+ * Decode the string at the current offset into p->str.
+ */
+static int	read_string (JsonParser *p)
+{
+	const unsigned char *in = AT(p) + 1;
+	const unsigned char *end = AT(p) + 1;
+	char *	out;
+	size_t	need;
+	int	seqlen;
+
+	if (AT(p)[0] != '"')
+		goto fail;
+
+	while ((size_t)(end - p->content) < p->length && *end != '"')
+	{
+		if (*end == '\\')
+		{
+			if ((size_t)(end + 1 - p->content) >= p->length)
+				goto fail;
+			end++;
+		}
+		end++;
+	}
+	if ((size_t)(end - p->content) >= p->length || *end != '"')
+		goto fail;
+
+	/* A \uXXXX may decode into 3 bytes, a surrogate pair into 4 */
+	need = (size_t)(end - in) + 5;
+	if (need > p->strsize)
+	{
+		p->strsize = need * 2;
+		RESIZE(p->str, char, p->strsize);
+	}
+
+	out = p->str;
+	while (in < end)
+	{
+		if (*in != '\\')
+		{
+			*out++ = *in++;
+			continue;
+		}
+
+		seqlen = 2;
+		switch (in[1])
+		{
+			case 'b': *out++ = '\b'; break;
+			case 'f': *out++ = '\f'; break;
+			case 'n': *out++ = '\n'; break;
+			case 'r': *out++ = '\r'; break;
+			case 't': *out++ = '\t'; break;
+			case '"':
+			case '\\':
+			case '/': *out++ = in[1]; break;
+			case 'u':
+				if (!(seqlen = utf16_literal(in, end, &out)))
+					goto fail;
+				break;
+			default:
+				goto fail;
+		}
+		in += seqlen;
+	}
+	*out = 0;
+
+	p->offset = (size_t)(end - p->content) + 1;
+	return 1;
+
+fail:
+	/* cJSON leaves the error where it stopped decoding */
+	p->offset = (size_t)(in - p->content);
+	return 0;
+}
+
+static int	read_number (JsonParser *p)
+{
+	char	buffer[64];
+	char *	after;
+	double	number;
+	size_t	i;
+
+	for (i = 0; i < sizeof(buffer) - 1 && CAN_ACCESS(p, i); i++)
+	{
+		if (!strchr("0123456789+-eE.", AT(p)[i]) || !AT(p)[i])
+			break;
+		buffer[i] = AT(p)[i];
+	}
+	buffer[i] = 0;
+
+	number = strtod(buffer, &after);
+	if (after == buffer)
+		return 0;
+
+	p->offset += (size_t)(after - buffer);
+	if (p->handler)
+		p->handler->value(p, JSON_NUMBER, NULL, number);
+	return 1;
+}
+
+static int	read_array (JsonParser *p)
+{
+	long	n = 0;
+
+	if (p->depth >= JSON_NESTING_LIMIT)
+		return 0;
+	p->depth++;
+
+	if (AT(p)[0] != '[')
+		return 0;
+
+	if (p->handler)
+		p->handler->open(p, JSON_ARRAY, p->offset);
+
+	p->offset++;
+	skip_whitespace(p);
+	if (CAN_ACCESS(p, 0) && AT(p)[0] == ']')
+		goto success;
+
+	if (!CAN_ACCESS(p, 0))
+	{
+		p->offset--;
+		return 0;
+	}
+
+	p->offset--;
+	do
+	{
+		p->offset++;
+		skip_whitespace(p);
+		if (p->handler)
+			p->handler->member(p, NULL, n++);
+		if (!read_value(p))
+			return 0;
+		skip_whitespace(p);
+	}
+	while (CAN_ACCESS(p, 0) && AT(p)[0] == ',');
+
+	if (!CAN_ACCESS(p, 0) || AT(p)[0] != ']')
+		return 0;
+
+success:
+	p->depth--;
+	p->offset++;
+	if (p->handler)
+		p->handler->close(p, JSON_ARRAY, p->offset);
+	return 1;
+}
+
+static int	read_object (JsonParser *p)
+{
+	long	n = 0;
+
+	if (p->depth >= JSON_NESTING_LIMIT)
+		return 0;
+	p->depth++;
+
+	if (!CAN_ACCESS(p, 0) || AT(p)[0] != '{')
+		return 0;
+
+	if (p->handler)
+		p->handler->open(p, JSON_OBJECT, p->offset);
+
+	p->offset++;
+	skip_whitespace(p);
+	if (CAN_ACCESS(p, 0) && AT(p)[0] == '}')
+		goto success;
+
+	if (!CAN_ACCESS(p, 0))
+	{
+		p->offset--;
+		return 0;
+	}
+
+	p->offset--;
+	do
+	{
+		if (!CAN_ACCESS(p, 1))
+			return 0;
+
+		p->offset++;
+		skip_whitespace(p);
+		if (!read_string(p))
+			return 0;
+		skip_whitespace(p);
+
+		if (!CAN_ACCESS(p, 0) || AT(p)[0] != ':')
+			return 0;
+		if (p->handler)
+			p->handler->member(p, p->str, n++);
+
+		p->offset++;
+		skip_whitespace(p);
+		if (!read_value(p))
+			return 0;
+		skip_whitespace(p);
+	}
+	while (CAN_ACCESS(p, 0) && AT(p)[0] == ',');
+
+	if (!CAN_ACCESS(p, 0) || AT(p)[0] != '}')
+		return 0;
+
+success:
+	p->depth--;
+	p->offset++;
+	if (p->handler)
+		p->handler->close(p, JSON_OBJECT, p->offset);
+	return 1;
+}
+
+static int	read_value (JsonParser *p)
+{
+	if (CAN_READ(p, 4) && !strncmp((const char *)AT(p), "null", 4))
+	{
+		p->offset += 4;
+		if (p->handler)
+			p->handler->value(p, JSON_NULL, NULL, 0);
+		return 1;
+	}
+	if (CAN_READ(p, 5) && !strncmp((const char *)AT(p), "false", 5))
+	{
+		p->offset += 5;
+		if (p->handler)
+			p->handler->value(p, JSON_FALSE, NULL, 0);
+		return 1;
+	}
+	if (CAN_READ(p, 4) && !strncmp((const char *)AT(p), "true", 4))
+	{
+		p->offset += 4;
+		if (p->handler)
+			p->handler->value(p, JSON_TRUE, NULL, 1);
+		return 1;
+	}
+	if (!CAN_ACCESS(p, 0))
+		return 0;
+
+	if (AT(p)[0] == '"')
+	{
+		if (!read_string(p))
+			return 0;
+		if (p->handler)
+			p->handler->value(p, JSON_STRING, p->str, 0);
+		return 1;
+	}
+	if (AT(p)[0] == '-' || (AT(p)[0] >= '0' && AT(p)[0] <= '9'))
+		return read_number(p);
+	if (AT(p)[0] == '[')
+		return read_array(p);
+	if (AT(p)[0] == '{')
+		return read_object(p);
+
+	return 0;
+}
+
+/*
+ * Run the parser over 'json'.  Returns 1 on success; on failure returns 0
+ * and puts the offset of the error in 'errpos' (same as cJSON_GetErrorPtr)
+ */
+static int	json_parse (const char *json, const JsonHandler *handler, void *data, size_t *errpos)
+{
+	JsonParser	p;
+	int		retval;
+
+	p.content = (const unsigned char *)json;
+	p.length = strlen(json) + 1;
+	p.offset = 0;
+	p.depth = 0;
+	p.handler = handler;
+	p.data = data;
+	p.str = NULL;
+	p.strsize = 0;
+
+	if (CAN_ACCESS(&p, 4) && !strncmp(json, "\xEF\xBB\xBF", 3))
+		p.offset += 3;
+	skip_whitespace(&p);
+
+	if (!(retval = read_value(&p)) && errpos)
+		*errpos = p.offset < p.length ? p.offset : p.length - 1;
+
+	new_free(&p.str);
+	return retval;
+}
+
+
+/* * * * * * * * * * * * * * * * $json_explode() * * * * * * * * * * * * * */
+/*
+ * The variable name for the current value is kept in 'path'.  Each open
+ * container remembers how long the path was when it was opened, so each
+ * member just chops the path back and appends its own name.
+ */
+typedef struct {
+	char *		path;
+	size_t		len;
+	size_t		size;
+	size_t *	base;
+	size_t		depth;
+	size_t		max_depth;
+} ExplodeState;
+
+static void	explode_append (ExplodeState *e, const char *str, size_t len)
+{
+	if (e->len + len + 1 > e->size)
+	{
+		while (e->len + len + 1 > e->size)
+			e->size = e->size ? e->size * 2 : 128;
+		RESIZE(e->path, char, e->size);
+	}
+	memcpy(e->path + e->len, str, len);
+	e->len += len;
+	e->path[e->len] = 0;
+}
+
+static void	explode_open (JsonParser *p, int type, size_t offset)
+{
+	ExplodeState *e = (ExplodeState *)p->data;
+
+	if (e->depth >= e->max_depth)
+	{
+		e->max_depth = e->max_depth ? e->max_depth * 2 : 16;
+		RESIZE(e->base, size_t, e->max_depth);
+	}
+	e->base[e->depth++] = e->len;
+}
+
+static void	explode_member (JsonParser *p, const char *key, long index)
+{
+	ExplodeState *e = (ExplodeState *)p->data;
+	char	number[32];
+	size_t	start;
+	char *	ptr;
+
+	e->len = e->base[e->depth - 1];
+	explode_append(e, ".", 1);
+
+	if (key)
+	{
+		start = e->len;
+		explode_append(e, key, strlen(key));
+
+		/* The name must be mangled to be suitable as an ASSIGN */
+		for (ptr = e->path + start; *ptr; ptr++)
+			if (!isalnum(*ptr))
+				*ptr = '_';
+	}
+	else
+		explode_append(e, number, snprintf(number, sizeof(number), "%ld", index));
+}
+
+static void	explode_value (JsonParser *p, int type, const char *str, double num)
+{
+	ExplodeState *e = (ExplodeState *)p->data;
+
+	switch (type)
+	{
+		case JSON_FALSE:
+			add_var_alias(e->path, "0", 0);
+			break;
+		case JSON_TRUE:
+			add_var_alias(e->path, "1", 0);
+			break;
+		case JSON_NULL:
+			add_var_alias(e->path, NULL, 0);
+			break;
+		case JSON_NUMBER:
+			add_var_alias(e->path, ftoa(num), 0);
+			break;
+		case JSON_STRING:
+			add_var_alias(e->path, str, 0);
+			break;
+	}
+}
+
+static void	explode_close (JsonParser *p, int type, size_t offset)
+{
+	ExplodeState *e = (ExplodeState *)p->data;
+
+	e->len = e->base[--e->depth];
+	e->path[e->len] = 0;
+}
+
+static const JsonHandler explode_handler = {
+	explode_open, explode_member, explode_value, explode_close
+};
+
+/*
+ * Turn 'json' into a structure of assign variables under 'var'.
+ * The document is checked first, so nothing is assigned if it's invalid.
+ * Returns 1 on success, 0 on a parse error (with its offset in 'errpos').
+ */
+int	json_explode (const char *var, const char *json, size_t *errpos)
+{
+	ExplodeState	e;
+
+	if (!json_parse(json, NULL, NULL, errpos))
+		return 0;
+
+	memset(&e, 0, sizeof(e));
+	explode_append(&e, var, strlen(var));
+
+	begin_var_alias_batch();
+	json_parse(json, &explode_handler, &e, NULL);
+	end_var_alias_batch();
+
+	new_free(&e.path);
+	new_free((char **)&e.base);
+	return 1;
+}
+
+
+/* * * * * * * * * * * * * * * * $json_implode() * * * * * * * * * * * * * */
+typedef struct {
+	char *	buf;
+	size_t	len;
+	size_t	size;
+} JsonBuffer;
+
+static void	put_bytes (JsonBuffer *b, const char *str, size_t len)
+{
+	if (b->len + len + 1 > b->size)
+	{
+		while (b->len + len + 1 > b->size)
+			b->size = b->size ? b->size * 2 : 256;
+		RESIZE(b->buf, char, b->size);
+	}
+	memcpy(b->buf + b->len, str, len);
+	b->len += len;
+	b->buf[b->len] = 0;
+}
+
+static void	put_tabs (JsonBuffer *b, int depth)
+{
+	while (depth-- > 0)
+		put_bytes(b, "\t", 1);
+}
+
+/* The same escaping cJSON uses */
+static void	put_string (JsonBuffer *b, const char *str)
+{
+	const unsigned char *s, *run;
+	char	escape[8];
+
+	put_bytes(b, "\"", 1);
+	for (run = s = (const unsigned char *)str; *s; s++)
+	{
+		if (*s > 31 && *s != '"' && *s != '\\')
+			continue;
+
+		put_bytes(b, (const char *)run, s - run);
+		run = s + 1;
+		switch (*s)
+		{
+			case '\\': put_bytes(b, "\\\\", 2); break;
+			case '"':  put_bytes(b, "\\\"", 2); break;
+			case '\b': put_bytes(b, "\\b", 2); break;
+			case '\f': put_bytes(b, "\\f", 2); break;
+			case '\n': put_bytes(b, "\\n", 2); break;
+			case '\r': put_bytes(b, "\\r", 2); break;
+			case '\t': put_bytes(b, "\\t", 2); break;
+			default:
+				put_bytes(b, escape, snprintf(escape, sizeof(escape), "\\u%04x", *s));
+		}
+	}
+	put_bytes(b, (const char *)run, s - run);
+	put_bytes(b, "\"", 1);
+}
+
+/*
+ * Write out an object whose members are the variables in 'sublist'.
+ * A member with sub-members of its own is an object, otherwise it is
+ * a string (and a member with no value at all is left out).
+ */
+static void	implode_object (JsonBuffer *b, char **sublist, int count, int depth, int compact)
+{
+	char **	children;
+	char *	value;
+	const char *name;
+	int	i, j, subcount;
+	int	first = 1;
+
+	put_bytes(b, "{", 1);
+	if (!compact)
+		put_bytes(b, "\n", 1);
+
+	for (i = 0; i < count; i++)
+	{
+		if ((name = strrchr(sublist[i], '.')))
+			name++;
+		else
+			name = sublist[i];
+
+		value = NULL;
+		children = get_subarray_elements(sublist[i], &subcount, VAR_ALIAS);
+		if (subcount == 0 && !(value = get_variable(sublist[i])))
+			continue;
+
+		if (!first)
+			put_bytes(b, compact ? "," : ",\n", compact ? 1 : 2);
+		first = 0;
+
+		if (!compact)
+			put_tabs(b, depth);
+		put_string(b, name);
+		put_bytes(b, compact ? ":" : ":\t", compact ? 1 : 2);
+
+		if (subcount == 0)
+			put_string(b, value);
+		else
+			implode_object(b, children, subcount, depth + 1, compact);
+
+		new_free(&value);
+		for (j = 0; j < subcount; j++)
+			new_free(&children[j]);
+		new_free((char **)&children);
+	}
+
+	if (!compact)
+	{
+		if (!first)
+			put_bytes(b, "\n", 1);
+		put_tabs(b, depth - 1);
+	}
+	put_bytes(b, "}", 1);
+}
+
+/*
+ * Turn the structure of assign variables under 'var' into a JSON object.
+ * Returns a malloced string, or NULL if 'var' has no members.
+ */
+char *	json_implode (const char *var, int compact)
+{
+	JsonBuffer	b;
+	char *	canon_var;
+	char **	sublist;
+	int	count, i;
+
+	canon_var = remove_brackets(var, NULL);
+	sublist = get_subarray_elements(canon_var, &count, VAR_ALIAS);
+	new_free(&canon_var);
+
+	if (count == 0)
+		return NULL;
+
+	memset(&b, 0, sizeof(b));
+	implode_object(&b, sublist, count, 1, compact);
+
+	for (i = 0; i < count; i++)
+		new_free(&sublist[i]);
+	new_free((char **)&sublist);
+	return b.buf;
+}
+
+
+/* * * * * * * * * * * * * * * * * $json_get() * * * * * * * * * * * * * * */
+/*
+ * We follow the path down the document as it goes by.  'matched' is how
+ * many parts of the path the containers we're in have matched; the members
+ * of the container at depth matched+1 are the candidates for the next
+ * part.  An object can have the same member more than once, and
+ * $json_explode() lets the last one win, so we do too: every match
+ * replaces 'result', and we read the whole document.
+ */
+#define GET_SEARCHING	0
+#define GET_DESCEND	1	/* Next value is on the path if a container */
+#define GET_TARGET	2	/* Next value is the one we want */
+#define GET_CAPTURE	3	/* Inside the container we want */
+
+typedef struct {
+	char **		parts;
+	int		count;
+	int		matched;
+	size_t		depth;
+	int		state;
+	size_t		start;
+	size_t		target_depth;
+	char *		result;
+} GetState;
+
+static void	get_open (JsonParser *p, int type, size_t offset)
+{
+	GetState *g = (GetState *)p->data;
+
+	if (g->state == GET_TARGET)
+	{
+		g->state = GET_CAPTURE;
+		g->start = offset;
+		g->target_depth = g->depth + 1;
+	}
+	else if (g->state == GET_DESCEND)
+	{
+		g->matched++;
+		g->state = GET_SEARCHING;
+	}
+	g->depth++;
+}
+
+static void	get_member (JsonParser *p, const char *key, long index)
+{
+	GetState *g = (GetState *)p->data;
+	char	number[32];
+
+	if (g->state != GET_SEARCHING || g->depth != (size_t)g->matched + 1)
+		return;
+
+	if (!key)
+	{
+		snprintf(number, sizeof(number), "%ld", index);
+		key = number;
+	}
+	if (strcmp(key, g->parts[g->matched]))
+		return;
+
+	if (g->matched + 1 == g->count)
+		g->state = GET_TARGET;
+	else
+		g->state = GET_DESCEND;
+}
+
+static void	get_value (JsonParser *p, int type, const char *str, double num)
+{
+	GetState *g = (GetState *)p->data;
+
+	if (g->state == GET_TARGET)
+	{
+		new_free(&g->result);
+		switch (type)
+		{
+			case JSON_FALSE:  g->result = malloc_strdup("0"); break;
+			case JSON_TRUE:   g->result = malloc_strdup("1"); break;
+			case JSON_NULL:   g->result = malloc_strdup(empty_string); break;
+			case JSON_NUMBER: g->result = malloc_strdup(ftoa(num)); break;
+			case JSON_STRING: g->result = malloc_strdup(str); break;
+		}
+	}
+
+	/* A scalar where the path wanted a container just isn't a match */
+	if (g->state == GET_TARGET || g->state == GET_DESCEND)
+		g->state = GET_SEARCHING;
+}
+
+static void	get_close (JsonParser *p, int type, size_t offset)
+{
+	GetState *g = (GetState *)p->data;
+
+	if (g->state == GET_CAPTURE && g->depth == g->target_depth)
+	{
+		new_free(&g->result);
+		g->result = malloc_strext((const char *)p->content + g->start,
+						offset - g->start);
+		g->state = GET_SEARCHING;
+	}
+	else if (g->state == GET_SEARCHING && g->matched > 0 &&
+			g->depth == (size_t)g->matched + 1)
+		g->matched--;		/* Leaving a container on the path */
+	g->depth--;
+}
+
+static const JsonHandler get_handler = {
+	get_open, get_member, get_value, get_close
+};
+
+/*
+ * Find the value at 'path' (member names and array indexes separated by
+ * dots) in 'json' without building the document.
+ * Scalars are returned the way $json_explode() would assign them, and
+ * objects and arrays are returned as their JSON text.  Returns 1 and sets
+ * 'result' (NULL if the path isn't there), or 0 on a parse error.
+ */
+int	json_get (const char *path, const char *json, char **result, size_t *errpos)
+{
+	GetState	g;
+	char *	copy;
+	char *	ptr;
+	int	retval;
+
+	memset(&g, 0, sizeof(g));
+	copy = malloc_strdup(path);
+	if (*copy)
+	{
+		for (ptr = copy, g.count = 1; *ptr; ptr++)
+			if (*ptr == '.')
+				g.count++;
+		g.parts = (char **)new_malloc(sizeof(char *) * g.count);
+		for (ptr = copy, g.count = 0; ptr; g.count++)
+		{
+			g.parts[g.count] = ptr;
+			if ((ptr = strchr(ptr, '.')))
+				*ptr++ = 0;
+		}
+	}
+	else
+		g.state = GET_TARGET;
+
+	if (!(retval = json_parse(json, &get_handler, &g, errpos)))
+		new_free(&g.result);
+	*result = g.result;
+
+	new_free((char **)&g.parts);
+	new_free(&copy);
+	return retval;
+}
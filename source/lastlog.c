@@ -380,23 +380,21 @@ void 	clear_level_from_lastlog (int window, Mask *levels)
 void 	clear_regex_from_lastlog (int window, const char *regex)
 {
 	Lastlog *item;
-	regex_t	preg;
-	int	errcode;
+	regex_t	*preg;
+	char	buffer[8192];
 
 	window = get_window_refnum(window);
 
 	if (!regex)
 		return;
 
-	if ((errcode = regcomp(&preg, regex, REG_EXTENDED|REG_ICASE|REG_NOSUB)))
+	*buffer = 0;
+	if (!(preg = get_regex(regex, REG_EXTENDED|REG_ICASE|REG_NOSUB, 
+					buffer, sizeof(buffer))))
 	{
-		char	buffer[8192];
-
-		*buffer = 0;
-		regerror(errcode, &preg, buffer, sizeof(buffer));
 		yell("clear_regex_from_lastlog: could not compile regex "
-			"regcomp(%s) returned %d (%s)",
-			regex, errcode, buffer);
+			"regcomp(%s) failed (%s)",
+			regex, buffer);
 		return;
 	}
 
@@ -406,14 +404,14 @@ void 	clear_regex_from_lastlog (int window, const char *regex)
 		Lastlog *next_item;
 
 		next_item = newer_lastlog_entry(item, window);
-		if (!regexec(&preg, item->msg, 0, NULL, 0))
+		if (!regexec(preg, item->msg, 0, NULL, 0))
 		{
 			remove_lastlog_item(item);
 			window_scrollback_needs_rebuild(window);
 		}
 		item = next_item;
 	}
-	regfree(&preg);
+	release_regex(preg);
 }
 
 /*
@@ -519,9 +517,7 @@ BUILT_IN_COMMAND(lastlog)
 	Lastlog *	end;
 	Lastlog *	l;
 	Lastlog *	lastshown;
-	regex_t 	realreg;
 	regex_t *	rex = NULL;
-	regex_t 	realnoreg;
 	regex_t *	norex = NULL;
 	int		cnt;
 	char *		arg;
@@ -795,30 +791,24 @@ BUILT_IN_COMMAND(lastlog)
 	if (regex)
 	{
 		int	options = REG_EXTENDED | REG_ICASE | REG_NOSUB;
-		int	errcode;
+		char	errmsg[1024];
 
-		if ((errcode = regcomp(&realreg, regex, options)))
+		if (!(rex = get_regex(regex, options, errmsg, sizeof(errmsg))))
 		{
-			char errmsg[1024];
-			regerror(errcode, &realreg, errmsg, 1024);
 			yell("%s", errmsg);
 			goto bail;
 		}
-		rex = &realreg;
 	}
 	if (noregex)
 	{
 		int	options = REG_EXTENDED | REG_ICASE | REG_NOSUB;
-		int	errcode;
+		char	errmsg[1024];
 
-		if ((errcode = regcomp(&realnoreg, noregex, options)))
+		if (!(norex = get_regex(noregex, options, errmsg, sizeof(errmsg))))
 		{
-			char errmsg[1024];
-			regerror(errcode, &realreg, errmsg, 1024);
 			yell("%s", errmsg);
 			goto bail;
 		}
-		norex = &realnoreg;
 	}
 
 	if (x_debug & DEBUG_LASTLOG)
@@ -1283,10 +1273,8 @@ restart2:
 bail:
 	if (outfp)
 		fclose(outfp);
-	if (rex)
-		regfree(rex);
-	if (norex)
-		regfree(norex);
+	release_regex(rex);
+	release_regex(norex);
 	set_window_lastlog_mask(0, save_mask);
 	pop_message_from(lc);
 	return;
@@ -1810,14 +1798,13 @@ void	move_lastlog_item_by_level (int oldwin, int newwin, Mask *levels)
 void	move_lastlog_item_by_regex (int oldwin, int newwin, const char *str)
 {
 	Lastlog *l;
-	regex_t preg;
-	int	errcode;
+	regex_t *preg;
+	char	errstr[256];
 
-	errcode = regcomp(&preg, str, REG_EXTENDED | REG_ICASE | REG_NOSUB);
-	if (errcode != 0)
+	preg = get_regex(str, REG_EXTENDED | REG_ICASE | REG_NOSUB, 
+				errstr, sizeof(errstr));
+	if (!preg)
 	{
-		char	errstr[256];
-		regerror(errcode, &preg, errstr, sizeof(errstr));
 		say("Regular expression [%s] does not compile: %s", 
 			str, errstr);
 		return;
@@ -1825,11 +1812,11 @@ void	move_lastlog_item_by_regex (int oldwin, int newwin, const char *str)
 
 	for (l = lastlog_oldest; l; l = l->newer)
 	{
-		if (l->window == oldwin && !regexec(&preg, l->msg, 0, NULL, 0))
+		if (l->window == oldwin && !regexec(preg, l->msg, 0, NULL, 0))
 			move_lastlog_item(l, newwin);
 	}
 
-	regfree(&preg);
+	release_regex(preg);
 }
 
 /************************************************************************/
@@ -40,6 +40,7 @@
 #include "server.h"
 #include "window.h"
 #include "functions.h"
+#include "history.h"
 
 #define MAX_TARGETS 32
 
@@ -719,6 +720,8 @@ void	add_to_logs (long window, int servref, const char *target, int level, const
 	Logfile *log;
 	int	i;
 
+	add_to_history(servref, target, level, orig_str);
+
 	for (log = logfiles; log; log = log->next)
 	{
 	    if (log->type == LOG_WINDOWS)
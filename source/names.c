@@ -35,7 +35,6 @@
 
 #include "irc.h"
 #include "ircaux.h"
-#include "alist.h"
 #include "names.h"
 #include "output.h"
 #include "screen.h"
@@ -46,14 +45,40 @@
 #include "hook.h"
 #include "parse.h"
 
-typedef struct nick_stru
+/*
+ * Everybody we can see on a server has one User, no matter how many of
+ * our channels they are on.  Each channel they are on is a Nick, which is
+ * both on the User's chain of channels and in the Channel's members.
+ * So a NICK change is done once (not once per channel) and a QUIT only
+ * has to visit the channels the person was actually on.
+ */
+typedef struct user_stru
 {
-	char *		nick;		/* nickname of person on channel */
+	char *		nick;		/* Their nickname */
 	char *		userhost;	/* Their userhost, if we know it */
-	short		suspicious;	/* True if the nick might be truncated */
-	short		chanop;		/* True if they are a channel operator */
-	short		voice;		/* 1 if they are, 0 if theyre not, -1 if uk */
-	short		half_assed;	/* 1 if they are, 0 if theyre not, -1 if uk */
+	int		refcnt;		/* How many of our channels they're on */
+	uint32_t	hashval;	/* server_strhash() of "nick" */
+struct	user_stru *	hash_next;	/* Next user in the hash bucket */
+struct	nick_stru *	channels;	/* Each channel they are on */
+}	User;
+
+/*
+ * A Nick's status on the channel is one bit for each of the server's
+ * ISUPPORT PREFIX modes, in the same order (so for "(qaohv)~&@%+", 
+ * bit 0 is +q and bit 4 is +v).  Without multi-prefix, NAMES only shows
+ * the highest one, so the ones below it are "unknown" until a MODE says.
+ */
+#define MAX_PREFIXES	16
+
+typedef struct nick_stru
+{
+	User *		user;		/* Who is on the channel */
+struct	channel_stru *	channel;	/* The channel they are on */
+struct	nick_stru *	next_channel;	/* Next channel "user" is on */
+	int		slot;		/* Where it is in channel->members */
+	unsigned short	prefixes;	/* PREFIX modes they have */
+	unsigned short	unknown;	/* PREFIX modes we don't know about */
+	unsigned char	suspicious;	/* True if the nick might be truncated */
 }	Nick;
 
 static	int	current_channel_counter = 0;
@@ -63,6 +88,10 @@ typedef	struct	channel_stru
 {
 struct	channel_stru *	next;		/* pointer to next channel */
 struct	channel_stru *	prev;		/* pointer to previous channel */
+struct	channel_stru *	server_next;	/* next channel on this server */
+struct	channel_stru *	server_prev;	/* prev channel on this server */
+struct	channel_stru *	hash_next;	/* next channel in hash bucket */
+	uint32_t	hashval;	/* server_strhash() of "channel" */
 	char *		channel;	/* channel name */
 	int		server;		/* The server the channel is "on" */
 	int		window;		/* The window the channel is "on" */
@@ -72,7 +101,10 @@ struct	channel_stru *	prev;		/* pointer to previous channel */
 	int		claimable;	/* Currently up for claiming */
 	int		claiming_window; /* What window claims us */
 	int		waiting;	/* Syncing, waiting for names/who */
-	alist		nicks;		/* alist of nicks on channel */
+	Nick **		members;	/* Everyone on the channel */
+	int		members_count;	/* How many are on the channel */
+	int		members_size;	/* How big "members" is */
+	int		members_sorted;	/* Is "members" in nickname order? */
 	char 		base_modes[54];	/* Just the modes w/o args */
 	int		limit;		/* max users for the channel */
 	char *		key;		/* key for this channel */
@@ -88,26 +120,207 @@ struct	channel_stru *	prev;		/* pointer to previous channel */
 /* channel_list: list of all the channels you are currently on */
 static	Channel *	channel_list = NULL;
 
+/*
+ * Each server keeps its channels in a hash table keyed by the channel
+ * name (as folded by server_stricmp()), and on a chain of its own that is
+ * in the same order as channel_list.  So find_channel() and walking a 
+ * server's channels never look at another server's channels.  The users
+ * on a server's channels are kept in a hash table the same way.
+ */
+typedef struct	server_names_stru
+{
+	Channel **	buckets;	/* Hash table (size is a power of 2) */
+	int		size;		/* Number of buckets */
+	int		count;		/* Number of channels */
+	int		table;		/* The stricmp table we hashed with */
+	Channel *	first;		/* Head of this server's chain */
+
+	User **		users;		/* Hash table (size is a power of 2) */
+	int		users_size;	/* Number of buckets */
+	int		users_count;	/* Number of users */
+	int		users_table;	/* The stricmp table we hashed with */
+
+	char *		prefix_005;	/* The PREFIX we parsed (a copy) */
+	char		prefix_modes[MAX_PREFIXES + 1];	/* eg, "qaohv" */
+	char		prefix_chars[MAX_PREFIXES + 1];	/* eg, "~&@%+" */
+}	ServerNames;
+
+static	ServerNames *	server_names = NULL;
+static	int		server_names_max = 0;
+
+/* The next channel walk_channels() will return -- see remove_member() */
+static	Nick *		walk_next = NULL;
+
 static	void	channel_hold_election (int window);
+static	void	remove_member (Nick *n);
+
+static ServerNames *	get_server_names (int server, int create)
+{
+	int	i;
+
+	if (server < 0)
+		return NULL;
+
+	if (server >= server_names_max)
+	{
+		if (!create)
+			return NULL;
+
+		RESIZE(server_names, ServerNames, server + 1);
+		for (i = server_names_max; i <= server; i++)
+		{
+			server_names[i].buckets = NULL;
+			server_names[i].size = 0;
+			server_names[i].count = 0;
+			server_names[i].table = -1;
+			server_names[i].first = NULL;
+			server_names[i].users = NULL;
+			server_names[i].users_size = 0;
+			server_names[i].users_count = 0;
+			server_names[i].users_table = -1;
+			server_names[i].prefix_005 = NULL;
+			server_names[i].prefix_modes[0] = 0;
+			server_names[i].prefix_chars[0] = 0;
+		}
+		server_names_max = server + 1;
+	}
+
+	return &server_names[server];
+}
+
+/*
+ * Rebuild the hash table for "server" with "size" buckets.  This is also
+ * how we recover when the server's CASEMAPPING changes out from under us.
+ */
+static void	rehash_server_channels (ServerNames *sc, int server, int size)
+{
+	Channel *ch;
+	int	i;
+
+	new_free((char **)&sc->buckets);
+	sc->buckets = (Channel **)new_malloc(sizeof(Channel *) * size);
+	for (i = 0; i < size; i++)
+		sc->buckets[i] = NULL;
+	sc->size = size;
+	sc->table = get_server_stricmp_table(server);
+
+	for (ch = sc->first; ch; ch = ch->server_next)
+	{
+		ch->hashval = server_strhash(ch->channel, server);
+		i = ch->hashval & (sc->size - 1);
+		ch->hash_next = sc->buckets[i];
+		sc->buckets[i] = ch;
+	}
+}
+
+/* Put a new channel at the head of channel_list and its server's chain */
+static void	link_channel (Channel *chan)
+{
+	ServerNames *sc;
+	int	i;
+
+	chan->prev = NULL;
+	chan->next = channel_list;
+	if (channel_list)
+		channel_list->prev = chan;
+	channel_list = chan;
+
+	chan->server_prev = chan->server_next = chan->hash_next = NULL;
+	if (!(sc = get_server_names(chan->server, 1)))
+		return;
+
+	chan->server_next = sc->first;
+	if (sc->first)
+		sc->first->server_prev = chan;
+	sc->first = chan;
 
-#define NICK(l, i)	((Nick *)(l . list[i] -> data))
+	if (++sc->count > sc->size || sc->table != get_server_stricmp_table(chan->server))
+		rehash_server_channels(sc, chan->server, 
+					sc->size ? sc->size * 2 : 16);
+	else
+	{
+		chan->hashval = server_strhash(chan->channel, chan->server);
+		i = chan->hashval & (sc->size - 1);
+		chan->hash_next = sc->buckets[i];
+		sc->buckets[i] = chan;
+	}
+}
+
+/* Take a channel off of channel_list and its server's chain */
+static void	unlink_channel (Channel *chan)
+{
+	ServerNames *sc;
+	Channel **	pp;
+
+	if (chan != channel_list)
+	{
+		if (!chan->prev)
+			panic(1, "chan != channel_list, but chan->prev is NULL");
+		chan->prev->next = chan->next;
+	}
+	else
+	{
+		if (chan->prev)
+			panic(1, "channel_list->prev is not NULL");
+		channel_list = chan->next;
+	}
+
+	if (chan->next)
+		chan->next->prev = chan->prev;
+	chan->next = chan->prev = NULL;
+
+	if (!(sc = get_server_names(chan->server, 0)) || !sc->size)
+		return;
+
+	for (pp = &sc->buckets[chan->hashval & (sc->size - 1)]; *pp; 
+						pp = &(*pp)->hash_next)
+	{
+		if (*pp == chan)
+		{
+			*pp = chan->hash_next;
+			break;
+		}
+	}
+
+	if (chan->server_prev)
+		chan->server_prev->server_next = chan->server_next;
+	else
+		sc->first = chan->server_next;
+	if (chan->server_next)
+		chan->server_next->server_prev = chan->server_prev;
+	chan->server_next = chan->server_prev = chan->hash_next = NULL;
+
+	if (--sc->count == 0)
+	{
+		new_free((char **)&sc->buckets);
+		sc->size = 0;
+	}
+}
 
 /*
  * This isnt strictly neccesary, its more of a cosmetic function.
  */
 static int	traverse_all_channels (Channel **ptr, int server, int only_this_server)
 {
+	ServerNames *sc;
+
+	if (only_this_server)
+	{
+		if (*ptr)
+			*ptr = (*ptr)->server_next;
+		else if ((sc = get_server_names(server, 0)))
+			*ptr = sc->first;
+
+		return *ptr ? 1 : 0;
+	}
+
 	if (!*ptr)
 		*ptr = channel_list;
 	else
 		*ptr = (*ptr)->next;
 
-	if (only_this_server)
-		while (*ptr && (*ptr)->server != server)
-			*ptr = (*ptr)->next;
-	else
-		while (*ptr && (*ptr)->server == server)
-			*ptr = (*ptr)->next;
+	while (*ptr && (*ptr)->server == server)
+		*ptr = (*ptr)->next;
 
 
 	if (!*ptr)
@@ -126,7 +339,9 @@ static int	traverse_all_channels (Channel **ptr, int server, int only_this_serve
 
 static Channel *find_channel (const char *channel, int server)
 {
-	Channel *ch = NULL;
+	ServerNames *sc;
+	Channel *ch;
+	uint32_t hashval;
 
 	if (server == NOSERV)
 		server = primary_server;
@@ -136,8 +351,15 @@ static Channel *find_channel (const char *channel, int server)
 		if (!(channel = get_window_echannel(0)))
 			return NULL;		/* sb colten */
 
-	while (traverse_all_channels(&ch, server, 1))
-	    if (!server_stricmp(ch->channel, channel, server))
+	if (!(sc = get_server_names(server, 0)) || !sc->size)
+		return NULL;
+
+	if (sc->table != get_server_stricmp_table(server))
+		rehash_server_channels(sc, server, sc->size);
+
+	hashval = server_strhash(channel, server);
+	for (ch = sc->buckets[hashval & (sc->size - 1)]; ch; ch = ch->hash_next)
+	    if (ch->hashval == hashval && !server_stricmp(ch->channel, channel, server))
 		return ch;
 
 	return NULL;
@@ -148,20 +370,15 @@ static Channel *create_channel (const char *name, int server)
 {
 	Channel *new_c = (Channel *)new_malloc(sizeof(Channel));
 
-	new_c->prev = new_c->next = NULL;
 	new_c->channel = malloc_strdup(name);
 	new_c->server = server;
 	new_c->waiting = 0;
 	new_c->window = -1;
 	new_c->claimable = 0;
 	new_c->claiming_window = -1;
-	new_c->nicks.total_max = new_c->nicks.max = 0;
-	new_c->nicks.list = NULL;
-	if (get_server_stricmp_table(server) == 0)
-		new_c->nicks.func = (alist_func) ascii_strnicmp;
-	else
-		new_c->nicks.func = (alist_func) rfc1459_strnicmp;
-	new_c->nicks.hash = HASH_INSENSITIVE;
+	new_c->members = NULL;
+	new_c->members_count = new_c->members_size = 0;
+	new_c->members_sorted = 1;
 
 	new_c->base_modes[0] = 0;
 	new_c->modestr = NULL;
@@ -171,28 +388,18 @@ static Channel *create_channel (const char *name, int server)
 	new_c->voice = 0;
 	new_c->half_assed = 0;
 
-	new_c->next = channel_list;
-	if (channel_list)
-		channel_list->prev = new_c;
-	channel_list = new_c;
+	link_channel(new_c);
 	return new_c;
 }
 
 /* Nicklist destructor */
 static void 	clear_channel (Channel *chan)
 {
-	int	i;
-
-	for (i = 0; i < chan->nicks.max; i++)
-	{
-		Nick *x = (Nick *)chan->nicks.list[i]->data;
-		new_free(&x->nick);
-		new_free(&x->userhost);
-		new_free(&(chan->nicks.list[i]->data));
-		new_free(&(chan->nicks.list[i]->name));
-	}
-	new_free((void **)&chan->nicks.list);
-	chan->nicks.max = chan->nicks.total_max = 0;
+	while (chan->members_count > 0)
+		remove_member(chan->members[chan->members_count - 1]);
+	new_free((char **)&chan->members);
+	chan->members_size = 0;
+	chan->members_sorted = 1;
 }
 
 /* Channel destructor -- caller must free "chan". */
@@ -202,22 +409,7 @@ static void 	destroy_channel (Channel *chan)
 	Char *	new_current_channel;
 
 	is_current_now = is_current_channel(chan->channel, chan->server);
-
-	if (chan != channel_list)
-	{
-		if (!chan->prev)
-			panic(1, "chan != channel_list, but chan->prev is NULL");
-		chan->prev->next = chan->next;
-	}
-	else
-	{
-		if (chan->prev)
-			panic(1, "channel_list->prev is not NULL");
-		channel_list = chan->next;
-	}
-
-	if (chan->next)
-		chan->next->prev = chan->prev;
+	unlink_channel(chan);
 
 	/*
 	 * If we are a current window, then we will no longer be so;
@@ -234,15 +426,16 @@ static void 	destroy_channel (Channel *chan)
 			get_window_user_refnum(chan->window), chan->channel, new_current_channel);
 	}
 
+	/* The members need to know what server they were on */
+	if (chan->members_size)
+		clear_channel(chan);
+
 	new_free(&chan->channel);
 	chan->server = NOSERV;
 	chan->window = -1;
 	chan->claimable = -1;
 	chan->claiming_window = -1;
 
-	if (chan->nicks.total_max)
-		clear_channel(chan);
-
 	new_free(&chan->modestr);
 	chan->limit = 0;
 	new_free(&chan->key); 
@@ -265,6 +458,7 @@ void 	add_channel (const char *name, int server)
 		destroy_channel(new_c);
 		malloc_strcpy(&(new_c->channel), name);
 		new_c->server = server;
+		link_channel(new_c);
 	}
 	else
 		new_c = create_channel(name, server);
@@ -337,15 +531,297 @@ void 	remove_channel (const char *channel, int server)
  * Nickname maintainance
  *
  */
+static void	rehash_server_users (ServerNames *sn, int server, int size)
+{
+	User **	old = sn->users;
+	int	old_size = sn->users_size;
+	User *	u;
+	int	i, j;
+
+	sn->users = (User **)new_malloc(sizeof(User *) * size);
+	for (i = 0; i < size; i++)
+		sn->users[i] = NULL;
+	sn->users_size = size;
+	sn->users_table = get_server_stricmp_table(server);
+
+	for (i = 0; i < old_size; i++)
+	{
+		while ((u = old[i]))
+		{
+			old[i] = u->hash_next;
+			u->hashval = server_strhash(u->nick, server);
+			j = u->hashval & (size - 1);
+			u->hash_next = sn->users[j];
+			sn->users[j] = u;
+		}
+	}
+	new_free((char **)&old);
+}
+
+static void	hash_user (ServerNames *sn, User *u, int server)
+{
+	int	i;
+
+	if (sn->users_count + 1 > sn->users_size || 
+	    sn->users_table != get_server_stricmp_table(server))
+		rehash_server_users(sn, server, 
+			sn->users_count + 1 > sn->users_size ? 
+				(sn->users_size ? sn->users_size * 2 : 64) :
+				sn->users_size);
+
+	u->hashval = server_strhash(u->nick, server);
+	i = u->hashval & (sn->users_size - 1);
+	u->hash_next = sn->users[i];
+	sn->users[i] = u;
+	sn->users_count++;
+}
+
+static void	unhash_user (ServerNames *sn, User *u)
+{
+	User **	pp;
+
+	for (pp = &sn->users[u->hashval & (sn->users_size - 1)]; *pp;
+						pp = &(*pp)->hash_next)
+	{
+		if (*pp == u)
+		{
+			*pp = u->hash_next;
+			break;
+		}
+	}
+	u->hash_next = NULL;
+
+	if (--sn->users_count == 0)
+	{
+		new_free((char **)&sn->users);
+		sn->users_size = 0;
+	}
+}
+
+static User *	find_user (int server, const char *nick)
+{
+	ServerNames *sn;
+	User *	u;
+	uint32_t hashval;
+
+	if (!(sn = get_server_names(server, 0)) || !sn->users_size)
+		return NULL;
+
+	if (sn->users_table != get_server_stricmp_table(server))
+		rehash_server_users(sn, server, sn->users_size);
+
+	hashval = server_strhash(nick, server);
+	for (u = sn->users[hashval & (sn->users_size - 1)]; u; u = u->hash_next)
+		if (u->hashval == hashval && !server_stricmp(u->nick, nick, server))
+			return u;
+
+	return NULL;
+}
+
+/* Find the user "nick" on "server", creating them if neccesary */
+static User *	get_user (int server, const char *nick)
+{
+	ServerNames *sn;
+	User *	u;
+
+	if ((u = find_user(server, nick)))
+		return u;
+
+	if (!(sn = get_server_names(server, 1)))
+		panic(1, "get_user: server [%d] is not valid", server);
+
+	u = (User *)new_malloc(sizeof(User));
+	u->nick = malloc_strdup(nick);
+	u->userhost = NULL;
+	u->refcnt = 0;
+	u->channels = NULL;
+	hash_user(sn, u, server);
+	return u;
+}
+
+/* Throw away a user who isn't on any of our channels any more */
+static void	release_user (int server, User *u)
+{
+	if (u->refcnt > 0)
+		return;
+
+	unhash_user(get_server_names(server, 0), u);
+	new_free(&u->nick);
+	new_free(&u->userhost);
+	new_free((char **)&u);
+}
+
+/* Give a user a new nickname (which might only differ by case) */
+static void	rename_user (int server, User *u, const char *new_nick)
+{
+	ServerNames *sn = get_server_names(server, 0);
+	Nick *	n;
+
+	unhash_user(sn, u);
+	malloc_strcpy(&u->nick, new_nick);
+	hash_user(sn, u, server);
+
+	for (n = u->channels; n; n = n->next_channel)
+		n->channel->members_sorted = 0;
+}
+
+static int	sort_members_server = NOSERV;
+
+static int	compare_members (const void *a, const void *b)
+{
+	const Nick *	na = *(const Nick * const *)a;
+	const Nick *	nb = *(const Nick * const *)b;
+
+	return server_stricmp(na->user->nick, nb->user->nick, sort_members_server);
+}
+
+/* 
+ * Members are kept in no particular order while they come and go, 
+ * and are put in nickname order only when someone wants to look at them.
+ */
+static void	sort_members (Channel *chan)
+{
+	int	i;
+
+	if (chan->members_sorted)
+		return;
+
+	sort_members_server = chan->server;
+	if (chan->members_count > 1)
+		qsort(chan->members, chan->members_count, sizeof(Nick *), 
+				compare_members);
+	for (i = 0; i < chan->members_count; i++)
+		chan->members[i]->slot = i;
+	chan->members_sorted = 1;
+}
+
+/* Put "user" on the end of "chan", without looking to see if they're on it */
+static Nick *	append_member (Channel *chan, User *user)
+{
+	Nick *	n;
+
+	n = (Nick *)new_malloc(sizeof(Nick));
+	n->user = user;
+	n->channel = chan;
+	n->prefixes = 0;
+	n->unknown = 0;
+	n->suspicious = 0;
+
+	n->next_channel = user->channels;
+	user->channels = n;
+	user->refcnt++;
+
+	if (chan->members_count == chan->members_size)
+	{
+		chan->members_size = chan->members_size ? 
+					chan->members_size * 2 : 8;
+		RESIZE(chan->members, Nick *, chan->members_size);
+	}
+
+	if (chan->members_sorted && chan->members_count > 0 &&
+	    server_stricmp(chan->members[chan->members_count - 1]->user->nick,
+				user->nick, chan->server) > 0)
+		chan->members_sorted = 0;
+	n->slot = chan->members_count;
+	chan->members[chan->members_count++] = n;
+	return n;
+}
+
+/* Put "user" on "chan" (if they aren't already) */
+static Nick *	add_member (Channel *chan, User *user)
+{
+	Nick *	n;
+
+	for (n = user->channels; n; n = n->next_channel)
+		if (n->channel == chan)
+			return n;
+
+	return append_member(chan, user);
+}
+
+/* 
+ * Take "n" off of its user's chain of channels.  The chain is only as
+ * long as the number of our channels they're on, so it's not worth a
+ * back pointer in every Nick.
+ */
+static void	unlink_member (Nick *n)
+{
+	Nick **	ptr;
+
+	if (walk_next == n)
+		walk_next = n->next_channel;
+
+	for (ptr = &n->user->channels; *ptr; ptr = &(*ptr)->next_channel)
+	{
+		if (*ptr == n)
+		{
+			*ptr = n->next_channel;
+			break;
+		}
+	}
+	n->next_channel = NULL;
+}
+
+/* Free "n" (which is not in its channel's members any more) */
+static void	forget_member (Nick *n)
+{
+	User *	user = n->user;
+
+	unlink_member(n);
+	user->refcnt--;
+	release_user(n->channel->server, user);
+	new_free((char **)&n);
+}
+
+/* 
+ * Take "n" off of its channel, and forget its user if that was the last.
+ * The last member is moved into its slot, so this doesn't depend on how
+ * many are on the channel.
+ */
+static void	remove_member (Nick *n)
+{
+	Channel *chan = n->channel;
+	Nick *	last;
+
+	last = chan->members[--chan->members_count];
+	if (last != n)
+	{
+		chan->members[n->slot] = last;
+		last->slot = n->slot;
+		chan->members_sorted = 0;
+	}
+	forget_member(n);
+}
+
+/* Move a membership from one user to another */
+static void	move_member (Nick *n, User *to)
+{
+	User *	from = n->user;
+
+	unlink_member(n);
+	n->user = to;
+	n->next_channel = to->channels;
+	to->channels = n;
+	to->refcnt++;
+	n->channel->members_sorted = 0;
+
+	from->refcnt--;
+	release_user(n->channel->server, from);
+}
+
 static Nick *	find_nick_on_channel (Channel *ch, const char *nick)
 {
-	int cnt, loc;
-	Nick *new_n = (Nick *)find_alist_item(&ch->nicks, nick, &cnt, &loc);
+	User *	user;
+	Nick *	n;
 
-	if (cnt >= 0 || !new_n)
+	if (!(user = find_user(ch->server, nick)))
 		return NULL;
 
-	return new_n;
+	for (n = user->channels; n; n = n->next_channel)
+		if (n->channel == ch)
+			return n;
+
+	return NULL;
 }
 
 static Nick *	find_nick (int server, const char *channel, const char *nick)
@@ -371,17 +847,17 @@ static Nick *	find_suspicious_on_channel (Channel *ch, const char *nick)
 	/*
 	 * Efficiency here isn't terribly important, but correctness IS.
 	 */
-	for (pos = 0; pos < ch->nicks.max; pos++)
+	for (pos = 0; pos < ch->members_count; pos++)
 	{
-		Nick *	n = ch->nicks.list[pos]->data;
-		char *	s = n->nick;
+		Nick *	n = ch->members[pos];
+		char *	s = n->user->nick;
 		size_t	siz = strlen(s);
 
 		/* 
 		 * Is the nick in the list (s) a subset of 'nick'? 
 		 * If not, keep going.
 		 */
-		if (ch->nicks.func(s, nick, siz))
+		if (server_strnicmp(s, nick, siz, ch->server))
 			continue;
 
 		/*
@@ -400,6 +876,147 @@ static Nick *	find_suspicious_on_channel (Channel *ch, const char *nick)
 
 
 
+/*
+ * Make sure we've got the server's PREFIX 005 figured out: which modes
+ * (highest first) go with which nickname prefixes.
+ */
+static ServerNames *	get_server_prefixes (int server)
+{
+	ServerNames *sn;
+	const char *prefix, *chars;
+	size_t	len;
+
+	if (!(sn = get_server_names(server, 1)))
+		return NULL;
+
+	if (!(prefix = get_server_005(server, "PREFIX")) || *prefix != '(' ||
+	    !(chars = strchr(prefix, ')')))
+		prefix = "(ohv)@%+";
+	if (sn->prefix_005 && !strcmp(sn->prefix_005, prefix))
+		return sn;
+
+	malloc_strcpy(&sn->prefix_005, prefix);
+	chars = strchr(prefix, ')') + 1;
+	len = chars - prefix - 2;
+	if (len > strlen(chars))
+		len = strlen(chars);
+	if (len > MAX_PREFIXES)
+		len = MAX_PREFIXES;
+
+	memcpy(sn->prefix_modes, prefix + 1, len);
+	sn->prefix_modes[len] = 0;
+	memcpy(sn->prefix_chars, chars, len);
+	sn->prefix_chars[len] = 0;
+	return sn;
+}
+
+/* Which bit of Nick.prefixes is "mode" on this server (or 0)? */
+static unsigned short	prefix_mode_bit (int server, char mode)
+{
+	ServerNames *sn;
+	const char *p;
+
+	if (!mode || !(sn = get_server_prefixes(server)))
+		return 0;
+	if (!(p = strchr(sn->prefix_modes, mode)))
+		return 0;
+	return 1 << (p - sn->prefix_modes);
+}
+
+/* 1 if "n" has "mode", 0 if they don't, -1 if we don't know */
+static int	nick_has_mode (Nick *n, char mode)
+{
+	unsigned short bit = prefix_mode_bit(n->channel->server, mode);
+
+	if (n->prefixes & bit)
+		return 1;
+	if (n->unknown & bit)
+		return -1;
+	return 0;
+}
+
+/* 
+ * Is "n" a channel operator?  Anybody above +o (owners and admins) counts,
+ * since NAMES won't tell us if they're +o as well.
+ */
+static int	nick_is_chanop (Nick *n)
+{
+	unsigned short bit = prefix_mode_bit(n->channel->server, 'o');
+
+	if (!bit)
+		return 0;
+	return (n->prefixes & (bit | (bit - 1))) ? 1 : 0;
+}
+
+/* Give "n" (or take away) the PREFIX mode "mode" */
+static void	set_nick_mode (Nick *n, char mode, int add)
+{
+	unsigned short bit = prefix_mode_bit(n->channel->server, mode);
+
+	if (add)
+		n->prefixes |= bit;
+	else
+		n->prefixes &= ~bit;
+	n->unknown &= ~bit;
+}
+
+/* 
+ * We (on "chan") were given (or lost) the PREFIX mode "mode".  We're a
+ * chanop as long as we have +o or anything above it, so losing +q doesn't
+ * make us not one if we still have +o, and vice versa.
+ */
+static void	set_my_mode (Channel *chan, char mode, int add)
+{
+	Nick *	me;
+
+	if (mode == 'v')
+		chan->voice = add;
+	else if (mode == 'h')
+		chan->half_assed = add;
+
+	if ((me = find_nick_on_channel(chan, 
+				get_server_nickname(chan->server))))
+	{
+		set_nick_mode(me, mode, add);
+		chan->chop = nick_is_chanop(me);
+	}
+	else if (mode == 'o')
+		chan->chop = add;
+	else if (add)
+	{
+		unsigned short bit = prefix_mode_bit(chan->server, mode);
+
+		if (bit && bit < prefix_mode_bit(chan->server, 'o'))
+			chan->chop = 1;
+	}
+}
+
+/*
+ * Strip the prefixes off the front of "nick", and return the PREFIX modes
+ * they stand for in "prefixes".  Without multi-prefix, we only get the
+ * highest one, so the ones below that go into "unknown".  If "nick" is
+ * us, this also sets our own status on "chan".
+ */
+static const char *	strip_nick_prefixes (Channel *chan, ServerNames *sn, const char *nick, unsigned short *prefixes, unsigned short *unknown)
+{
+	const char *	p;
+	unsigned short	bit;
+
+	while (*nick && (p = strchr(sn->prefix_chars, *nick)))
+	{
+		nick++;
+		bit = 1 << (p - sn->prefix_chars);
+		*prefixes |= bit;
+		*unknown = (*unknown | ~(bit | (bit - 1))) & ~*prefixes;
+
+		if (is_me(chan->server, nick))
+			set_my_mode(chan, sn->prefix_modes[p - sn->prefix_chars], 1);
+	}
+
+	*unknown &= (1 << strlen(sn->prefix_chars)) - 1;
+	return nick;
+}
+
 /*
  * add_to_channel: adds the given nickname to the given channel.  If the
  * nickname is already on the channel, nothing happens.  If the channel is
@@ -408,85 +1025,116 @@ static Nick *	find_suspicious_on_channel (Channel *ch, const char *nick)
  */
 void 	add_to_channel (const char *channel, const char *nick, int server, int suspicious, int oper, int voice, int ha)
 {
-	Nick 	*new_n, *old;
+	Nick 	*new_n;
 	Channel *chan;
-	int	ischop = oper;
-	int	isvoice = voice;
-	int	half_assed = ha;
-const	char	*prefix;
+	ServerNames *sn;
+	unsigned short	prefixes = 0, unknown = 0;
 
 	if (!(chan = find_channel(channel, server)))
 		return;
+	sn = get_server_prefixes(chan->server);
 
-	prefix = get_server_005(from_server, "PREFIX");
-	if (prefix && *prefix == '(' && (prefix = strchr(prefix, ')')))
-		prefix++;
-	if (!prefix || !*prefix)
-		prefix = "@%+";
-
-	/* 
-	 * This is defensive just in case someone in the future
-	 * decides to do the right thing...
-	 */
-	for (;;)
+	if (oper)
+		prefixes |= prefix_mode_bit(chan->server, 'o');
+	if (voice)
+		prefixes |= prefix_mode_bit(chan->server, 'v');
+	if (ha)
+		prefixes |= prefix_mode_bit(chan->server, 'h');
+	nick = strip_nick_prefixes(chan, sn, nick, &prefixes, &unknown);
+
+	new_n = add_member(chan, get_user(chan->server, nick));
+	new_n->suspicious = suspicious;
+	new_n->prefixes = prefixes;
+	new_n->unknown = unknown;
+}
+
+/*
+ * add_names_to_channel: Adds everyone in a NAMES reply ("names") to a
+ * channel that is syncing.  Everyone is tacked onto the end of the channel
+ * without checking whether they're already there -- it's up to 
+ * channel_names_done() to sort the channel and sift out anyone who was
+ * named twice once the server says the NAMES are over.
+ */
+void	add_names_to_channel (const char *channel, const char *names, int server)
+{
+	Channel *chan;
+	ServerNames *sn;
+	char	*copy, *nick;
+	const char *n;
+	Nick	*new_n;
+	unsigned short	prefixes, unknown;
+
+	if (!(chan = find_channel(channel, server)))
+		return;
+
+	sn = get_server_prefixes(chan->server);
+	chan->members_sorted = 0;
+	copy = LOCAL_COPY(names);
+	while ((nick = next_arg(copy, &copy)) != NULL)
 	{
-		if (!strchr(prefix, *nick))
-		{
-			break;
-		}
-		else if (*nick == '+')
-		{
-			nick++;
-			if (is_me(server, nick))
-				chan->voice = 1;
-			isvoice = 1;
-		}
-		else if (*nick == '@')
-		{
-			nick++;
-			if (is_me(server, nick))
-				chan->chop = 1;
-			else 
-			{
-				if (isvoice == 0)
-					isvoice = -1;
-				if (half_assed == 0)
-					half_assed = -1;
-			}
-			ischop = 1;
-		}
-		else if (*nick == '%')
-		{
-			nick++;
-			if (is_me(server, nick))
-				chan->half_assed = 1;
-			else
-			{
-				if (isvoice == 0)
-					isvoice = -1;
-			}
-			half_assed = 1;
-		}
-		else
-		{
-			nick++;
-			break;
-		}
+		/*
+		 * XXX If the last nickname on the list ends with \  
+		 * and there is a space after it, that would end up
+		 * in 'nick' here -> trim it.  (This actually happens)
+		 */
+		remove_trailing_spaces(nick, 0);
+
+		prefixes = unknown = 0;
+		n = strip_nick_prefixes(chan, sn, nick, &prefixes, &unknown);
+		if (!*n)
+			continue;
+
+		new_n = append_member(chan, get_user(chan->server, n));
+		new_n->prefixes = prefixes;
+		new_n->unknown = unknown;
+
+		/*
+		 * 1999 Oct 29 -- This is a hack to compensate for
+		 * a bug in older ircd implementations that can result
+		 * in a truncated nickname at the end of a names reply.
+		 * The last nickname in a names list is then always
+		 * treated with suspicion until the WHO reply is 
+		 * completed and we know that its not truncated. --esl
+		 */
+		if (!copy || !*copy)
+			new_n->suspicious = 1;
 	}
+}
 
-	new_n = (Nick *)new_malloc(sizeof(Nick));
-	new_n->nick = malloc_strdup(nick);
-	new_n->userhost = NULL;
-	new_n->suspicious = suspicious;
-	new_n->chanop = ischop;
-	new_n->voice = isvoice;
-	new_n->half_assed = half_assed;
+/*
+ * channel_names_done: The server has finished the NAMES for a syncing
+ * channel, so put everyone in order (once) and fold together anyone who
+ * showed up more than once.
+ */
+void	channel_names_done (const char *channel, int server)
+{
+	Channel *chan;
+	Nick	*prev, *n;
+	int	i, j;
+
+	if (!(chan = find_channel(channel, server)))
+		return;
 
-	if ((old = (Nick *)add_to_alist(&chan->nicks, nick, new_n)))
+	/* Duplicates are next to each other; squeeze them out in place */
+	sort_members(chan);
+	for (i = j = 1; i < chan->members_count; i++)
 	{
-		new_free(&old->nick);
-		new_free(&old->userhost);
+		prev = chan->members[j - 1];
+		n = chan->members[i];
+		if (prev->user != n->user)
+		{
+			n->slot = j;
+			chan->members[j++] = n;
+			continue;
+		}
+
+		prev->prefixes |= n->prefixes;
+		prev->unknown = (prev->unknown | n->unknown) & ~prev->prefixes;
+		prev->suspicious = n->suspicious;
+		forget_member(n);
 	}
+	if (chan->members_count > 0)
+		chan->members_count = j;
 }
 
 void 	add_userhost_to_channel (const char *channel, const char *nick, int server, const char *uh)
@@ -521,9 +1169,7 @@ void 	add_userhost_to_channel (const char *channel, const char *nick, int server
 		 */
 		else
 		{
-		    remove_from_alist(&chan->nicks, new_n->nick);
-		    malloc_strcpy(&new_n->nick, nick);
-		    add_to_alist(&chan->nicks, nick, new_n);
+		    move_member(new_n, get_user(chan->server, nick));
 		    if (x_debug & DEBUG_CHANNELS)
 		    {
 			yell("Detected and corrected a nickname mangled by "
@@ -540,7 +1186,8 @@ void 	add_userhost_to_channel (const char *channel, const char *nick, int server
 		}
 	}
 
-	malloc_strcpy(&new_n->userhost, uh);
+	malloc_strcpy(&new_n->user->userhost, uh);
+	new_n->suspicious = 0;		/* WHO says they're for real */
 }
 
 
@@ -551,23 +1198,24 @@ void 	add_userhost_to_channel (const char *channel, const char *nick, int server
  */
 void 	remove_from_channel (const char *channel, const char *nick, int server)
 {
-	Channel *chan = NULL;
-	Nick	*tmp;
+	User	*user;
+	Nick	*tmp, *next;
 
 	if (server == NOSERV) return;
 
-	while (traverse_all_channels(&chan, server, 1))
+	if (!(user = find_user(server, nick)))
+		return;
+
+	/* When the last one goes, so does "user" -- but "next" is NULL */
+	for (tmp = user->channels; tmp; tmp = next)
 	{
+		next = tmp->next_channel;
+
 		/* This is correct, dont change it! */
-		if (channel && server_stricmp(channel, chan->channel, server))
+		if (channel && server_stricmp(channel, tmp->channel->channel, server))
 			continue;
 
-		if ((tmp = (Nick *)remove_from_alist(&chan->nicks, nick)))
-		{
-			new_free(&tmp->nick);
-			new_free(&tmp->userhost); /* Da5id reported mf here */
-			new_free((char **)&tmp);
-		}
+		remove_member(tmp);
 	}
 }
 
@@ -578,20 +1226,26 @@ void 	remove_from_channel (const char *channel, const char *nick, int server)
  */
 void 	rename_nick (const char *old_nick, const char *new_nick, int server)
 {
-	Channel *chan = NULL;
-	Nick	*tmp;
+	User	*user, *other;
+	Nick	*tmp, *next;
 
 	if (server == NOSERV) return;		/* Sanity check */
 
-	while (traverse_all_channels(&chan, server, 1))
+	if (!(user = find_user(server, old_nick)))
+		return;
+
+	/* If we think someone already has the new nick, we were wrong. */
+	if ((other = find_user(server, new_nick)) && other != user)
 	{
-		if ((tmp = (Nick *)remove_from_alist(&chan->nicks, old_nick)))
+		for (tmp = other->channels; tmp; tmp = next)
 		{
-			malloc_strcpy(&tmp->nick, new_nick);
-			malloc_strcpy(&tmp->userhost, FromUserHost);
-			add_to_alist(&chan->nicks, new_nick, tmp);
+			next = tmp->next_channel;
+			remove_member(tmp);
 		}
 	}
+
+	rename_user(server, user, new_nick);
+	malloc_strcpy(&user->userhost, FromUserHost);
 }
 
 
@@ -624,7 +1278,7 @@ int 	is_chanop (const char *channel, const char *nick)
 	Nick *n;
 
 	if ((n = find_nick(from_server, channel, nick)))
-		return n->chanop;
+		return nick_is_chanop(n);
 	else
 		return 0;
 }
@@ -634,7 +1288,7 @@ int	is_chanvoice (const char *channel, const char *nick)
 	Nick *n;
 
 	if ((n = find_nick(from_server, channel, nick)))
-		return n->voice;
+		return nick_has_mode(n, 'v');
 	else
 		return 0;
 }
@@ -644,17 +1298,39 @@ int	is_halfop (const char *channel, const char *nick)
 	Nick *n;
 
 	if ((n = find_nick(from_server, channel, nick)))
-		return n->half_assed;
+		return nick_has_mode(n, 'h');
 	else
 		return 0;
 }
 
+/*
+ * get_nick_prefixes: The nickname prefixes (eg, "~@") that "nick" has on 
+ * "channel", highest first, as the server's PREFIX 005 spells them.
+ */
+char *	get_nick_prefixes (const char *channel, const char *nick, int server)
+{
+	ServerNames *sn;
+	Nick *	n;
+	char	buffer[MAX_PREFIXES + 1];
+	int	i, j;
+
+	if (!(n = find_nick(server, channel, nick)) || 
+	    !(sn = get_server_prefixes(server)))
+		return malloc_strdup(empty_string);
+
+	for (i = j = 0; sn->prefix_chars[i]; i++)
+		if (n->prefixes & (1 << i))
+			buffer[j++] = sn->prefix_chars[i];
+	buffer[j] = 0;
+	return malloc_strdup(buffer);
+}
+
 int	number_on_channel (const char *name, int server)
 {
 	Channel *channel = find_channel(name, server);
 
 	if (channel)
-		return channel->nicks.max;
+		return channel->members_count;
 	else
 		return 0;
 }
@@ -668,8 +1344,9 @@ char	*create_nick_list (const char *name, int server)
 	if (!channel)
 		return NULL;
 
-	for (i = 0; i < channel->nicks.max; i++)
-		malloc_strcat_word(&str, space, NICK(channel->nicks, i)->nick, DWORD_NO);
+	sort_members(channel);
+	for (i = 0; i < channel->members_count; i++)
+		malloc_strcat_word(&str, space, channel->members[i]->user->nick, DWORD_NO);
 
 	return str;
 }
@@ -683,9 +1360,10 @@ char	*create_chops_list (const char *name, int server)
 	if (!channel)
 		return malloc_strdup(empty_string);
 
-	for (i = 0; i < channel->nicks.max; i++)
-	    if (NICK(channel->nicks, i)->chanop)
-		malloc_strcat_word(&str, space, NICK(channel->nicks, i)->nick, DWORD_NO);
+	sort_members(channel);
+	for (i = 0; i < channel->members_count; i++)
+	    if (nick_is_chanop(channel->members[i]))
+		malloc_strcat_word(&str, space, channel->members[i]->user->nick, DWORD_NO);
 
 	if (!str)
 		return malloc_strdup(empty_string);
@@ -701,9 +1379,10 @@ char	*create_nochops_list (const char *name, int server)
 	if (!channel)
 		return malloc_strdup(empty_string);
 
-	for (i = 0; i < channel->nicks.max; i++)
-	    if (!NICK(channel->nicks, i)->chanop)
-		malloc_strcat_word(&str, space, NICK(channel->nicks, i)->nick, DWORD_NO);
+	sort_members(channel);
+	for (i = 0; i < channel->members_count; i++)
+	    if (!nick_is_chanop(channel->members[i]))
+		malloc_strcat_word(&str, space, channel->members[i]->user->nick, DWORD_NO);
 
 	if (!str)
 		return malloc_strdup(empty_string);
@@ -875,9 +1554,9 @@ static void	decifer_mode (const char *modes, Channel *chan)
 			    arg = get_server_nickname(from_server);
 
 			if (is_me(from_server, arg))
-				chan->chop = add;
+				set_my_mode(chan, 'o', add);
 			if ((nick = find_nick_on_channel(chan, arg)))
-				nick->chanop = add;
+				set_nick_mode(nick, 'o', add);
 			continue;
 		}
 		case 'v':
@@ -894,7 +1573,7 @@ static void	decifer_mode (const char *modes, Channel *chan)
 			if (is_me(from_server, arg))
 				chan->voice = add;
 			if ((nick = find_nick_on_channel(chan, arg)))
-				nick->voice = add;
+				set_nick_mode(nick, 'v', add);
 			continue;
 		}
 		case 'h': /* erfnet's borked 'half-assed oper' mode */
@@ -911,12 +1590,22 @@ static void	decifer_mode (const char *modes, Channel *chan)
 			if (is_me(from_server, arg))
 				chan->half_assed = add;
 			if ((nick = find_nick_on_channel(chan, arg)))
-				nick->half_assed = add;
+				set_nick_mode(nick, 'h', add);
 			continue;
 		}
 
 		default:
 		{
+		    /* The other PREFIX modes (+q, +a, and so on) */
+		    if (type == 2 && arg && prefix_mode_bit(chan->server, *mode_str))
+		    {
+			if (is_me(from_server, arg))
+				set_my_mode(chan, *mode_str, add);
+			if ((nick = find_nick_on_channel(chan, arg)))
+				set_nick_mode(nick, *mode_str, add);
+			continue;
+		    }
+
 		    if (type == 2 || type == 3 || type == 4)
 			continue;	/* Skip modes with args */
 
@@ -1058,13 +1747,14 @@ static void 	show_channel (Channel *chan)
 	*ptr = 0;
 	nick_len = BIG_BUFFER_SIZE * 10;
 
-	for (i = 0; i < chan->nicks.max; i++)
+	sort_members(chan);
+	for (i = 0; i < chan->members_count; i++)
 	{
-		strlcpy(ptr, NICK(chan->nicks, i)->nick, nick_len);
-		if (NICK(chan->nicks, i)->userhost)
+		strlcpy(ptr, chan->members[i]->user->nick, nick_len);
+		if (chan->members[i]->user->userhost)
 		{
 			strlcat(ptr, "!", nick_len);
-			strlcat(ptr, NICK(chan->nicks, i)->userhost, nick_len);
+			strlcat(ptr, chan->members[i]->user->userhost, nick_len);
 		}
 		strlcat(ptr, space, nick_len);
 
@@ -1089,28 +1779,32 @@ char	*scan_channel (char *cname)
 	Channel *	wc = find_channel(cname, from_server);
 	char		buffer[NICKNAME_LEN + 5];
 	char		*retval = NULL;
-	int		i;
+	int		i, voice;
 
 	if (!wc)
 		return malloc_strdup(empty_string);
 
-	for (i = 0; i < wc->nicks.max; i++)
+	sort_members(wc);
+	for (i = 0; i < wc->members_count; i++)
 	{
-		if (NICK(wc->nicks, i)->chanop)
+		Nick *	n = wc->members[i];
+
+		if (nick_is_chanop(n))
 			buffer[0] = '@';
-		else if (NICK(wc->nicks, i)->half_assed == 1)
+		else if (nick_has_mode(n, 'h') == 1)
 			buffer[0] = '%';
 		else
 			buffer[0] = '.';
 
-		if (NICK(wc->nicks, i)->voice == 1)
+		voice = nick_has_mode(n, 'v');
+		if (voice == 1)
 			buffer[1] = '+';
-		else if (NICK(wc->nicks, i)->voice == -1)
+		else if (voice == -1)
 			buffer[1] = '?';
 		else
 			buffer[1] = '.';
 
-		strlcpy(buffer + 2, NICK(wc->nicks, i)->nick, sizeof(buffer) - 2);
+		strlcpy(buffer + 2, n->user->nick, sizeof(buffer) - 2);
 		malloc_strcat_word(&retval, space, buffer, DWORD_NO);
 	}
 
@@ -1276,29 +1970,21 @@ int     is_current_channel (const char *channel, int server)
  */
 void 	destroy_server_channels (int server)
 {
-	Channel	*tmp = NULL;
-	int	reset = 0;
+	ServerNames *sc;
+	Channel	*tmp;
 
 	if (server == NOSERV)
 		return;		/* Sanity check */
 
 	/*
-	 * Regretably, the referntial integrity of the channels is broken
-	 * at this point -- meaning that we cannot use traverse_all_channels
-	 * which attempts to restore referntial integrity -- but we do not
-	 * want that!  So we have to slog through this on our own and kill
-	 * off the channels without the assistance of traverse_all_channels.
+	 * Always take the head of the server's chain, because the 
+	 * /on channel_lost can do anything it wants to the others.
 	 */
-	for (tmp = channel_list; tmp; 
-		reset ? (tmp = channel_list) : (tmp = tmp->next))
+	while ((sc = get_server_names(server, 0)) && (tmp = sc->first))
 	{
-		reset = 0;
-		if (tmp->server != server)
-			continue;
 		do_hook(CHANNEL_LOST_LIST, "%d %s %d", tmp->server, tmp->channel, get_window_user_refnum(tmp->window));
 		destroy_channel(tmp);
 		new_free((char **)&tmp);
-		reset = 1;
 	}
 	window_check_channels();
 }
@@ -1306,47 +1992,47 @@ void 	destroy_server_channels (int server)
 
 const char *	what_channel (const char *nick, int servref)
 {
-	Channel *tmp = NULL;
+	User *	user;
 
-	while (traverse_all_channels(&tmp, servref, 1))
-	{
-		if (find_nick_on_channel(tmp, nick))
-			return tmp->channel;
-	}
+	if ((user = find_user(servref, nick)) && user->channels)
+		return user->channels->channel->channel;
 
 	return NULL;
 }
 
+/*
+ * Return each channel "nick" is on, one per call.  If the channel we 
+ * would return next goes away in the meantime, remove_member() moves 
+ * "walk_next" along for us.
+ */
 const char *	walk_channels (int init, const char *nick)
 {
-	static	Channel *tmp = (Channel *) 0;
+	User *	user;
+	Nick *	n;
 
 	if (init)
-		tmp = NULL;
-
-	while (traverse_all_channels(&tmp, from_server, 1))
 	{
-		if (find_nick_on_channel(tmp, nick))
-			return (tmp->channel);
+		if ((user = find_user(from_server, nick)))
+			walk_next = user->channels;
+		else
+			walk_next = NULL;
 	}
 
-	return NULL;
+	if (!(n = walk_next))
+		return NULL;
+
+	walk_next = n->next_channel;
+	return n->channel->channel;
 }
 
 const char *	fetch_userhost (int server, const char *chan, const char *nick)
 {
-	Channel *tmp = NULL;
-	Nick *user = NULL;
+	User *	user;
 
 	if (server == NOSERV) return NULL;		/* Sanity check */
 
-	if (chan && (tmp = find_channel(chan, server)) &&
-			(user = find_nick_on_channel(tmp, nick)))
+	if ((user = find_user(server, nick)))
 		return user->userhost;
-	else while (traverse_all_channels(&tmp, server, 1))
-		if ((user = find_nick_on_channel(tmp, nick)) && 
-				user->userhost)
-			return user->userhost;
 
 	return NULL;
 }
@@ -65,10 +65,15 @@ typedef	struct	notify_stru
 {
 	char	*nick;			/* Who are we watching? */
 	int	flag;			/* Is the person on irc? */
+	int	pushed;		/* Is the server watching them for us? */
 } NotifyItem;
 
 static 	void	ison_notify (int refnum, char *AskedFor, char *AreOn);
 static 	void	rebuild_notify_ison 	(int server);
+static	int	notify_push_add		(int refnum, NotifyItem *item);
+static	void	notify_push_remove	(int refnum, NotifyItem *item);
+static	void	notify_push_clear	(int refnum);
+static	char *	notify_unpushed		(int refnum, const char *nicks);
 
 
 #define NOTIFY_LIST(s)		(&(s->notify_list))
@@ -127,7 +132,8 @@ static void	rebuild_notify_ison (int refnum)
 		s->ison[0] = 0;
 
 	for (i = 0; i < NOTIFY_MAX(s); i++)
-		malloc_strcat_wordlist(&s->ison, space, NOTIFY_ITEM(s, i)->nick);
+		if (!NOTIFY_ITEM(s, i)->pushed)
+		    malloc_strcat_wordlist(&s->ison, space, NOTIFY_ITEM(s, i)->nick);
 }
 
 
@@ -168,6 +174,7 @@ BUILT_IN_COMMAND(notify)
 
 			    if ((new_n = (NotifyItem *)remove_from_alist(NOTIFY_LIST(s), nick)))
 			    {
+				notify_push_remove(refnum, new_n);
 				new_free(&(new_n->nick));
 				new_free((char **)&new_n);
 
@@ -194,6 +201,7 @@ BUILT_IN_COMMAND(notify)
 			    if (!(s = get_server(refnum)))
 				continue;
 
+			    notify_push_clear(refnum);
 			    while ((new_n = (NotifyItem *)alist_pop(NOTIFY_LIST(s), 0)))
 			    {
 				new_free(&new_n->nick);
@@ -234,7 +242,9 @@ BUILT_IN_COMMAND(notify)
 			new_n = (NotifyItem *)new_malloc(sizeof(NotifyItem));
 			new_n->nick = malloc_strdup(nick);
 			new_n->flag = 0;
+			new_n->pushed = 0;
 			add_to_alist(NOTIFY_LIST(s), nick, new_n);
+			notify_push_add(refnum, new_n);
 			added = 1;
 		     }
 
@@ -257,7 +267,13 @@ BUILT_IN_COMMAND(notify)
 		    continue;
 
 		if (is_server_registered(refnum) && list && *list)
-			isonbase(refnum, list, ison_notify);
+		{
+			char *	unpushed = notify_unpushed(refnum, list);
+
+			if (unpushed && *unpushed)
+				isonbase(refnum, unpushed, ison_notify);
+			new_free(&unpushed);
+		}
 	    }
 	}
 
@@ -341,7 +357,7 @@ void 	do_notify (void)
 			if (x_debug & DEBUG_NOTIFY)
 			    yell("Notify ISON issued for server [%d] with [%s]" , servnum, s->ison);
 		}
-		else if (NOTIFY_MAX(s))
+		else if (NOTIFY_MAX(s) && s->notify_pushed < NOTIFY_MAX(s))
 		{
 			if (x_debug & DEBUG_NOTIFY)
 				yell("Server [%d]'s notify list is"
@@ -510,6 +526,7 @@ void 	make_notify_list (int refnum)
 		tmp = (NotifyItem *)new_malloc(sizeof(NotifyItem));
 		tmp->nick = malloc_strdup(NOTIFY_ITEM(sp, i)->nick);
 		tmp->flag = 0;
+		tmp->pushed = 0;
 
 		add_to_alist (NOTIFY_LIST(s), tmp->nick, tmp);
 		malloc_strcat_wordlist(&list, space, tmp->nick);
@@ -559,6 +576,331 @@ char *	get_notify_nicks (int refnum, int showon)
 	return (list ? list : malloc_strdup(empty_string));
 }
 
+/***************************************************************************/
+/*
+ * Servers that support MONITOR (IRCv3) or WATCH will tell us on their own
+ * when someone on our notify list signs on or off, so we don't have to 
+ * keep asking with ISON.  As soon as the server's 005 says it can do one
+ * of these, we give it our notify list, and after that we only tell it 
+ * about the nicks that are added or removed.  If the server's list gets
+ * full, the nicks it won't take are ISON'd like before.
+ */
+#define NOTIFY_PUSH_LINE	400	/* How much to put in one command */
+
+/* Tell the server to start (or stop) watching "nicks" */
+static void	notify_push_send (int refnum, int add, const char *nicks)
+{
+	Server *s;
+	char *	line = NULL;
+	char *	copy, *nick;
+
+	if (!(s = get_server(refnum)) || !nicks || !*nicks)
+		return;
+
+	copy = LOCAL_COPY(nicks);
+	while ((nick = next_arg(copy, &copy)))
+	{
+		if (line && strlen(line) + strlen(nick) + 2 > NOTIFY_PUSH_LINE)
+		{
+			send_to_aserver(refnum, "%s", line);
+			new_free(&line);
+		}
+
+		if (s->notify_push == NOTIFY_PUSH_MONITOR)
+		{
+			if (!line)
+				malloc_sprintf(&line, "MONITOR %c %s", 
+						add ? '+' : '-', nick);
+			else
+				malloc_strcat_wordlist(&line, ",", nick);
+		}
+		else
+		{
+			if (!line)
+				malloc_strcpy(&line, "WATCH");
+			malloc_strcat(&line, add ? " +" : " -");
+			malloc_strcat(&line, nick);
+		}
+	}
+
+	if (line)
+		send_to_aserver(refnum, "%s", line);
+	new_free(&line);
+}
+
+/* 
+ * notify_push_add: Have the server watch "item" for us, if it can.
+ * Returns 1 if it is, and 0 if we'll have to ISON it.
+ */
+static int	notify_push_add (int refnum, NotifyItem *item)
+{
+	Server *s;
+
+	if (!(s = get_server(refnum)) || !s->notify_push || item->pushed)
+		return item->pushed;
+	if (s->notify_push_max && s->notify_pushed >= s->notify_push_max)
+		return 0;
+
+	item->pushed = 1;
+	s->notify_pushed++;
+	notify_push_send(refnum, 1, item->nick);
+	return 1;
+}
+
+/* 
+ * notify_push_fill: Give the server as many of the nicks we're ISONing
+ * as it will take (except "skip", which is on its way out)
+ */
+static void	notify_push_fill (int refnum, NotifyItem *skip)
+{
+	Server *s;
+	char *	list = NULL;
+	int	i;
+
+	if (!(s = get_server(refnum)) || !s->notify_push)
+		return;
+
+	for (i = 0; i < NOTIFY_MAX(s); i++)
+	{
+		if (s->notify_push_max && s->notify_pushed >= s->notify_push_max)
+			break;
+		if (NOTIFY_ITEM(s, i)->pushed || NOTIFY_ITEM(s, i) == skip)
+			continue;
+		NOTIFY_ITEM(s, i)->pushed = 1;
+		s->notify_pushed++;
+		malloc_strcat_wordlist(&list, space, NOTIFY_ITEM(s, i)->nick);
+	}
+
+	if (list)
+	{
+		notify_push_send(refnum, 1, list);
+		rebuild_notify_ison(refnum);
+	}
+	new_free(&list);
+}
+
+/* notify_push_remove: "item" is leaving the notify list */
+static void	notify_push_remove (int refnum, NotifyItem *item)
+{
+	Server *s;
+
+	if (!(s = get_server(refnum)) || !item->pushed)
+		return;
+
+	item->pushed = 0;
+	s->notify_pushed--;
+	if (s->notify_push)
+	{
+		notify_push_send(refnum, 0, item->nick);
+		notify_push_fill(refnum, item);
+	}
+}
+
+/* notify_push_clear: The whole notify list is going away */
+static void	notify_push_clear (int refnum)
+{
+	Server *s;
+	int	i;
+
+	if (!(s = get_server(refnum)))
+		return;
+
+	if (s->notify_push && s->notify_pushed)
+	{
+		if (s->notify_push == NOTIFY_PUSH_MONITOR)
+			send_to_aserver(refnum, "MONITOR C");
+		else
+			send_to_aserver(refnum, "WATCH C");
+	}
+
+	for (i = 0; i < NOTIFY_MAX(s); i++)
+		NOTIFY_ITEM(s, i)->pushed = 0;
+	s->notify_pushed = 0;
+}
+
+/* Which of "nicks" does the server *not* watch for us? */
+static char *	notify_unpushed (int refnum, const char *nicks)
+{
+	Server *	s;
+	NotifyItem *	item;
+	char *		copy, *nick;
+	char *		retval = NULL;
+
+	if (!(s = get_server(refnum)))
+		return NULL;
+	if (!s->notify_pushed)
+		return malloc_strdup(nicks);
+
+	copy = LOCAL_COPY(nicks);
+	while ((nick = next_arg(copy, &copy)))
+	{
+		item = (NotifyItem *)alist_lookup(NOTIFY_LIST(s), nick, 0, 0);
+		if (!item || !item->pushed)
+			malloc_strcat_wordlist(&retval, space, nick);
+	}
+	return retval;
+}
+
+/*
+ * notify_push_start: This is called after each 005 from the server.  If it
+ * says it does MONITOR or WATCH (and we're not already using it), hand 
+ * over our notify list.
+ */
+void	notify_push_start (int refnum)
+{
+	Server *	s;
+	const char *	limit;
+
+	if (!(s = get_server(refnum)) || s->notify_push)
+		return;
+
+	if ((limit = get_server_005(refnum, "MONITOR")))
+		s->notify_push = NOTIFY_PUSH_MONITOR;
+	else if ((limit = get_server_005(refnum, "WATCH")))
+		s->notify_push = NOTIFY_PUSH_WATCH;
+	else
+		return;
+
+	s->notify_push_max = atol(limit);
+	if (s->notify_push_max < 0)
+		s->notify_push_max = 0;
+	s->notify_pushed = 0;
+
+	if (x_debug & DEBUG_NOTIFY)
+		yell("Server [%d] will do %s (limit %d) for notify", refnum,
+			s->notify_push == NOTIFY_PUSH_MONITOR ? "MONITOR" : "WATCH",
+			s->notify_push_max);
+
+	notify_push_fill(refnum, NULL);
+}
+
+/* notify_push_stop: We've been disconnected, so go back to using ISON */
+void	notify_push_stop (int refnum)
+{
+	Server *s;
+	int	i;
+
+	if (!(s = get_server(refnum)))
+		return;
+
+	for (i = 0; i < NOTIFY_MAX(s); i++)
+		NOTIFY_ITEM(s, i)->pushed = 0;
+	s->notify_push = NOTIFY_PUSH_NONE;
+	s->notify_push_max = 0;
+	s->notify_pushed = 0;
+	rebuild_notify_ison(refnum);
+}
+
+/* The server told us "nick" (who is "uh") is on irc */
+static void	notify_push_signon (int refnum, const char *nick, const char *uh)
+{
+	Server *s;
+	NotifyItem *tmp;
+
+	if (!(s = get_server(refnum)))
+		return;
+
+	if (!(tmp = (NotifyItem *)alist_lookup(NOTIFY_LIST(s), nick, 0, 0)))
+		return;
+
+	if (tmp->flag != 1)
+		notify_userhost_reply(refnum, nick, uh);
+	tmp->flag = 1;
+}
+
+/* The server can't watch "nick" for us after all */
+static void	notify_push_refused (int refnum, const char *nick)
+{
+	Server *s;
+	NotifyItem *tmp;
+
+	if (!(s = get_server(refnum)))
+		return;
+
+	if ((tmp = (NotifyItem *)alist_lookup(NOTIFY_LIST(s), nick, 0, 0)) && 
+			tmp->pushed)
+	{
+		tmp->pushed = 0;
+		s->notify_pushed--;
+		rebuild_notify_ison(refnum);
+	}
+}
+
+/*
+ * notify_push_reply: This is called for the MONITOR and WATCH numerics.
+ * Returns 1 if it was one of ours (and so the user doesn't need to see it)
+ *
+ *	730 RPL_MONONLINE	:nick!user@host[,nick!user@host...]
+ *	731 RPL_MONOFFLINE	:nick[,nick...]
+ *	734 ERR_MONLISTFULL	limit nick[,nick...] :Monitor list is full
+ *	600 RPL_LOGON		nick user host ts :logged online
+ *	601 RPL_LOGOFF		nick user host ts :logged offline
+ *	602 RPL_WATCHOFF	nick user host ts :stopped watching
+ *	604 RPL_NOWON		nick user host ts :is online
+ *	605 RPL_NOWOFF		nick user host ts :is offline
+ *	512 ERR_TOOMANYWATCH	nick :Maximum size for WATCH-list is N entries
+ */
+int	notify_push_reply (int refnum, int numeric, const char **ArgList)
+{
+	Server *s;
+	char *	nicks;
+	char *	nick;
+	char *	uh;
+	char	buffer[BIG_BUFFER_SIZE + 1];
+
+	if (!(s = get_server(refnum)) || !ArgList[0])
+		return 0;
+
+	if (numeric >= 730)
+	{
+		if (s->notify_push != NOTIFY_PUSH_MONITOR)
+			return 0;
+
+		if (numeric == 734)
+		{
+			if (!ArgList[1])
+				return 0;
+			nicks = LOCAL_COPY(ArgList[1]);
+		}
+		else
+			nicks = LOCAL_COPY(ArgList[0]);
+
+		while (nicks && *nicks)
+		{
+			if (!*(nick = next_in_comma_list(nicks, &nicks)))
+				continue;
+			if ((uh = strchr(nick, '!')))
+				*uh++ = 0;
+
+			if (numeric == 730)
+				notify_push_signon(refnum, nick, uh);
+			else if (numeric == 731)
+				notify_mark(refnum, nick, 0, 1);
+			else
+				notify_push_refused(refnum, nick);
+		}
+		return 1;
+	}
+
+	if (s->notify_push != NOTIFY_PUSH_WATCH)
+		return 0;
+
+	nick = LOCAL_COPY(ArgList[0]);
+	if (numeric == 512)
+		notify_push_refused(refnum, nick);
+	else if (!ArgList[1] || !ArgList[2])
+		return 0;
+	else if (numeric == 600 || numeric == 604)
+	{
+		snprintf(buffer, sizeof buffer, "%s@%s", ArgList[1], ArgList[2]);
+		notify_push_signon(refnum, nick, buffer);
+	}
+	else if (numeric == 601 || numeric == 605)
+		notify_mark(refnum, nick, 0, 1);
+
+	return 1;
+}
+
 /***************************************************************************/
 char 	notify_timeref[] = "NOTTIM";
 
@@ -309,6 +309,7 @@ void 	numbered_command (const char *from, const char *comm, char const **ArgList
 			else
 				set_server_005(from_server, set, space);
 		}
+		notify_push_start(from_server);
 		break;
 	}
 
@@ -463,6 +464,22 @@ void 	numbered_command (const char *from, const char *comm, char const **ArgList
 		ison_returned(from_server, from, comm, ArgList);
 		goto END;
 
+	case 600:		/* #define RPL_LOGON		600 */
+	case 601:		/* #define RPL_LOGOFF		601 */
+	case 602:		/* #define RPL_WATCHOFF		602 */
+	case 604:		/* #define RPL_NOWON		604 */
+	case 605:		/* #define RPL_NOWOFF		605 */
+	case 730:		/* #define RPL_MONONLINE	730 */
+	case 731:		/* #define RPL_MONOFFLINE	731 */
+		if (notify_push_reply(from_server, numeric, ArgList))
+			goto END;
+		break;
+
+	case 512:		/* #define ERR_TOOMANYWATCH	512 */
+	case 734:		/* #define ERR_MONLISTFULL	734 */
+		notify_push_reply(from_server, numeric, ArgList);
+		break;
+
 	case 315:		/* #define RPL_ENDOFWHO         315 */
 		who_end(from_server, from, comm, ArgList);
 		goto END;
@@ -629,32 +646,7 @@ void 	numbered_command (const char *from, const char *comm, char const **ArgList
 
 		if (channel_is_syncing(channel, from_server))
 		{
-		    char *line_copy = LOCAL_COPY(line);
-		    char *nick;
-
-		    while ((nick = next_arg(line_copy, &line_copy)) != NULL)
-		    {
-			/*
-			 * XXX If the last nickname on the list ends with \  
-			 * and there is a space after it, that would end up
-			 * in 'nick' here -> trim it.  (This actually happens)
-			 */
-			remove_trailing_spaces(nick, 0);
-
-			/*
-			 * 1999 Oct 29 -- This is a hack to compensate for
-			 * a bug in older ircd implementations that can result
-			 * in a truncated nickname at the end of a names reply.
-			 * The last nickname in a names list is then always
-			 * treated with suspicion until the WHO reply is 
-			 * completed and we know that its not truncated. --esl
-			 */
-			if (!line || !*line)
-				add_to_channel(channel, nick, from_server, 1, 0, 0, 0);
-			else
-				add_to_channel(channel, nick, from_server, 0, 0, 0, 0);
-		    }
-
+		    add_names_to_channel(channel, line, from_server);
 		    break;
 		}
 		else
@@ -1478,7 +1470,9 @@ DISPLAY:
 		if (!(channel = ArgList[0]))
 			{ rfc1459_odd(from, comm, ArgList); goto END; }
 
-		if (!channel_is_syncing(channel, from_server))
+		if (channel_is_syncing(channel, from_server))
+			channel_names_done(channel, from_server);
+		else
 			display_msg(from, comm, ArgList);
 
 		break;
@@ -68,6 +68,9 @@ static	void	strip_modes (const char *, const char *, const char *);
 /* User and host information from server 2.7 */
 const char	*FromUserHost = empty_string;
 
+/* The sender (nick or server) of the message being handled */
+const char	*FromNick = empty_string;
+
 /* CAP tags information */
 const char	*Tags = empty_string;
 
@@ -1524,6 +1527,7 @@ void 	parse_server (const char *orig_line, size_t orig_line_size)
 	const char	**ArgList;
 	const char	*TrueArgs[MAXPARA + 2];	/* Include space for command */
 	const char 	*OldFromUserHost;
+	const char	*OldFromNick;
 	int	loc;
 	char	*line;
 
@@ -1552,19 +1556,25 @@ void 	parse_server (const char *orig_line, size_t orig_line_size)
 	    line = LOCAL_COPY(orig_line);
 
 	OldFromUserHost = FromUserHost;
+	OldFromNick = FromNick;
 	FromUserHost = empty_string;
 	ArgList = TrueArgs;
 	BreakArgs(line, &from, ArgList);
+	FromNick = from ? from : empty_string;
 
 	if ((!(comm = *ArgList++)) || !from || !*ArgList)
 	{ 
 		rfc1459_odd(from, comm, ArgList);
+		FromUserHost = OldFromUserHost;
+		FromNick = OldFromNick;
 		return;		/* Serious protocol violation -- ByeBye */
 	}
 
 	if (*from && !islegal(*from))
 	{ 
 		rfc1459_odd(from, comm, ArgList);
+		FromUserHost = OldFromUserHost;
+		FromNick = OldFromNick;
 		return;		
 	}
 
@@ -1584,6 +1594,7 @@ void 	parse_server (const char *orig_line, size_t orig_line_size)
 	}
 
 	FromUserHost = OldFromUserHost;
+	FromNick = OldFromNick;
 	from_server = -1;
 }
 
@@ -0,0 +1,399 @@
+/*
+ * profiler.c -- Where did all my cpu go?
+ *
+ * Copyright 2026 EPIC Software Labs
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. All redistributions, whether of source code or in binary form must
+ *    retain the the above copyright notice, the above paragraph (the one
+ *    permitting redistribution), this list of conditions, and the following
+ *    disclaimer.
+ * 2. The names of the author(s) may not be used to endorse or promote 
+ *    products derived from this software without specific prior written
+ *    permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS ``AS IS'' AND ANY EXPRESS OR 
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES 
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY DIRECT, INDIRECT, 
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, 
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED 
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY 
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF 
+ * SUCH DAMAGE.
+ */
+#include "irc.h"
+#include "ircaux.h"
+#include "alist.h"
+#include "alias.h"
+#include "output.h"
+#include "functions.h"
+#include "reg.h"
+#include "profiler.h"
+
+/*
+ * The profiler keeps track of every alias, /ON, and function call
+ * while it's turned on.  For each thing it counts how many times it
+ * was called, how much wall time was spent in it (both "inclusive",
+ * which counts whatever it called, and "exclusive", which doesn't), and
+ * how many times new_malloc() was called while it was running.
+ *
+ * It also keeps the exclusive time for each distinct call stack it 
+ * sees, so $profilerctl(DUMP file) can write out the "collapsed stack"
+ * format that flamegraph.pl and friends want.
+ *
+ * Everything in here is dead weight when the profiler is off; the
+ * PROFILE_ENTER() macro checks ``profiling'' before calling us.
+ */
+typedef struct ProfileEntryStru
+{
+	char *	name;		/* "type:NAME" */
+	char *	filename;	/* Where it was loaded, or NULL */
+	intmax_t calls;		/* How many times it was called */
+	double	inclusive;	/* Seconds spent here and in callees */
+	double	exclusive;	/* Seconds spent only here */
+	intmax_t allocations;	/* new_malloc()s done only here */
+	int	active;		/* How many frames are running it */
+} ProfileEntry;
+
+typedef struct ProfileFrameStru
+{
+	ProfileEntry *entry;
+	Timeval	start;		/* When this frame started */
+	double	children;	/* Seconds spent in our callees */
+	intmax_t start_allocs;	/* new_malloc_count when we started */
+	intmax_t child_allocs;	/* new_malloc()s done by our callees */
+	int	hook_body;	/* An /ON whose body hasn't started yet */
+} ProfileFrame;
+
+typedef struct ProfileStackStru
+{
+	double	exclusive;	/* Seconds spent at the top of this stack */
+} ProfileStack;
+
+static const char *profile_types[] = { "alias", "function", "on", "builtin" };
+
+	int		profiling = 0;
+static	alist		profile_entries = { NULL, 0, 0, strncmp, HASH_SENSITIVE };
+static	alist		profile_stacks = { NULL, 0, 0, strncmp, HASH_SENSITIVE };
+static	ProfileFrame *	frames = NULL;
+static	int		frames_size = 0;
+static	int		frames_depth = 0;
+
+static ProfileEntry *	find_profile_entry (const char *key)
+{
+	ProfileEntry *	e;
+	int		cnt, loc;
+
+	e = find_alist_item(&profile_entries, key, &cnt, &loc);
+	if (cnt < 0)
+		return e;
+	return NULL;
+}
+
+static ProfileEntry *	get_profile_entry (int type, const char *name, const char *filename)
+{
+	ProfileEntry *	e;
+	char *		key;
+
+	key = alloca(strlen(profile_types[type]) + strlen(name) + 2);
+	sprintf(key, "%s:%s", profile_types[type], name);
+
+	if ((e = find_profile_entry(key)))
+		return e;
+
+	e = new_malloc(sizeof(ProfileEntry));
+	e->name = malloc_strdup(key);
+	if (!filename && (type == PROFILE_ALIAS || type == PROFILE_FUNCTION))
+		filename = get_cmd_alias_package(name);
+	e->filename = filename && *filename ? malloc_strdup(filename) : NULL;
+	e->calls = 0;
+	e->inclusive = e->exclusive = 0;
+	e->allocations = 0;
+	e->active = 0;
+	add_to_alist(&profile_entries, e->name, e);
+	return e;
+}
+
+/*
+ * profile_enter -- Something is about to be run.
+ * Returns 1 if we started a new frame, and you must call profile_leave()
+ * when it's done; returns 0 if you must not.
+ */
+int	profile_enter (int type, const char *name, const char *filename)
+{
+	ProfileFrame *f;
+
+	if (!profiling || !name)
+		return 0;
+
+	/*
+	 * An /ON runs its body through call_user_command(), which would
+	 * otherwise show up as a second frame named after the event.
+	 */
+	if (frames_depth > 0 && frames[frames_depth - 1].hook_body &&
+	    (type == PROFILE_ALIAS || type == PROFILE_FUNCTION))
+	{
+		frames[frames_depth - 1].hook_body = 0;
+		return 0;
+	}
+
+	if (frames_depth >= frames_size)
+	{
+		frames_size = frames_size ? frames_size * 2 : 32;
+		RESIZE(frames, ProfileFrame, frames_size);
+	}
+
+	f = &frames[frames_depth++];
+	f->entry = get_profile_entry(type, name, filename);
+	f->entry->calls++;
+	f->entry->active++;
+	f->children = 0;
+	f->child_allocs = 0;
+	f->hook_body = (type == PROFILE_HOOK);
+	f->start_allocs = new_malloc_count;
+	get_time(&f->start);
+	return 1;
+}
+
+static void	add_profile_stack (double exclusive)
+{
+	ProfileStack *	s;
+	char *		key = NULL;
+	int		i, cnt, loc;
+
+	for (i = 0; i < frames_depth; i++)
+	{
+		if (i > 0)
+			malloc_strcat(&key, ";");
+		malloc_strcat(&key, frames[i].entry->name);
+	}
+
+	s = find_alist_item(&profile_stacks, key, &cnt, &loc);
+	if (cnt >= 0)
+	{
+		s = new_malloc(sizeof(ProfileStack));
+		s->exclusive = 0;
+		add_to_alist(&profile_stacks, key, s);
+	}
+	s->exclusive += exclusive;
+	new_free(&key);
+}
+
+void	profile_leave (void)
+{
+	ProfileFrame *	f;
+	Timeval		now;
+	double		elapsed, exclusive;
+	intmax_t	allocs;
+
+	if (frames_depth <= 0)
+		return;
+
+	get_time(&now);
+	f = &frames[frames_depth - 1];
+	elapsed = time_diff(f->start, now);
+	exclusive = elapsed - f->children;
+	allocs = new_malloc_count - f->start_allocs;
+
+	f->entry->exclusive += exclusive;
+	f->entry->allocations += allocs - f->child_allocs;
+
+	/* Recursive calls are only counted once for inclusive time */
+	if (--f->entry->active == 0)
+		f->entry->inclusive += elapsed;
+
+	add_profile_stack(exclusive);
+
+	frames_depth--;
+	if (frames_depth > 0)
+	{
+		frames[frames_depth - 1].children += elapsed;
+		frames[frames_depth - 1].child_allocs += allocs;
+	}
+}
+
+/*
+ * This can be done while frames are running (it usually will be, since
+ * you call $profilerctl() from a script), so we only clear out the
+ * numbers, and don't throw away any of the entries.
+ */
+static void	reset_profile (void)
+{
+	ProfileEntry *	e;
+	ProfileStack *	s;
+	int		i;
+
+	for (i = 0; i < profile_entries.max; i++)
+	{
+		e = profile_entries.list[i]->data;
+		e->calls = 0;
+		e->inclusive = e->exclusive = 0;
+		e->allocations = 0;
+	}
+
+	while (profile_stacks.max > 0)
+	{
+		s = alist_pop(&profile_stacks, profile_stacks.max - 1);
+		new_free(&s);
+	}
+}
+
+/*
+ * Write out every call stack we've seen in the "collapsed stack" format
+ *	alias:FOO;on:PUBLIC#3;builtin:MATCH 1234
+ * where the number is microseconds spent at the top of that stack.
+ */
+static int	dump_profile (const char *filename)
+{
+	Filename	real_filename;
+	FILE *		fp;
+	ProfileStack *	s;
+	int		i, count = 0;
+
+	if (normalize_filename(filename, real_filename))
+	{
+		say("PROFILER: %s contains an invalid path", filename);
+		return -1;
+	}
+
+	if (!(fp = fopen(real_filename, "w")))
+	{
+		say("PROFILER: Couldn't open %s: %s", real_filename, 
+							strerror(errno));
+		return -1;
+	}
+
+	for (i = 0; i < profile_stacks.max; i++)
+	{
+		s = profile_stacks.list[i]->data;
+		fprintf(fp, "%s %jd\n", profile_stacks.list[i]->name, 
+				(intmax_t)(s->exclusive * 1000000));
+		count++;
+	}
+
+	fclose(fp);
+	return count;
+}
+
+/*
+ * $profilerctl() arguments:
+ *   START
+ *	- Start profiling.  Numbers from before are kept.
+ *   STOP
+ *	- Stop profiling.  Numbers are kept.
+ *   RESET
+ *	- Throw away all the numbers.
+ *   STATUS
+ *	- Returns 1 if the profiler is on, 0 if it is off.
+ *   LIST [<pattern>]
+ *	- Returns the name of everything that has been profiled, such as
+ *	  "alias:FOO", "function:BAR", "on:PUBLIC#3" or "builtin:MATCH".
+ *   GET <name>
+ *	- Returns "<calls> <inclusive> <exclusive> <allocations> <file>"
+ *	  The times are in seconds. <file> is "*" if it isn't known.
+ *   FILES
+ *	- Returns every file that has something that has been profiled.
+ *   FILE <filename>
+ *	- Returns "<calls> <exclusive> <allocations>" added up for 
+ *	  everything that was loaded from <filename>.
+ *   DUMP <filename>
+ *	- Writes a collapsed-stack file suitable for flamegraph.pl and
+ *	  returns the number of stacks written (-1 on error).
+ */
+char *	profilerctl (char *input)
+{
+	char *		listc;
+	size_t		len;
+	ProfileEntry *	e;
+	int		i;
+
+	GET_FUNC_ARG(listc, input);
+	len = strlen(listc);
+
+	if (!my_strnicmp(listc, "START", len)) {
+		profiling = 1;
+		RETURN_INT(profiling);
+	} else if (!my_strnicmp(listc, "STOP", len)) {
+		profiling = 0;
+		RETURN_INT(profiling);
+	} else if (!my_strnicmp(listc, "STATUS", len)) {
+		RETURN_INT(profiling);
+	} else if (!my_strnicmp(listc, "RESET", len)) {
+		reset_profile();
+		RETURN_INT(1);
+	} else if (!my_strnicmp(listc, "LIST", len)) {
+		char *	retval = NULL;
+
+		for (i = 0; i < profile_entries.max; i++)
+		{
+			e = profile_entries.list[i]->data;
+			if (!e->calls)
+				continue;
+			if (*input && !wild_match(input, e->name))
+				continue;
+			malloc_strcat_word(&retval, space, e->name, DWORD_NO);
+		}
+		RETURN_MSTR(retval);
+	} else if (!my_strnicmp(listc, "GET", len)) {
+		GET_FUNC_ARG(listc, input);
+		if (!(e = find_profile_entry(listc)))
+			RETURN_EMPTY;
+
+		return malloc_sprintf(NULL, "%jd %f %f %jd %s", e->calls,
+				e->inclusive, e->exclusive, e->allocations, 
+				e->filename ? e->filename : star);
+	} else if (!my_strnicmp(listc, "FILE", len)) {
+		/* Before FILES, so that "FILE" isn't taken as "FILES" */
+		intmax_t	calls = 0, allocations = 0;
+		double		exclusive = 0;
+
+		GET_FUNC_ARG(listc, input);
+		for (i = 0; i < profile_entries.max; i++)
+		{
+			e = profile_entries.list[i]->data;
+			if (!e->filename || strcmp(e->filename, listc))
+				continue;
+			calls += e->calls;
+			exclusive += e->exclusive;
+			allocations += e->allocations;
+		}
+		return malloc_sprintf(NULL, "%jd %f %jd", calls, exclusive, 
+							allocations);
+	} else if (!my_strnicmp(listc, "FILES", len)) {
+		char *	retval = NULL;
+		ProfileEntry *	other;
+		int	j;
+
+		for (i = 0; i < profile_entries.max; i++)
+		{
+			e = profile_entries.list[i]->data;
+			if (!e->calls || !e->filename)
+				continue;
+
+			/* Only mention each file once */
+			for (j = 0; j < i; j++)
+			{
+				other = profile_entries.list[j]->data;
+				if (other->calls && other->filename && 
+					!strcmp(other->filename, e->filename))
+					break;
+			}
+			if (j < i)
+				continue;
+
+			malloc_strcat_word(&retval, space, e->filename, DWORD_NO);
+		}
+		RETURN_MSTR(retval);
+	} else if (!my_strnicmp(listc, "DUMP", len)) {
+		GET_FUNC_ARG(listc, input);
+		RETURN_INT(dump_profile(listc));
+	}
+
+	RETURN_EMPTY;
+}
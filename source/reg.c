@@ -52,6 +52,7 @@
 #include "irc.h"
 #include "ircaux.h"
 #include "output.h"
+#include "functions.h"
 #include "reg.h"
 
 static	int	total_explicit;
@@ -505,6 +506,199 @@ static int new_match (const char *pattern, const char *string)
 	return 0;
 }
 
+static int	wild_match_uncached (const char *p, const char *str);
+
+/*
+ * The same few patterns tend to be matched against lots and lots of strings
+ * (/ON hooks, ignores, $match() and $pattern() over a word list), so 
+ * wild_match() keeps the last WILD_CACHE_SIZE patterns it saw "compiled":
+ *   - A pattern with no wildcards, or just *'s at the start and/or end
+ *     ("foo", "foo*", "*foo", "*foo*") is handled right here, without
+ *     new_match(), since its value is always the same if it matches.
+ *   - Otherwise, a string can't match unless it starts with the plain
+ *     chars before the first wildcard, ends with the ones after the last
+ *     wildcard, and has all the plain chars in between, in order.  So we
+ *     check that before we bother with new_match().
+ * Patterns with a \\ in them don't get any of this.
+ */
+#define WILD_CACHE_SIZE		128
+#define WILD_CACHE_BUCKETS	256
+
+#define WILD_LITERAL	0		/* "foo" */
+#define WILD_PREFIX	1		/* "foo*" */
+#define WILD_SUFFIX	2		/* "*foo" */
+#define WILD_SUBSTRING	3		/* "*foo*" */
+#define WILD_GENERIC	4		/* Anything else */
+#define WILD_QUOTED	5		/* Has a \\ in it */
+
+typedef struct	WildPatternStru
+{
+	char *		pattern;	/* The pattern (our own copy) */
+	uint32_t	hashval;	/* Hash of the pattern */
+	int		kind;		/* WILD_LITERAL, WILD_PREFIX, etc */
+	const char *	lit;		/* The plain chars (for the above) */
+	size_t		litlen;		/* How many plain chars there are */
+	size_t		headlen;	/* Plain chars at the start */
+	size_t		taillen;	/* Plain chars at the end */
+	int		weight;		/* What we return if it matches */
+struct	WildPatternStru *hash_next;
+struct	WildPatternStru *lru_prev;	/* Used more recently */
+struct	WildPatternStru *lru_next;	/* Used less recently */
+}	WildPattern;
+
+static	WildPattern	wild_cache[WILD_CACHE_SIZE];
+static	WildPattern *	wild_buckets[WILD_CACHE_BUCKETS];
+static	WildPattern *	wild_lru_head = NULL;
+static	WildPattern *	wild_lru_tail = NULL;
+static	int		wild_cache_used = 0;
+
+static uint32_t	wild_hash (const char *p)
+{
+	uint32_t h = 2166136261U;
+
+	for (; *p; p++)
+		h = (h ^ (unsigned char)*p) * 16777619U;
+	return h;
+}
+
+/* Fill in "wp" for its pattern */
+static void	compile_wild_pattern (WildPattern *wp)
+{
+	const char *p = wp->pattern;
+	size_t	len, lead, trail;
+
+	len = strlen(p);
+	wp->lit = p;
+	wp->litlen = len;
+	wp->headlen = wp->taillen = 0;
+	wp->kind = WILD_QUOTED;
+
+	if (strchr(p, '\\'))
+		return;
+	wp->kind = WILD_GENERIC;
+
+	for (lead = 0; p[lead] == '*'; lead++)
+		;
+	for (trail = 0; trail < len - lead && p[len - 1 - trail] == '*'; trail++)
+		;
+
+	if (strcspn(p + lead, "*%?") >= len - lead - trail)
+	{
+		wp->lit = p + lead;
+		wp->litlen = len - lead - trail;
+		wp->weight = (int)wp->litlen + 1;
+
+		if (!lead && !trail)
+			wp->kind = WILD_LITERAL;
+		else if (!lead)
+			wp->kind = WILD_PREFIX;
+		else if (!trail && wp->litlen)
+			wp->kind = WILD_SUFFIX;
+		else
+			wp->kind = WILD_SUBSTRING;
+		return;
+	}
+
+	wp->headlen = strcspn(p, "*%?");
+	for (trail = 0; trail < len; trail++)
+		if (strchr("*%?", p[len - 1 - trail]))
+			break;
+	wp->taillen = trail;
+}
+
+/* Find (or compile) the pattern "p" and make it the most recently used */
+static WildPattern *	get_wild_pattern (const char *p)
+{
+	WildPattern *wp, **ptr;
+	uint32_t hashval;
+
+	hashval = wild_hash(p);
+	for (wp = wild_buckets[hashval % WILD_CACHE_BUCKETS]; wp; wp = wp->hash_next)
+		if (wp->hashval == hashval && !strcmp(wp->pattern, p))
+			break;
+
+	if (!wp)
+	{
+		/* Use a new one if we have it, otherwise the least recent */
+		if (wild_cache_used < WILD_CACHE_SIZE)
+			wp = &wild_cache[wild_cache_used++];
+		else
+		{
+			wp = wild_lru_tail;
+			ptr = &wild_buckets[wp->hashval % WILD_CACHE_BUCKETS];
+			for (; *ptr; ptr = &(*ptr)->hash_next)
+			{
+				if (*ptr == wp)
+				{
+					*ptr = wp->hash_next;
+					break;
+				}
+			}
+
+			wild_lru_tail = wp->lru_prev;
+			wild_lru_tail->lru_next = NULL;
+			wp->lru_prev = wp->lru_next = NULL;
+		}
+
+		malloc_strcpy(&wp->pattern, p);
+		wp->hashval = hashval;
+		compile_wild_pattern(wp);
+		wp->hash_next = wild_buckets[hashval % WILD_CACHE_BUCKETS];
+		wild_buckets[hashval % WILD_CACHE_BUCKETS] = wp;
+	}
+	else if (wp == wild_lru_head)
+		return wp;
+	else
+	{
+		wp->lru_prev->lru_next = wp->lru_next;
+		if (wp->lru_next)
+			wp->lru_next->lru_prev = wp->lru_prev;
+		else
+			wild_lru_tail = wp->lru_prev;
+	}
+
+	wp->lru_prev = NULL;
+	wp->lru_next = wild_lru_head;
+	if (wild_lru_head)
+		wild_lru_head->lru_prev = wp;
+	wild_lru_head = wp;
+	if (!wild_lru_tail)
+		wild_lru_tail = wp;
+	return wp;
+}
+
+/* Does "str" start with the "len" chars in "lit" (ignoring case)? */
+static int	wild_prefix (const char *lit, size_t len, const char *str)
+{
+	size_t	i;
+
+	for (i = 0; i < len; i++)
+		if (!str[i] || tolower(lit[i]) != tolower(str[i]))
+			return 0;
+	return 1;
+}
+
+/* Where is the first "len" chars of "lit" in "str" (ignoring case)? */
+static const char *	wild_substring (const char *lit, size_t len, const char *str)
+{
+	char	first[3];
+
+	if (len == 0)
+		return str;
+
+	/* Let strpbrk() (or strchr()) look for the first char */
+	first[0] = tolower(lit[0]);
+	first[1] = toupper(lit[0]);
+	first[2] = 0;
+	if (first[0] == first[1])
+		first[1] = 0;
+
+	for (; (str = strpbrk(str, first)); str++)
+		if (wild_prefix(lit, len, str))
+			return str;
+	return NULL;
+}
+
 /*
  * wild_match: calculate the "value" of str when matched against pattern.
  * The "value" of a string is always zero if it is not matched by the pattern.
@@ -514,6 +708,68 @@ static int new_match (const char *pattern, const char *string)
  * \\[ and \\] handling is an epic extension.
  */
 int wild_match (const char *p, const char *str)
+{
+	WildPattern *wp;
+	size_t	slen, runlen;
+	const char *pp, *s;
+
+	if (x_debug & (DEBUG_REGEX | DEBUG_REGEX_DEBUG))
+		return wild_match_uncached(p, str);
+
+	wp = get_wild_pattern(p);
+	switch (wp->kind)
+	{
+	    case WILD_LITERAL:
+		if (wild_prefix(wp->lit, wp->litlen, str) && !str[wp->litlen])
+			return wp->weight;
+		return 0;
+
+	    case WILD_PREFIX:
+		if (wild_prefix(wp->lit, wp->litlen, str))
+			return wp->weight;
+		return 0;
+
+	    case WILD_SUFFIX:
+		slen = strlen(str);
+		if (slen >= wp->litlen && 
+		    wild_prefix(wp->lit, wp->litlen, str + slen - wp->litlen))
+			return wp->weight;
+		return 0;
+
+	    case WILD_SUBSTRING:
+		if (wild_substring(wp->lit, wp->litlen, str))
+			return wp->weight;
+		return 0;
+	}
+
+	if (wp->kind == WILD_QUOTED)
+		return wild_match_uncached(p, str);
+
+	/* Not a simple one -- at least see if it could possibly match. */
+	if (wp->headlen && !wild_prefix(wp->pattern, wp->headlen, str))
+		return 0;
+	if (wp->taillen)
+	{
+		slen = strlen(str);
+		if (slen < wp->taillen || !wild_prefix(wp->pattern + 
+				strlen(wp->pattern) - wp->taillen, 
+				wp->taillen, str + slen - wp->taillen))
+			return 0;
+	}
+	for (pp = wp->pattern, s = str; *pp; pp += runlen)
+	{
+		pp += strspn(pp, "*%?");
+		if (!(runlen = strcspn(pp, "*%?")))
+			break;
+		if (!(s = wild_substring(pp, runlen, s)))
+			return 0;
+		s += runlen;
+	}
+
+	return wild_match_uncached(p, str);
+}
+
+static int	wild_match_uncached (const char *p, const char *str)
 {
 	total_explicit = 0;
 
@@ -593,7 +849,7 @@ int wild_match (const char *p, const char *str)
 				 * The total_explicit we return is whatever
 				 * sub-pattern has the highest total_explicit
 				 */
-				if ((tmpval = wild_match(my_buff, str)))
+				if ((tmpval = wild_match_uncached(my_buff, str)))
 				{
 					if (tmpval > best_total)
 						best_total = tmpval;
@@ -767,3 +1023,145 @@ char *	pattern2regex (const char *pattern, int *weight)
 	return retval;
 }
 
+
+
+/*
+ * /LASTLOG -REGEX, /WINDOW SEARCH_BACK and friends used to regcomp() their
+ * regex every time they were called and regfree() it right after, which
+ * adds up when a script does it in a loop.  So compiled regexes are kept
+ * here, keyed by the regex and its cflags, and the least recently used one
+ * is thrown away once we have more than REGEX_CACHE_SIZE.
+ *
+ * get_regex() hands back a regex_t that you must give back to release_regex()
+ * when you're done with it (instead of calling regfree()).  A regex that
+ * somebody is still using is never thrown away, so it's safe to hold on to
+ * one while you do things that might call get_regex() themselves.
+ */
+#define REGEX_CACHE_SIZE	32
+
+typedef struct	RegexCacheStru
+{
+	regex_t		preg;		/* Must be first -- see release_regex */
+	char *		regex;		/* The regex (our own copy) */
+	int		cflags;		/* What it was compiled with */
+	uint32_t	hashval;	/* wild_hash() of the regex */
+	int		refs;		/* How many people are using it now */
+	unsigned long	last_used;	/* For throwing away the oldest */
+struct	RegexCacheStru *next;
+}	RegexCache;
+
+static	RegexCache *	regex_cache = NULL;
+static	int		regex_cache_count = 0;
+static	unsigned long	regex_cache_clock = 0;
+static	unsigned long	regex_cache_hits = 0;
+static	unsigned long	regex_cache_misses = 0;
+
+/* Throw away unused regexes, oldest first, until we're down to "max" */
+static void	trim_regex_cache (int max)
+{
+	RegexCache *rc, **ptr, **oldest;
+
+	while (regex_cache_count > max)
+	{
+		oldest = NULL;
+		for (ptr = &regex_cache; *ptr; ptr = &(*ptr)->next)
+			if ((*ptr)->refs == 0 && 
+			    (!oldest || (*ptr)->last_used < (*oldest)->last_used))
+				oldest = ptr;
+
+		if (!oldest)
+			return;		/* Everybody's busy */
+
+		rc = *oldest;
+		*oldest = rc->next;
+		regex_cache_count--;
+		regfree(&rc->preg);
+		new_free(&rc->regex);
+		new_free((char **)&rc);
+	}
+}
+
+/*
+ * Return a compiled "regex" (using "cflags").  If it doesn't compile, 
+ * the reason is put in "errbuf" and NULL is returned.
+ */
+regex_t *	get_regex (const char *regex, int cflags, char *errbuf, size_t errlen)
+{
+	RegexCache *rc;
+	uint32_t hashval;
+	int	errcode;
+
+	hashval = wild_hash(regex);
+	for (rc = regex_cache; rc; rc = rc->next)
+		if (rc->hashval == hashval && rc->cflags == cflags && 
+				!strcmp(rc->regex, regex))
+			break;
+
+	if (rc)
+		regex_cache_hits++;
+	else
+	{
+		regex_cache_misses++;
+		rc = (RegexCache *)new_malloc(sizeof(*rc));
+		memset(&rc->preg, 0, sizeof(rc->preg));
+		if ((errcode = regcomp(&rc->preg, regex, cflags)))
+		{
+			if (errbuf && errlen)
+				regerror(errcode, &rc->preg, errbuf, errlen);
+			new_free((char **)&rc);
+			return NULL;
+		}
+
+		rc->regex = malloc_strdup(regex);
+		rc->cflags = cflags;
+		rc->hashval = hashval;
+		rc->refs = 0;
+		rc->next = regex_cache;
+		regex_cache = rc;
+		regex_cache_count++;
+	}
+
+	rc->refs++;
+	rc->last_used = ++regex_cache_clock;
+	trim_regex_cache(REGEX_CACHE_SIZE);
+	return &rc->preg;
+}
+
+/* You're done with something you got from get_regex() */
+void	release_regex (regex_t *preg)
+{
+	RegexCache *rc = (RegexCache *)preg;
+
+	if (!preg)
+		return;
+	if (rc->refs > 0)
+		rc->refs--;
+	trim_regex_cache(REGEX_CACHE_SIZE);
+}
+
+/*
+ * $regexctl() arguments:
+ *   STATS
+ *	- Returns "<hits> <misses> <cached>" for the compiled regex cache.
+ *   FLUSH
+ *	- Throws away every cached regex nobody is using right now.
+ *	  Returns how many are left.
+ */
+char *	regexctl (char *input)
+{
+	char *	listc;
+	size_t	len;
+
+	GET_FUNC_ARG(listc, input);
+	len = strlen(listc);
+
+	if (!my_strnicmp(listc, "STATS", len)) {
+		return malloc_sprintf(NULL, "%lu %lu %d", regex_cache_hits,
+				regex_cache_misses, regex_cache_count);
+	} else if (!my_strnicmp(listc, "FLUSH", len)) {
+		trim_regex_cache(0);
+		RETURN_INT(regex_cache_count);
+	}
+
+	RETURN_EMPTY;
+}
@@ -64,6 +64,7 @@
 #include "commands.h"
 #include "parse.h"
 #include "newio.h"
+#include "history.h"
 #include <sys/ioctl.h>
 
 #define CURRENT_WSERV_VERSION	4
@@ -3292,8 +3293,12 @@ static void 	add_to_window (int window_, const char *str)
 		rewriter = get_window_log_rewrite(window_);
 	if (get_window_log_mangle(window_))
 		mangler = get_window_log_mangle(window_);
-	add_to_log(0, get_window_log_fp(window_), window_, str, mangler, rewriter);
-	add_to_logs(window_, from_server, get_who_from(), get_who_level(), str);
+	/* Lines being replayed from the history are already logged */
+	if (!history_replaying)
+	{
+		add_to_log(0, get_window_log_fp(window_), window_, str, mangler, rewriter);
+		add_to_logs(window_, from_server, get_who_from(), get_who_level(), str);
+	}
 	refnum = add_to_lastlog(window_, str);
 
 	/* Add to scrollback + display... */
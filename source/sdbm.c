@@ -11,6 +11,10 @@
  * Note: I didn't change anything!  I swear! ;-)  It is my fervent hope that
  *       files created by this file are compatable with the sdbm support in
  *       perl and apache.  The files are probably not compatable with ndbm.
+ * Note: Later I did change things: pages are now cached and written back
+ *	 lazily (sdbm_sync()), the directory is kept in memory, stores can
+ *	 be batched (sdbm_bulk()), and new databases may use bigger pages.
+ *	 Databases with the default page size are still compatable.
  */
 #include <fcntl.h>
 #include "irc.h"
@@ -18,12 +22,48 @@
 #include "sdbm.h"
 
 #define DBLKSIZ 4096
-#define PBLKSIZ 1024
-#define PAIRMAX 1008			/* arbitrary on PBLKSIZ-N */
+#define PBLKSIZ 1024			/* page size of existing databases */
+#define PBLKMAX 32768			/* page offsets are shorts */
+#define PAIROVH	16			/* PAIRMAX is PBLKSIZ less this */
 #define SPLTMAX	10			/* maximum allowed splits */
 					/* for a single insertion */
+#define CACHDEF	1024			/* default pages kept in memory */
+#define CACHMIN	4			/* makroom needs a few pinned */
+#define CACHMAX	(64 * 1024 * 1024)	/* most bytes of pages to cache */
+#define BULKMAX	(16 * 1024 * 1024)	/* flush bulk inserts this often */
 #define DIRFEXT	".dir"
 #define PAGFEXT	".pag"
+#define SIZFEXT	".siz"
+
+/*
+ * A page in the page cache.  The cache is a fixed number of slots kept
+ * in LRU order (MRU at the head), with a small hash table on the page
+ * number to find them.  A slot's buffer is only allocated the first
+ * time the slot is used.  Dirty pages are written back when they are
+ * evicted, or by sdbm_sync().
+ */
+struct sdbm_page {
+	long	bno;			/* page number, -1 if unused */
+	int	dirty;			/* needs to be written back */
+	int	hnext;			/* next slot in this hash chain */
+	int	prev;			/* LRU list */
+	int	next;
+	char *	buf;			/* pagsiz bytes, once used */
+};
+
+/*
+ * A pair queued by sdbm_store() in bulk mode.  The key and value live
+ * in db->arena, back to back.
+ */
+struct sdbm_pending {
+	long		hash;
+	long		order;		/* page number */
+	long		seq;		/* keeps duplicate keys in order */
+	size_t		off;
+	int		ksize;
+	int		vsize;
+	int		flags;
+};
 
 struct SDBM {
 	int dirf;		       /* directory file descriptor */
@@ -36,10 +76,35 @@ struct SDBM {
 	int keyptr;		       /* current key for nextkey */
 	long blkno;		       /* current page to read/write */
 	long pagbno;		       /* current page in pagbuf */
-	char pagbuf[PBLKSIZ];	       /* page file block buffer */
-	long dirbno;		       /* current block in dirbuf */
-	char dirbuf[DBLKSIZ];	       /* directory file block buffer */
+	char *pagbuf;		       /* current page (a cache slot) */
 	int  error;			/* Errno value */
+
+	int  pagsiz;			/* page size of this database */
+	int  pairmax;			/* largest key+value that fits */
+	long npages;			/* pages in the file, incl. dirty */
+	char *scratch;			/* pagsiz bytes for splpage */
+
+	struct sdbm_page *cache;	/* the page cache */
+	int  ncache;			/* number of slots */
+	int  nused;			/* slots handed out so far */
+	int *hash;			/* hash heads, hsize entries */
+	int  hsize;			/* power of two */
+	int  mru;			/* LRU list head */
+	int  lru;			/* LRU list tail */
+	int  cur;			/* slot holding pagbuf, or -1 */
+
+	char *dirbuf;			/* the whole directory bitmap */
+	long dirsiz;			/* bytes allocated in dirbuf */
+	long dirlo;			/* dirty directory blocks, */
+	long dirhi;			/*  or -1 if none */
+
+	int  bulk;			/* queue stores until sync */
+	struct sdbm_pending *pending;
+	long npending;
+	long maxpending;
+	char *arena;
+	size_t arenalen;
+	size_t arenasiz;
 };
 
 #define DBM_RDONLY	0x1	       /* data base open read-only */
@@ -52,22 +117,29 @@ struct SDBM {
 
 #define BYTESIZ		8
 
-static	SDBM *	sdbm__prep 	(char *, char *, int, int);
-static	int	sdbm__fitpair 	(char *, int);
-static	void	sdbm__putpair 	(char *, Datum, Datum);
-static	Datum	sdbm__getpair 	(char *, Datum);
-static	int	sdbm__delpair 	(char *, Datum);
-static	int	sdbm__chkpage 	(char *);
-static	Datum	sdbm__getnkey 	(char *, int);
-static	void	sdbm__splpage 	(char *, char *, long);
-static	int	sdbm__duppair 	(char *, Datum);
+static	SDBM *	sdbm__prep 	(char *, char *, char *, int, int, int);
+static	int	sdbm__fitpair 	(char *, int, int);
+static	void	sdbm__putpair 	(char *, int, Datum, Datum);
+static	Datum	sdbm__getpair 	(char *, int, Datum);
+static	int	sdbm__delpair 	(char *, int, Datum);
+static	int	sdbm__chkpage 	(char *, int);
+static	Datum	sdbm__getnkey 	(char *, int, int);
+static	void	sdbm__splpage 	(SDBM *, char *, char *, long);
+static	int	sdbm__duppair 	(char *, int, Datum);
 static 	long	sdbm__hash	(const char *str, int len);
 static 	int 	sdbm__getdbit 	(SDBM *, long);
 static 	int 	sdbm__setdbit 	(SDBM *, long);
+static 	long 	sdbm__walk 	(SDBM *, long);
 static 	int 	sdbm__getpage 	(SDBM *, long);
 static 	Datum 	sdbm__getnext 	(SDBM *);
 static 	int 	sdbm__makroom	(SDBM *, long, int);
-static 	int 	sdbm__seepair 	(char *, int, const char *, int);
+static 	int 	sdbm__seepair 	(char *, int, int, const char *, int);
+static	int	sdbm__store	(SDBM *, Datum, Datum, int);
+static	int	sdbm__flush	(SDBM *);
+static	int	sdbm__slot	(SDBM *, long, int, int);
+static	int	sdbm__writeback	(SDBM *);
+static	int	sdbm__newcache	(SDBM *, int);
+static	void	sdbm__dirty	(SDBM *, int);
 
 /*
  * useful macros
@@ -75,9 +147,10 @@ static 	int 	sdbm__seepair 	(char *, int, const char *, int);
 #define bad(x)		((x).dptr == NULL || (x).dsize <= 0)
 #define exhash(item)	sdbm__hash((item).dptr, (item).dsize)
 #define ioerr(db)	((db)->flags |= DBM_IOERR, (db)->error = errno)
+#define pending(db)	((db)->npending ? sdbm__flush(db) : 0)
 
-#define OFF_PAG(xoff)	(long) (xoff) * PBLKSIZ
-#define OFF_DIR(xoff)	(long) (xoff) * DBLKSIZ
+#define OFF_PAG(db, xoff)	(off_t) (xoff) * (db)->pagsiz
+#define OFF_DIR(xoff)	(off_t) (xoff) * DBLKSIZ
 
 static long masks[] = {
 	000000000000, 000000000001, 000000000003, 000000000007,
@@ -93,19 +166,37 @@ static long masks[] = {
 Datum nullitem = {NULL, 0};
 
 SDBM *sdbm_open (const char *file, int flags, int mode)
+{
+	return sdbm_open_pagesize(file, flags, mode, 0);
+}
+
+/*
+ * sdbm_open_pagesize - Like sdbm_open(), but a database created by this
+ * call uses "pagsiz" byte pages instead of the traditional 1024.  Such
+ * databases get a third file (.siz) recording the page size; they cannot
+ * be read by other sdbm implementations.  Existing databases always use
+ * whatever page size they were created with.  Pass 0 for the default.
+ */
+SDBM *sdbm_open_pagesize (const char *file, int flags, int mode, int pagsiz)
 {
 	SDBM *db;
 	char *dirname;
 	char *pagname;
-	int dirlen, paglen;
+	char *sizname;
+	int dirlen, paglen, sizlen;
 
 	if (file == NULL || !*file)
 		return errno = EINVAL, (SDBM *) NULL;
+	if (pagsiz == 0)
+		pagsiz = PBLKSIZ;
+	if (pagsiz < PBLKSIZ || pagsiz > PBLKMAX || (pagsiz & (pagsiz - 1)))
+		return errno = EINVAL, (SDBM *) NULL;
 /*
- * need space for two seperate filenames
+ * need space for three seperate filenames
  */
 	dirlen = strlen(file) + strlen(DIRFEXT) + 1;
 	paglen = strlen(file) + strlen(PAGFEXT) + 1;
+	sizlen = strlen(file) + strlen(SIZFEXT) + 1;
 
 /*
  * build the file names
@@ -119,26 +210,73 @@ SDBM *sdbm_open (const char *file, int flags, int mode)
 		return errno = ENOMEM, (SDBM *) NULL;
 	snprintf(pagname, paglen, "%s%s", file, PAGFEXT);
 
-	db = sdbm__prep(dirname, pagname, flags, mode);
+	if ((sizname = new_malloc(sizlen)) == NULL)
+		return errno = ENOMEM, (SDBM *) NULL;
+	snprintf(sizname, sizlen, "%s%s", file, SIZFEXT);
+
+	db = sdbm__prep(dirname, pagname, sizname, flags, mode, pagsiz);
 	new_free(&dirname);
 	new_free(&pagname);
+	new_free(&sizname);
 	return db;
 }
 
-static SDBM *	sdbm__prep (char *dirname, char *pagname, int flags, int mode)
+/*
+ * Figure out the page size of the database.  If there is a .siz file,
+ * that's it.  Otherwise a database that already has pages uses PBLKSIZ,
+ * and a brand new one gets what the caller asked for (recorded in a new
+ * .siz file unless it's PBLKSIZ, so plain databases stay plain).
+ */
+static int	sdbm__pagsiz (SDBM *db, char *sizname, int flags, int mode, int want)
+{
+	struct stat pstat;
+	char	buf[16];
+	ssize_t	len;
+	int	fd, size;
+
+	if ((fd = open(sizname, O_RDONLY)) > -1) {
+		len = read(fd, buf, sizeof(buf) - 1);
+		(void) close(fd);
+		if (len <= 0)
+			return errno = EINVAL, -1;
+		buf[len] = 0;
+		size = atoi(buf);
+		if (size < PBLKSIZ || size > PBLKMAX || (size & (size - 1)))
+			return errno = EINVAL, -1;
+		return size;
+	}
+
+	if (want == PBLKSIZ || sdbm_rdonly(db))
+		return PBLKSIZ;
+	if (fstat(db->pagf, &pstat) || pstat.st_size > 0)
+		return PBLKSIZ;
+
+	if ((fd = open(sizname, O_WRONLY | O_CREAT | O_TRUNC, mode)) < 0)
+		return -1;
+	len = snprintf(buf, sizeof(buf), "%d\n", want);
+	if (write(fd, buf, len) != len) {
+		(void) close(fd);
+		return -1;
+	}
+	(void) close(fd);
+	return want;
+}
+
+static SDBM *	sdbm__prep (char *dirname, char *pagname, char *sizname, int flags, int mode, int pagsiz)
 {
 	SDBM *db;
-	struct stat dstat;
+	struct stat dstat, pstat;
+	ssize_t	len;
+	long	got;
 
 	if ((db = (SDBM *)new_malloc(sizeof(SDBM))) == NULL)
 		return errno = ENOMEM, (SDBM *) NULL;
+	(void) memset(db, 0, sizeof(SDBM));
+	db->cur = db->mru = db->lru = -1;
+	db->dirlo = db->dirhi = -1;
 
-        db->flags = 0;
-        db->hmask = 0;
-        db->blkptr = 0;
-        db->keyptr = 0;
 /*
- * adjust user flags so that WRONLY becomes RDWR, 
+ * adjust user flags so that WRONLY becomes RDWR,
  * as required by this package. Also set our internal
  * flag for RDONLY if needed.
  */
@@ -153,21 +291,41 @@ static SDBM *	sdbm__prep (char *dirname, char *pagname, int flags, int mode)
 /*
  * need the dirfile size to establish max bit number.
  */
-			if (fstat(db->dirf, &dstat) == 0) {
+			if (fstat(db->dirf, &dstat) == 0 &&
+			    fstat(db->pagf, &pstat) == 0 &&
+			    (db->pagsiz = sdbm__pagsiz(db, sizname, flags,
+							mode, pagsiz)) > 0) {
+				db->pairmax = db->pagsiz - PAIROVH;
+				db->npages = (pstat.st_size + db->pagsiz - 1)
+						/ db->pagsiz;
+				db->pagbno = -1;
+				db->maxbno = dstat.st_size * BYTESIZ;
 /*
+ * the directory is small (one bit per page), so we keep all of it.
  * zero size: either a fresh database, or one with a single,
  * unsplit data page: dirpage is all zeros.
  */
-				db->dirbno = (!dstat.st_size) ? 0 : -1;
-				db->pagbno = -1;
-				db->maxbno = dstat.st_size * BYTESIZ;
-
-				(void) memset(db->pagbuf, 0, PBLKSIZ);
-				(void) memset(db->dirbuf, 0, DBLKSIZ);
+				db->dirsiz = (dstat.st_size / DBLKSIZ + 1)
+						* DBLKSIZ;
+				db->dirbuf = new_malloc(db->dirsiz);
+				(void) memset(db->dirbuf, 0, db->dirsiz);
+				for (got = 0; got < dstat.st_size; got += len) {
+					len = read(db->dirf, db->dirbuf + got,
+						   db->dirsiz - got);
+					if (len <= 0)
+						break;
+				}
+
+				db->scratch = new_malloc(db->pagsiz);
+				if (got >= dstat.st_size &&
+				    sdbm__newcache(db, CACHDEF) == 0) {
 			/*
 			 * success
 			 */
-				return db;
+					return db;
+				}
+				new_free(&db->scratch);
+				new_free(&db->dirbuf);
 			}
 			(void) close(db->dirf);
 	    }
@@ -179,11 +337,22 @@ static SDBM *	sdbm__prep (char *dirname, char *pagname, int flags, int mode)
 
 void	sdbm_close(SDBM *db)
 {
+	int	i;
+
 	if (db == NULL)
 		errno = EINVAL;
 	else {
+		(void) sdbm_sync(db);
 		(void) close(db->dirf);
 		(void) close(db->pagf);
+		for (i = 0; i < db->ncache; i++)
+			new_free(&db->cache[i].buf);
+		new_free((char **)&db->cache);
+		new_free((char **)&db->hash);
+		new_free((char **)&db->pending);
+		new_free(&db->arena);
+		new_free(&db->dirbuf);
+		new_free(&db->scratch);
 		new_free(&db);
 	}
 }
@@ -192,9 +361,11 @@ Datum	sdbm_fetch (SDBM *db, Datum key)
 {
 	if (db == NULL || bad(key))
 		return errno = EINVAL, nullitem;
+	if (pending(db))
+		return nullitem;
 
 	if (sdbm__getpage(db, exhash(key)))
-		return sdbm__getpair(db->pagbuf, key);
+		return sdbm__getpair(db->pagbuf, db->pagsiz, key);
 
 	return ioerr(db), nullitem;
 }
@@ -205,17 +376,16 @@ int	sdbm_delete (SDBM *db, Datum key)
 		return errno = EINVAL, -1;
 	if (sdbm_rdonly(db))
 		return errno = EPERM, -1;
+	if (pending(db))
+		return -1;
 
 	if (sdbm__getpage(db, exhash(key))) {
-		if (!sdbm__delpair(db->pagbuf, key))
+		if (!sdbm__delpair(db->pagbuf, db->pagsiz, key))
 			return -1;
 /*
- * update the page file
+ * the page will be written out later
  */
-		if (lseek(db->pagf, OFF_PAG(db->pagbno), SEEK_SET) < 0
-		    || write(db->pagf, db->pagbuf, PBLKSIZ) < 0)
-			return ioerr(db), -1;
-
+		sdbm__dirty(db, db->cur);
 		return 0;
 	}
 
@@ -224,8 +394,8 @@ int	sdbm_delete (SDBM *db, Datum key)
 
 int	sdbm_store (SDBM *db, Datum key, Datum val, int flags)
 {
+	struct sdbm_pending *p;
 	int need;
-	long hash;
 
 	if (db == NULL || bad(key))
 		return errno = EINVAL, -1;
@@ -236,33 +406,70 @@ int	sdbm_store (SDBM *db, Datum key, Datum val, int flags)
 /*
  * is the pair too big (or too small) for this database ??
  */
-	if (need < 0 || need > PAIRMAX)
+	if (need < 0 || need > db->pairmax)
 		return errno = EINVAL, -1;
 
+	if (!db->bulk)
+		return sdbm__store(db, key, val, flags);
+
+/*
+ * bulk mode: just remember it.  sdbm__flush() will insert everything
+ * in page order, so each page is visited once per flush.
+ */
+	if (db->npending == db->maxpending) {
+		db->maxpending = db->maxpending ? db->maxpending * 2 : 1024;
+		RESIZE(db->pending, struct sdbm_pending, db->maxpending);
+	}
+	if (db->arenalen + need > db->arenasiz) {
+		while (db->arenalen + need > db->arenasiz)
+			db->arenasiz = db->arenasiz ? db->arenasiz * 2 : 65536;
+		RESIZE(db->arena, char, db->arenasiz);
+	}
+
+	p = &db->pending[db->npending];
+	p->hash = exhash(key);
+	p->seq = db->npending++;
+	p->off = db->arenalen;
+	p->ksize = key.dsize;
+	p->vsize = val.dsize;
+	p->order = 0;
+	p->flags = flags;
+	memcpy(db->arena + db->arenalen, key.dptr, key.dsize);
+	memcpy(db->arena + db->arenalen + key.dsize, val.dptr, val.dsize);
+	db->arenalen += need;
+
+	if (db->arenalen >= BULKMAX)
+		return sdbm__flush(db);
+	return 0;
+}
+
+static int	sdbm__store (SDBM *db, Datum key, Datum val, int flags)
+{
+	int need;
+	long hash;
+
+	need = key.dsize + val.dsize;
 	if (sdbm__getpage(db, (hash = exhash(key)))) {
 /*
  * if we need to replace, delete the key/data pair
  * first. If it is not there, ignore.
  */
 		if (flags == DBM_REPLACE)
-			(void) sdbm__delpair(db->pagbuf, key);
-		else if (sdbm__duppair(db->pagbuf, key))
+			(void) sdbm__delpair(db->pagbuf, db->pagsiz, key);
+		else if (sdbm__duppair(db->pagbuf, db->pagsiz, key))
 			return 1;
 /*
  * if we do not have enough room, we have to split.
  */
-		if (!sdbm__fitpair(db->pagbuf, need))
+		if (!sdbm__fitpair(db->pagbuf, db->pagsiz, need))
 			if (!sdbm__makroom(db, hash, need))
 				return ioerr(db), -1;
 /*
  * we have enough room or split is successful. insert the key,
- * and update the page file.
+ * and mark the page for writing.
  */
-		(void) sdbm__putpair(db->pagbuf, key, val);
-
-		if (lseek(db->pagf, OFF_PAG(db->pagbno), SEEK_SET) < 0
-		    || write(db->pagf, db->pagbuf, PBLKSIZ) < 0)
-			return ioerr(db), -1;
+		(void) sdbm__putpair(db->pagbuf, db->pagsiz, key, val);
+		sdbm__dirty(db, db->cur);
 	/*
 	 * success
 	 */
@@ -272,6 +479,65 @@ int	sdbm_store (SDBM *db, Datum key, Datum val, int flags)
 	return ioerr(db), -1;
 }
 
+static int	sdbm__pendcmp (const void *a, const void *b)
+{
+	const struct sdbm_pending *x = (const struct sdbm_pending *)a;
+	const struct sdbm_pending *y = (const struct sdbm_pending *)b;
+
+	if (x->order != y->order)
+		return x->order < y->order ? -1 : 1;
+	return x->seq < y->seq ? -1 : (x->seq > y->seq);
+}
+
+/*
+ * sdbm__flush - insert everything queued up in bulk mode.  The pairs
+ * are sorted by the page their hash selects right now.  (Sorting on the
+ * hash itself would be worse than not sorting: the keys that pile up in
+ * a page would share so many hash bits that splitting it wouldn't help.)
+ * Pairs for the same page keep their order, and pages that split during
+ * the flush are still in the cache while the rest of their pairs arrive.
+ */
+static int	sdbm__flush (SDBM *db)
+{
+	struct sdbm_pending *p;
+	Datum	key, val;
+	long	i, j;
+	long	sorted = 0;
+	int	retval = 0;
+
+	for (i = 0; i < db->npending; i++) {
+/*
+ * a new database starts with one page, so re-sort whatever is left
+ * each time the number of pages doubles.
+ */
+		if (db->npages >= 2 * sorted) {
+			sorted = db->npages > 0 ? db->npages : 1;
+			for (j = i; j < db->npending; j++) {
+				p = &db->pending[j];
+				p->order = sdbm__walk(db, p->hash);
+			}
+			qsort(db->pending + i, db->npending - i,
+				sizeof(*db->pending), sdbm__pendcmp);
+		}
+
+		p = &db->pending[i];
+		key.dptr = db->arena + p->off;
+		key.dsize = p->ksize;
+		val.dptr = db->arena + p->off + p->ksize;
+		val.dsize = p->vsize;
+		if (sdbm__store(db, key, val, p->flags) < 0) {
+			retval = -1;
+			break;
+		}
+	}
+
+	db->npending = db->maxpending = 0;
+	db->arenalen = db->arenasiz = 0;
+	new_free((char **)&db->pending);
+	new_free(&db->arena);
+	return retval;
+}
+
 /*
  * sdbm__makroom - make room by splitting the overfull page
  * this routine will attempt to make room for SPLTMAX times before
@@ -280,61 +546,51 @@ int	sdbm_store (SDBM *db, Datum key, Datum val, int flags)
 static int	sdbm__makroom (SDBM *db, long hash, int need)
 {
 	long newp;
-	char twin[PBLKSIZ];
-	char *pag = db->pagbuf;
-	char *new = twin;
+	int  slot;
+	char *new;
 	int smax = SPLTMAX;
 
 	do {
-/*
- * split the current page
- */
-		(void) sdbm__splpage(pag, new, db->hmask + 1);
 /*
  * address of the new page
  */
 		newp = (hash & db->hmask) | (db->hmask + 1);
+		if ((slot = sdbm__slot(db, newp, 0, db->cur)) < 0)
+			return 0;
+		new = db->cache[slot].buf;
+/*
+ * split the current page
+ */
+		(void) sdbm__splpage(db, db->pagbuf, new, db->hmask + 1);
+		sdbm__dirty(db, db->cur);
+		sdbm__dirty(db, slot);
 
 /*
- * write delay, read avoidence/cache shuffle:
  * select the page for incoming pair: if key is to go to the new page,
- * write out the previous one, and copy the new one over, thus making
- * it the current page. If not, simply write the new page, and we are
- * still looking at the page of interest. current page is not updated
- * here, as sdbm_store will do so, after it inserts the incoming pair.
+ * it becomes the current page.  Both are in the cache and will be
+ * written out later.
  */
 		if (hash & (db->hmask + 1)) {
-			if (lseek(db->pagf, OFF_PAG(db->pagbno), SEEK_SET) < 0
-			    || write(db->pagf, db->pagbuf, PBLKSIZ) < 0)
-				return 0;
+			db->cur = slot;
 			db->pagbno = newp;
-			(void) memcpy(pag, new, PBLKSIZ);
+			db->pagbuf = new;
 		}
-		else if (lseek(db->pagf, OFF_PAG(newp), SEEK_SET) < 0
-			 || write(db->pagf, new, PBLKSIZ) < 0)
-			return 0;
 
 		if (!sdbm__setdbit(db, db->curbit))
 			return 0;
 /*
  * see if we have enough room now
  */
-		if (sdbm__fitpair(pag, need))
+		if (sdbm__fitpair(db->pagbuf, db->pagsiz, need))
 			return 1;
 /*
  * try again... update curbit and hmask as sdbm__getpage would have
  * done. because of our update of the current page, we do not
- * need to read in anything. BUT we have to write the current
- * [deferred] page out, as the window of failure is too great.
+ * need to read in anything.
  */
 		db->curbit = 2 * db->curbit +
 			((hash & (db->hmask + 1)) ? 2 : 1);
 		db->hmask |= db->hmask + 1;
-
-		if (lseek(db->pagf, OFF_PAG(db->pagbno), SEEK_SET) < 0
-		    || write(db->pagf, db->pagbuf, PBLKSIZ) < 0)
-			return 0;
-
 	} while (--smax);
 /*
  * if we are here, this is real bad news. After SPLTMAX splits,
@@ -353,13 +609,11 @@ Datum	sdbm_firstkey (SDBM *db)
 {
 	if (db == NULL)
 		return errno = EINVAL, nullitem;
+	if (pending(db))
+		return nullitem;
 /*
  * start at page 0
  */
-	if (lseek(db->pagf, OFF_PAG(0), SEEK_SET) < 0
-	    || read(db->pagf, db->pagbuf, PBLKSIZ) < 0)
-		return ioerr(db), nullitem;
-	db->pagbno = 0;
 	db->blkptr = 0;
 	db->keyptr = 0;
 
@@ -370,6 +624,8 @@ Datum	sdbm_nextkey (SDBM *db)
 {
 	if (db == NULL)
 		return errno = EINVAL, nullitem;
+	if (pending(db))
+		return nullitem;
 	return sdbm__getnext(db);
 }
 
@@ -380,14 +636,287 @@ int	sdbm_error (SDBM *db)
 	return db->error;
 }
 
+/*
+ * sdbm_sync - Write every modified page and directory block to disk.
+ * Returns 0 on success, -1 on error (see sdbm_error()).
+ */
+int	sdbm_sync (SDBM *db)
+{
+	if (db == NULL)
+		return errno = EINVAL, -1;
+	if (sdbm_rdonly(db))
+		return 0;
+	if (pending(db))
+		return -1;
+	if (sdbm__writeback(db))
+		return ioerr(db), -1;
+	return 0;
+}
+
+/*
+ * sdbm_cache - Change the number of pages kept in memory (at most
+ * CACHMAX bytes worth).  Returns the (possibly new) size of the cache;
+ * pass 0 just to ask.
+ */
+int	sdbm_cache (SDBM *db, int pages)
+{
+	if (db == NULL)
+		return errno = EINVAL, -1;
+	if (pages <= 0 || pages == db->ncache)
+		return db->ncache;
+	if (pending(db) || sdbm__newcache(db, pages))
+		return -1;
+	return db->ncache;
+}
+
+/*
+ * sdbm_bulk - Turn bulk mode on or off.  In bulk mode, sdbm_store()
+ * only queues the pair, so it always succeeds (even for DBM_INSERT on an
+ * existing key).  The queue is inserted, sorted by the page each pair
+ * goes to (see sdbm__flush()), whenever it gets big, or by anything
+ * other than sdbm_store().  Returns the old mode.
+ */
+int	sdbm_bulk (SDBM *db, int on)
+{
+	int	old;
+
+	if (db == NULL)
+		return errno = EINVAL, -1;
+	old = db->bulk;
+	if (on >= 0)
+		db->bulk = on ? 1 : 0;
+	if (!db->bulk && pending(db))
+		return -1;
+	return old;
+}
+
+int	sdbm_pagesize (SDBM *db)
+{
+	if (db == NULL)
+		return errno = EINVAL, -1;
+	return db->pagsiz;
+}
+
+/*
+ * The page cache.
+ */
+static void	sdbm__unlink (SDBM *db, int slot)
+{
+	struct sdbm_page *p = &db->cache[slot];
+
+	if (p->prev >= 0)
+		db->cache[p->prev].next = p->next;
+	else
+		db->mru = p->next;
+	if (p->next >= 0)
+		db->cache[p->next].prev = p->prev;
+	else
+		db->lru = p->prev;
+}
+
+static void	sdbm__touch (SDBM *db, int slot)
+{
+	struct sdbm_page *p = &db->cache[slot];
+
+	if (db->mru == slot)
+		return;
+	sdbm__unlink(db, slot);
+	p->prev = -1;
+	p->next = db->mru;
+	if (db->mru >= 0)
+		db->cache[db->mru].prev = slot;
+	db->mru = slot;
+	if (db->lru < 0)
+		db->lru = slot;
+}
+
+static void	sdbm__unhash (SDBM *db, int slot)
+{
+	int *	sp;
+
+	for (sp = &db->hash[db->cache[slot].bno & (db->hsize - 1)];
+	     *sp >= 0; sp = &db->cache[*sp].hnext) {
+		if (*sp == slot) {
+			*sp = db->cache[slot].hnext;
+			break;
+		}
+	}
+	db->cache[slot].bno = -1;
+}
+
+static void	sdbm__dirty (SDBM *db, int slot)
+{
+	db->cache[slot].dirty = 1;
+	if (db->cache[slot].bno >= db->npages)
+		db->npages = db->cache[slot].bno + 1;
+}
+
+static int	sdbm__putpage (SDBM *db, struct sdbm_page *p)
+{
+	if (lseek(db->pagf, OFF_PAG(db, p->bno), SEEK_SET) < 0
+	    || write(db->pagf, p->buf, db->pagsiz) < 0)
+		return -1;
+	p->dirty = 0;
+	return 0;
+}
+
+/*
+ * sdbm__slot - Return the slot holding page "bno", reading it from
+ * the file if "doread" (a "hole" or the end of the file reads as 0s).
+ * The LRU page is evicted to make room, unless it is "pin".
+ */
+static int	sdbm__slot (SDBM *db, long bno, int doread, int pin)
+{
+	struct sdbm_page *p;
+	int	slot;
+	ssize_t	len;
+
+	for (slot = db->hash[bno & (db->hsize - 1)]; slot >= 0;
+	     slot = db->cache[slot].hnext) {
+		if (db->cache[slot].bno == bno) {
+			sdbm__touch(db, slot);
+			return slot;
+		}
+	}
+
+	if (db->nused < db->ncache) {
+		slot = db->nused++;
+		p = &db->cache[slot];
+		p->buf = new_malloc(db->pagsiz);
+		p->prev = -1;
+		p->next = db->mru;
+		if (db->mru >= 0)
+			db->cache[db->mru].prev = slot;
+		db->mru = slot;
+		if (db->lru < 0)
+			db->lru = slot;
+	} else {
+		slot = db->lru;
+		if (slot == pin)
+			slot = db->cache[slot].prev;
+		p = &db->cache[slot];
+		if (p->bno >= 0) {
+			if (p->dirty && sdbm__putpage(db, p))
+				return -1;
+			sdbm__unhash(db, slot);
+		}
+		if (slot == db->cur) {
+			db->cur = -1;
+			db->pagbno = -1;
+			db->pagbuf = NULL;
+		}
+		sdbm__touch(db, slot);
+	}
+
+	p->dirty = 0;
+	if (doread) {
+		len = 0;
+		if (bno < db->npages) {
+			if (lseek(db->pagf, OFF_PAG(db, bno), SEEK_SET) < 0
+			    || (len = read(db->pagf, p->buf, db->pagsiz)) < 0)
+				return -1;
+		}
+		if (len < db->pagsiz)
+			(void) memset(p->buf + len, 0, db->pagsiz - len);
+		if (!sdbm__chkpage(p->buf, db->pagsiz))
+			return -1;
+	}
+
+	p->bno = bno;
+	p->hnext = db->hash[bno & (db->hsize - 1)];
+	db->hash[bno & (db->hsize - 1)] = slot;
+	return slot;
+}
+
+/*
+ * Write out the dirty pages (in file order) and directory blocks.
+ */
+static int	sdbm__writeback (SDBM *db)
+{
+	struct sdbm_page **dirty;
+	int	i, n;
+	int	retval = 0;
+
+	dirty = (struct sdbm_page **)new_malloc(sizeof(*dirty) * (db->nused + 1));
+	for (i = n = 0; i < db->nused; i++)
+		if (db->cache[i].bno >= 0 && db->cache[i].dirty)
+			dirty[n++] = &db->cache[i];
+
+	/* Insertion sort by page number; n is at most the cache size */
+	for (i = 1; i < n; i++) {
+		struct sdbm_page *p = dirty[i];
+		int	j;
+
+		for (j = i; j > 0 && dirty[j - 1]->bno > p->bno; j--)
+			dirty[j] = dirty[j - 1];
+		dirty[j] = p;
+	}
+
+	for (i = 0; i < n; i++)
+		if (sdbm__putpage(db, dirty[i]))
+			retval = -1;
+	new_free((char **)&dirty);
+
+	if (db->dirlo >= 0) {
+		if (lseek(db->dirf, OFF_DIR(db->dirlo), SEEK_SET) < 0
+		    || write(db->dirf, db->dirbuf + db->dirlo * DBLKSIZ,
+			   (db->dirhi - db->dirlo + 1) * DBLKSIZ) < 0)
+			retval = -1;
+		else
+			db->dirlo = db->dirhi = -1;
+	}
+	return retval;
+}
+
+/*
+ * (Re)build the page cache with "pages" slots, writing out whatever
+ * is dirty in the old one first.  The slots get their buffers from
+ * sdbm__slot(), so an empty cache costs next to nothing.
+ */
+static int	sdbm__newcache (SDBM *db, int pages)
+{
+	int	i;
+
+	if (pages > CACHMAX / db->pagsiz)
+		pages = CACHMAX / db->pagsiz;
+	if (pages < CACHMIN)
+		pages = CACHMIN;
+	if (db->cache && sdbm__writeback(db))
+		return ioerr(db), -1;
+
+	for (i = 0; i < db->nused; i++)
+		new_free(&db->cache[i].buf);
+	new_free((char **)&db->cache);
+	new_free((char **)&db->hash);
+
+	db->ncache = pages;
+	db->nused = 0;
+	db->cache = (struct sdbm_page *)new_malloc(sizeof(*db->cache) * pages);
+	for (i = 0; i < pages; i++) {
+		db->cache[i].bno = -1;
+		db->cache[i].dirty = 0;
+		db->cache[i].hnext = db->cache[i].prev = db->cache[i].next = -1;
+		db->cache[i].buf = NULL;
+	}
+	for (db->hsize = 1; db->hsize < pages; db->hsize *= 2)
+		;
+	db->hash = (int *)new_malloc(sizeof(int) * db->hsize);
+	for (i = 0; i < db->hsize; i++)
+		db->hash[i] = -1;
+
+	db->mru = db->lru = db->cur = -1;
+	db->pagbno = -1;
+	db->pagbuf = NULL;
+	return 0;
+}
+
 /*
  * all important binary trie traversal
  */
-static int	sdbm__getpage (SDBM *db, long hash)
+static long	sdbm__walk (SDBM *db, long hash)
 {
 	int hbit;
 	long dbit;
-	long pagb;
 
 	dbit = 0;
 	hbit = 0;
@@ -397,67 +926,66 @@ static int	sdbm__getpage (SDBM *db, long hash)
 	db->curbit = dbit;
 	db->hmask = masks[hbit];
 
-	pagb = hash & db->hmask;
-/*
- * see if the block we need is already in memory.
- * note: this lookaside cache has about 10% hit rate.
- */
-	if (pagb != db->pagbno) { 
+	return hash & db->hmask;
+}
+
+static int	sdbm__getpage (SDBM *db, long hash)
+{
+	long pagb;
+	int slot;
+
+	pagb = sdbm__walk(db, hash);
 /*
- * note: here, we assume a "hole" is read as 0s.
- * if not, must zero pagbuf first.
+ * see if the block we need is already current, else go to the cache.
  */
-		if (lseek(db->pagf, OFF_PAG(pagb), SEEK_SET) < 0
-		    || read(db->pagf, db->pagbuf, PBLKSIZ) < 0)
-			return 0;
-		if (!sdbm__chkpage(db->pagbuf))
+	if (pagb != db->pagbno || db->cur < 0) {
+		if ((slot = sdbm__slot(db, pagb, 1, -1)) < 0)
 			return 0;
+		db->cur = slot;
+		db->pagbuf = db->cache[slot].buf;
 		db->pagbno = pagb;
 	}
+	else
+		sdbm__touch(db, db->cur);
 	return 1;
 }
 
 static int	sdbm__getdbit (SDBM *db, long dbit)
 {
 	long c;
-	long dirb;
 
 	c = dbit / BYTESIZ;
-	dirb = c / DBLKSIZ;
-
-	if (dirb != db->dirbno) {
-		if (lseek(db->dirf, OFF_DIR(dirb), SEEK_SET) < 0
-		    || read(db->dirf, db->dirbuf, DBLKSIZ) < 0)
-			return 0;
-		db->dirbno = dirb;
-	}
+	if (c >= db->dirsiz)
+		return 0;
 
-	return db->dirbuf[c % DBLKSIZ] & (1 << dbit % BYTESIZ);
+	return db->dirbuf[c] & (1 << dbit % BYTESIZ);
 }
 
 static int	sdbm__setdbit (SDBM *db, long dbit)
 {
 	long c;
 	long dirb;
+	long size;
 
 	c = dbit / BYTESIZ;
 	dirb = c / DBLKSIZ;
 
-	if (dirb != db->dirbno) {
-		if (lseek(db->dirf, OFF_DIR(dirb), SEEK_SET) < 0
-		    || read(db->dirf, db->dirbuf, DBLKSIZ) < 0)
-			return 0;
-		db->dirbno = dirb;
+	if (c >= db->dirsiz) {
+		size = (dirb + 1) * DBLKSIZ;
+		RESIZE(db->dirbuf, char, size);
+		(void) memset(db->dirbuf + db->dirsiz, 0, size - db->dirsiz);
+		db->dirsiz = size;
 	}
 
-	db->dirbuf[c % DBLKSIZ] |= (1 << dbit % BYTESIZ);
+	db->dirbuf[c] |= (1 << dbit % BYTESIZ);
 
 	if (dbit >= db->maxbno)
 		db->maxbno += DBLKSIZ * BYTESIZ;
 
-	if (lseek(db->dirf, OFF_DIR(dirb), SEEK_SET) < 0
-	    || write(db->dirf, db->dirbuf, DBLKSIZ) < 0)
-		return 0;
+	if (db->dirlo < 0 || dirb < db->dirlo)
+		db->dirlo = dirb;
+	if (dirb > db->dirhi)
+		db->dirhi = dirb;
 
 	return 1;
 }
@@ -469,26 +997,24 @@ static int	sdbm__setdbit (SDBM *db, long dbit)
 static Datum	sdbm__getnext (SDBM *db)
 {
 	Datum key;
+	int slot;
 
 	for (;;) {
+		if (db->blkptr >= db->npages)
+			break;
+		if ((slot = sdbm__slot(db, db->blkptr, 1, -1)) < 0)
+			break;
+
 		db->keyptr++;
-		key = sdbm__getnkey(db->pagbuf, db->keyptr);
+		key = sdbm__getnkey(db->cache[slot].buf, db->pagsiz, db->keyptr);
 		if (key.dptr != NULL)
 			return key;
 /*
  * we either run out, or there is nothing on this page..
- * try the next one... If we lost our position on the
- * file, we will have to seek.
+ * try the next one...
  */
 		db->keyptr = 0;
-		if (db->pagbno != db->blkptr++)
-			if (lseek(db->pagf, OFF_PAG(db->blkptr), SEEK_SET) < 0)
-				break;
-		db->pagbno = db->blkptr;
-		if (read(db->pagf, db->pagbuf, PBLKSIZ) <= 0)
-			break;
-		if (!sdbm__chkpage(db->pagbuf))
-			break;
+		db->blkptr++;
 	}
 
 	return ioerr(db), nullitem;
@@ -550,27 +1076,27 @@ static long	sdbm__hash (const char *str, int len)
  * nth (ino[ino[0]]) entry's offset.
  */
 
-static int	sdbm__fitpair (char *pag, int need)
+static int	sdbm__fitpair (char *pag, int pagsiz, int need)
 {
 	int n;
 	int my_off;
 	int avail;
 	short *ino = (short *) pag;
 
-	my_off = ((n = ino[0]) > 0) ? ino[n] : PBLKSIZ;
+	my_off = ((n = ino[0]) > 0) ? ino[n] : pagsiz;
 	avail = my_off - (n + 1) * sizeof(short);
 	need += 2 * sizeof(short);
 
 	return need <= avail;
 }
 
-static void	sdbm__putpair (char *pag, Datum key, Datum val)
+static void	sdbm__putpair (char *pag, int pagsiz, Datum key, Datum val)
 {
 	int n;
 	int my_off;
 	short *ino = (short *) pag;
 
-	my_off = ((n = ino[0]) > 0) ? ino[n] : PBLKSIZ;
+	my_off = ((n = ino[0]) > 0) ? ino[n] : pagsiz;
 /*
  * enter the key first
  */
@@ -589,7 +1115,7 @@ static void	sdbm__putpair (char *pag, Datum key, Datum val)
 	ino[0] += 2;
 }
 
-static Datum	sdbm__getpair (char *pag, Datum key)
+static Datum	sdbm__getpair (char *pag, int pagsiz, Datum key)
 {
 	int i;
 	int n;
@@ -599,7 +1125,7 @@ static Datum	sdbm__getpair (char *pag, Datum key)
 	if ((n = ino[0]) == 0)
 		return nullitem;
 
-	if ((i = sdbm__seepair(pag, n, key.dptr, key.dsize)) == 0)
+	if ((i = sdbm__seepair(pag, pagsiz, n, key.dptr, key.dsize)) == 0)
 		return nullitem;
 
 	val.dptr = pag + ino[i + 1];
@@ -607,13 +1133,13 @@ static Datum	sdbm__getpair (char *pag, Datum key)
 	return val;
 }
 
-static int	sdbm__duppair (char *pag, Datum key)
+static int	sdbm__duppair (char *pag, int pagsiz, Datum key)
 {
 	short *ino = (short *) pag;
-	return ino[0] > 0 && sdbm__seepair(pag, ino[0], key.dptr, key.dsize) > 0;
+	return ino[0] > 0 && sdbm__seepair(pag, pagsiz, ino[0], key.dptr, key.dsize) > 0;
 }
 
-static Datum	sdbm__getnkey (char *pag, int num)
+static Datum	sdbm__getnkey (char *pag, int pagsiz, int num)
 {
 	Datum key;
 	int my_off;
@@ -623,7 +1149,7 @@ static Datum	sdbm__getnkey (char *pag, int num)
 	if (ino[0] == 0 || num > ino[0])
 		return nullitem;
 
-	my_off = (num > 1) ? ino[num - 1] : PBLKSIZ;
+	my_off = (num > 1) ? ino[num - 1] : pagsiz;
 
 	key.dptr = pag + ino[num];
 	key.dsize = my_off - ino[num];
@@ -631,7 +1157,7 @@ static Datum	sdbm__getnkey (char *pag, int num)
 	return key;
 }
 
-static int	sdbm__delpair (char *pag, Datum key)
+static int	sdbm__delpair (char *pag, int pagsiz, Datum key)
 {
 	int n;
 	int i;
@@ -640,7 +1166,7 @@ static int	sdbm__delpair (char *pag, Datum key)
 	if ((n = ino[0]) == 0)
 		return 0;
 
-	if ((i = sdbm__seepair(pag, n, key.dptr, key.dsize)) == 0)
+	if ((i = sdbm__seepair(pag, pagsiz, n, key.dptr, key.dsize)) == 0)
 		return 0;
 /*
  * found the key. if it is the last entry
@@ -651,7 +1177,7 @@ static int	sdbm__delpair (char *pag, Datum key)
  */
 	if (i < n - 1) {
 		int m;
-		char *dst = pag + (i == 1 ? PBLKSIZ : ino[i - 1]);
+		char *dst = pag + (i == 1 ? pagsiz : ino[i - 1]);
 		char *src = pag + ino[i + 1];
 		int   zoo = dst - src;
 
@@ -699,10 +1225,10 @@ static int	sdbm__delpair (char *pag, Datum key)
  * return offset index in the range 0 < i < n.
  * return 0 if not found.
  */
-static int	sdbm__seepair (char *pag, int n, const char *key, int siz)
+static int	sdbm__seepair (char *pag, int pagsiz, int n, const char *key, int siz)
 {
 	int i;
-	int my_off = PBLKSIZ;
+	int my_off = pagsiz;
 	short *ino = (short *) pag;
 
 	for (i = 1; i < n; i += 2) {
@@ -714,19 +1240,20 @@ static int	sdbm__seepair (char *pag, int n, const char *key, int siz)
 	return 0;
 }
 
-static void	sdbm__splpage (char *pag, char *new, long sbit)
+static void	sdbm__splpage (SDBM *db, char *pag, char *new, long sbit)
 {
 	Datum key;
 	Datum val;
 
 	int n;
-	int my_off = PBLKSIZ;
-	char cur[PBLKSIZ];
+	int pagsiz = db->pagsiz;
+	int my_off = pagsiz;
+	char *cur = db->scratch;
 	short *ino = (short *) cur;
 
-	(void) memcpy(cur, pag, PBLKSIZ);
-	(void) memset(pag, 0, PBLKSIZ);
-	(void) memset(new, 0, PBLKSIZ);
+	(void) memcpy(cur, pag, pagsiz);
+	(void) memset(pag, 0, pagsiz);
+	(void) memset(new, 0, pagsiz);
 
 	n = ino[0];
 	for (ino++; n > 0; ino += 2) {
@@ -737,7 +1264,8 @@ static void	sdbm__splpage (char *pag, char *new, long sbit)
 /*
  * select the page pointer (by looking at sbit) and insert
  */
-		(void) sdbm__putpair((exhash(key) & sbit) ? new : pag, key, val);
+		(void) sdbm__putpair((exhash(key) & sbit) ? new : pag, pagsiz,
+					key, val);
 
 		my_off = ino[1];
 		n -= 2;
@@ -750,17 +1278,17 @@ static void	sdbm__splpage (char *pag, char *new, long sbit)
  * reasonable, and all offsets in the index should be in order.
  * this could be made more rigorous.
  */
-static int	sdbm__chkpage (char *pag)
+static int	sdbm__chkpage (char *pag, int pagsiz)
 {
 	int n;
 	int my_off;
 	short *ino = (short *) pag;
 
-	if ((n = ino[0]) < 0 || n > PBLKSIZ / (int)sizeof(short))
+	if ((n = ino[0]) < 0 || n > pagsiz / (int)sizeof(short))
 		return 0;
 
 	if (n > 0) {
-		my_off = PBLKSIZ;
+		my_off = pagsiz;
 		for (ino++; n > 0; ino += 2) {
 			if (ino[0] > my_off || ino[1] > my_off ||
 			    ino[1] > ino[0])
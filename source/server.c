@@ -775,13 +775,19 @@ static	int	serverinfo_to_newserv (ServerInfo *si)
 	s->max_cached_chan_size = -1;
 	s->who_queue = NULL;
 	s->ison = NULL;
+	s->notify_push = 0;
+	s->notify_push_max = 0;
+	s->notify_pushed = 0;
 	s->ison_len = 500;
-	s->ison_max = 1;
+	s->ison_max = 4;
 	s->ison_queue = NULL;
 	s->ison_wait = NULL;
-	s->userhost_max = 1;
+	s->userhost_max = 4;
 	s->userhost_queue = NULL;
 	s->userhost_wait = NULL;
+	memset(&s->who_stats, 0, sizeof(s->who_stats));
+	memset(&s->ison_stats, 0, sizeof(s->ison_stats));
+	memset(&s->userhost_stats, 0, sizeof(s->userhost_stats));
 	s->uh_addr_set = 0;
 	memset(&s->uh_addr.ss, 0, sizeof(s->uh_addr.ss));
 	memset(&s->local_sockname.ss, 0, sizeof(s->local_sockname.ss));
@@ -3039,6 +3045,7 @@ void	server_is_unregistered (int refnum)
 		return;
 
 	destroy_005(refnum);
+	notify_push_stop(refnum);
 	set_server_away_status(refnum, 0);
 	set_server_state(refnum, SERVER_EOF);
 }
@@ -4703,6 +4710,10 @@ char 	*serverctl 	(char *input)
 		} else if (!my_strnicmp(listc, "ISONLEN", len)) {
 			num = get_server_ison_len(refnum);
 			RETURN_INT(num);
+		} else if (!my_strnicmp(listc, "ISON_QUEUE", len)) {
+			return get_server_queue_stats(refnum, "ISON");
+		} else if (!my_strnicmp(listc, "WHO_QUEUE", len)) {
+			return get_server_queue_stats(refnum, "WHO");
 		} else if (!my_strnicmp(listc, "CONNECTED", len)) {
 			num = is_server_registered(refnum);
 			RETURN_INT(num);
@@ -4749,6 +4760,9 @@ char 	*serverctl 	(char *input)
 		} else if (!my_strnicmp(listc, "USERHOST", len)) {
 			ret = get_server_userhost(refnum);
 			RETURN_STR(ret);
+		} else if (!my_strnicmp(listc, "USERHOST_QUEUE", len)) {
+			/* After USERHOST, so that "USERHOST" isn't taken as this */
+			return get_server_queue_stats(refnum, "USERHOST");
 		} else if (!my_strnicmp(listc, "VERSION", len)) {
 			ret = get_server_version_string(refnum);
 			RETURN_STR(ret);
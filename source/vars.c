@@ -61,6 +61,7 @@
 #include "commands.h"
 #include "ifcmd.h"
 #include "ssl.h"
+#include "history.h"
 
 
 /*
@@ -430,6 +431,8 @@ void 	init_variables_stage1 (void)
 	VAR(FLOATING_POINT_MATH, 	BOOL, NULL);
 	VAR(FLOATING_POINT_PRECISION,	INT,  NULL);
 	VAR(HIDE_PRIVATE_CHANNELS,	BOOL, update_all_status_wrapper);
+	VAR(HISTORY_DIR,		STR,  set_history_dir);
+	VAR(HISTORY_LEVEL,		STR,  set_history_mask);
 	VAR(HOLD_SLIDER,		INT,  NULL);
 	VAR(INDENT,			BOOL, set_indent);
         VAR(INPUT_INDICATOR_LEFT,	STR,  NULL);
@@ -440,6 +443,8 @@ void 	init_variables_stage1 (void)
 	VAR(LASTLOG, 			INT,  set_lastlog_size);
 	VAR(LASTLOG_LEVEL,		STR,  set_lastlog_mask);
 	VAR(LASTLOG_REWRITE,		STR,  NULL);
+#define DEFAULT_LOAD_CACHE_DIR NULL
+	VAR(LOAD_CACHE_DIR,		STR,  NULL);
 #define DEFAULT_LOAD_PATH NULL
 	VAR(LOAD_PATH,			STR,  NULL);
 	VAR(LOG,			BOOL, logger);
@@ -57,6 +57,7 @@ static	char	who_timeref[] = "WHOTIM";
 
 
 static int	who_queue_debug (void *unused);
+static void	queue_reply_received (QueueStats *stats, Timeval *sent_time);
 
 static void	WHO_DEBUG (const char *format, ...)
 {
@@ -233,6 +234,7 @@ static void who_queue_add (int refnum, WhoEntry *item)
 		bottom->next = item;
 
 	get_time(&item->request_time);
+	s->who_stats.sent++;
 
 	WHO_DEBUG("Adding item to who queue for server %d [%s]", 
 			refnum, who_item_full_desc(item));
@@ -925,6 +927,9 @@ void	who_end (int refnum, const char *from, const char *comm, const char **ArgLi
 	l = message_from(new_w->who_target, LEVEL_OTHER);
 	do
 	{
+		queue_reply_received(&get_server(refnum)->who_stats, 
+					&new_w->request_time);
+
 		/* Defer to another function, if neccesary.  */
 		if (new_w->end)
 			new_w->end(refnum, from, comm, ArgList);
@@ -1024,6 +1029,9 @@ int	fake_who_end (int refnum, const char *from, const char *comm, const char *wh
 	l = message_from(new_w->who_target, LEVEL_OTHER);
 	do
 	{
+		queue_reply_received(&get_server(refnum)->who_stats, 
+					&new_w->request_time);
+
 		/* Defer to another function, if neccesary.  */
 		if (new_w->end)
 		{
@@ -1052,6 +1060,142 @@ int	fake_who_end (int refnum, const char *from, const char *comm, const char *wh
 }
 
 
+/*
+ * Queue statistics -- How long the server takes to answer us.
+ */
+static void	queue_reply_received (QueueStats *stats, Timeval *sent_time)
+{
+	Timeval	now;
+	double	d;
+
+	get_time(&now);
+	d = time_diff(*sent_time, now);
+	stats->replies++;
+	stats->total_latency += d;
+	if (d > stats->max_latency)
+		stats->max_latency = d;
+}
+
+/*
+ * get_server_queue_stats -- What $serverctl(GET <refnum> WHO_QUEUE) returns.
+ * "queue" is "WHO", "ISON" or "USERHOST".  The return value is 
+ *	<waiting> <in-flight> <sent> <replies> <avg-latency> <max-latency>
+ * where <waiting> is how many haven't been sent yet, <in-flight> is how
+ * many have been sent but not answered yet, and the latencies are seconds.
+ */
+char *	get_server_queue_stats (int refnum, const char *queue)
+{
+	Server *	s;
+	QueueStats *	stats;
+	int		waiting = 0, inflight = 0;
+
+	if (!(s = get_server(refnum)))
+		return malloc_strdup(empty_string);
+
+	if (!my_stricmp(queue, "WHO"))
+	{
+		WhoEntry *w;
+
+		for (w = s->who_queue; w; w = w->next)
+			if (!w->piggyback)
+				inflight++;
+		stats = &s->who_stats;
+	}
+	else if (!my_stricmp(queue, "ISON"))
+	{
+		IsonEntry *i;
+
+		for (i = s->ison_queue; i; i = i->next)
+			if (!i->piggyback)
+				inflight++;
+		for (i = s->ison_wait; i; i = i->next)
+			waiting++;
+		stats = &s->ison_stats;
+	}
+	else if (!my_stricmp(queue, "USERHOST"))
+	{
+		UserhostEntry *u;
+
+		for (u = s->userhost_queue; u; u = u->next)
+			if (!u->piggyback)
+				inflight++;
+		for (u = s->userhost_wait; u; u = u->next)
+			waiting++;
+		stats = &s->userhost_stats;
+	}
+	else
+		return malloc_strdup(empty_string);
+
+	return malloc_sprintf(NULL, "%d %d %lu %lu %f %f", 
+			waiting, inflight, stats->sent, stats->replies,
+			stats->replies ? stats->total_latency / stats->replies : 0.0,
+			stats->max_latency);
+}
+
+/* Is the "len" char nick at "nick" one of the words in "list"? */
+static int	queue_has_nick (const char *list, const char *nick, size_t len)
+{
+	const char *p;
+
+	for (p = list; *p; )
+	{
+		while (*p == ' ')
+			p++;
+		if (*p && !my_strnicmp(p, nick, len) && (!p[len] || p[len] == ' '))
+			return 1;
+		while (*p && *p != ' ')
+			p++;
+	}
+	return 0;
+}
+
+/*
+ * queue_can_add -- Can the nicks in "more" go out in the same ISON or
+ * USERHOST as the ones in "query"?  Not if that would make it more than
+ * "maxwords" nicks or "maxlen" chars (if they're not 0), and not if any
+ * of the nicks are already in "query" (the server might only answer once)
+ */
+static int	queue_can_add (const char *query, const char *more, int maxwords, int maxlen)
+{
+	const char *	p;
+	const char *	nick;
+	size_t		len;
+	int		words = 0;
+
+	if (maxlen && (int)(strlen(query) + strlen(more) + 1) >= maxlen)
+		return 0;
+
+	for (p = query; *p; )
+	{
+		while (*p == ' ')
+			p++;
+		if (*p)
+			words++;
+		while (*p && *p != ' ')
+			p++;
+	}
+
+	for (p = more; *p; )
+	{
+		while (*p == ' ')
+			p++;
+		if (!*p)
+			break;
+
+		nick = p;
+		while (*p && *p != ' ')
+			p++;
+		len = p - nick;
+
+		if (maxwords && ++words > maxwords)
+			return 0;
+		if (queue_has_nick(query, nick, len))
+			return 0;
+	}
+	return 1;
+}
+
+
 /*
  *
  *
@@ -1088,11 +1232,18 @@ static void ison_queue_add (int refnum, IsonEntry *item, int next)
 	return;
 }
 
+/*
+ * Send the next waiting ISON, unless there are already ison_max of them 
+ * waiting for an answer.  Any other waiting ISONs that fit are sent along
+ * with it in the same ISON; each of them is marked as a "piggyback" on
+ * the one before it, and ison_returned() splits the answer up again.
+ */
 static void ison_queue_send (int refnum)
 {
-	int count = 1;
+	int count = 0;
 	Server *s;
-	IsonEntry *save, *bottom;
+	IsonEntry *save, *last, *bottom;
+	char *	query = NULL;
 
 	if (!(s = get_server(refnum)))
 		return;
@@ -1100,27 +1251,39 @@ static void ison_queue_send (int refnum)
 	if (!(save = s->ison_wait))
 		return;
 
-	bottom = s->ison_queue;
-	while (bottom)
+	for (bottom = s->ison_queue; bottom; bottom = bottom->next)
 	{
-		if (s->ison_max && ++count > s->ison_max)
-			return;
-		else if (bottom->next)
-			bottom = bottom->next;
-		else
+		if (!bottom->piggyback)
+			count++;
+		if (!bottom->next)
+			break;
+	}
+	if (s->ison_max && count >= s->ison_max)
+		return;
+
+	malloc_strcpy(&query, save->ison_asked);
+	for (last = save; last->next; last = last->next)
+	{
+		if (!last->next->ison_asked || !queue_can_add(query, 
+				last->next->ison_asked, 0, s->ison_len))
 			break;
+		malloc_strcat_wordlist(&query, space, last->next->ison_asked);
+		last->piggyback = 1;
 	}
 
-	s->ison_wait = save->next;
+	s->ison_wait = last->next;
 
 	if (bottom)
 		bottom->next = save;
 	else
 		s->ison_queue = save;
 
-	save->next = NULL;
+	last->next = NULL;
 
-	send_to_aserver(refnum, "ISON %s", save->ison_asked);
+	get_time(&save->sent_time);
+	s->ison_stats.sent++;
+	send_to_aserver(refnum, "ISON %s", query);
+	new_free(&query);
 }
 
 static void ison_entry_pop (IsonEntry **entry)
@@ -1191,6 +1354,9 @@ static IsonEntry *get_new_ison_entry (int refnum, int next)
 	new_w->oncmd = NULL;
 	new_w->offcmd = NULL;
 	new_w->endcmd = NULL;
+	new_w->piggyback = 0;
+	new_w->sent_time.tv_sec = 0;
+	new_w->sent_time.tv_usec = 0;
 	ison_queue_add(refnum, new_w, next);
 	return new_w;
 }
@@ -1206,8 +1372,9 @@ static void ison_queue_list (int refnum)
 
 	for (item = s->ison_queue; item; item = item->next, count++)
 	{
-		yell("[%d] [%s] ["UINTMAX_HEX_FORMAT"]", count, item->ison_asked, 
-				(uintmax_t)item->line);
+		yell("[%d] [%s] ["UINTMAX_HEX_FORMAT"]%s", count, item->ison_asked, 
+				(uintmax_t)item->line,
+				item->piggyback ? " (piggyback)" : empty_string);
 	}
 
 	for (item = s->ison_wait; item; item = item->next, count++)
@@ -1422,6 +1589,43 @@ void	isonbase (int refnum, char *args, void (*line) (int, char *, char *))
 	}
 }
 
+/*
+ * ison_entry_returned: Tell whoever asked for "new_i" that the nicks in
+ * "online" are on irc.  (The rest of the ones they asked about aren't.)
+ */
+static void	ison_entry_returned (int refnum, IsonEntry *new_i, const char *online)
+{
+	char	*do_off = NULL, *this1, *all1, *this2, *all2;
+
+	all1 = LOCAL_COPY(new_i->ison_asked);
+	all2 = LOCAL_COPY(online);
+	if (new_i->offcmd)
+		while ((this2 = next_arg(all2, &all2)))
+			while ((this1 = next_arg(all1, &all1)) && my_stricmp(this1, this2))
+				malloc_strcat_wordlist(&do_off, space, this1);
+	malloc_strcat_wordlist(&do_off, space, all1);
+
+	if (new_i->line) 
+	{
+		char *ison_ret = LOCAL_COPY(online);
+		new_i->line(refnum, new_i->ison_asked, ison_ret);
+	}
+	else
+	{
+		if (new_i->oncmd && *online)
+			call_lambda_command("ISON", new_i->oncmd, online);
+		if (new_i->offcmd && do_off && *do_off)
+			call_lambda_command("ISON", new_i->offcmd, do_off);
+		if (new_i->endcmd)
+			call_lambda_command("ISON", new_i->endcmd, NULL);
+		if (!new_i->oncmd && !new_i->offcmd &&
+				do_hook(current_numeric, "%s", online))
+			put_it("%s Currently online: %s", banner(), online);
+	}
+
+	new_free(&do_off);
+}
+
 /* 
  * ison_returned: this is called when numeric 303 is received in
  * numbers.c. ISON must always be the property of the WHOIS queue.
@@ -1431,7 +1635,8 @@ void	isonbase (int refnum, char *args, void (*line) (int, char *, char *))
 void	ison_returned (int refnum, const char *from, const char *comm, const char **ArgList)
 {
 	IsonEntry *new_i = ison_queue_top(refnum);
-	char	*do_off = NULL, *this1, *all1, *this2, *all2;
+	char	*online, *nick, *mine;
+	int	batched, piggyback;
 
 	if (!ArgList[0])
 		{ rfc1459_odd(from, comm, ArgList); return; }
@@ -1444,35 +1649,34 @@ void	ison_returned (int refnum, const char *from, const char *comm, const char *
 		return;
 	}
 
-	all1 = LOCAL_COPY(new_i->ison_asked);
-	all2 = LOCAL_COPY(ArgList[0]);
-	if (new_i->offcmd)
-		while ((this2 = next_arg(all2, &all2)))
-			while ((this1 = next_arg(all1, &all1)) && my_stricmp(this1, this2))
-				malloc_strcat_wordlist(&do_off, space, this1);
-	malloc_strcat_wordlist(&do_off, space, all1);
+	queue_reply_received(&get_server(refnum)->ison_stats, &new_i->sent_time);
 
 	PasteArgs(ArgList, 0);
-	if (new_i->line) 
-	{
-		char *ison_ret = LOCAL_COPY(ArgList[0]);
-		new_i->line(refnum, new_i->ison_asked, ison_ret);
-	}
-	else
+	batched = new_i->piggyback;
+	do
 	{
-		if (new_i->oncmd && ArgList[0] && ArgList[0][0])
-			call_lambda_command("ISON", new_i->oncmd, ArgList[0]);
-		if (new_i->offcmd && do_off && *do_off)
-			call_lambda_command("ISON", new_i->offcmd, do_off);
-		if (new_i->endcmd)
-			call_lambda_command("ISON", new_i->endcmd, NULL);
-		if (!new_i->oncmd && !new_i->offcmd &&
-				do_hook(current_numeric, "%s", ArgList[0]))
-			put_it("%s Currently online: %s", banner(), ArgList[0]);
+		if (!(new_i = ison_queue_top(refnum)))
+			break;
+		piggyback = new_i->piggyback;
+
+		/* If several ISONs went out together, pick out our nicks */
+		if (batched)
+		{
+			mine = NULL;
+			online = LOCAL_COPY(ArgList[0]);
+			while ((nick = next_arg(online, &online)))
+				if (queue_has_nick(new_i->ison_asked, nick, strlen(nick)))
+					malloc_strcat_wordlist(&mine, space, nick);
+			ison_entry_returned(refnum, new_i, mine ? mine : empty_string);
+			new_free(&mine);
+		}
+		else
+			ison_entry_returned(refnum, new_i, ArgList[0]);
+
+		ison_queue_pop(refnum);
 	}
+	while (piggyback);
 
-	new_free(&do_off);
-	ison_queue_pop(refnum);
 	ison_queue_send(refnum);
 	return;
 }
@@ -1529,11 +1733,20 @@ static void userhost_queue_add (int refnum, UserhostEntry *item)
 	return;
 }
 
+/*
+ * Send the next waiting USERHOST, unless there are already userhost_max
+ * of them waiting for an answer.  Like ISON, any other waiting USERHOSTs
+ * (of the same kind) that fit are sent along with it, up to the 5 nicks
+ * the server will answer for at once.
+ */
+#define USERHOST_MAX_NICKS	5
+
 static void userhost_queue_send (int refnum)
 {
-	int count = 1;
+	int count = 0;
 	Server *s;
-	UserhostEntry *save, *bottom;
+	UserhostEntry *save, *last, *bottom;
+	char *	query = NULL;
 
 	if (!(s = get_server(refnum)))
 		return;
@@ -1541,34 +1754,51 @@ static void userhost_queue_send (int refnum)
 	if (!(save = s->userhost_wait))
 		return;
 
-	bottom = s->userhost_queue;
-	while (bottom)
+	for (bottom = s->userhost_queue; bottom; bottom = bottom->next)
 	{
-		if (s->userhost_max && ++count > s->userhost_max)
-			return;
-		else if (bottom->next)
-			bottom = bottom->next;
-		else
+		if (!bottom->piggyback)
+			count++;
+		if (!bottom->next)
+			break;
+	}
+	if (s->userhost_max && count >= s->userhost_max)
+		return;
+
+	malloc_strcpy(&query, save->userhost_asked);
+	for (last = save; last->next; last = last->next)
+	{
+		if (last->next->format != save->format ||
+		    !last->next->userhost_asked ||
+		    !queue_can_add(query, last->next->userhost_asked, 
+					USERHOST_MAX_NICKS, 0))
 			break;
+		malloc_strcat_wordlist(&query, space, last->next->userhost_asked);
+		last->piggyback = 1;
 	}
 
-	s->userhost_wait = save->next;
+	s->userhost_wait = last->next;
 
 	if (bottom)
 		bottom->next = save;
 	else
 		s->userhost_queue = save;
 
-	save->next = NULL;
+	last->next = NULL;
 
-	send_to_aserver(refnum, save->format, save->userhost_asked);
+	get_time(&save->sent_time);
+	s->userhost_stats.sent++;
+	send_to_aserver(refnum, save->format, query);
+	new_free(&query);
 }
 
 static void userhost_entry_pop (UserhostEntry **entry)
 {
-	UserhostEntry *save = (*entry)->next;
+	UserhostEntry *save;
 
-	/* XXX But what if *entry is null? */
+	if (!*entry)
+		return;
+
+	save = (*entry)->next;
 	new_free(&(*entry)->userhost_asked);
 	new_free(&(*entry)->text);
 	new_free((char **)entry);
@@ -1604,6 +1834,9 @@ static UserhostEntry *get_new_userhost_entry (int refnum)
 	new_u->text = NULL;
 	new_u->next = NULL;
 	new_u->func = NULL;
+	new_u->piggyback = 0;
+	new_u->sent_time.tv_sec = 0;
+	new_u->sent_time.tv_usec = 0;
 	userhost_queue_add(refnum, new_u);
 	return new_u;
 }
@@ -1785,30 +2018,16 @@ void userhostbase (int refnum, char *args, const char *subargs, void (*line) (in
 	}
 }
 
-/* 
- * userhost_returned: this is called when numeric 302 is received in
- * numbers.c. USERHOST must always remain the property of the userhost
- * queue.  Sending out USERHOST requests to the server without going
- * through this queue will cause it to be corrupted and the client will
- * go higgledy-piggledy.
+/*
+ * userhost_entry_returned: Go through the nicks that "top" asked about,
+ * taking the ones that are on irc off the front of "results" (which
+ * is what is left of the 302 reply "reply").  Returns -1 if the reply
+ * doesn't make any sense.
  */
-void	userhost_returned (int refnum, const char *from, const char *comm, const char **ArgList)
+static int	userhost_entry_returned (int refnum, UserhostEntry *top, char **results, const char *reply)
 {
-	UserhostEntry *top = userhost_queue_top(refnum);
 	char *ptr;
-	char *results;
-
-	if (!ArgList[0])
-		{ rfc1459_odd(from, comm, ArgList); return; }
-
-	if (!top)
-	{
-		yell("### Please don't /quote a server command that returns the 302 numeric.");
-		return;
-	}
 
-	PasteArgs(ArgList, 0);
-	results = LOCAL_COPY(ArgList[0]);
 	ptr = top->userhost_asked;
 
 	/*
@@ -1831,22 +2050,21 @@ void	userhost_returned (int refnum, const char *from, const char *comm, const ch
 		 * part of ArgList, and the following char will
 		 * either be a * or an = (eg, nick*= or nick=)
 		 */
-		if (results && (!my_strnicmp(cnick, results, len)
-	            && (results[len] == '*' || results[len] == '=')))
+		if (*results && (!my_strnicmp(cnick, *results, len)
+	            && ((*results)[len] == '*' || (*results)[len] == '=')))
 		{
 			UserhostItem item;
 			char *nick, *user, *host;
 
 			/* Extract all the interesting info */
 			item.connected = 1;
-			nick = next_arg(results, &results);
+			nick = next_arg(*results, results);
 			user = strchr(nick, '=');
 			if (!user)
 			{
 				yell("Can't parse useless USERHOST reply [%s]", 
-						ArgList[0]);
-				userhost_queue_pop(refnum);
-				return;
+						reply);
+				return -1;
 			}
 
 			if (user[-1] == '*')
@@ -1869,9 +2087,8 @@ void	userhost_returned (int refnum, const char *from, const char *comm, const ch
 			if (!host)
 			{
 				yell("Can't parse useless USERHOST reply [%s]", 
-						ArgList[0]);
-				userhost_queue_pop(refnum);
-				return;
+						reply);
+				return -1;
 			}
 			*host++ = 0;
 
@@ -1937,7 +2154,61 @@ void	userhost_returned (int refnum, const char *from, const char *comm, const ch
 		}
 	}
 
-	userhost_queue_pop(refnum);
+	return 0;
+}
+
+/* 
+ * userhost_returned: this is called when numeric 302 is received in
+ * numbers.c. USERHOST must always remain the property of the userhost
+ * queue.  Sending out USERHOST requests to the server without going
+ * through this queue will cause it to be corrupted and the client will
+ * go higgledy-piggledy.
+ */
+void	userhost_returned (int refnum, const char *from, const char *comm, const char **ArgList)
+{
+	UserhostEntry *top = userhost_queue_top(refnum);
+	char *results;
+	int	piggyback;
+
+	if (!ArgList[0])
+		{ rfc1459_odd(from, comm, ArgList); return; }
+
+	if (!top)
+	{
+		yell("### Please don't /quote a server command that returns the 302 numeric.");
+		return;
+	}
+
+	queue_reply_received(&get_server(refnum)->userhost_stats, 
+				&top->sent_time);
+
+	PasteArgs(ArgList, 0);
+	results = LOCAL_COPY(ArgList[0]);
+
+	/*
+	 * If several USERHOSTs went out together, the answers to all 
+	 * of them are in this one reply, in the order we asked.
+	 */
+	do
+	{
+		if (!(top = userhost_queue_top(refnum)))
+			break;
+		piggyback = top->piggyback;
+
+		if (userhost_entry_returned(refnum, top, &results, ArgList[0]))
+		{
+			userhost_queue_pop(refnum);
+			while (piggyback && (top = userhost_queue_top(refnum)))
+			{
+				piggyback = top->piggyback;
+				userhost_queue_pop(refnum);
+			}
+			return;
+		}
+		userhost_queue_pop(refnum);
+	}
+	while (piggyback);
+
 	userhost_queue_send(refnum);
 }
 
@@ -7689,32 +7689,22 @@ regex_t *last_regex = NULL;
 
 static int	new_search_term (const char *arg)
 {
-	int	errcode;
+	char	errstr[1024];
 
 	if (last_regex)
 	{
 		debuglog("clearing last search term");
-		regfree(last_regex);
-	}
-	else
-	{
-		debuglog("Creating first search term");
-		last_regex = new_malloc(sizeof(*last_regex));
+		release_regex(last_regex);
 	}
 
-	memset(last_regex, 0, sizeof(*last_regex));
 	debuglog("compiling regex: %s", arg);
-	errcode = regcomp(last_regex, arg, 
-				REG_EXTENDED | REG_ICASE | REG_NOSUB);
-	if (errcode != 0)
+	last_regex = get_regex(arg, REG_EXTENDED | REG_ICASE | REG_NOSUB,
+				errstr, sizeof(errstr));
+	if (!last_regex)
 	{
-		char	errstr[1024];
-
-		regerror(errcode, last_regex, errstr, sizeof(errstr));
 		debuglog("regex compile failed: %s : %s", arg, errstr);
 		say("The regex [%s] isn't acceptable because [%s]", 
 				arg, errstr);
-		new_free((char **)&last_regex);
 		return -1;
 	}
 	debuglog("regex appeared to compile successfully");
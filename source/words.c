@@ -569,6 +569,99 @@ static int	move_to_next_word (const char **str, const char *start, int extended,
 	return 1;
 }
 
+/*
+ * The word index cache --
+ * Scripts tend to walk a long word list one word at a time, doing
+ * $word($i $list) or $restw($i $list) with the same list over and over.
+ * Walking to the 'i'th word each time makes such a loop O(n^2), so when
+ * someone skips a lot of words, we remember where every word in that
+ * string starts.  The next time we're asked about the same string (the
+ * same bytes, not the same pointer -- function args are always copies)
+ * we can jump straight to any word.
+ *
+ * Since entries are matched by content, an entry for a variable's old 
+ * value can't be used after the variable changes; it just falls out of 
+ * the cache as other strings are indexed.
+ */
+#define WORD_INDEX_MIN		16	/* Walk if skipping fewer words */
+#define WORD_INDEX_MINLEN	1024	/* Walk if counting a shorter string */
+#define WORD_INDEX_SLOTS	4
+
+typedef struct {
+	char *		string;		/* A copy of the string indexed */
+	size_t		len;		/* strlen(string) */
+	int		extended;	/* DWORD_YES or DWORD_NO */
+	char *		quotes;		/* The double quotes honored */
+	int		nwords;		/* Number of words in string */
+	size_t *	offsets;	/* Where each word starts */
+	unsigned long	last_used;
+} WordIndex;
+
+static	WordIndex	word_index[WORD_INDEX_SLOTS];
+static	unsigned long	word_index_clock = 0;
+
+/*
+ * Return the index of the word starts in 'start'.  offsets[i] is where
+ * move_to_next_word() would be after moving 'i' words from the start,
+ * for i = 0 .. nwords, and offsets[nwords] is the end of the string.
+ */
+static WordIndex *	get_word_index (const char *start, int extended, const char *quotes)
+{
+	WordIndex *	wi;
+	const char *	pointer;
+	size_t		len;
+	int		i, size;
+
+	CHECK_EXTENDED_SUPPORT
+	len = strlen(start);
+	quotes = nonull(quotes);
+
+	for (i = 0; i < WORD_INDEX_SLOTS; i++)
+	{
+		wi = &word_index[i];
+		if (wi->string && wi->len == len && 
+		    wi->extended == extended && !strcmp(wi->quotes, quotes) &&
+		    !memcmp(wi->string, start, len))
+		{
+			wi->last_used = ++word_index_clock;
+			return wi;
+		}
+	}
+
+	/* Replace the one that hasn't been used in the longest time */
+	wi = &word_index[0];
+	for (i = 1; i < WORD_INDEX_SLOTS; i++)
+		if (word_index[i].last_used < wi->last_used)
+			wi = &word_index[i];
+
+	new_free(&wi->string);
+	new_free(&wi->quotes);
+	new_free((char **)&wi->offsets);
+
+	size = 64;
+	RESIZE(wi->offsets, size_t, size);
+	wi->offsets[0] = 0;
+	wi->nwords = 0;
+	for (pointer = start; *pointer; )
+	{
+		move_to_next_word(&pointer, start, extended, quotes);
+		if (wi->nwords + 2 > size)
+		{
+			size *= 2;
+			RESIZE(wi->offsets, size_t, size);
+		}
+		wi->offsets[++wi->nwords] = pointer - start;
+	}
+
+	wi->string = new_malloc(len + 1);
+	memcpy(wi->string, start, len + 1);
+	wi->len = len;
+	wi->extended = extended;
+	wi->quotes = malloc_strdup(quotes);
+	wi->last_used = ++word_index_clock;
+	return wi;
+}
+
 /* 
  * 'real_move_to_abs_word' -- Find the start of the 'word'th word in 'start'.
  *
@@ -601,8 +694,20 @@ const char *	real_move_to_abs_word (const char *start, const char **mark, int wo
 	if (x_debug & DEBUG_EXTRACTW_DEBUG)
 		yell(">>>> real_move_to_abs_word: start [%s], count [%d], extended [%d], quotes [%s]", start, word, extended, quotes);
 
-	for (; counter > 0 && *pointer; counter--)
-		move_to_next_word(&pointer, start, extended, quotes);
+	if (counter >= WORD_INDEX_MIN && *pointer)
+	{
+		WordIndex *	wi;
+
+		wi = get_word_index(start, extended, quotes);
+		if (counter > wi->nwords)
+			counter = wi->nwords;
+		pointer = start + wi->offsets[counter];
+	}
+	else
+	{
+		for (; counter > 0 && *pointer; counter--)
+			move_to_next_word(&pointer, start, extended, quotes);
+	}
 
 	if (x_debug & DEBUG_EXTRACTW_DEBUG)
 		yell("<<<< real_move_to_abs_word: pointer [%s]", pointer);
@@ -620,6 +725,9 @@ int	count_words (const char *str, int extended, const char *quotes)
 	const char *	pointer = str;
 	int		counter = 0;
 
+	if (str && strlen(str) >= WORD_INDEX_MINLEN)
+		return get_word_index(str, extended, quotes)->nwords;
+
 	while (move_to_next_word(&pointer, str, extended, quotes))
 		counter++;
 